@@ -1,329 +1,325 @@
-/**
- * included by audio.h
- */
-
-#include <assert.h>
-#include <errno.h>
-#include <math.h>
-#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-
-#if DEBUG_TIMED
 #include <time.h>
-#endif
 
 #include <aaudio/AAudio.h>
 
-#include "audio.h"
 #include "config.h"
 #include "logging.h"
-#include "render.h"
+#include "sink.h"
 
 static const char *FILENAME = "aaudio_bind.c";
 
+struct aaudio_sink_t {
+    AAudioStream *_Nullable stream;
+    sink_pull_fn _Nullable pull;
+    sink_error_fn _Nullable error;
+    void *_Nullable user;
+};
+
 static int
-init_aaudio_fmt (int wav_fmt_code, int *fmt, size_t *siz)
+init_aaudio_fmt (int wav_fmt_code, int *fmt)
 {
     switch (wav_fmt_code) {
-        case 0:                           // U8
-        case 4:                           // DBL
-            *fmt = AAUDIO_FORMAT_INVALID; // -1
-            *siz = 0;
-            return NCAP_EGEN;
         case 1:                           // S16
             *fmt = AAUDIO_FORMAT_PCM_I16; // 1
-            *siz = 2;
-            return NCAP_OK;
+            return SINK_OK;
         case 2:                           // S32
             *fmt = AAUDIO_FORMAT_PCM_I32; // 4
-            *siz = 4;
-            return NCAP_OK;
+            return SINK_OK;
         case 3:                             // FLT
             *fmt = AAUDIO_FORMAT_PCM_FLOAT; // 2
-            *siz = 4;
-            return NCAP_OK;
+            return SINK_OK;
+        case 0: // U8
+        case 4: // DBL
         default:
-            *fmt = AAUDIO_FORMAT_UNSPECIFIED; // 0
-            *siz = 2;
-            return NCAP_EGEN;
+            *fmt = AAUDIO_FORMAT_INVALID; // -1
+            return SINK_ERR;
     }
 }
 
-const float STEVENS_a_RECIP = 0.67f;
+/** the sink's pull function behind AAudio's real-time thread */
+static aaudio_data_callback_result_t
+data_cb (AAudioStream *stream, void *user, void *audio, int32_t nframes)
+{
+    (void)stream;
+
+    const struct aaudio_sink_t *as = user;
+
+    as->pull (as->user, audio, nframes);
+
+    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
 
 /**
- * scales a buffer using volume and specific volume in `ncap_config`.
- * `psi(I) + n = psi(kI)` => `k = (n/I^a + 1)^(1/a)`.
- * k in `[0, 1]` => n in `[-I^a, 0]`.
- * decreases by -I^a/10 every time (proportional to intensity).
- *
- * stevens's power law: `https://en.wikipedia.org/wiki/Stevens%27s_power_law`.
+ * on a thread of AAudio's once the stream fails. the stream must not be
+ * closed from here, so the sink's owner is told and closes it
  */
 static void
-sclbuf (void *buf, const aaudio_format_t fmt, const size_t width, size_t len,
-        uint8_t svol)
+error_cb (AAudioStream *stream, void *user, aaudio_result_t error)
 {
-    int     pth_ret;
-    uint8_t vol;
-    config_get (vol, volume, pth_ret);
-
-    float scl;
-
-    if (pth_ret == 0) {
-        scl = powf ((vol * svol) / 10000.0f, STEVENS_a_RECIP);
-    } else {
-        logwf ("WARN: config_get failed with error code %d: %s. Dropping "
-               "frame...",
-               pth_ret, strerror (pth_ret));
-        scl = 0;
-    }
+    (void)stream;
 
-    for (; len--; buf += width) {
-        switch (fmt) {
-            case AAUDIO_FORMAT_PCM_I16:
-                *(int16_t *)buf *= scl;
-                break;
-            case AAUDIO_FORMAT_PCM_I32:
-                *(int32_t *)buf *= scl;
-                break;
-            case AAUDIO_FORMAT_PCM_FLOAT:
-                *(float *)buf *= scl;
-                break;
-            case AAUDIO_FORMAT_INVALID:
-            default:
-                return;
-        }
-    }
-}
+    const struct aaudio_sink_t *as = user;
 
-pthread_mutex_t audio_mx     = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t  audio_cv     = PTHREAD_COND_INITIALIZER;
-bool            audio_isplay = false;
+    logwf ("AAudio stream failed with code %d", error);
 
-pthread_mutex_t audio_int_mx = PTHREAD_MUTEX_INITIALIZER;
-bool            audio_int    = false;
+    as->error (as->user,
+               error == AAUDIO_ERROR_DISCONNECTED ? SINK_EDISC : SINK_ERR);
+}
 
-int
-audio_play (const char *fn, size_t idx)
+static int
+aaudio_open (struct sink_t *this, const struct sink_cfg_t *cfg)
 {
-    FILE *fp = fopen (fn, "rb");
+    int fmt;
 
-    if (fp == NULL) {
-        logef ("Failed to open file `%s': error: %s", fn, strerror (errno));
-        return NCAP_EIO;
+    if (init_aaudio_fmt (cfg->fmt, &fmt) != SINK_OK) {
+        logef ("ERROR: no AAudio format for WAV format %d", cfg->fmt);
+        return SINK_ERR;
     }
 
-    logif ("Opened file `%s'", fn);
+    logvf ("Using AAudio format with code %d", fmt);
 
-    struct cwav_header_t header;
-    fread (&header, CWAV_HEADER_SIZ, 1, fp);
+    struct aaudio_sink_t *as = calloc (1, sizeof *as);
 
-    // clang-format off
-    logvf ("WAV header RIFF:\t%.4s",          header.riff.ckID);
-    logvf ("WAV header file size:\t%u",       header.riff.cksize);
-    logvf ("WAV header WAVE:\t%.4s",          header.riff.WAVEID);
-    logvf ("WAV header fmt :\t%.4s",          header.fmt.ckID);
-    logvf ("WAV header block size:\t%u",      header.fmt.cksize);
-    logvf ("WAV header audio fmt:\t%u",       header.fmt.wFormatTag);
-    logvf ("WAV header channels:\t%u",        header.fmt.nChannels);
-    logvf ("WAV header sample rate:\t%u",     header.fmt.nSamplesPerSec);
-    logvf ("WAV header byte rate:\t%u",       header.fmt.nAvgBytesPerSec);
-    logvf ("WAV header block alignment:\t%u", header.fmt.nBlockAlign);
-    logvf ("WAV header bits per sample:\t%u", header.fmt.wBitsPerSample);
-    logvf ("WAV header data:\t%.4s",          header.data.ckID);
-    logvf ("WAV header data size:\t%u",       header.data.cksize);
-    // clang-format on
+    if (as == NULL)
+        return SINK_EMEM;
 
-    // stream builder
-
-    const uint64_t nstimeout   = 1000000000;
-    const uint32_t channels    = header.fmt.nChannels;
-    const uint32_t sample_rate = header.fmt.nSamplesPerSec;
+    as->pull  = cfg->pull;
+    as->error = cfg->error;
+    as->user  = cfg->user;
 
     AAudioStreamBuilder *builder;
-    aaudio_result_t      res = AAudio_createStreamBuilder (&builder);
-
-    // init aaudio setup data
-    int    AAUDIO_FMT;
-    size_t PCM_DATA_WIDTH;
-    int    stat = init_aaudio_fmt (header.fmt.wFormatTag, &AAUDIO_FMT,
-                                   &PCM_DATA_WIDTH);
 
-    if (stat < 0) {
-        logef ("ERROR: init_aaudio_fmt failed with code %d\n", stat);
-        return NCAP_EGEN;
+    if (AAudio_createStreamBuilder (&builder) != AAUDIO_OK) {
+        loge ("AAudio createStreamBuilder failed");
+        free (as);
+        return SINK_ERR;
     }
 
-    logif ("Using AAudio format with code %d", AAUDIO_FMT);
-    logif ("Using PCM data width of %zu", PCM_DATA_WIDTH);
-
-    if (AAUDIO_FMT == AAUDIO_FORMAT_UNSPECIFIED)
-        logw ("WARN: using AAUDIO_FORMAT_UNSPECIFIED");
+    AAudioStreamBuilder_setFormat (builder, fmt);
+    AAudioStreamBuilder_setChannelCount (builder, cfg->channels);
+    AAudioStreamBuilder_setSampleRate (builder, cfg->sample_rate);
+    AAudioStreamBuilder_setPerformanceMode (builder, to_aaudio_pm (cfg->perf));
 
-    AAudioStreamBuilder_setFormat (builder, AAUDIO_FMT);
-    AAudioStreamBuilder_setChannelCount (builder, channels);
-    AAudioStreamBuilder_setSampleRate (builder, sample_rate);
-    AAudioStreamBuilder_setPerformanceMode (
-        builder, to_aaudio_pm (ncap_config.aaudio_optimize));
+    if (cfg->pull != NULL)
+        AAudioStreamBuilder_setDataCallback (builder, data_cb, as);
 
-    // stream
+    if (cfg->error != NULL)
+        AAudioStreamBuilder_setErrorCallback (builder, error_cb, as);
 
-    AAudioStream *stream;
-    res = AAudioStreamBuilder_openStream (builder, &stream);
+    aaudio_result_t res
+        = AAudioStreamBuilder_openStream (builder, &as->stream);
     AAudioStreamBuilder_delete (builder);
 
     if (res != AAUDIO_OK) {
-        loge ("AAudio openStream failed");
-        return NCAP_EGEN;
+        logef ("AAudio openStream failed with code %d", res);
+        free (as);
+        return SINK_ERR;
     }
 
-    const int32_t frames_per_burst = AAudioStream_getFramesPerBurst (stream);
-    const int32_t buf_cap = AAudioStream_getBufferCapacityInFrames (stream);
-    int32_t       buf_siz = AAudioStream_getBufferSizeInFrames (stream);
+    this->impl   = as;
+    this->burst  = AAudioStream_getFramesPerBurst (as->stream);
+    this->cap    = AAudioStream_getBufferCapacityInFrames (as->stream);
+    this->device = AAudioStream_getDeviceId (as->stream);
 
     // clang-format off
-    logvf ("device id: %d",        AAudioStream_getDeviceId (stream));
-    logvf ("direction: %d",        AAudioStream_getDirection (stream));
-    logvf ("sharing mode: %d",     AAudioStream_getSharingMode (stream));
-    logvf ("stream channels: %d",  channels);
-    logvf ("frames_per_burst: %d", frames_per_burst);
-    logvf ("sample_rate: %d",      sample_rate);
-    logvf ("buf_cap: %d",          buf_cap);
-    logvf ("buf_siz: %d",          buf_siz);
+    logvf ("device id: %d",    this->device);
+    logvf ("direction: %d",    AAudioStream_getDirection (as->stream));
+    logvf ("sharing mode: %d", AAudioStream_getSharingMode (as->stream));
     // clang-format on
 
-    AAudioStream_requestStart (stream);
-    aaudio_stream_state_t state = AAUDIO_STREAM_STATE_UNINITIALIZED;
-    res                         = AAudioStream_waitForStateChange (
-        stream, AAUDIO_STREAM_STATE_STARTING, &state, nstimeout);
+    return SINK_OK;
+}
+
+static void
+aaudio_close (struct sink_t *this)
+{
+    struct aaudio_sink_t *as = this->impl;
+
+    if (as == NULL)
+        return;
 
-    const size_t buflen      = frames_per_burst * channels;
-    void        *buf         = malloc (buflen * PCM_DATA_WIDTH);
-    int32_t      prev_ur_cnt = 0;
+    // the callback is not called after the close
+    if (AAudioStream_close (as->stream) != AAUDIO_OK)
+        loge ("AAudio failed to close");
+    else
+        logi ("AAudio stream closed.");
 
-#if DEBUG_TIMED
-    const time_t timer_start = time (NULL);
-    const time_t dur         = 5;
-#endif
+    free (as);
+    this->impl = NULL;
+}
 
-    logi ("Stream started. Playing audio...");
+static int
+aaudio_start (struct sink_t *this)
+{
+    const uint64_t        nstimeout = 1000000000;
+    struct aaudio_sink_t *as        = this->impl;
 
-    int      pth_ret;
-    int      ret = NCAP_OK;
-    uint8_t *vols;
+    AAudioStream_requestStart (as->stream);
+    aaudio_stream_state_t state = AAUDIO_STREAM_STATE_UNINITIALIZED;
+
+    return AAudioStream_waitForStateChange (
+               as->stream, AAUDIO_STREAM_STATE_STARTING, &state, nstimeout)
+                   == AAUDIO_OK
+               ? SINK_OK
+               : SINK_ERR;
+}
 
-#if DEBUG_TIMED
-#define AUDIO_STOP_COND                                                       \
-    (res >= AAUDIO_OK && !feof (fp) && time (NULL) - timer_start < dur)
-#else
-#define AUDIO_STOP_COND (res >= AAUDIO_OK && !feof (fp))
-#endif
+/** waits for the pause to take, as a flush needs it */
+static int
+aaudio_pause (struct sink_t *this)
+{
+    const uint64_t              nstimeout = 1000000000;
+    const struct aaudio_sink_t *as        = this->impl;
 
-    while (AUDIO_STOP_COND) {
-        // check for interrupt
+    if (AAudioStream_requestPause (as->stream) != AAUDIO_OK)
+        return SINK_ERR;
 
-        if ((pth_ret = pthread_mutex_lock (&audio_int_mx)) != 0) {
-            logef ("ERROR: pthread_mutex_lock on audio_mx failed with error "
-                   "code %d: %s. stopping playback...",
-                   pth_ret, strerror (pth_ret));
-            break;
-        }
+    aaudio_stream_state_t state = AAUDIO_STREAM_STATE_UNINITIALIZED;
 
-        if (audio_int) {
-            audio_int = false;
-            ret       = NCAP_INT;
-            pthread_mutex_unlock (&audio_int_mx);
-            break;
-        }
+    return AAudioStream_waitForStateChange (
+               as->stream, AAUDIO_STREAM_STATE_PAUSING, &state, nstimeout)
+                   == AAUDIO_OK
+               ? SINK_OK
+               : SINK_ERR;
+}
 
-        pthread_mutex_unlock (&audio_int_mx);
+static int
+aaudio_stop (struct sink_t *this)
+{
+    const uint64_t              nstimeout = 1000000000;
+    const struct aaudio_sink_t *as        = this->impl;
 
-        // check for pause (playback control)
+    AAudioStream_requestStop (as->stream);
+    aaudio_stream_state_t state = AAUDIO_STREAM_STATE_UNINITIALIZED;
+    aaudio_result_t       res   = AAudioStream_waitForStateChange (
+        as->stream, AAUDIO_STREAM_STATE_STOPPING, &state, nstimeout);
 
-        if ((pth_ret = pthread_mutex_lock (&audio_mx)) != 0) {
-            logef ("ERROR: pthread_mutex_lock on audio_mx failed with error "
-                   "code %d: %s. stopping playback...",
-                   pth_ret, strerror (pth_ret));
-            break;
-        }
+    if (res != AAUDIO_OK) {
+        loge ("AAudio failed to stop. Closing anyway...");
+        return SINK_ERR;
+    }
 
-        if (!audio_isplay)
-            logi ("audio_isplay = false. waiting for audio_cv...");
+    logi ("AAudio stream stopped.");
 
-        while (!audio_isplay)
-            pthread_cond_wait (&audio_cv, &audio_mx);
+    return SINK_OK;
+}
 
-        pthread_mutex_unlock (&audio_mx);
+static long
+aaudio_flush (struct sink_t *this)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-        // check for window close
+    // the read position stands still while paused
+    const int64_t dropped = AAudioStream_getFramesWritten (as->stream)
+                            - AAudioStream_getFramesRead (as->stream);
 
-        if (render_closing_nb ()) {
-            logi ("stopping playback...; wclose = true");
-            break;
-        }
+    if (AAudioStream_requestFlush (as->stream) != AAUDIO_OK) {
+        loge ("AAudio failed to flush");
+        return SINK_ERR;
+    }
 
-        // play
+    return dropped > 0 ? dropped : 0;
+}
 
-        if (fread (buf, PCM_DATA_WIDTH, buflen, fp) <= 0)
-            logw ("WARN: fread returned with code <= 0");
+static long
+aaudio_write (struct sink_t *this, const void *buf, size_t nframes,
+              uint64_t timeout_ns)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-        config_get (vols, track_vols, pth_ret);
+    aaudio_result_t res
+        = AAudioStream_write (as->stream, buf, nframes, timeout_ns);
 
-        sclbuf (buf, AAUDIO_FMT, PCM_DATA_WIDTH, buflen,
-                pth_ret == 0 ? vols[idx] : 100);
-        res = AAudioStream_write (stream, buf, frames_per_burst, nstimeout);
+    if (res >= AAUDIO_OK)
+        return res;
 
-        if (buf_siz < buf_cap) {
-            int32_t ur_cnt = AAudioStream_getXRunCount (stream);
+    logef ("AAudioStream_write failed with code %d", res);
 
-            logdf ("underruns: %d", ur_cnt);
+    return res == AAUDIO_ERROR_DISCONNECTED ? SINK_EDISC : SINK_ERR;
+}
 
-            if (ur_cnt > prev_ur_cnt) {
-                prev_ur_cnt = ur_cnt;
-                buf_siz     = AAudioStream_setBufferSizeInFrames (
-                    stream, buf_siz + frames_per_burst);
-            }
-        }
+static int
+aaudio_state (struct sink_t *this)
+{
+    const struct aaudio_sink_t *as = this->impl;
+
+    switch (AAudioStream_getState (as->stream)) {
+        case AAUDIO_STREAM_STATE_STARTING:
+        case AAUDIO_STREAM_STATE_STARTED:
+            return SINK_STARTED;
+        case AAUDIO_STREAM_STATE_PAUSING:
+        case AAUDIO_STREAM_STATE_PAUSED:
+            return SINK_PAUSED;
+        case AAUDIO_STREAM_STATE_DISCONNECTED:
+            return SINK_DISCONNECTED;
+        default:
+            return SINK_STOPPED;
     }
+}
 
-    if (res < AAUDIO_OK)
-        logef ("Write loop stopped due to AAudio error with code %d.", res);
+static int32_t
+aaudio_xruns (struct sink_t *this)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-    // deinit
+    return AAudioStream_getXRunCount (as->stream);
+}
 
-    free (buf);
-    fclose (fp);
+static int32_t
+aaudio_get_buf (struct sink_t *this)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-#if DEBUG_TIMED
-    logif ("Audio play ended after %u secs. Stopping stream...",
-           (uint32_t)dur);
-#else
-    logi ("audio play ended");
-#endif
+    return AAudioStream_getBufferSizeInFrames (as->stream);
+}
 
-    AAudioStream_requestStop (stream);
-    state = AAUDIO_STREAM_STATE_UNINITIALIZED;
-    res   = AAudioStream_waitForStateChange (
-        stream, AAUDIO_STREAM_STATE_STOPPING, &state, nstimeout);
+static int32_t
+aaudio_set_buf (struct sink_t *this, int32_t siz)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-    if (res != AAUDIO_OK)
-        loge ("AAudio failed to stop. Closing anyway...");
-    else
-        logi ("AAudio stream stopped.");
+    return AAudioStream_setBufferSizeInFrames (as->stream, siz);
+}
+
+static int
+aaudio_timestamp (struct sink_t *this, int64_t *frames, int64_t *ns)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-    res = AAudioStream_close (stream);
+    return AAudioStream_getTimestamp (as->stream, CLOCK_MONOTONIC, frames, ns)
+                   == AAUDIO_OK
+               ? SINK_OK
+               : SINK_ERR;
+}
 
-    if (res != AAUDIO_OK) {
-        loge ("AAudio failed to close");
-        return NCAP_EGEN;
-    }
+static int
+aaudio_counters (struct sink_t *this, int64_t *written, int64_t *read)
+{
+    const struct aaudio_sink_t *as = this->impl;
 
-    logi ("AAudio stream closed.");
+    *written = AAudioStream_getFramesWritten (as->stream);
+    *read    = AAudioStream_getFramesRead (as->stream);
 
-    return ret;
+    return *written >= 0 && *read >= 0 ? SINK_OK : SINK_ERR;
 }
+
+const struct sink_ops_t sink_aaudio = {
+    .name      = "aaudio",
+    .open      = aaudio_open,
+    .close     = aaudio_close,
+    .start     = aaudio_start,
+    .pause     = aaudio_pause,
+    .stop      = aaudio_stop,
+    .flush     = aaudio_flush,
+    .write     = aaudio_write,
+    .state     = aaudio_state,
+    .xruns     = aaudio_xruns,
+    .get_buf   = aaudio_get_buf,
+    .set_buf   = aaudio_set_buf,
+    .timestamp = aaudio_timestamp,
+    .counters  = aaudio_counters,
+};
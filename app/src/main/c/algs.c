@@ -8,7 +8,7 @@
 void
 memswp (void *restrict p1, void *restrict p2, size_t width)
 {
-    void    *tmp;
+    uint8_t  tmp[64];
     uint64_t u64tmp;
 
     switch (width) {
@@ -33,11 +33,15 @@ memswp (void *restrict p1, void *restrict p2, size_t width)
             *(uint64_t *)p2 = u64tmp;
             break;
         default:
-            tmp = malloc (width);
-            memcpy (tmp, p1, width);
-            memcpy (p1, p2, width);
-            memcpy (p2, tmp, width);
-            free (tmp);
+            // a piece at a time through the stack, however wide
+            for (size_t off = 0; off < width; off += sizeof tmp) {
+                const size_t n
+                    = width - off < sizeof tmp ? width - off : sizeof tmp;
+
+                memcpy (tmp, (uint8_t *)p1 + off, n);
+                memcpy ((uint8_t *)p1 + off, (uint8_t *)p2 + off, n);
+                memcpy ((uint8_t *)p2 + off, tmp, n);
+            }
     }
 }
 
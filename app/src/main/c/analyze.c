@@ -0,0 +1,510 @@
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "analyze.h"
+#include "logging.h"
+#include "spscq.h"
+#include "thrctl.h"
+#include "trackdb.h"
+
+static const char *FILENAME = "analyze.c";
+
+/** blocks in flight to the worker thread, at most */
+#define ANALYZE_NBLKS 16
+
+struct analyze_blk_t {
+    float *buf;
+    size_t cap; // frames
+    size_t nframes;
+};
+
+// peak
+
+struct peak_state_t {
+    uint32_t channels;
+    float    peak;
+    uint64_t clipped;
+};
+
+static void
+peak_init (void *state, uint32_t sample_rate, uint32_t channels)
+{
+    (void)sample_rate;
+
+    *(struct peak_state_t *)state
+        = (struct peak_state_t){ .channels = channels };
+}
+
+static void
+peak_process (void *state, const float *buf, size_t nframes)
+{
+    struct peak_state_t *st      = state;
+    const size_t         n       = nframes * st->channels;
+    float                peak    = st->peak;
+    uint64_t             clipped = 0;
+    size_t               i       = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t one = vdupq_n_f32 (1.0f);
+    float32x4_t       vmax = vdupq_n_f32 (0);
+    uint32x4_t        vclip = vdupq_n_u32 (0);
+
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t a = vabsq_f32 (vld1q_f32 (buf + i));
+
+        vmax  = vmaxq_f32 (vmax, a);
+        vclip = vsubq_u32 (vclip, vcgeq_f32 (a, one)); // mask is ~0 = -1
+    }
+
+    float    m[4];
+    uint32_t c[4];
+    vst1q_f32 (m, vmax);
+    vst1q_u32 (c, vclip);
+#elif defined(__SSE2__)
+    const __m128 one   = _mm_set1_ps (1.0f);
+    const __m128 absm  = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+    __m128       vmax  = _mm_setzero_ps ();
+    __m128i      vclip = _mm_setzero_si128 ();
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 a = _mm_and_ps (_mm_loadu_ps (buf + i), absm);
+
+        vmax  = _mm_max_ps (vmax, a);
+        vclip = _mm_sub_epi32 (vclip,
+                               _mm_castps_si128 (_mm_cmpge_ps (a, one)));
+    }
+
+    float    m[4];
+    uint32_t c[4];
+    _mm_storeu_ps (m, vmax);
+    _mm_storeu_si128 ((__m128i *)c, vclip);
+#endif
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+    for (int k = 0; k < 4; ++k) {
+        peak = m[k] > peak ? m[k] : peak;
+        clipped += c[k];
+    }
+#endif
+
+    for (; i < n; ++i) {
+        const float a = fabsf (buf[i]);
+
+        peak = a > peak ? a : peak;
+        clipped += a >= 1.0f;
+    }
+
+    st->peak = peak;
+    st->clipped += clipped;
+}
+
+static uint16_t
+peak_finalize (void *state, void *res)
+{
+    const struct peak_state_t  *st = state;
+    const struct analyze_peak_t r  = {
+         .peak    = st->peak,
+         .clipped = st->clipped,
+    };
+
+    memcpy (res, &r, sizeof r);
+    return sizeof r;
+}
+
+const struct analyzer_t analyzer_peak = {
+    .name      = "peak",
+    .tag       = ANALYZE_PEAK_TAG,
+    .ver       = ANALYZE_PEAK_VER,
+    .state_siz = sizeof (struct peak_state_t),
+    .init      = peak_init,
+    .process   = peak_process,
+    .finalize  = peak_finalize,
+};
+
+// rms
+
+struct rms_state_t {
+    uint32_t channels;
+    double   sum;
+    uint64_t n;
+};
+
+static void
+rms_init (void *state, uint32_t sample_rate, uint32_t channels)
+{
+    (void)sample_rate;
+
+    *(struct rms_state_t *)state
+        = (struct rms_state_t){ .channels = channels };
+}
+
+static void
+rms_process (void *state, const float *buf, size_t nframes)
+{
+    struct rms_state_t *st  = state;
+    const size_t        n   = nframes * st->channels;
+    float               sum = 0;
+    size_t              i   = 0;
+
+    // float per block is fine since blocks are short; the running total is
+    // double
+
+#if defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32 (0);
+
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vld1q_f32 (buf + i);
+        acc                 = vmlaq_f32 (acc, v, v);
+    }
+
+    float a[4];
+    vst1q_f32 (a, acc);
+    sum = a[0] + a[1] + a[2] + a[3];
+#elif defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps ();
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps (buf + i);
+        acc            = _mm_add_ps (acc, _mm_mul_ps (v, v));
+    }
+
+    float a[4];
+    _mm_storeu_ps (a, acc);
+    sum = a[0] + a[1] + a[2] + a[3];
+#endif
+
+    for (; i < n; ++i)
+        sum += buf[i] * buf[i];
+
+    st->sum += sum;
+    st->n += n;
+}
+
+static uint16_t
+rms_finalize (void *state, void *res)
+{
+    const struct rms_state_t  *st = state;
+    const struct analyze_rms_t r  = {
+         .rms_db = st->n ? 10 * log10 (st->sum / st->n) : -INFINITY,
+    };
+
+    memcpy (res, &r, sizeof r);
+    return sizeof r;
+}
+
+const struct analyzer_t analyzer_rms = {
+    .name      = "rms",
+    .tag       = ANALYZE_RMS_TAG,
+    .ver       = ANALYZE_RMS_VER,
+    .state_siz = sizeof (struct rms_state_t),
+    .init      = rms_init,
+    .process   = rms_process,
+    .finalize  = rms_finalize,
+};
+
+// registry
+
+static const struct analyzer_t *registry[ANALYZE_MAX] = {
+    &analyzer_peak,
+    &analyzer_rms,
+};
+
+static size_t nregistry = 2;
+
+int
+analyze_register (const struct analyzer_t *an)
+{
+    if (nregistry == ANALYZE_MAX)
+        return ANALYZE_ERR;
+
+    registry[nregistry++] = an;
+
+    return ANALYZE_OK;
+}
+
+const struct analyzer_t *const *
+analyze_registered (size_t *n)
+{
+    *n = nregistry;
+    return registry;
+}
+
+// driver
+
+static void
+process (struct analyze_t *this, const float *buf, size_t nframes)
+{
+    for (size_t i = 0; i < this->n; ++i)
+        this->an[i]->process (this->state[i], buf, nframes);
+}
+
+static void
+s16_to_flt (float *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t scl = vdupq_n_f32 (1.0f / 32768);
+
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v  = vld1q_s16 (src + i);
+        const int32x4_t lo = vmovl_s16 (vget_low_s16 (v));
+        const int32x4_t hi = vmovl_s16 (vget_high_s16 (v));
+
+        vst1q_f32 (dst + i, vmulq_f32 (vcvtq_f32_s32 (lo), scl));
+        vst1q_f32 (dst + i + 4, vmulq_f32 (vcvtq_f32_s32 (hi), scl));
+    }
+#elif defined(__SSE2__)
+    const __m128 scl = _mm_set1_ps (1.0f / 32768);
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+        // sign extend by unpacking into the high halves
+        const __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+        const __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+        _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (lo), scl));
+        _mm_storeu_ps (dst + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scl));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] * (1.0f / 32768);
+}
+
+/** converts `n` samples to float in `dst` */
+static void
+to_float (float *dst, const void *buf, int fmt, size_t n)
+{
+    switch (fmt) {
+        case 1: // S16
+            s16_to_flt (dst, buf, n);
+            break;
+        case 2: { // S32
+            const int32_t *src = buf;
+
+            for (size_t i = 0; i < n; ++i)
+                dst[i] = src[i] * (1.0f / 2147483648.0f);
+
+            break;
+        }
+        case 3: // FLT
+            memcpy (dst, buf, n * sizeof *dst);
+            break;
+    }
+}
+
+static void *
+tfn_analyze (void *arg)
+{
+    struct analyze_t     *this = arg;
+    struct analyze_blk_t *blk;
+
+    thrctl_apply (THRCTL_ANALYSIS);
+
+    while ((blk = spscq_pop (&this->full)) != NULL) {
+        process (this, blk->buf, blk->nframes);
+
+        // `empty` has room for every block there is
+        spscq_trypush (&this->empty, blk);
+    }
+
+    return NULL;
+}
+
+/** producer side. recycled block, new block, or waits for the worker */
+static struct analyze_blk_t *
+blk_get (struct analyze_t *this, size_t nframes)
+{
+    struct analyze_blk_t *blk = spscq_trypop (&this->empty);
+
+    if (blk == NULL) {
+        if (this->nblks < ANALYZE_NBLKS) {
+            if ((blk = calloc (1, sizeof *blk)) == NULL)
+                return NULL;
+
+            ++this->nblks;
+        } else if ((blk = spscq_pop (&this->empty)) == NULL) {
+            return NULL;
+        }
+    }
+
+    if (blk->cap < nframes) {
+        float *tmp
+            = realloc (blk->buf, nframes * this->channels * sizeof *tmp);
+
+        if (tmp == NULL) {
+            free (blk->buf);
+            free (blk);
+            --this->nblks;
+            return NULL;
+        }
+
+        blk->buf = tmp;
+        blk->cap = nframes;
+    }
+
+    return blk;
+}
+
+static void
+blk_freeall (struct spscq_t *q)
+{
+    for (struct analyze_blk_t *blk; (blk = spscq_trypop (q)) != NULL;) {
+        free (blk->buf);
+        free (blk);
+    }
+}
+
+static void
+stop_worker (struct analyze_t *this)
+{
+    if (!this->threaded)
+        return;
+
+    spscq_close (&this->full);
+    pthread_join (this->tid, NULL);
+
+    blk_freeall (&this->full);
+    blk_freeall (&this->empty);
+    spscq_deinit (&this->full);
+    spscq_deinit (&this->empty);
+
+    this->threaded = false;
+}
+
+int
+analyze_begin (struct analyze_t *this, uint64_t key,
+               const struct analyzer_t *const *an, size_t n,
+               uint32_t sample_rate, uint32_t channels, bool threaded)
+{
+    memset (this, 0, sizeof *this);
+    this->sample_rate = sample_rate;
+    this->channels    = channels;
+
+    uint8_t res[ANALYZE_RES_MAX];
+
+    for (size_t i = 0; i < n && this->n < ANALYZE_MAX; ++i) {
+        if (trackdb_get (key, an[i]->tag, an[i]->ver, res, sizeof res) >= 0)
+            continue;
+
+        if ((this->state[this->n] = malloc (an[i]->state_siz)) == NULL)
+            goto err;
+
+        an[i]->init (this->state[this->n], sample_rate, channels);
+        this->an[this->n++] = an[i];
+    }
+
+    if (this->n == 0 || !threaded)
+        return ANALYZE_OK;
+
+    if (spscq_init (&this->full, ANALYZE_NBLKS) != SPSCQ_OK)
+        goto err;
+
+    if (spscq_init (&this->empty, ANALYZE_NBLKS) != SPSCQ_OK) {
+        spscq_deinit (&this->full);
+        goto err;
+    }
+
+    int pth_ret;
+
+    if ((pth_ret = pthread_create (&this->tid, NULL, tfn_analyze, this))
+        != 0) {
+        logwf ("WARN: pthread_create failed: %s. analyzing inline",
+               strerror (pth_ret));
+        spscq_deinit (&this->full);
+        spscq_deinit (&this->empty);
+        return ANALYZE_OK;
+    }
+
+    this->threaded = true;
+
+    return ANALYZE_OK;
+
+err:
+    for (size_t i = 0; i < this->n; ++i)
+        free (this->state[i]);
+
+    this->n = 0;
+
+    return ANALYZE_EMEM;
+}
+
+int
+analyze_feed (struct analyze_t *this, const void *buf, int fmt,
+              size_t nframes)
+{
+    if (this->n == 0 || fmt < 1 || fmt > 3)
+        return ANALYZE_OK;
+
+    const size_t nsamples = nframes * this->channels;
+
+    if (this->threaded) {
+        struct analyze_blk_t *blk = blk_get (this, nframes);
+
+        if (blk == NULL)
+            return ANALYZE_EMEM;
+
+        to_float (blk->buf, buf, fmt, nsamples);
+        blk->nframes = nframes;
+
+        return spscq_push (&this->full, blk) == SPSCQ_OK ? ANALYZE_OK
+                                                         : ANALYZE_ERR;
+    }
+
+    // float input is processed in place
+    if (fmt == 3) {
+        process (this, buf, nframes);
+        return ANALYZE_OK;
+    }
+
+    if (this->fbuf_siz < nsamples) {
+        float *tmp = realloc (this->fbuf, nsamples * sizeof *tmp);
+
+        if (tmp == NULL)
+            return ANALYZE_EMEM;
+
+        this->fbuf     = tmp;
+        this->fbuf_siz = nsamples;
+    }
+
+    to_float (this->fbuf, buf, fmt, nsamples);
+    process (this, this->fbuf, nframes);
+
+    return ANALYZE_OK;
+}
+
+void
+analyze_end (struct analyze_t *this, uint64_t key, bool store)
+{
+    stop_worker (this);
+
+    uint8_t res[ANALYZE_RES_MAX];
+
+    for (size_t i = 0; i < this->n; ++i) {
+        if (store) {
+            const uint16_t len = this->an[i]->finalize (this->state[i], res);
+
+            trackdb_put (key, this->an[i]->tag, this->an[i]->ver, res, len);
+            logvf ("stored %s analysis (%u bytes)", this->an[i]->name, len);
+        }
+
+        free (this->state[i]);
+    }
+
+    free (this->fbuf);
+    memset (this, 0, sizeof *this);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spscq.h"
+#include "trackdb.h"
+
+/**
+ * single-pass per-track analysis. every registered analyzer sees each
+ * decoded block once, as interleaved float, and finally serializes a small
+ * result that is stored in the trackdb under its tag and version. tracks
+ * that already have a current result are not analyzed again.
+ */
+
+#define ANALYZE_OK   0
+#define ANALYZE_ERR  -1
+#define ANALYZE_EMEM -2
+
+/** analyzers registered at once, at most */
+#define ANALYZE_MAX 8
+
+/** largest serialized result */
+#define ANALYZE_RES_MAX 256
+
+struct analyzer_t {
+    const char *_Nonnull name;
+    uint32_t tag; // trackdb tag of the result
+    uint16_t ver; // bump when the result layout or meaning changes
+    size_t   state_siz;
+
+    void (*_Nonnull init) (void *_Nonnull state, uint32_t sample_rate,
+                           uint32_t channels);
+
+    /** `nframes` interleaved frames in [-1, 1] */
+    void (*_Nonnull process) (void *_Nonnull state,
+                              const float *_Nonnull buf, size_t nframes);
+
+    /** @return bytes of result written to `res`, at most `ANALYZE_RES_MAX` */
+    uint16_t (*_Nonnull finalize) (void *_Nonnull state, void *_Nonnull res);
+};
+
+/** sample peak, `ANALYZE_PEAK_TAG` */
+struct analyze_peak_t {
+    float    peak;    // largest magnitude
+    uint64_t clipped; // samples at or beyond full scale
+};
+
+#define ANALYZE_PEAK_TAG TRACKDB_TAG ('P', 'E', 'A', 'K')
+#define ANALYZE_PEAK_VER 1
+
+/** mean power, `ANALYZE_RMS_TAG` */
+struct analyze_rms_t {
+    float rms_db; // dBFS over all samples, -inf for digital silence
+};
+
+#define ANALYZE_RMS_TAG TRACKDB_TAG ('R', 'M', 'S', 'L')
+#define ANALYZE_RMS_VER 1
+
+extern const struct analyzer_t analyzer_peak;
+extern const struct analyzer_t analyzer_rms;
+
+/** a block handed to the worker thread */
+struct analyze_blk_t;
+
+/** one track being analyzed */
+struct analyze_t {
+    uint32_t sample_rate;
+    uint32_t channels;
+    size_t   n; // analyzers still to run on this track
+    const struct analyzer_t *_Nonnull an[ANALYZE_MAX];
+    void *_Nullable state[ANALYZE_MAX];
+
+    // float conversion for the synchronous path
+    float *_Nullable fbuf;
+    size_t fbuf_siz;
+
+    // worker thread handoff
+    bool           threaded;
+    pthread_t      tid;
+    struct spscq_t full;
+    struct spscq_t empty;
+    size_t         nblks;
+};
+
+/**
+ * registers `an` for every track analyzed from now on. not thread safe.
+ *
+ * @return `ANALYZE_OK` or `ANALYZE_ERR` when `ANALYZE_MAX` are registered
+ */
+extern int analyze_register (const struct analyzer_t *_Nonnull an);
+
+/** the registered analyzers, peak and RMS by default */
+extern const struct analyzer_t *_Nonnull const *_Nonnull analyze_registered (
+    size_t *_Nonnull n);
+
+/**
+ * starts analyzing the track `key` with analyzers `an`. analyzers whose
+ * current result is already in the trackdb are skipped. with `threaded`,
+ * blocks are converted here and processed on a worker thread.
+ */
+extern int analyze_begin (struct analyze_t *_Nonnull this, uint64_t key,
+                          const struct analyzer_t *_Nonnull const *_Nonnull an,
+                          size_t n, uint32_t sample_rate, uint32_t channels,
+                          bool threaded);
+
+/**
+ * feeds `nframes` interleaved frames of WAV format `fmt` (1 S16, 2 S32,
+ * 3 FLT; others are ignored). nearly free when no analyzer is left.
+ */
+extern int analyze_feed (struct analyze_t *_Nonnull this,
+                         const void *_Nonnull buf, int fmt, size_t nframes);
+
+/**
+ * finishes the track. with `store`, finalizes every analyzer and puts the
+ * results in the trackdb under `key`; otherwise (track not fully decoded)
+ * throws them away.
+ */
+extern void analyze_end (struct analyze_t *_Nonnull this, uint64_t key,
+                         bool store);
+
+#endif // !ANALYZE_H
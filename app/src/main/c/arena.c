@@ -0,0 +1,121 @@
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+struct arena_chunk_t {
+    struct arena_chunk_t *next;
+    size_t                cap;
+    size_t                used;
+    max_align_t           data[];
+};
+
+/** `siz` rounded up to the alignment of any type */
+static inline size_t
+aligned (size_t siz)
+{
+    return (siz + alignof (max_align_t) - 1) & ~(alignof (max_align_t) - 1);
+}
+
+void
+arena_init (struct arena_t *this, size_t chunk)
+{
+    this->head  = NULL;
+    this->cur   = NULL;
+    this->chunk = aligned (chunk);
+}
+
+void *
+arena_alloc (struct arena_t *this, size_t siz)
+{
+    siz = aligned (siz);
+
+    // the chunks past `cur` are empty since the reset
+    for (struct arena_chunk_t *c = this->cur; c != NULL; c = c->next) {
+        if (c->cap - c->used >= siz) {
+            void *const p = (char *)c->data + c->used;
+
+            c->used += siz;
+            this->cur = c;
+
+            return p;
+        }
+    }
+
+    const size_t          cap = siz > this->chunk ? siz : this->chunk;
+    struct arena_chunk_t *c   = malloc (sizeof *c + cap);
+
+    if (c == NULL)
+        return NULL;
+
+    c->next = NULL;
+    c->cap  = cap;
+    c->used = siz;
+
+    // appended, so the chunks a reset keeps are tried in the same order
+    struct arena_chunk_t **tail = &this->head;
+
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+
+    *tail     = c;
+    this->cur = c;
+
+    return c->data;
+}
+
+void
+arena_reset (struct arena_t *this)
+{
+    for (struct arena_chunk_t *c = this->head; c != NULL; c = c->next)
+        c->used = 0;
+
+    this->cur = this->head;
+}
+
+void
+arena_deinit (struct arena_t *this)
+{
+    for (struct arena_chunk_t *c = this->head, *next; c != NULL; c = next) {
+        next = c->next;
+        free (c);
+    }
+
+    this->head = NULL;
+    this->cur  = NULL;
+}
+
+void *
+pool_get (struct pool_t *this)
+{
+    void *obj = NULL;
+
+    pthread_mutex_lock (&this->mx);
+
+    if (this->n > 0)
+        obj = this->objs[--this->n];
+
+    pthread_mutex_unlock (&this->mx);
+
+    return obj;
+}
+
+bool
+pool_put (struct pool_t *this, void *obj)
+{
+    bool kept = false;
+
+    pthread_mutex_lock (&this->mx);
+
+    if (this->n < this->cap) {
+        this->objs[this->n++] = obj;
+        kept                  = true;
+    }
+
+    pthread_mutex_unlock (&this->mx);
+
+    return kept;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * memory that outlives the tracks it is used for, so playing one does not
+ * allocate.
+ *
+ * an arena hands out pieces of large chunks and frees nothing until it is
+ * reset, which keeps the chunks for the next round: after the first, a
+ * round that asks for no more than the last allocates nothing. a pool keeps
+ * up to a fixed number of objects that would otherwise be freed, to be
+ * taken again instead of allocating new ones.
+ */
+
+struct arena_chunk_t;
+
+struct arena_t {
+    struct arena_chunk_t *_Nullable head; // oldest first
+    struct arena_chunk_t *_Nullable cur;  // the one being carved up
+    size_t                          chunk; // bytes of a new chunk, at least
+};
+
+/** not thread safe, as nothing on an arena is. allocates nothing yet */
+extern void arena_init (struct arena_t *_Nonnull this, size_t chunk);
+
+/**
+ * @return `siz` bytes aligned for any type, from the current chunk or the
+ * next one with room, or a new chunk if none has. NULL if that fails
+ */
+extern void *_Nullable arena_alloc (struct arena_t *_Nonnull this,
+                                    size_t siz);
+
+/** takes back everything handed out. the chunks are kept */
+extern void arena_reset (struct arena_t *_Nonnull this);
+
+/** frees the chunks. the arena can be used again */
+extern void arena_deinit (struct arena_t *_Nonnull this);
+
+struct pool_t {
+    pthread_mutex_t mx;
+    size_t          n;
+    size_t          cap;
+    void *_Nullable *_Nonnull objs;
+};
+
+/** a pool keeping as many objects as the array `objs` holds */
+#define POOL_INITIALIZER(objs)                                                \
+    { PTHREAD_MUTEX_INITIALIZER, 0, sizeof (objs) / sizeof *(objs), (objs) }
+
+/** thread safe. @return the object put last, or NULL if there is none */
+extern void *_Nullable pool_get (struct pool_t *_Nonnull this);
+
+/**
+ * thread safe. keeps `obj` for `pool_get`.
+ *
+ * @return false if the pool is full, in which case `obj` is the caller's
+ * to free
+ */
+extern bool pool_put (struct pool_t *_Nonnull this, void *_Nonnull obj);
+
+#endif // !ARENA_H
@@ -0,0 +1,330 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libavutil/dict.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#include <libavcodec/avcodec.h>
+
+#include <libavformat/avformat.h>
+
+#include "art.h"
+#include "atlas.h"
+#include "audio.h"
+#include "libav_dl.h"
+#include "logging.h"
+#include "strvec.h"
+#include "thrctl.h"
+#include "trackdb.h"
+
+static const char *FILENAME = "art.c";
+
+static pthread_t       art_tid;
+static bool            started = false;
+static atomic_bool     ready   = false;
+static atomic_bool     stop    = false;
+static struct atlas_t  atlas;
+static uint32_t       *cells = NULL;
+static const char     *prefix;
+static const strvec_t *tracks;
+static const char     *fn_atlas;
+
+/**
+ * album and album artist, so same-named albums by different artists get
+ * their own cell. tracks without an album tag are their own album.
+ */
+static uint64_t
+album_key (const AVFormatContext *fctx, const char *fn)
+{
+    const AVDictionaryEntry *album
+        = LIBAV (av_dict_get) (fctx->metadata, "album", NULL, 0);
+
+    if (album == NULL)
+        return trackdb_key (fn) | 1;
+
+    const AVDictionaryEntry *artist
+        = LIBAV (av_dict_get) (fctx->metadata, "album_artist", NULL, 0);
+
+    if (artist == NULL)
+        artist = LIBAV (av_dict_get) (fctx->metadata, "artist", NULL, 0);
+
+    char buf[512];
+    snprintf (buf, sizeof buf, "%s\n%s", artist ? artist->value : "",
+              album->value);
+
+    // 0 means no art
+    return trackdb_key (buf) | 1;
+}
+
+/** @return 0, or -1 for pixel formats without a converter */
+static int
+frame_src (const AVFrame *frame, struct atlas_src_t *src)
+{
+    memset (src, 0, sizeof *src);
+
+    switch (frame->format) {
+        case AV_PIX_FMT_YUVJ420P:
+            src->full_range = true;
+            // fall through
+        case AV_PIX_FMT_YUV420P:
+            src->pix = ATLAS_PIX_YUV420;
+            break;
+        case AV_PIX_FMT_YUVJ422P:
+            src->full_range = true;
+            // fall through
+        case AV_PIX_FMT_YUV422P:
+            src->pix = ATLAS_PIX_YUV422;
+            break;
+        case AV_PIX_FMT_YUVJ444P:
+            src->full_range = true;
+            // fall through
+        case AV_PIX_FMT_YUV444P:
+            src->pix = ATLAS_PIX_YUV444;
+            break;
+        case AV_PIX_FMT_GRAY8:
+            src->pix = ATLAS_PIX_GRAY;
+            break;
+        case AV_PIX_FMT_RGB24:
+            src->pix = ATLAS_PIX_RGB24;
+            break;
+        case AV_PIX_FMT_RGBA:
+            src->pix = ATLAS_PIX_RGBA;
+            break;
+        default:
+            return -1;
+    }
+
+    src->w = frame->width;
+    src->h = frame->height;
+
+    for (int i = 0; i < 3; ++i) {
+        src->plane[i]    = frame->data[i];
+        src->linesize[i] = frame->linesize[i];
+    }
+
+    return 0;
+}
+
+/** decodes the attached picture of `st` into a new cell for `key` */
+static int
+add_pic (const AVStream *st, uint64_t key)
+{
+    const AVCodec *codec
+        = LIBAV (avcodec_find_decoder) (st->codecpar->codec_id);
+
+    if (codec == NULL)
+        return -1;
+
+    AVCodecContext *cctx  = LIBAV (avcodec_alloc_context3) (codec);
+    AVFrame        *frame = LIBAV (av_frame_alloc) ();
+    int             ret   = -1;
+
+    if (cctx == NULL || frame == NULL)
+        goto exit;
+
+    if (LIBAV (avcodec_parameters_to_context) (cctx, st->codecpar) < 0
+        || LIBAV (avcodec_open2) (cctx, codec, NULL) < 0)
+        goto exit;
+
+    if (LIBAV (avcodec_send_packet) (cctx, &st->attached_pic) < 0
+        || LIBAV (avcodec_send_packet) (cctx, NULL) < 0
+        || LIBAV (avcodec_receive_frame) (cctx, frame) < 0)
+        goto exit;
+
+    struct atlas_src_t src;
+    uint32_t           idx;
+
+    if (frame_src (frame, &src) != 0) {
+        logwf ("WARN: no converter for cover pixel format %d",
+               frame->format);
+        goto exit;
+    }
+
+    if ((ret = atlas_add (&atlas, key, &src, &idx)) != ATLAS_OK) {
+        logwf ("WARN: atlas_add failed with code %d", ret);
+    } else {
+        logvf ("%dx%d cover art in cell %" PRIu32, src.w, src.h, idx);
+    }
+
+exit:
+    LIBAV (av_frame_free) (&frame);
+    LIBAV (avcodec_free_context) (&cctx);
+
+    return ret;
+}
+
+/**
+ * @return album key of `fn` if it has art, which is then in the atlas, or 0
+ */
+static uint64_t
+extract (const char *fn, bool *dirty)
+{
+    AVFormatContext *fctx = NULL;
+    uint64_t         key  = 0;
+
+    // the container header is enough for tags and attached pictures
+    if (LIBAV (avformat_open_input) (&fctx, fn, NULL, NULL) != 0)
+        return 0;
+
+    const AVStream *pic = NULL;
+
+    for (unsigned i = 0; i < fctx->nb_streams && pic == NULL; ++i)
+        if (fctx->streams[i]->disposition & AV_DISPOSITION_ATTACHED_PIC)
+            pic = fctx->streams[i];
+
+    if (pic == NULL)
+        goto exit;
+
+    key = album_key (fctx, fn);
+
+    if (atlas_find (&atlas, key) != ATLAS_NONE)
+        goto exit;
+
+    if (add_pic (pic, key) == ATLAS_OK)
+        *dirty = true;
+    else
+        key = 0;
+
+exit:
+    LIBAV (avformat_close_input) (&fctx);
+
+    return key;
+}
+
+static void *
+tfn_art (void *arg)
+{
+    (void)arg;
+
+    int  ret;
+    bool dirty = false;
+
+    thrctl_apply (THRCTL_IO);
+
+    switch (ret = atlas_read (&atlas, fn_atlas)) {
+        case ATLAS_OK:
+            logif ("loaded %" PRIu32 " album covers from `%s'", atlas.ncells,
+                   fn_atlas);
+            break;
+        case ATLAS_ENOENT:
+            break;
+        default:
+            logwf ("WARN: discarding atlas `%s', atlas_read returned %d",
+                   fn_atlas, ret);
+            dirty = true;
+    }
+
+    if (libav_load () != NCAP_OK) {
+        loge ("ERROR: libav_load failed. no album art");
+        goto exit;
+    }
+
+    char fn[PATH_MAX];
+
+    for (size_t i = 0; i < tracks->siz && !atomic_load (&stop); ++i) {
+        snprintf (fn, sizeof fn, "%s/%s", prefix, tracks->ptr[i]);
+
+        const uint64_t tkey = trackdb_key (fn);
+        uint64_t       akey;
+
+        // tracks known to have no art, or art already in the atlas, are not
+        // reopened
+        if (trackdb_get (tkey, ART_KEY_TAG, ART_KEY_VER, &akey, sizeof akey)
+                != sizeof akey
+            || (akey && atlas_find (&atlas, akey) == ATLAS_NONE)) {
+            akey = extract (fn, &dirty);
+            trackdb_put (tkey, ART_KEY_TAG, ART_KEY_VER, &akey, sizeof akey);
+        }
+
+        cells[i] = akey ? atlas_find (&atlas, akey) : ATLAS_NONE;
+    }
+
+    if (dirty && atlas_write (&atlas, fn_atlas) == ATLAS_OK)
+        logif ("wrote %" PRIu32 " album covers to `%s'", atlas.ncells,
+               fn_atlas);
+
+exit:
+    atomic_store_explicit (&ready, true, memory_order_release);
+
+    return NULL;
+}
+
+int
+art_start (const char *prefix_, const strvec_t *sv, const char *fn,
+           uint32_t cell)
+{
+    prefix   = prefix_;
+    tracks   = sv;
+    fn_atlas = fn;
+
+    atlas_init (&atlas, cell);
+    atomic_store (&stop, false);
+
+    if ((cells = malloc (sv->siz * sizeof *cells)) == NULL)
+        return ENOMEM;
+
+    for (size_t i = 0; i < sv->siz; ++i)
+        cells[i] = ATLAS_NONE;
+
+    int pth_ret;
+
+    if ((pth_ret = pthread_create (&art_tid, NULL, tfn_art, NULL)) != 0) {
+        free (cells);
+        cells = NULL;
+        return pth_ret;
+    }
+
+    started = true;
+
+    return 0;
+}
+
+bool
+art_ready (void)
+{
+    return atomic_load_explicit (&ready, memory_order_acquire);
+}
+
+const struct atlas_t *
+art_atlas (void)
+{
+    return &atlas;
+}
+
+void
+art_drop_pixels (void)
+{
+    free (atlas.pixels);
+    atlas.pixels = NULL;
+}
+
+uint32_t
+art_cell (size_t i)
+{
+    return cells != NULL && i < tracks->siz ? cells[i] : ATLAS_NONE;
+}
+
+void
+art_deinit (void)
+{
+    if (started) {
+        atomic_store (&stop, true);
+        pthread_join (art_tid, NULL);
+        started = false;
+    }
+
+    atomic_store (&ready, false);
+    atlas_deinit (&atlas);
+    free (cells);
+    cells = NULL;
+}
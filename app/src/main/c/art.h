@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef ART_H
+#define ART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atlas.h"
+#include "strvec.h"
+#include "trackdb.h"
+
+/**
+ * album art. a background thread pulls the attached picture out of each
+ * track, once per album, downscales it into the thumbnail atlas and keeps
+ * the atlas file up to date. the render thread only ever uploads the
+ * finished atlas.
+ */
+
+/**
+ * album key of a track, 0 if it has no art. cached so tracks are not
+ * reopened
+ */
+#define ART_KEY_TAG TRACKDB_TAG ('A', 'R', 'T', 'K')
+#define ART_KEY_VER 1
+
+/**
+ * starts the art thread for the tracks in `sv` under `prefix`. `cell` is the
+ * thumbnail size in pixels. `prefix`, `sv` and `fn_atlas` must outlive
+ * `art_deinit`.
+ *
+ * @return 0 or a pthread error code
+ */
+extern int art_start (const char *_Nonnull prefix,
+                      const strvec_t *_Nonnull sv,
+                      const char *_Nonnull fn_atlas, uint32_t cell);
+
+/** nonblocking. true once the atlas and `art_cell` are final */
+extern bool art_ready (void);
+
+/** valid once `art_ready`. pixels may be dropped with `art_drop_pixels` */
+extern const struct atlas_t *_Nonnull art_atlas (void);
+
+/** frees the CPU copy of the atlas pixels once it is uploaded */
+extern void art_drop_pixels (void);
+
+/** atlas cell of track `i` or `ATLAS_NONE`. only valid once `art_ready` */
+extern uint32_t art_cell (size_t i);
+
+/** stops and joins the art thread and frees everything */
+extern void art_deinit (void);
+
+#endif // !ART_H
@@ -0,0 +1,341 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "logging.h"
+
+static const char *FILENAME = "atlas.c";
+
+/** "NCAT" */
+#define ATLAS_MAGIC 0x5441434eu
+
+struct atlas_hdr_t {
+    uint32_t magic;
+    uint32_t ver;
+    uint32_t cell;
+    uint32_t cols;
+    uint32_t ncells;
+    uint32_t rows;
+};
+
+static inline uint8_t
+clamp8 (int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+/** BT.601, `full` for JPEG range */
+static void
+yuv2rgb (int y, int u, int v, bool full, uint8_t *rgb)
+{
+    const int d = u - 128;
+    const int e = v - 128;
+
+    if (full) {
+        rgb[0] = clamp8 (y + ((359 * e + 128) >> 8));
+        rgb[1] = clamp8 (y - ((88 * d + 183 * e + 128) >> 8));
+        rgb[2] = clamp8 (y + ((454 * d + 128) >> 8));
+    } else {
+        const int c = 298 * (y - 16);
+
+        rgb[0] = clamp8 ((c + 409 * e + 128) >> 8);
+        rgb[1] = clamp8 ((c - 100 * d - 208 * e + 128) >> 8);
+        rgb[2] = clamp8 ((c + 516 * d + 128) >> 8);
+    }
+}
+
+/**
+ * averages the `[x0, x1) x [y0, y1)` box of `src` into one RGBA pixel.
+ * YUV is averaged before conversion, which is the same thing since the
+ * conversion is linear up to clamping.
+ */
+static void
+box (const struct atlas_src_t *src, int x0, int x1, int y0, int y1,
+     uint8_t *dst)
+{
+    uint32_t  sum[4] = { 0, 0, 0, 0 };
+    const int n      = (x1 - x0) * (y1 - y0);
+    int       cx     = 0;
+    int       cy     = 0;
+
+    switch (src->pix) {
+        case ATLAS_PIX_YUV420:
+            cy = 1;
+            // fall through
+        case ATLAS_PIX_YUV422:
+            cx = 1;
+            // fall through
+        case ATLAS_PIX_YUV444:
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t *py = src->plane[0] + y * src->linesize[0];
+                const uint8_t *pu
+                    = src->plane[1] + (y >> cy) * src->linesize[1];
+                const uint8_t *pv
+                    = src->plane[2] + (y >> cy) * src->linesize[2];
+
+                for (int x = x0; x < x1; ++x) {
+                    sum[0] += py[x];
+                    sum[1] += pu[x >> cx];
+                    sum[2] += pv[x >> cx];
+                }
+            }
+
+            yuv2rgb ((sum[0] + n / 2) / n, (sum[1] + n / 2) / n,
+                     (sum[2] + n / 2) / n, src->full_range, dst);
+            dst[3] = 255;
+            return;
+        case ATLAS_PIX_GRAY:
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t *p = src->plane[0] + y * src->linesize[0];
+
+                for (int x = x0; x < x1; ++x)
+                    sum[0] += p[x];
+            }
+
+            dst[0] = dst[1] = dst[2] = (sum[0] + n / 2) / n;
+            dst[3]                   = 255;
+            return;
+        case ATLAS_PIX_RGB24:
+        case ATLAS_PIX_RGBA: {
+            const int step = src->pix == ATLAS_PIX_RGBA ? 4 : 3;
+
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t *p
+                    = src->plane[0] + y * src->linesize[0] + x0 * step;
+
+                for (int x = x0; x < x1; ++x, p += step) {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    sum[3] += step == 4 ? p[3] : 255;
+                }
+            }
+
+            for (int c = 0; c < 4; ++c)
+                dst[c] = (sum[c] + n / 2) / n;
+
+            return;
+        }
+    }
+}
+
+void
+atlas_init (struct atlas_t *this, uint32_t cell)
+{
+    memset (this, 0, sizeof *this);
+    this->cell = cell;
+    this->cols = cell ? ATLAS_DIM_MAX / cell : 0;
+}
+
+void
+atlas_deinit (struct atlas_t *this)
+{
+    free (this->keys);
+    free (this->pixels);
+    atlas_init (this, this->cell);
+}
+
+uint32_t
+atlas_find (const struct atlas_t *this, uint64_t key)
+{
+    for (uint32_t i = 0; i < this->ncells; ++i)
+        if (this->keys[i] == key)
+            return i;
+
+    return ATLAS_NONE;
+}
+
+void
+atlas_pos (const struct atlas_t *this, uint32_t idx, uint32_t *x, uint32_t *y)
+{
+    *x = idx % this->cols * this->cell;
+    *y = idx / this->cols * this->cell;
+}
+
+uint32_t
+atlas_width (const struct atlas_t *this)
+{
+    return this->cols * this->cell;
+}
+
+uint32_t
+atlas_height (const struct atlas_t *this)
+{
+    return this->rows * this->cell;
+}
+
+/** makes room for one more cell, a grid row at a time */
+static int
+grow (struct atlas_t *this)
+{
+    if (this->ncells % this->cols == 0) {
+        const uint32_t rows = this->ncells / this->cols + 1;
+
+        if (rows * this->cell > ATLAS_DIM_MAX)
+            return ATLAS_EFULL;
+
+        const size_t rowsiz = (size_t)atlas_width (this) * this->cell * 4;
+        uint8_t     *tmp    = realloc (this->pixels, rows * rowsiz);
+
+        if (tmp == NULL)
+            return ATLAS_EMEM;
+
+        memset (tmp + (rows - 1) * rowsiz, 0, rowsiz);
+        this->pixels = tmp;
+        this->rows   = rows;
+
+        uint64_t *ktmp = realloc (this->keys,
+                                  rows * this->cols * sizeof *this->keys);
+
+        if (ktmp == NULL)
+            return ATLAS_EMEM;
+
+        this->keys = ktmp;
+    }
+
+    return ATLAS_OK;
+}
+
+int
+atlas_add (struct atlas_t *this, uint64_t key, const struct atlas_src_t *src,
+           uint32_t *idx)
+{
+    int ret;
+
+    if (this->cell == 0 || src->w <= 0 || src->h <= 0
+        || src->plane[0] == NULL)
+        return ATLAS_ERR;
+
+    if (src->pix <= ATLAS_PIX_YUV444
+        && (src->plane[1] == NULL || src->plane[2] == NULL))
+        return ATLAS_ERR;
+
+    if ((ret = grow (this)) != ATLAS_OK)
+        return ret;
+
+    const int side = src->w < src->h ? src->w : src->h;
+    const int ox   = (src->w - side) / 2;
+    const int oy   = (src->h - side) / 2;
+    const int cell = this->cell;
+
+    uint32_t px, py;
+    atlas_pos (this, *idx = this->ncells, &px, &py);
+
+    const size_t stride = (size_t)atlas_width (this) * 4;
+    uint8_t     *row    = this->pixels + py * stride + px * 4;
+
+    for (int y = 0; y < cell; ++y, row += stride) {
+        const int y0 = oy + y * side / cell;
+        int       y1 = oy + (y + 1) * side / cell;
+
+        if (y1 <= y0)
+            y1 = y0 + 1;
+
+        for (int x = 0; x < cell; ++x) {
+            const int x0 = ox + x * side / cell;
+            int       x1 = ox + (x + 1) * side / cell;
+
+            if (x1 <= x0)
+                x1 = x0 + 1;
+
+            box (src, x0, x1, y0, y1, row + x * 4);
+        }
+    }
+
+    this->keys[this->ncells++] = key;
+
+    return ATLAS_OK;
+}
+
+int
+atlas_write (const struct atlas_t *this, const char *fn)
+{
+    FILE *fp = fopen (fn, "wb");
+
+    if (fp == NULL) {
+        logef ("ERROR: fopen `%s' failed for wb: %s", fn, strerror (errno));
+        return ATLAS_ERR;
+    }
+
+    const struct atlas_hdr_t hdr = {
+        .magic  = ATLAS_MAGIC,
+        .ver    = ATLAS_VER,
+        .cell   = this->cell,
+        .cols   = this->cols,
+        .ncells = this->ncells,
+        .rows   = this->rows,
+    };
+
+    const size_t npix = (size_t)atlas_width (this) * atlas_height (this) * 4;
+    int          ret  = ATLAS_OK;
+
+    if (fwrite (&hdr, sizeof hdr, 1, fp) != 1
+        || fwrite (this->keys, sizeof *this->keys, this->ncells, fp)
+               != this->ncells
+        || fwrite (this->pixels, 1, npix, fp) != npix) {
+        logef ("ERROR: could not write atlas `%s'", fn);
+        ret = ATLAS_ERR;
+    }
+
+    fclose (fp);
+
+    return ret;
+}
+
+int
+atlas_read (struct atlas_t *this, const char *fn)
+{
+    atlas_deinit (this);
+
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL)
+        return ATLAS_ENOENT;
+
+    struct atlas_hdr_t hdr;
+    int                ret = ATLAS_OK;
+
+    if (fread (&hdr, sizeof hdr, 1, fp) != 1 || hdr.magic != ATLAS_MAGIC) {
+        ret = ATLAS_ERR;
+        goto exit;
+    }
+
+    if (hdr.ver != ATLAS_VER || hdr.cell != this->cell
+        || hdr.cols != this->cols || hdr.ncells > hdr.rows * hdr.cols
+        || hdr.rows * hdr.cell > ATLAS_DIM_MAX) {
+        ret = ATLAS_EVER;
+        goto exit;
+    }
+
+    const size_t npix = (size_t)hdr.cols * hdr.cell * hdr.rows * hdr.cell * 4;
+
+    this->keys   = malloc ((size_t)hdr.rows * hdr.cols * sizeof *this->keys);
+    this->pixels = malloc (npix);
+
+    if (this->keys == NULL || this->pixels == NULL) {
+        ret = ATLAS_EMEM;
+        goto exit;
+    }
+
+    if (fread (this->keys, sizeof *this->keys, hdr.ncells, fp) != hdr.ncells
+        || fread (this->pixels, 1, npix, fp) != npix) {
+        ret = ATLAS_ERR;
+        goto exit;
+    }
+
+    this->ncells = hdr.ncells;
+    this->rows   = hdr.rows;
+
+exit:
+    fclose (fp);
+
+    if (ret != ATLAS_OK)
+        atlas_deinit (this);
+
+    return ret;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * thumbnail atlas: square RGBA cells of `cell` pixels laid out in a grid
+ * `ATLAS_DIM_MAX` pixels wide, one cell per album key. the pixel buffer is a
+ * ready-to-upload texture, so drawing a thumbnail never decodes anything.
+ *
+ * on disk: `struct atlas_hdr_t`, `ncells` keys, then the pixels.
+ */
+
+#define ATLAS_EVER   -5
+#define ATLAS_ENOENT -4
+#define ATLAS_EFULL  -3
+#define ATLAS_EMEM   -2
+#define ATLAS_ERR    -1
+#define ATLAS_OK     0
+
+#define ATLAS_VER 1
+
+/** no cell */
+#define ATLAS_NONE UINT32_MAX
+
+/** atlas width and height limit, the smallest GLES2 max texture size */
+#define ATLAS_DIM_MAX 2048
+
+/** pixel layouts `atlas_add` can read */
+enum atlas_pix_e {
+    ATLAS_PIX_YUV420, // 3 planes, chroma halved both ways
+    ATLAS_PIX_YUV422, // 3 planes, chroma halved horizontally
+    ATLAS_PIX_YUV444, // 3 planes
+    ATLAS_PIX_GRAY,   // 1 plane
+    ATLAS_PIX_RGB24,  // 1 packed plane
+    ATLAS_PIX_RGBA,   // 1 packed plane
+};
+
+/** a decoded picture, borrowed */
+struct atlas_src_t {
+    enum atlas_pix_e pix;
+    bool             full_range; // YUV only: JPEG range instead of MPEG
+    int              w;
+    int              h;
+    const uint8_t *_Nullable plane[3];
+    int linesize[3];
+};
+
+struct atlas_t {
+    uint32_t cell;   // cell width and height
+    uint32_t cols;   // cells per grid row
+    uint32_t ncells; // cells in use
+    uint32_t rows;   // grid rows allocated
+    uint64_t *_Nullable keys;
+    uint8_t *_Nullable pixels; // RGBA, `atlas_width` x `atlas_height`
+};
+
+extern void atlas_init (struct atlas_t *_Nonnull this, uint32_t cell);
+
+extern void atlas_deinit (struct atlas_t *_Nonnull this);
+
+/** @return the cell of `key` or `ATLAS_NONE` */
+extern uint32_t atlas_find (const struct atlas_t *_Nonnull this,
+                            uint64_t key);
+
+/**
+ * center-crops `src` to a square and box-filters it into a new cell for
+ * `key`, stored in `idx`.
+ *
+ * @return `ATLAS_OK`, `ATLAS_EFULL`, `ATLAS_EMEM`, or `ATLAS_ERR` for a bad
+ * source
+ */
+extern int atlas_add (struct atlas_t *_Nonnull this, uint64_t key,
+                      const struct atlas_src_t *_Nonnull src,
+                      uint32_t *_Nonnull idx);
+
+/** top-left pixel of cell `idx` */
+extern void atlas_pos (const struct atlas_t *_Nonnull this, uint32_t idx,
+                       uint32_t *_Nonnull x, uint32_t *_Nonnull y);
+
+extern uint32_t atlas_width (const struct atlas_t *_Nonnull this);
+
+extern uint32_t atlas_height (const struct atlas_t *_Nonnull this);
+
+extern int atlas_write (const struct atlas_t *_Nonnull this,
+                        const char *_Nonnull fn);
+
+/**
+ * replaces the contents of `this` with `fn`.
+ *
+ * @return `ATLAS_OK`, `ATLAS_ENOENT`, or `ATLAS_EVER` if the file has another
+ * version or cell size. `this` is left empty on error
+ */
+extern int atlas_read (struct atlas_t *_Nonnull this, const char *_Nonnull fn);
+
+#endif // !ATLAS_H
@@ -1,54 +1,1818 @@
-#include "aaudio_bind.c"
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "audio.h"
+#include "bufctl.h"
+#include "chmix.h"
+#include "dither.h"
+#include "config.h"
+#include "eq.h"
+#include "gain.h"
+#include "logging.h"
+#include "pipeline.h"
+#include "playctl.h"
+#include "ring.h"
+#include "sink.h"
+#include "stretch.h"
+#include "timing.h"
+#include "trackdb.h"
+
+#ifndef NCAP_ISTEST
 #include "render.h"
+#else
+// render.h needs raylib; tests provide this
+extern void render_sync_playback_button (void);
+#endif // NCAP_ISTEST
+
+static const char *FILENAME = "audio.c";
+
+struct playctl_t audio_ctl;
+
+/** between the audio thread and `audio_seek` and `audio_position` callers */
+static struct {
+    _Atomic uint64_t to;     // source frame a seek asked for
+    _Atomic uint64_t ask_ns; // when
+    _Atomic uint64_t pos;    // source frame playing, see `publish_pos`
+    _Atomic uint64_t len;    // the track's frames, 0 if unknown
+} seek;
+
+/** `saved.ctl`'s one bit: a position to save at once */
+#define SAVE_ASK 0x1u
+
+/** between the audio thread and `audio_save_pos` */
+static struct {
+    pthread_mutex_t  mx;  // over writing the position
+    struct playctl_t ctl; // `SAVE_ASK`, for `audio_save_wait`
+    _Atomic uint32_t seq; // odd while `key` and `seek.pos` change together
+    _Atomic uint64_t key; // of the track playing
+    uint64_t         last_key; // what was written last, under `mx`
+    uint64_t         last_pos;
+} saved = { .mx = PTHREAD_MUTEX_INITIALIZER };
+
+/** when the sink said its device went away, 0 if it has not since */
+static _Atomic uint64_t disc_ns;
+
+/** when the last interrupt was asked for, 0 once the next track took it */
+static _Atomic uint64_t tap_ask_ns;
+
+/** a linear fade over `len` frames, `pos` of which are done */
+struct fade_t {
+    size_t len;
+    size_t pos;
+    bool   in;
+};
+
+#define FADE_NONE 0
+#define FADE_OUT  1
+#define FADE_IN   2
+
+/**
+ * state shared with `pull`. the decode side fills `ring` a burst at a time;
+ * the sink's thread only copies out of it.
+ */
+struct cb_state_t {
+    struct ring_t    ring;
+    size_t           blk;
+    int              fmt;
+    uint32_t         channels;
+    _Atomic int      fade_req; // `FADE_*`, set by the decode side
+    int              fade_cur; // the one `fade` was set up for
+    struct fade_t    fade;
+    _Atomic uint64_t held;     // silent frames since a fade-out ended
+    _Atomic size_t   drop_to; // ring position queued audio is dropped up to
+    _Atomic uint64_t starved; // callbacks that ran short and padded silence
+    _Atomic uint64_t ncb;
+    _Atomic uint64_t cb_ns;   // time spent inside the callback
+    struct timing_t *timing;  // `out.timing`
+};
+
+/**
+ * the output stream. it stays open and started across tracks with the same
+ * format and sink, and only the audio thread touches it.
+ */
+static struct out_t {
+    struct sink_t     sink;
+    bool              open;
+    int               fmt;      // WAV format code of the source
+    int               sink_fmt; // and of the stream, S16 when dithered
+    uint32_t          channels; // after the mix
+    size_t            blk;      // and bytes per frame
+    uint32_t          sample_rate;
+    bool              cbmode;
+    bool              deep;   // deep-buffer write mode, see `play_deep`
+    uint8_t           perf;   // `aaudio_optimize` as of the open
+    bool              broken; // failing writes or no reopen; reopen
+    struct cb_state_t cb;
+    int64_t           written; // frames written since the open
+    struct fade_t     fade;    // write mode's, see `out_fading`
+    bool              paused;  // the loops start the sink after a write
+    uint64_t          wakeups; // feeder sleeps and blocking writes
+    struct arena_t    arena;   // the stream's buffers, reset on each open
+    void *_Nullable   bbuf;    // the loops' buffer, see `out_open`
+    struct chmix_t    mix;        // source channels to the stream's
+    bool              mix_valid;  // `mix` is set up for the source
+    uint32_t          mix_gen;    // `config_mix_gen` `mix` was set at
+    uint64_t          src_layout; // `pipeline_t.layout` it was set up for
+    struct dither_t   dither;
+    int               dither_mode; // `DITHER_*`, off when not reducing
+    struct eq_t       eq;
+    uint32_t          eq_gen; // `config_eq_gen` `eq` was set at
+    bool              eq_valid;
+    struct stretch_t  st;        // playback speed, see `stretch_read`
+    bool              st_valid;  // `st` is open for the stream's format
+    uint32_t          speed_gen; // `config_speed_gen` `st` was set at
+    struct bufctl_t   buf;          // buffer size controller
+    uint64_t          buf_key;      // trackdb key of the learned size
+    uint64_t          track_end_ns; // when the last `audio_play` returned
+    uint64_t          pub_ns;       // when the position was last published
+    uint64_t          seek_t0;      // when the seek under way was asked for
+    uint64_t          seek_ns;      // the last seek's time to audible
+    uint64_t          tap_t0;       // when the track was tapped, if it was
+    uint64_t          tap_ns;       // the last tap's time to audible
+    uint64_t          recover_t0;   // when the device under reopen went
+    uint64_t          recover_ns;   // the last reopen's time to audible
+    uint64_t          nrecover;     // reopens after the device went away
+    uint64_t          launch_ns;    // `audio_init`
+    uint64_t          resume_ns; // launch to the first resumed stream start
+    struct timing_t   timing;    // across streams, see `audio_timing`
+    uint64_t          timing_log_ns; // last timing summary
+} out;
+
+#ifndef NCAP_ISTEST
+static const struct sink_ops_t *sink_sel = &sink_aaudio;
+#else
+static const struct sink_ops_t *sink_sel = &sink_paced;
+#endif
+static const char *sink_arg = NULL;
+
+#define CTL_PLAY 0
+#define CTL_STOP 1
+#define CTL_INT  2
+
+static void out_close (bool drained);
+static void out_pause (uint32_t sample_rate);
+static void out_resume (void);
+static void out_seek (struct pipeline_t *pl, bool paused);
+static int  out_recover (struct pipeline_t *pl, bool paused);
+static void save_pos (const struct pipeline_t *pl);
+static void publish_pos (const struct pipeline_t *pl);
+static void sample_timing (void);
+
+/** @return frames in a fade at `sample_rate` */
+static inline size_t
+fade_len (uint32_t sample_rate)
+{
+    const size_t len = (size_t)sample_rate * NCAP_AUDIO_FADE_MS / 1000;
+    return len > 0 ? len : 1;
+}
+
+/**
+ * fades the next `nframes` frames of `buf` along `f`. past its end, a
+ * fade-in leaves them alone and a fade-out silences them. no locks, so
+ * `pull` can use it.
+ */
+static void
+fade_apply (struct fade_t *f, void *buf, int fmt, uint32_t channels,
+            size_t blk, size_t nframes)
+{
+    size_t n = f->len - f->pos;
+
+    if (n > nframes)
+        n = nframes;
+
+    if (n > 0) {
+        const float g0 = (float)f->pos / f->len;
+        const float g1 = (float)(f->pos + n) / f->len;
+
+        gain_ramp (buf, buf, fmt, n, channels, f->in ? g0 : 1 - g0,
+                   f->in ? g1 : 1 - g1);
+        f->pos += n;
+    }
+
+    if (!f->in && nframes > n)
+        memset ((uint8_t *)buf + n * blk, 0, (nframes - n) * blk);
+}
+
+/**
+ * the write loop fades out its next bursts itself before it pauses.
+ *
+ * @return whether it still has to, starting the fade if it has not yet
+ */
+static bool
+out_fading (void)
+{
+    if (out.cbmode || out.deep)
+        return false;
+
+    if (out.fade.in) {
+        out.fade.in  = false;
+        out.fade.pos = 0;
+    }
+
+    return out.fade.pos < out.fade.len;
+}
+
+/**
+ * checks for interrupt, seek, a lost device, pause and window close between
+ * bursts, normally with one atomic load. a pause fades out first, then
+ * sleeps on `audio_ctl` with the sink paused, so it neither plays out
+ * silence nor counts the wait as underruns. a seek or a lost device wakes
+ * it and is dealt with paused. playback fades back in where it stopped.
+ */
+static int
+play_ctl (struct pipeline_t *pl)
+{
+    uint32_t w;
+    bool     paused = false;
+
+    while ((w = playctl_get (&audio_ctl)) != PLAYCTL_PLAY) {
+        if (w & PLAYCTL_INT && playctl_take (&audio_ctl, PLAYCTL_INT))
+            return CTL_INT;
+
+        if (w & PLAYCTL_CLOSE) {
+            logi ("stopping playback...; wclose = true");
+            return CTL_STOP;
+        }
+
+        if (w & PLAYCTL_SEEK && playctl_take (&audio_ctl, PLAYCTL_SEEK)) {
+            out_seek (pl, paused);
+            continue;
+        }
+
+        if (w & PLAYCTL_DISC && playctl_take (&audio_ctl, PLAYCTL_DISC)) {
+            if (out_recover (pl, paused) != NCAP_OK)
+                return CTL_STOP;
+
+            continue;
+        }
+
+        if (w & PLAYCTL_PLAY)
+            continue;
+
+        if (!paused) {
+            if (out_fading ())
+                return CTL_PLAY;
+
+            out_pause (pl->sample_rate);
+            save_pos (pl);
+            paused = true;
+            logi ("paused. waiting on audio_ctl...");
+        }
+
+        playctl_wait (&audio_ctl, PLAYCTL_PLAY | PLAYCTL_CLOSE | PLAYCTL_SEEK
+                                      | PLAYCTL_DISC);
+    }
+
+    if (paused)
+        out_resume ();
+
+    // resumed before the fade-out was through
+    if (!out.cbmode && !out.fade.in) {
+        out.fade.in  = true;
+        out.fade.pos = out.fade.len - out.fade.pos;
+    }
+
+    return CTL_PLAY;
+}
+
+/** follows the equalizer settings, taking `config_mx` only after a change */
+static void
+eq_sync (void)
+{
+    const uint32_t gen
+        = atomic_load_explicit (&config_eq_gen, memory_order_acquire);
+
+    if (out.eq_valid && gen == out.eq_gen)
+        return;
+
+    struct eq_band_t bands[EQ_MAX_BANDS];
+    size_t           nbands = 0;
+    int16_t          preamp = 0;
+    int              pth_ret;
+
+    if ((pth_ret = pthread_mutex_lock (&config_mx)) != 0) {
+        logwf ("WARN: pthread_mutex_lock on config_mx failed with error "
+               "code %d: %s. keeping the old eq...",
+               pth_ret, strerror (pth_ret));
+        return;
+    }
+
+    const uint8_t preset = ncap_config.eq_preset;
+
+    if (!ncap_config.eq_on) {
+        // flat
+    } else if (preset < EQ_NPRESETS) {
+        memcpy (bands, eq_presets[preset], sizeof bands);
+        nbands = EQ_MAX_BANDS;
+    } else if (preset == EQ_PRESET_CUSTOM) {
+        memcpy (bands, ncap_config.eq_bands, sizeof bands);
+        nbands = ncap_config.eq_nbands < EQ_MAX_BANDS ? ncap_config.eq_nbands
+                                                      : EQ_MAX_BANDS;
+        preamp = ncap_config.eq_preamp;
+    }
+
+    pthread_mutex_unlock (&config_mx);
+
+    eq_set (&out.eq, bands, nbands, preamp);
+    out.eq_gen   = gen;
+    out.eq_valid = true;
+
+    logvf ("eq: preset %hhu, %zu bands, %s", preset, nbands,
+           eq_active (&out.eq) ? "active" : "bypassed");
+}
+
+/** follows the playback speed, taking `config_mx` only after a change */
+static void
+speed_sync (void)
+{
+    const uint32_t gen
+        = atomic_load_explicit (&config_speed_gen, memory_order_acquire);
+
+    if (!out.st_valid || gen == out.speed_gen)
+        return;
+
+    uint16_t pct = 100;
+    int      pth_ret;
+
+    config_get (pct, speed, pth_ret);
+
+    if (pth_ret != 0) {
+        logwf ("WARN: pthread_mutex_lock on config_mx failed with error "
+               "code %d: %s. keeping the old speed...",
+               pth_ret, strerror (pth_ret));
+        return;
+    }
+
+    stretch_set (&out.st, pct);
+    out.speed_gen = gen;
+
+    logvf ("speed %hu%%: %.2fx", pct, out.st.speed);
+}
+
+/** follows mono and balance, taking `config_mx` only after a change */
+static void
+mix_sync (void)
+{
+    const uint32_t gen
+        = atomic_load_explicit (&config_mix_gen, memory_order_acquire);
+
+    if (!out.mix_valid || gen == out.mix_gen)
+        return;
+
+    int pth_ret;
+
+    if ((pth_ret = pthread_mutex_lock (&config_mx)) != 0) {
+        logwf ("WARN: pthread_mutex_lock on config_mx failed with error "
+               "code %d: %s. keeping the old mix...",
+               pth_ret, strerror (pth_ret));
+        return;
+    }
+
+    const bool   mono    = ncap_config.mono;
+    const int8_t balance = ncap_config.balance;
+
+    pthread_mutex_unlock (&config_mx);
+
+    chmix_set (&out.mix, mono, balance);
+    out.mix_gen = gen;
+
+    logvf ("mix: %" PRIu32 " to %" PRIu32 " channels, mono %d, balance "
+           "%hhd",
+           out.mix.in, out.mix.out, mono, balance);
+}
+
+/**
+ * reads `nframes` frames of `pl` into `buf` through the time-stretch, which
+ * takes `speed` times as many from `pl`, a step's worth at a time. back at
+ * normal speed, what it holds plays out before reads go straight to `pl`
+ * again.
+ *
+ * @return frames read; fewer only at the end of the track
+ */
+static size_t
+stretch_read (struct pipeline_t *pl, void *buf, size_t nframes)
+{
+    struct stretch_t *const st = &out.st;
+    size_t                  n  = 0;
+
+    speed_sync ();
+
+    if (!out.st_valid)
+        return pipeline_read (pl, buf, nframes);
+
+    if (st->speed == 1 && st->primed)
+        stretch_drain (st);
+
+    while (n < nframes) {
+        uint8_t *const dst = (uint8_t *)buf + n * pl->blk;
+
+        if (st->speed == 1 && !stretch_held (st))
+            return n + pipeline_read (pl, dst, nframes - n);
+
+        const size_t got = stretch_get (st, dst, nframes - n);
+
+        n += got;
+
+        if (got > 0)
+            continue;
+
+        const size_t want  = stretch_want (st);
+        const size_t nread = pipeline_read (pl, st->raw, want);
+
+        stretch_put (st, st->raw, nread);
+
+        // the end of the track is not stretched
+        if (nread < want) {
+            stretch_drain (st);
+            return n + stretch_get (st, dst, nframes - n);
+        }
+    }
+
+    return n;
+}
+
+/**
+ * reads up to one burst from `pl` into `buf` at the playback speed, then
+ * mixes it down to the stream's channels, applies the equalizer and the
+ * volume and reduces it to the stream's format. `buf` holds a burst of
+ * source frames; sets `eof` on the last
+ * one, which is short. `config_mx` is only taken after a volume, mix,
+ * equalizer or speed change.
+ *
+ * @return frames read, now of `out.blk` bytes each
+ */
+static size_t
+fill_burst (struct pipeline_t *pl, void *buf, size_t nframes,
+            struct gain_t *gain, size_t idx, bool *eof)
+{
+    const size_t nread = stretch_read (pl, buf, nframes);
+
+    if (nread < nframes)
+        *eof = true;
+
+    const uint32_t gen
+        = atomic_load_explicit (&config_vol_gen, memory_order_acquire);
+
+    if (!gain->valid || gen != gain->gen) {
+        int      pth_ret;
+        uint8_t  vol  = 0;
+        uint8_t *vols = NULL;
+
+        if ((pth_ret = pthread_mutex_lock (&config_mx)) == 0) {
+            vol  = ncap_config.volume;
+            vols = ncap_config.track_vols;
+
+            gain_set (gain, vol, vols != NULL ? vols[idx] : 100);
+            gain->gen = gen;
+            pthread_mutex_unlock (&config_mx);
+
+            logvf ("volume %hhu, track volume %hhu: gain %.3f", vol,
+                   gain->svol, gain->target);
+        } else {
+            logwf ("WARN: pthread_mutex_lock on config_mx failed with error "
+                   "code %d: %s. keeping the old volume...",
+                   pth_ret, strerror (pth_ret));
+        }
+    }
+
+    mix_sync ();
+    chmix_apply (&out.mix, buf, pl->fmt, nread);
+
+    eq_sync ();
+    eq_apply (&out.eq, buf, pl->fmt, nread);
+    gain_apply (gain, buf, buf, pl->fmt, nread, out.channels);
+
+    if (out.dither_mode != DITHER_OFF)
+        dither_apply (&out.dither, buf, buf, nread);
+
+    publish_pos (pl);
+    sample_timing ();
+
+    return nread;
+}
+
+static inline uint64_t
+now_ns (clockid_t clk)
+{
+    struct timespec ts;
+    clock_gettime (clk, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * the first burst after a seek went to the sink, with nothing queued ahead
+ * of it: the seek took this long to be heard, less the output latency
+ * `timing` reports
+ */
+static void
+seek_heard (void)
+{
+    if (out.seek_t0 == 0)
+        return;
+
+    out.seek_ns = now_ns (CLOCK_MONOTONIC) - out.seek_t0;
+    out.seek_t0 = 0;
+
+    if (out.seek_ns > NCAP_AUDIO_SEEK_MS * 1000000ull)
+        logwf ("WARN: seek audible in %.1f ms, over the %d ms target",
+               out.seek_ns / 1e6, NCAP_AUDIO_SEEK_MS);
+    else
+        logif ("seek audible in %.1f ms", out.seek_ns / 1e6);
+}
+
+/**
+ * the first burst of a tapped track went to the sink: the tap took this
+ * long to be heard, from the interrupt through the next track's open
+ */
+static void
+tap_heard (void)
+{
+    if (out.tap_t0 == 0)
+        return;
+
+    out.tap_ns = now_ns (CLOCK_MONOTONIC) - out.tap_t0;
+    out.tap_t0 = 0;
+
+    if (out.tap_ns > NCAP_AUDIO_TAP_MS * 1000000ull)
+        logwf ("WARN: tapped track audible in %.1f ms, over the %d ms "
+               "target",
+               out.tap_ns / 1e6, NCAP_AUDIO_TAP_MS);
+    else
+        logif ("tapped track audible in %.1f ms", out.tap_ns / 1e6);
+}
+
+/**
+ * the first audio since the device went away went to a new stream, which
+ * was started with it
+ */
+static void
+recover_heard (void)
+{
+    if (out.recover_t0 == 0)
+        return;
+
+    out.recover_ns = now_ns (CLOCK_MONOTONIC) - out.recover_t0;
+    out.recover_t0 = 0;
+
+    if (out.recover_ns > NCAP_AUDIO_RECOVER_MS * 1000000ull)
+        logwf ("WARN: new device audible in %.1f ms, over the %d ms target",
+               out.recover_ns / 1e6, NCAP_AUDIO_RECOVER_MS);
+    else
+        logif ("new device audible in %.1f ms", out.recover_ns / 1e6);
+}
+
+/**
+ * the sink's error callback, on a thread of its own. only flags the loss:
+ * `play_ctl` reopens the stream on the audio thread
+ */
+static void
+sink_lost (void *user, int err)
+{
+    (void)user;
+    (void)err;
+
+    uint64_t none = 0;
+
+    atomic_compare_exchange_strong (&disc_ns, &none,
+                                    now_ns (CLOCK_MONOTONIC));
+    playctl_set (&audio_ctl, PLAYCTL_DISC);
+}
+
+/** learned buffer size, per device and stream format, `BUF_TAG` */
+struct buf_learned_t {
+    int32_t siz;
+    int32_t burst;
+};
+
+#define BUF_TAG TRACKDB_TAG ('B', 'U', 'F', 'S')
+#define BUF_VER 1
+
+/** lets the controller see the xrun counter, applying what it decides */
+static void
+tune_buf (void)
+{
+    struct sink_t *const s   = &out.sink;
+    const uint64_t       now = now_ns (CLOCK_MONOTONIC);
+    const int32_t        siz
+        = bufctl_update (&out.buf, s->ops->xruns (s), now);
+
+    if (siz == 0)
+        return;
+
+    const int32_t applied = s->ops->set_buf (s, siz);
+
+    bufctl_applied (&out.buf, applied);
+
+    logdf ("buffer %s to %d frames after %d xruns",
+           bufctl_last (&out.buf)->why == BUFCTL_GROW ? "grown" : "shrunk",
+           applied, out.buf.xruns);
+}
+
+/** stores the learned buffer size for the next stream on this device */
+static void
+save_buf (void)
+{
+    const struct buf_learned_t l
+        = { .siz = out.buf.siz, .burst = out.buf.burst };
+
+    trackdb_put (out.buf_key, BUF_TAG, BUF_VER, &l, sizeof l);
+}
+
+/**
+ * runs on the sink's thread, real-time on AAudio: no locks, allocation or
+ * logging. whole frames only, so a short ring never shifts the channel
+ * order. a fade-out reads no further than its end and then holds, padding
+ * silence, so a resume fades in from the next frame in the ring.
+ */
+static void
+pull (void *user, void *audio, size_t nframes)
+{
+    struct cb_state_t *cb    = user;
+    const uint64_t     start = now_ns (CLOCK_MONOTONIC);
+    size_t             want  = nframes * cb->blk;
+    const int          req
+        = atomic_load_explicit (&cb->fade_req, memory_order_acquire);
+
+    if (req != cb->fade_cur) {
+        cb->fade_cur = req;
+        cb->fade.pos = 0;
+        cb->fade.in  = req == FADE_IN;
+    }
+
+    ring_drop_to (&cb->ring,
+                  atomic_load_explicit (&cb->drop_to, memory_order_acquire));
+
+    if (req == FADE_OUT && want > (cb->fade.len - cb->fade.pos) * cb->blk)
+        want = (cb->fade.len - cb->fade.pos) * cb->blk;
+
+    size_t avail = ring_used (&cb->ring);
+
+    avail -= avail % cb->blk;
+
+    const size_t got
+        = ring_read (&cb->ring, audio, avail < want ? avail : want);
+
+    if (req != FADE_NONE)
+        fade_apply (&cb->fade, audio, cb->fmt, cb->channels, cb->blk,
+                    got / cb->blk);
+
+    if (got < nframes * cb->blk) {
+        memset ((uint8_t *)audio + got, 0, nframes * cb->blk - got);
+
+        if (got < want)
+            atomic_fetch_add_explicit (&cb->starved, 1,
+                                       memory_order_relaxed);
+        else
+            atomic_fetch_add_explicit (&cb->held, nframes - got / cb->blk,
+                                       memory_order_relaxed);
+    }
+
+    const uint64_t end = now_ns (CLOCK_MONOTONIC);
+
+    atomic_fetch_add_explicit (&cb->ncb, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit (&cb->cb_ns, end - start, memory_order_relaxed);
+    timing_cb (cb->timing, start, end);
+}
+
+/** blocking write loop, one burst per write */
+static int
+play_write (struct pipeline_t *pl, size_t idx, struct gain_t *gain)
+{
+    const uint64_t       nstimeout = 1000000000;
+    struct sink_t *const s         = &out.sink;
+
+#if DEBUG_TIMED
+    const time_t timer_start = time (NULL);
+    const time_t dur         = 5;
+#endif
+
+    long res = SINK_OK;
+    int  ret = NCAP_OK;
+    bool eof = false;
+    int  ctl;
+
+#if DEBUG_TIMED
+#define AUDIO_STOP_COND                                                       \
+    (res >= SINK_OK && !eof && time (NULL) - timer_start < dur)
+#else
+#define AUDIO_STOP_COND (res >= SINK_OK && !eof)
+#endif
+
+    while (AUDIO_STOP_COND) {
+        if ((ctl = play_ctl (pl)) != CTL_PLAY) {
+            ret = ctl == CTL_INT ? NCAP_INT : NCAP_OK;
+            break;
+        }
+
+        // a fade-out reads no further than its end
+        size_t want = s->burst;
+
+        if (!out.fade.in && want > out.fade.len - out.fade.pos)
+            want = out.fade.len - out.fade.pos;
+
+        // a short last burst is not padded, so the next track follows on
+        const size_t n = fill_burst (pl, out.bbuf, want, gain, idx, &eof);
+
+        if (n > 0) {
+            fade_apply (&out.fade, out.bbuf, out.sink_fmt, out.channels,
+                        out.blk, n);
+            res = s->ops->write (s, out.bbuf, n, nstimeout);
+            out.written += res > 0 ? res : 0;
+            ++out.wakeups;
+            timing_burst (&out.timing, now_ns (CLOCK_MONOTONIC));
+        }
+
+        // the burst is read again from where the device stopped
+        if (res == SINK_EDISC) {
+            sink_lost (NULL, SINK_EDISC);
+            res = SINK_OK;
+            continue;
+        }
+
+        // started once something is queued, so resuming does not underrun
+        if (out.paused && res >= SINK_OK) {
+            out.paused = false;
+            s->ops->start (s);
+            recover_heard ();
+        }
+
+        if (n > 0) {
+            seek_heard ();
+            tap_heard ();
+        }
+
+        tune_buf ();
+    }
+
+    if (res < SINK_OK) {
+        logef ("Write loop stopped due to sink error with code %ld.", res);
+        out.broken = true;
+    }
+
+    return ret;
+}
+
+/**
+ * frames queued in the sink, from its last timestamp extrapolated to now.
+ * without a timestamp, `exact` is false and nothing is assumed played yet.
+ * a sink whose device went away played nothing since, so its counters say.
+ */
+static int64_t
+queued (uint32_t sample_rate, bool *exact)
+{
+    struct sink_t *const s = &out.sink;
+    int64_t              frames, ns, written, read;
+
+    if (s->ops->state (s) == SINK_DISCONNECTED
+        && s->ops->counters (s, &written, &read) == SINK_OK) {
+        *exact = true;
+        return written > read ? written - read : 0;
+    }
+
+    if (!(*exact = s->ops->timestamp (s, &frames, &ns) == SINK_OK))
+        return out.written < out.buf.siz ? out.written : out.buf.siz;
+
+    const int64_t played
+        = frames
+          + ((int64_t)now_ns (CLOCK_MONOTONIC) - ns) * sample_rate
+                / 1000000000;
+    const int64_t q = out.written - played;
+
+    return q < 0 ? 0 : q;
+}
+
+/**
+ * @return the source frame playing now. frames still in the ring or queued
+ * in the sink are not played yet; in callback mode the sink's own buffer is
+ * not counted, which puts the position up to a buffer ahead.
+ */
+static uint64_t
+play_pos (const struct pipeline_t *pl)
+{
+    bool    exact;
+    int64_t back = 0;
+
+    if (out.open)
+        back = queued (pl->sample_rate, &exact);
+
+    if (out.open && out.cbmode)
+        back += ring_used (&out.cb.ring) / out.cb.blk;
+
+    // output frames stand for `speed` source frames each
+    if (out.st_valid)
+        back = back * out.st.speed + stretch_behind (&out.st);
+
+    return pipeline_pos (pl, back);
+}
+
+/** writes the position of track `key`. `saved.mx` is held */
+static void
+write_pos (uint64_t key, uint64_t pos)
+{
+    if (config_write_pos (key, pos) != CONFIG_OK) {
+        logwf ("WARN: could not save the position %" PRIu64, pos);
+        return;
+    }
+
+    saved.last_key = key;
+    saved.last_pos = pos;
+}
+
+/**
+ * publishes the position and asks for it to be saved at once, on pause and
+ * at the ends of a track. the write is `audio_save_pos`'s, off this thread
+ */
+static void
+save_pos (const struct pipeline_t *pl)
+{
+    atomic_store_explicit (&seek.pos, play_pos (pl), memory_order_relaxed);
+    playctl_set (&saved.ctl, SAVE_ASK);
+}
+
+/** shows the position, every `NCAP_AUDIO_POS_UI_MS` */
+static void
+publish_pos (const struct pipeline_t *pl)
+{
+    const uint64_t t = now_ns (CLOCK_MONOTONIC);
+
+    if (t - out.pub_ns < NCAP_AUDIO_POS_UI_MS * 1000000ull)
+        return;
+
+    out.pub_ns = t;
+    atomic_store_explicit (&seek.pos, play_pos (pl), memory_order_relaxed);
+}
+
+/**
+ * samples the output latency every `TIMING_SAMPLE_MS`, counting the ring
+ * in callback mode, and logs a summary every `NCAP_AUDIO_TIMING_LOG_MS`
+ */
+static void
+sample_timing (void)
+{
+    struct sink_t *const s = &out.sink;
+    const uint64_t       t = now_ns (CLOCK_MONOTONIC);
+    int64_t              written, read, frames, ns;
+
+    if (!out.open || !timing_due (&out.timing, t))
+        return;
+
+    if (s->ops->counters (s, &written, &read) == SINK_OK
+        && s->ops->timestamp (s, &frames, &ns) == SINK_OK)
+        timing_latency (&out.timing,
+                        out.cbmode ? ring_used (&out.cb.ring) / out.cb.blk
+                                   : 0,
+                        written, read, frames, ns, t);
+
+    if (t - out.timing_log_ns < NCAP_AUDIO_TIMING_LOG_MS * 1000000ull)
+        return;
+
+    struct timing_stats_t stats;
+    char                  line[256];
+
+    out.timing_log_ns = t;
+    timing_stats (&out.timing, &stats);
+    timing_summary (&stats, line, sizeof line);
+
+    logif ("timing: %s", line);
+}
+
+/**
+ * pauses `out` at the end of a fade-out. the write loop has written its
+ * fade and waits here for the sink to play it; `pull` is asked for one and
+ * then to hold silence for a buffer's worth. either way only silence is
+ * left in the sink, which is flushed so a resume plays at once. deep mode
+ * cannot reach back into its buffer to fade, so it pauses right away and
+ * keeps the buffer to play on from the same frame; the platform ramps a
+ * pause on that path.
+ */
+static void
+out_pause (uint32_t sample_rate)
+{
+    const uint64_t        timeout_ns = 200000000;
+    const struct timespec nap        = { .tv_sec = 0, .tv_nsec = 1000000 };
+    struct sink_t *const  s          = &out.sink;
+    const uint64_t        t0         = now_ns (CLOCK_MONOTONIC);
+
+    if (out.cbmode) {
+        const uint64_t hold = (uint64_t)out.buf.siz + s->burst;
+
+        atomic_store_explicit (&out.cb.held, 0, memory_order_relaxed);
+        atomic_store_explicit (&out.cb.fade_req, FADE_OUT,
+                               memory_order_release);
+
+        while (atomic_load_explicit (&out.cb.held, memory_order_relaxed)
+                   < hold
+               && s->ops->state (s) == SINK_STARTED
+               && now_ns (CLOCK_MONOTONIC) - t0 < timeout_ns)
+            nanosleep (&nap, NULL);
+    } else if (!out.deep) {
+        bool    exact = true;
+        int64_t q;
+
+        // without a timestamp, wait once for the estimate
+        while (exact && (q = queued (sample_rate, &exact)) > 0
+               && now_ns (CLOCK_MONOTONIC) - t0 < timeout_ns) {
+            const struct timespec ts
+                = { .tv_sec  = 0,
+                    .tv_nsec = exact ? nap.tv_nsec
+                                     : q * 1000000000 / sample_rate };
+            nanosleep (&ts, NULL);
+        }
+    }
+
+    s->ops->pause (s);
+
+    if (!out.deep) {
+        const long dropped = s->ops->flush (s);
+
+        if (dropped > 0) {
+            logdf ("flushed %ld frames on pause", dropped);
+        }
+    }
+
+    // running the queue dry is no reason to grow the buffer. a stream not
+    // started since a reopen still waits for a write
+    out.buf.xruns = s->ops->xruns (s);
+    out.paused    = out.paused || (!out.cbmode && !out.deep);
+
+    logif ("paused %s in %.1f ms",
+           out.deep ? "at once" : "after a fade-out",
+           (now_ns (CLOCK_MONOTONIC) - t0) / 1e6);
+}
+
+/**
+ * restarts `out` after `out_pause`, fading in from the frame it stopped at.
+ * the write loop starts the sink after its first write.
+ */
+static void
+out_resume (void)
+{
+    if (out.cbmode)
+        atomic_store_explicit (&out.cb.fade_req, FADE_IN,
+                               memory_order_release);
+
+    // the pause is no burst period
+    timing_restart (&out.timing);
+
+    if (!out.paused)
+        out.sink.ops->start (&out.sink);
+
+    out.fade.in  = true;
+    out.fade.pos = 0;
+
+    logi ("resuming with a fade-in");
+}
+
+/**
+ * moves `pl` to the frame `audio_seek` asked for, dropping what is queued
+ * for output. `pull` fades out and holds silence, which takes a fade and a
+ * callback, and is asked to fade in again with the first new burst in the
+ * ring. the write loops pause and flush the sink at once, starting it again
+ * after their next write, which fades in. seeking while `paused` leaves the
+ * fade-in to `out_resume`.
+ */
+static void
+out_seek (struct pipeline_t *pl, bool paused)
+{
+    const uint64_t        timeout_ns = 200000000;
+    const struct timespec nap        = { .tv_sec = 0, .tv_nsec = 500000 };
+    struct sink_t *const  s          = &out.sink;
+    const uint64_t        frame      = atomic_load (&seek.to);
+    const uint64_t        t0         = now_ns (CLOCK_MONOTONIC);
+
+    if (out.cbmode) {
+        if (!paused) {
+            atomic_store_explicit (&out.cb.held, 0, memory_order_relaxed);
+            atomic_store_explicit (&out.cb.fade_req, FADE_OUT,
+                                   memory_order_release);
+
+            while (atomic_load_explicit (&out.cb.held, memory_order_relaxed)
+                       == 0
+                   && s->ops->state (s) == SINK_STARTED
+                   && now_ns (CLOCK_MONOTONIC) - t0 < timeout_ns)
+                nanosleep (&nap, NULL);
+        }
+
+        atomic_store_explicit (&out.cb.drop_to, ring_pos (&out.cb.ring),
+                               memory_order_release);
+
+        // so the ring has room for the new position at once
+        while (!paused && ring_used (&out.cb.ring) > 0
+               && s->ops->state (s) == SINK_STARTED
+               && now_ns (CLOCK_MONOTONIC) - t0 < timeout_ns)
+            nanosleep (&nap, NULL);
+    } else {
+        if (!paused)
+            s->ops->pause (s);
+
+        const long dropped = s->ops->flush (s);
+
+        if (dropped > 0) {
+            logdf ("flushed %ld frames on seek", dropped);
+        }
+
+        // running the queue dry is no reason to grow the buffer
+        out.buf.xruns = s->ops->xruns (s);
+        out.paused    = true;
+        out.fade.in   = true;
+        out.fade.pos  = 0;
+    }
+
+    const uint64_t t1 = now_ns (CLOCK_MONOTONIC);
+
+    stretch_reset (&out.st);
+
+    if (pipeline_seek (pl, frame) != NCAP_OK)
+        logwf ("WARN: seek to frame %" PRIu64 " failed. ending the track",
+               frame);
+
+    // the gap is no burst period. the new position is shown at once
+    timing_restart (&out.timing);
+    out.seek_t0 = paused ? 0 : atomic_load (&seek.ask_ns);
+    atomic_store_explicit (&seek.pos, pipeline_pos (pl, 0),
+                           memory_order_relaxed);
+
+    logif ("seeking to frame %" PRIu64 ": output dropped in %.1f ms, "
+           "pipeline moved in %.1f ms",
+           frame, (t1 - t0) / 1e6, (now_ns (CLOCK_MONOTONIC) - t1) / 1e6);
+}
+
+/**
+ * deep-buffer write loop for power saving. the sink buffer is as large as
+ * it goes; each wakeup tops it up in one write and then sleeps until it
+ * runs down to `NCAP_AUDIO_DEEP_LOW_MS`, so the thread wakes a few times a
+ * second instead of once a burst. pause, skip and close end the sleep.
+ */
+static int
+play_deep (struct pipeline_t *pl, size_t idx, struct gain_t *gain)
+{
+    const uint64_t       nstimeout = 1000000000;
+    struct sink_t *const s         = &out.sink;
+    const uint32_t       rate      = pl->sample_rate;
+    const int64_t        low = (int64_t)rate * NCAP_AUDIO_DEEP_LOW_MS / 1000;
+
+    long res = SINK_OK;
+    int  ret = NCAP_OK;
+    bool eof = false;
+    bool exact;
+    int  ctl;
+
+    while (res >= SINK_OK && !eof) {
+        if ((ctl = play_ctl (pl)) != CTL_PLAY) {
+            ret = ctl == CTL_INT ? NCAP_INT : NCAP_OK;
+            break;
+        }
+
+        const int64_t room = out.buf.siz - queued (rate, &exact);
+
+        if (room >= s->burst) {
+            const size_t n
+                = fill_burst (pl, out.bbuf, room, gain, idx, &eof);
+
+            if (n > 0) {
+                res = s->ops->write (s, out.bbuf, n, nstimeout);
+                out.written += res > 0 ? res : 0;
+            }
+
+            if (res == SINK_EDISC) {
+                sink_lost (NULL, SINK_EDISC);
+                res = SINK_OK;
+                continue;
+            }
+
+            // after a seek or a reopen, once the buffer has something again
+            if (out.paused && res >= SINK_OK) {
+                out.paused = false;
+                s->ops->start (s);
+                recover_heard ();
+            }
+
+            if (n > 0) {
+                seek_heard ();
+                tap_heard ();
+            }
+
+            tune_buf ();
+        }
+
+        int64_t q = queued (rate, &exact) - low;
+
+        // without a timestamp the estimate may be off: check back sooner
+        if (!exact && q > low)
+            q = low;
+
+        if (!eof && q > 0) {
+            playctl_sleep (&audio_ctl, PLAYCTL_PLAY,
+                           (uint64_t)q * 1000000000 / rate);
+            ++out.wakeups;
+        }
+    }
+
+    if (res < SINK_OK) {
+        logef ("Deep write loop stopped due to sink error with code %ld.",
+               res);
+        out.broken = true;
+    }
+
+    return ret;
+}
+
+/**
+ * feeds the ring behind `pull` a burst at a time, sleeping for a quarter of
+ * the ring whenever it is full, or until the controls change. returns at
+ * the end of the track (`eof` if priming already reached it) with the tail
+ * still queued, so the next track follows without a gap.
+ */
+static int
+play_callback (struct pipeline_t *pl, size_t idx, struct gain_t *gain,
+               bool eof)
+{
+    struct cb_state_t *const cb    = &out.cb;
+    struct sink_t *const     s     = &out.sink;
+    const size_t             burst = (size_t)s->burst * out.blk;
+
+    const uint64_t nap_ns = NCAP_AUDIO_RING_MS * 1000000ull / 4;
+
+#if DEBUG_TIMED
+    const time_t timer_start = time (NULL);
+    const time_t dur         = 5;
+#endif
+
+    int ret = NCAP_OK;
+    int ctl = CTL_PLAY;
+
+    while (!eof) {
+#if DEBUG_TIMED
+        if (time (NULL) - timer_start >= dur)
+            break;
+#endif
+
+        if ((ctl = play_ctl (pl)) != CTL_PLAY) {
+            ret = ctl == CTL_INT ? NCAP_INT : NCAP_OK;
+            break;
+        }
+
+        // in case the sink did not call back, as when a start failed
+        if (s->ops->state (s) == SINK_DISCONNECTED) {
+            sink_lost (NULL, SINK_EDISC);
+            continue;
+        }
+
+        // pause, seek, skip and close end the nap
+        if (ring_cap (&cb->ring) - ring_used (&cb->ring) < burst) {
+            playctl_sleep (&audio_ctl, PLAYCTL_PLAY, nap_ns);
+            ++out.wakeups;
+            continue;
+        }
+
+        const size_t n
+            = fill_burst (pl, out.bbuf, s->burst, gain, idx, &eof);
+
+        ring_write (&cb->ring, out.bbuf, n * out.blk);
+
+        // a reopened stream starts once the ring has something for it
+        if (out.paused && n > 0) {
+            out.paused = false;
+            s->ops->start (s);
+            recover_heard ();
+        }
+
+        // `pull` held silence since the seek's fade-out
+        if (out.seek_t0 != 0 && n > 0) {
+            atomic_store_explicit (&cb->fade_req, FADE_IN,
+                                   memory_order_release);
+            seek_heard ();
+        }
+
+        if (n > 0)
+            tap_heard ();
+
+        tune_buf ();
+    }
+
+    // a skipped track should not keep playing out of the ring
+    if (ret == NCAP_INT)
+        atomic_store_explicit (&cb->drop_to, ring_pos (&cb->ring),
+                               memory_order_release);
+
+    return ret;
+}
+
+/** waits for the sink to play out the ring, unless interrupted */
+static void
+drain (void)
+{
+    const struct timespec nap = { .tv_sec = 0, .tv_nsec = 5000000 }; // 5 ms
+
+    while (out.cbmode && ring_used (&out.cb.ring) >= out.cb.blk
+           && out.sink.ops->state (&out.sink) == SINK_STARTED
+           && !(playctl_get (&audio_ctl) & (PLAYCTL_INT | PLAYCTL_CLOSE)))
+        nanosleep (&nap, NULL);
+}
+
+/**
+ * @return the `DITHER_*` mode float and S32 output of `pl` is reduced to S16
+ * with. only power saving trades the resolution for bandwidth
+ */
+static int
+dither_mode (const struct pipeline_t *pl)
+{
+    uint8_t mode, perf;
+
+    config_get_force (mode, dither);
+    config_get_force (perf, aaudio_optimize);
+
+    if (perf != 2 || (pl->fmt != 2 && pl->fmt != 3)
+        || mode > DITHER_SHAPED)
+        return DITHER_OFF;
+
+    return mode;
+}
+
+/** @return `SINK_OK` if the selected sink opened for `pl`, pulling `cb` */
+static int
+open_sink (const struct pipeline_t *pl, struct cb_state_t *cb)
+{
+    const struct sink_cfg_t cfg = {
+        .fmt         = out.sink_fmt,
+        .channels    = out.channels,
+        .sample_rate = pl->sample_rate,
+        .perf        = out.perf,
+        .pull        = cb != NULL ? pull : NULL,
+        .error       = sink_lost,
+        .user        = cb,
+    };
+
+    memset (&out.sink, 0, sizeof out.sink);
+    out.sink.ops = sink_sel;
+    out.sink.arg = sink_arg;
+
+    return sink_sel->open (&out.sink, &cfg);
+}
+
+/**
+ * opens `out` for `pl`. power saving uses the deep-buffer write loop; else
+ * the callback mode falls back to the write loop if its ring or stream
+ * cannot be set up. the learned buffer size is reapplied, or else `carry`,
+ * one learned on another device, if there is one.
+ */
+static int
+out_open (const struct pipeline_t *pl,
+          const struct buf_learned_t *_Nullable carry)
+{
+    struct sink_t *const s = &out.sink;
+
+    out.open    = false;
+    out.cbmode  = false;
+    out.broken  = false;
+    out.written = 0;
+    out.paused  = false;
+
+    config_get_force (out.perf, aaudio_optimize);
+    out.deep = NCAP_AUDIO_DEEP && out.perf == 2;
+
+    // more channels than it mixes go to the sink as they are
+    out.mix_valid  = chmix_init (&out.mix, pl->channels, pl->layout)
+                     == CHMIX_OK;
+    out.mix_gen    = atomic_load (&config_mix_gen) - 1;
+    out.src_layout = pl->layout;
+    out.channels   = out.mix_valid ? out.mix.out : pl->channels;
+
+    if (!out.mix_valid)
+        logwf ("WARN: no mix for %" PRIu32 " channels. playing them as they "
+               "are",
+               pl->channels);
+
+    out.dither_mode = dither_mode (pl);
+
+    if (out.dither_mode != DITHER_OFF
+        && dither_init (&out.dither, pl->fmt, out.channels, out.dither_mode)
+               != DITHER_OK) {
+        logw ("WARN: dither_init failed. keeping the source's format");
+        out.dither_mode = DITHER_OFF;
+    }
+
+    if (out.dither_mode != DITHER_OFF) {
+        logvf ("reducing WAV format %d to S16 with %s dither", pl->fmt,
+               out.dither_mode == DITHER_SHAPED ? "shaped" : "TPDF");
+    }
+
+    out.sink_fmt = out.dither_mode != DITHER_OFF ? 1 : pl->fmt;
+    out.blk      = (out.sink_fmt == 1 ? sizeof (int16_t) : pl->width)
+              * out.channels;
+
+    // more channels than it keeps state for leave the eq bypassed
+    out.eq_valid = false;
+    eq_init (&out.eq, out.channels, pl->sample_rate);
+
+    // and other formats play at normal speed
+    out.st_valid = stretch_init (&out.st, pl->fmt, pl->channels,
+                                 pl->sample_rate)
+                   == STRETCH_OK;
+    out.speed_gen = atomic_load (&config_speed_gen) - 1;
+
+    if (!out.st_valid)
+        logw ("WARN: stretch_init failed. playing at normal speed");
+
+    out.fade.len = fade_len (pl->sample_rate);
+    out.fade.pos = out.fade.len;
+    out.fade.in  = true;
+
+#if NCAP_AUDIO_CALLBACK
+    const size_t ring_siz
+        = (size_t)pl->sample_rate * NCAP_AUDIO_RING_MS / 1000 * out.blk;
+
+    out.cb.blk      = out.blk;
+    out.cb.fmt      = out.sink_fmt;
+    out.cb.channels = out.channels;
+    out.cb.fade_cur = FADE_NONE;
+    out.cb.fade.len = out.fade.len;
+    out.cb.timing   = &out.timing;
+    atomic_store (&out.cb.drop_to, 0);
+    atomic_store (&out.cb.fade_req, FADE_NONE);
+
+    if (out.deep) {
+        // the callback runs every burst, which is what deep mode avoids
+    } else if (ring_init (&out.cb.ring, ring_siz) != RING_OK) {
+        logw ("WARN: ring_init failed. using the write loop");
+    } else if (open_sink (pl, &out.cb) != SINK_OK) {
+        logwf ("WARN: %s sink failed to open in callback mode. using the "
+               "write loop",
+               sink_sel->name);
+        ring_deinit (&out.cb.ring);
+    } else {
+        out.open   = true;
+        out.cbmode = true;
+    }
+#endif
+
+    if (!out.open) {
+        if (open_sink (pl, NULL) != SINK_OK) {
+            logef ("ERROR: %s sink failed to open", sink_sel->name);
+            stretch_deinit (&out.st);
+            out.st_valid = false;
+            return NCAP_EGEN;
+        }
+
+        out.open = true;
+    }
+
+    // a burst for the loops, or the whole buffer for the deep one, of
+    // source frames. a reused stream keeps it, so tracks allocate nothing
+    arena_reset (&out.arena);
+
+    if ((out.bbuf = arena_alloc (&out.arena, (size_t)s->cap * pl->blk))
+        == NULL) {
+        loge ("ERROR: arena_alloc failed for the sink buffer");
+        out_close (false);
+        return NCAP_EALLOC;
+    }
+
+    out.fmt         = pl->fmt;
+    out.sample_rate = pl->sample_rate;
+
+    timing_stream (&out.timing, out.sample_rate, s->burst);
+
+    char key[64];
+    snprintf (key, sizeof key, "%s:%d:%d:%" PRIu32 ":%" PRIu32 ":%hhu",
+              s->ops->name, s->device, out.sink_fmt, out.channels,
+              out.sample_rate, out.perf);
+    out.buf_key = trackdb_key (key);
+
+    // deep mode keeps the whole capacity, which is then also the floor
+    int32_t siz = out.deep ? s->ops->set_buf (s, s->cap) : s->ops->get_buf (s);
+    struct buf_learned_t l;
+
+    bufctl_init (&out.buf, s->burst, s->cap, siz,
+                 out.perf, now_ns (CLOCK_MONOTONIC));
+
+    bool learned = !out.deep
+                   && trackdb_get (out.buf_key, BUF_TAG, BUF_VER, &l,
+                                   sizeof l)
+                          == sizeof l;
+
+    if (!out.deep && !learned && carry != NULL) {
+        l       = *carry;
+        learned = true;
+    }
+
+    // a learned size is kept in bursts, in case the burst changed
+    if (learned && l.burst > 0) {
+        siz = (int32_t)((int64_t)l.siz * s->burst / l.burst);
+        bufctl_applied (&out.buf, s->ops->set_buf (s, siz));
+        logif ("using the learned buffer size of %d frames", out.buf.siz);
+    }
+
+    logif ("%s sink: %" PRIu32 " channels at %" PRIu32 " Hz, burst %d, "
+           "buffer %d of %d frames",
+           s->ops->name, out.channels, out.sample_rate, s->burst,
+           out.buf.siz, s->cap);
+
+    return NCAP_OK;
+}
+
+/** primes the ring so the first callbacks have data, then starts `out` */
+static void
+out_start (struct pipeline_t *pl, struct gain_t *gain, size_t idx, bool *eof)
+{
+    struct sink_t *const s = &out.sink;
+
+    if (out.cbmode) {
+        const size_t burst = (size_t)s->burst * out.blk;
+
+        while (!*eof
+               && ring_cap (&out.cb.ring) - ring_used (&out.cb.ring)
+                      >= burst) {
+            const size_t n
+                = fill_burst (pl, out.bbuf, s->burst, gain, idx, eof);
+
+            ring_write (&out.cb.ring, out.bbuf, n * out.blk);
+        }
+    }
+
+    s->ops->start (s);
+
+    logif ("Stream started in %s mode on the %s sink",
+           out.cbmode ? "callback" : out.deep ? "deep-buffer" : "write",
+           s->ops->name);
+}
+
+/** stops and closes `out`, letting the ring play out first with `drained` */
+static void
+out_close (bool drained)
+{
+    struct sink_t *const s = &out.sink;
+
+    if (!out.open)
+        return;
+
+    if (drained)
+        drain ();
+
+    // a stream whose device went away only closes
+    if (s->ops->state (s) != SINK_DISCONNECTED)
+        s->ops->stop (s);
+
+    s->ops->close (s);
+
+    // the sink does not pull after the close
+    if (out.cbmode)
+        ring_deinit (&out.cb.ring);
+
+    stretch_deinit (&out.st);
+    out.st_valid = false;
+    out.open     = false;
+}
+
+/**
+ * reopens `out` after its device went away, on whichever device is the
+ * default now, and plays on from the frame the old one stopped at: what was
+ * queued for it is read again. the buffer size learned on the old device
+ * carries over, in bursts, unless the new one has its own. the new stream
+ * fades in and is started by the loops after their next write.
+ *
+ * @return `NCAP_OK`, or `NCAP_EGEN` if no stream would open, or only in
+ * another mode than the loop's
+ */
+static int
+out_recover (struct pipeline_t *pl, bool paused)
+{
+    const struct timespec nap    = { .tv_sec = 0, .tv_nsec = 20000000 };
+    const uint64_t        t1     = now_ns (CLOCK_MONOTONIC);
+    const uint64_t        frame  = play_pos (pl);
+    const int32_t         device = out.sink.device;
+    const bool            cbmode = out.cbmode;
+    const bool            deep   = out.deep;
+    uint64_t              t0     = atomic_exchange (&disc_ns, 0);
+    int                   ret;
+
+    const struct buf_learned_t carry
+        = { .siz = out.buf.siz, .burst = out.buf.burst };
+
+    if (t0 == 0)
+        t0 = t1;
+
+    save_buf ();
+    out_close (false);
+
+    if (pipeline_seek (pl, frame) != NCAP_OK)
+        logwf ("WARN: seek back to frame %" PRIu64 " failed. ending the "
+               "track",
+               frame);
+
+    // the new route may take a moment to show up
+    for (int i = 1; (ret = out_open (pl, &carry)) != NCAP_OK
+                    && i < NCAP_AUDIO_RECOVER_TRIES;
+         ++i)
+        nanosleep (&nap, NULL);
+
+    if (ret != NCAP_OK) {
+        loge ("ERROR: no stream would reopen. stopping playback...");
+        return NCAP_EGEN;
+    }
+
+    // the loop under way cannot feed another mode; the next track can
+    if (out.cbmode != cbmode || out.deep != deep) {
+        logw ("WARN: stream reopened in another mode. ending the track");
+        out.broken = true;
+        return NCAP_EGEN;
+    }
+
+    out.paused   = true;
+    out.fade.in  = true;
+    out.fade.pos = 0;
+    atomic_store (&out.cb.fade_req, FADE_IN);
+
+    // the gap is no burst period, nor is it a seek's
+    timing_restart (&out.timing);
+    out.recover_t0 = paused ? 0 : t0;
+    out.seek_t0    = 0;
+    ++out.nrecover;
+    atomic_store_explicit (&seek.pos, frame, memory_order_relaxed);
+
+    logif ("device %d went away: reopened on device %d at frame %" PRIu64
+           " in %.1f ms",
+           device, out.sink.device, frame,
+           (now_ns (CLOCK_MONOTONIC) - t1) / 1e6);
+
+    return NCAP_OK;
+}
+
+int
+audio_play (struct pipeline_t *pl, size_t idx)
+{
+    const uint64_t t0 = now_ns (CLOCK_MONOTONIC);
+
+    // a device lost since the last track ended
+    const bool lost = playctl_take (&audio_ctl, PLAYCTL_DISC)
+                      || (out.open
+                          && out.sink.ops->state (&out.sink)
+                                 == SINK_DISCONNECTED);
+
+    // keep the stream if the track has the same format as the last one
+
+    const bool reuse = out.open && !out.broken && !lost
+                       && out.sink.ops == sink_sel
+                       && out.sink.arg == sink_arg && out.fmt == pl->fmt
+                       && out.dither_mode == dither_mode (pl)
+                       && out.mix.in == pl->channels
+                       && out.src_layout == pl->layout
+                       && out.sample_rate == pl->sample_rate;
+
+    struct gain_t gain;
+    bool          eof = false;
+
+    gain_init (&gain);
+
+    // a seek meant for the last track
+    if (playctl_take (&audio_ctl, PLAYCTL_SEEK)) {
+        logd ("dropping a seek asked for before the track started");
+    }
+
+    // the key and position change together for `audio_save_pos`
+    atomic_fetch_add (&saved.seq, 1);
+    atomic_store (&saved.key, pl->key);
+    atomic_store (&seek.len, pl->length);
+    atomic_store (&seek.pos, pipeline_pos (pl, 0));
+    atomic_fetch_add (&saved.seq, 1);
+    out.seek_t0 = 0;
+
+    // a tap while paused is heard on resuming, which is not its doing
+    out.tap_t0 = atomic_exchange (&tap_ask_ns, 0);
+
+    if (!(playctl_get (&audio_ctl) & PLAYCTL_PLAY))
+        out.tap_t0 = 0;
+
+    // what a skip left of the last track
+    stretch_reset (&out.st);
+
+    if (!reuse) {
+        out_close (!out.broken && !lost);
+
+        // the closed stream may have called back since
+        playctl_clear (&audio_ctl, PLAYCTL_DISC);
+        atomic_store (&disc_ns, 0);
+
+        if (out_open (pl, NULL) != NCAP_OK)
+            return NCAP_EGEN;
+
+        // a track resumed mid-way fades in instead of clicking
+        if (pl->start > 0) {
+            out.fade.pos = 0;
+            atomic_store (&out.cb.fade_req, FADE_IN);
+        }
+
+        out_start (pl, &gain, idx, &eof);
+
+        // primed with the track. the write loops are heard on their first
+        if (out.cbmode)
+            tap_heard ();
+
+        if (pl->start > 0 && out.resume_ns == 0) {
+            out.resume_ns = now_ns (CLOCK_MONOTONIC) - out.launch_ns;
+            logif ("resumed at frame %" PRIu64 ", %.1f ms after launch",
+                   pl->start, out.resume_ns / 1e6);
+        }
+    } else if (!(playctl_get (&audio_ctl) & PLAYCTL_PLAY)) {
+        // paused between tracks at the end of the list: finish the last one
+        // before the stream is paused
+        drain ();
+    }
+
+    struct sink_t *const s  = &out.sink;
+    const uint64_t       t1 = now_ns (CLOCK_MONOTONIC);
+
+    // a kill from here on resumes this track, not the last
+    save_pos (pl);
+
+    logif ("track transition: %s stream in %.1f ms, %.1f ms since the last "
+           "track",
+           reuse ? "reused" : "opened", (t1 - t0) / 1e6,
+           out.track_end_ns ? (t1 - out.track_end_ns) / 1e6 : 0.0);
+
+    const uint64_t cpu_start = now_ns (CLOCK_THREAD_CPUTIME_ID);
+    const uint64_t ncb       = atomic_load (&out.cb.ncb);
+    const uint64_t cb_ns     = atomic_load (&out.cb.cb_ns);
+    const uint64_t starved   = atomic_load (&out.cb.starved);
+    const int32_t  xruns     = s->ops->xruns (s);
+    const uint64_t ngrow     = out.buf.ngrow;
+    const uint64_t nshrink   = out.buf.nshrink;
+    const uint64_t wakeups   = out.wakeups;
+
+    int ret = out.cbmode ? play_callback (pl, idx, &gain, eof)
+              : out.deep ? play_deep (pl, idx, &gain)
+                         : play_write (pl, idx, &gain);
+
+    const uint64_t cpu_ns = now_ns (CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    const double   secs   = (now_ns (CLOCK_MONOTONIC) - t1) / 1e9;
+
+    logi ("audio play ended");
+
+    // per-track cost of the two modes, for comparing them on a device
+    if (out.cbmode) {
+        logif ("callback mode: feeder cpu %.1f ms, %" PRIu64
+               " callbacks taking %.1f ms, %" PRIu64 " starved, %d xruns",
+               cpu_ns / 1e6, atomic_load (&out.cb.ncb) - ncb,
+               (atomic_load (&out.cb.cb_ns) - cb_ns) / 1e6,
+               atomic_load (&out.cb.starved) - starved,
+               s->ops->xruns (s) - xruns);
+    } else {
+        logif ("%s mode: writer cpu %.1f ms, %d xruns",
+               out.deep ? "deep-buffer" : "write", cpu_ns / 1e6,
+               s->ops->xruns (s) - xruns);
+    }
+
+    logif ("feeder wakeups: %" PRIu64 ", %.1f/s",
+           out.wakeups - wakeups,
+           secs > 0 ? (out.wakeups - wakeups) / secs : 0.0);
+
+    logif ("buffer: %d frames (%d max, %d floor), %" PRIu64
+           " grown and %" PRIu64 " shrunk this track",
+           out.buf.siz, out.buf.siz_max, out.buf.min, out.buf.ngrow - ngrow,
+           out.buf.nshrink - nshrink);
+
+    save_buf ();
+
+    // a skip saves the next track's at its start
+    if (ret != NCAP_INT)
+        save_pos (pl);
+
+    // the stream stays open for the next track unless playback is over
+    if (out.broken || playctl_get (&audio_ctl) & PLAYCTL_CLOSE)
+        out_close (false);
+
+    out.track_end_ns = now_ns (CLOCK_MONOTONIC);
+
+    return ret;
+}
+
+void
+audio_set_sink (const struct sink_ops_t *ops, const char *arg)
+{
+    sink_sel = ops;
+    sink_arg = arg;
+}
 
 void
 audio_init (void)
 {
-    audio_isplay = false;
+    playctl_init (&audio_ctl, 0);
+    timing_init (&out.timing);
+    out.launch_ns     = now_ns (CLOCK_MONOTONIC);
+    out.resume_ns     = 0;
+    out.timing_log_ns = out.launch_ns;
+    arena_init (&out.arena, NCAP_AUDIO_ARENA_BYTES);
 }
 
-bool
-audio_isplaying (void)
+void
+audio_deinit (void)
+{
+    out_close (false);
+    arena_deinit (&out.arena);
+}
+
+void
+audio_timing (struct timing_stats_t *stats)
 {
-    return audio_isplay;
+    timing_stats (&out.timing, stats);
 }
 
 int
-audio_resume (void)
+audio_seek (uint64_t frame)
 {
-    int pth_ret;
+    logvf ("seeking to frame %" PRIu64 "...", frame);
 
-    logv ("resuming audio...");
+    atomic_store (&seek.to, frame);
+    atomic_store (&seek.ask_ns, now_ns (CLOCK_MONOTONIC));
+    playctl_set (&audio_ctl, PLAYCTL_SEEK);
+
+    return 0;
+}
 
-    if ((pth_ret = pthread_mutex_lock (&audio_mx)) != 0)
-        return pth_ret;
+void
+audio_save_pos (void)
+{
+    pthread_mutex_lock (&saved.mx);
 
-    audio_isplay = true;
-    pth_ret      = pthread_cond_signal (&audio_cv);
+    const uint32_t seq = atomic_load (&saved.seq);
+    const uint64_t key = atomic_load (&saved.key);
+    const uint64_t pos = atomic_load (&seek.pos);
 
-    pthread_mutex_unlock (&audio_mx);
+    // nothing played yet, a track starting, or nothing new
+    if (seq != 0 && !(seq & 1) && seq == atomic_load (&saved.seq)
+        && (key != saved.last_key || pos != saved.last_pos))
+        write_pos (key, pos);
 
-    return pth_ret;
+    pthread_mutex_unlock (&saved.mx);
 }
 
-int
-audio_pause (void)
+void
+audio_save_top (void)
 {
-    int pth_ret;
+    atomic_fetch_add (&saved.seq, 1);
+    atomic_store (&saved.key, 0);
+    atomic_store (&seek.pos, 0);
+    atomic_fetch_add (&saved.seq, 1);
+    playctl_set (&saved.ctl, SAVE_ASK);
+}
 
-    logv ("pausing audio...");
+bool
+audio_save_wait (uint64_t ms)
+{
+    playctl_sleep (&saved.ctl, 0, ms * 1000000ull);
 
-    if ((pth_ret = pthread_mutex_lock (&audio_mx)) != 0)
-        return pth_ret;
+    return playctl_take (&saved.ctl, SAVE_ASK);
+}
 
-    audio_isplay = false;
-    pth_ret      = pthread_cond_signal (&audio_cv);
+void
+audio_save_wake (void)
+{
+    playctl_set (&saved.ctl, SAVE_ASK);
+}
+
+void
+audio_position (uint64_t *pos, uint64_t *len)
+{
+    *pos = atomic_load_explicit (&seek.pos, memory_order_relaxed);
+    *len = atomic_load_explicit (&seek.len, memory_order_relaxed);
+}
+
+bool
+audio_isplaying (void)
+{
+    return playctl_get (&audio_ctl) & PLAYCTL_PLAY;
+}
 
-    pthread_mutex_unlock (&audio_mx);
+int
+audio_resume (void)
+{
+    logv ("resuming audio...");
 
+    playctl_set (&audio_ctl, PLAYCTL_PLAY);
+
+    return 0;
+}
+
+int
+audio_pause (void)
+{
+    logv ("pausing audio...");
+
+    playctl_clear (&audio_ctl, PLAYCTL_PLAY);
     render_sync_playback_button ();
 
-    return pth_ret;
+    return 0;
 }
 
 int
@@ -56,14 +1820,16 @@ audio_interrupt (void)
 {
     logv ("interrupting audio...");
 
-    int pth_ret;
-
-    if ((pth_ret = pthread_mutex_lock (&audio_int_mx)) != 0)
-        return pth_ret;
+    atomic_store (&tap_ask_ns, now_ns (CLOCK_MONOTONIC));
+    playctl_set (&audio_ctl, PLAYCTL_INT);
 
-    audio_int = true;
+    return 0;
+}
 
-    pth_ret = pthread_mutex_unlock (&audio_int_mx);
+void
+audio_close (void)
+{
+    logv ("closing audio...");
 
-    return pth_ret;
+    playctl_set (&audio_ctl, PLAYCTL_CLOSE);
 }
@@ -7,6 +7,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "trackdb.h"
+
 #define CWAV_HEADER_SIZ 44
 
 struct cwav_header_t {
@@ -48,6 +50,21 @@ struct cwav_header_t {
     } data;
 };
 
+/**
+ * silence trimmed from a track by the pipeline, in source frames. stored in
+ * the trackdb under `CWAV_TRIM_TAG` after a whole decode, and used to cut
+ * the track again without scanning it.
+ */
+struct cwav_trim_t {
+    uint64_t frames; // decoded frames before trimming
+    uint64_t head;   // frames dropped before the first kept frame
+    uint64_t tail;   // frames dropped after the last kept frame
+    uint64_t keep;   // frames of silence kept, which `head` and `tail` are for
+};
+
+#define CWAV_TRIM_TAG TRACKDB_TAG ('T', 'R', 'I', 'M')
+#define CWAV_TRIM_VER 2
+
 #define NCAP_INT    1
 #define NCAP_OK     0
 #define NCAP_EGEN   -1
@@ -60,17 +77,84 @@ struct cwav_header_t {
 extern int libav_cvt_cwav (const char *_Nonnull fn_in,
                            const char *_Nonnull fn_out);
 
-extern int audio_play (const char *_Nonnull fn, size_t idx);
+struct pipeline_t;
+struct sink_ops_t;
+struct timing_stats_t;
+
+/** plays `pl` to the end or until interrupted. `idx` picks the track volume */
+extern int audio_play (struct pipeline_t *_Nonnull pl, size_t idx);
 
 /** not thread safe */
 extern void audio_init (void);
 
+/** closes the output stream kept open between tracks. audio thread only */
+extern void audio_deinit (void);
+
+/**
+ * output latency, burst period and callback timing since `audio_init`.
+ * any thread
+ */
+extern void audio_timing (struct timing_stats_t *_Nonnull stats);
+
 extern bool audio_isplaying (void);
 
 extern int audio_resume (void);
 
 extern int audio_pause (void);
 
+/**
+ * ends the track playing at once, for the next one a tap chose. the time
+ * from here to the next track being heard is logged against
+ * `NCAP_AUDIO_TAP_MS`. any thread
+ */
 extern int audio_interrupt (void);
 
+/**
+ * jumps to source frame `frame` of the track playing, dropping the audio
+ * queued for output. the audio thread does it between bursts, or at once
+ * while paused. any thread
+ */
+extern int audio_seek (uint64_t frame);
+
+/**
+ * the source frame playing and the track's length in frames, 0 if unknown,
+ * as of the last `NCAP_AUDIO_POS_UI_MS`. any thread
+ */
+extern void audio_position (uint64_t *_Nonnull pos, uint64_t *_Nonnull len);
+
+/**
+ * saves the position shown by `audio_position` if it moved since the last
+ * save, so a kill resumes about there. the audio thread never writes it:
+ * this is for a thread that is not real-time, after `audio_save_wait`
+ */
+extern void audio_save_pos (void);
+
+/**
+ * publishes no track at its top for `audio_save_pos`, so a kill between
+ * tracks starts the next one from its top. the audio thread, between tracks
+ */
+extern void audio_save_top (void);
+
+/**
+ * sleeps until the audio thread asks for the position to be saved at once,
+ * on pause and at the ends of a track, until `audio_save_wake`, or for at
+ * most `ms`. one waiter at a time.
+ *
+ * @return whether it was asked or woken
+ */
+extern bool audio_save_wait (uint64_t ms);
+
+/** ends an `audio_save_wait` early */
+extern void audio_save_wake (void);
+
+/** stops playback for good, waking a paused player */
+extern void audio_close (void);
+
+/**
+ * plays through `ops` from the next stream opened on, AAudio by default.
+ * `arg` is passed on as `sink_t.arg`. audio thread only
+ */
+extern void audio_set_sink (const struct sink_ops_t *_Nonnull ops,
+                            const char *_Nullable arg);
+
 #endif // !AUDIO_H
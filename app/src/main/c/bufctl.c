@@ -0,0 +1,123 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bufctl.h"
+
+void
+bufctl_init (struct bufctl_t *this, int32_t burst, int32_t cap, int32_t siz,
+             uint8_t mode, uint64_t now_ns)
+{
+    memset (this, 0, sizeof *this);
+
+    this->burst = burst > 0 ? burst : 1;
+    this->cap   = cap > this->burst ? cap : this->burst;
+
+    switch (mode) {
+        case 1: // low latency
+            this->min           = 2 * this->burst;
+            this->decay_base_ns = 3000000000ull;
+            break;
+        case 2: // power saving: never below what the stream chose
+            this->min = siz > 2 * this->burst ? siz : 2 * this->burst;
+            this->decay_base_ns = 10000000000ull;
+            break;
+        case 0:
+        default:
+            this->min           = 2 * this->burst;
+            this->decay_base_ns = 5000000000ull;
+    }
+
+    if (this->min > this->cap)
+        this->min = this->cap;
+
+    this->siz      = siz < this->min ? this->min : siz > cap ? cap : siz;
+    this->siz_max  = this->siz;
+    this->decay_ns = this->decay_base_ns;
+    this->last_ns  = now_ns;
+}
+
+static void
+record (struct bufctl_t *this, uint64_t now_ns, uint8_t why)
+{
+    struct bufctl_event_t *e = &this->hist[this->nhist++ % BUFCTL_HIST];
+
+    e->t_ns  = now_ns;
+    e->siz   = this->siz;
+    e->xruns = this->xruns;
+    e->why   = why;
+}
+
+int32_t
+bufctl_update (struct bufctl_t *this, int32_t xruns, uint64_t now_ns)
+{
+    const int32_t new_xruns = xruns - this->xruns;
+
+    this->xruns = xruns;
+
+    if (new_xruns > 0) {
+        this->xruns_total += new_xruns;
+
+        // the last shrink went too far: be slower to try again
+        if (this->shrunk_last && now_ns - this->last_ns < this->decay_ns
+            && this->decay_ns < BUFCTL_DECAY_MAX * this->decay_base_ns)
+            this->decay_ns *= 2;
+
+        this->last_ns     = now_ns;
+        this->shrunk_last = false;
+
+        if (this->siz >= this->cap)
+            return 0;
+
+        int32_t step = this->siz / 2;
+
+        step = (step + this->burst - 1) / this->burst * this->burst;
+
+        if (step < this->burst)
+            step = this->burst;
+
+        if (step > this->cap - this->siz)
+            step = this->cap - this->siz;
+
+        this->siz += step;
+        ++this->ngrow;
+
+        if (this->siz > this->siz_max)
+            this->siz_max = this->siz;
+
+        record (this, now_ns, BUFCTL_GROW);
+
+        return this->siz;
+    }
+
+    if (now_ns - this->last_ns >= this->decay_ns
+        && this->siz - this->burst >= this->min) {
+        this->siz -= this->burst;
+        this->last_ns     = now_ns;
+        this->shrunk_last = true;
+        ++this->nshrink;
+
+        record (this, now_ns, BUFCTL_SHRINK);
+
+        return this->siz;
+    }
+
+    return 0;
+}
+
+void
+bufctl_applied (struct bufctl_t *this, int32_t siz)
+{
+    if (siz > 0)
+        this->siz = siz;
+
+    if (this->siz > this->siz_max)
+        this->siz_max = this->siz;
+}
+
+const struct bufctl_event_t *
+bufctl_last (const struct bufctl_t *this)
+{
+    return this->nhist ? &this->hist[(this->nhist - 1) % BUFCTL_HIST] : NULL;
+}
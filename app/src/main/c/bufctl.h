@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef BUFCTL_H
+#define BUFCTL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * output buffer size controller. grows the buffer by half (at least a
+ * burst) on new xruns and takes a burst back off after a stretch of clean
+ * playback, down to a floor set by the performance mode. a shrink that is
+ * soon followed by an xrun doubles the clean stretch needed for the next
+ * one, so the size settles instead of oscillating.
+ *
+ * pure bookkeeping: the caller reads the xrun counter and applies sizes.
+ */
+
+/** decisions kept for `bufctl_t.hist` */
+#define BUFCTL_HIST 32
+
+/** the clean stretch never grows beyond this many times its base */
+#define BUFCTL_DECAY_MAX 8
+
+#define BUFCTL_GROW   0
+#define BUFCTL_SHRINK 1
+
+struct bufctl_event_t {
+    uint64_t t_ns;
+    int32_t  siz;   // frames, after the decision
+    int32_t  xruns; // stream xrun counter at the time
+    uint8_t  why;   // `BUFCTL_GROW` or `BUFCTL_SHRINK`
+};
+
+struct bufctl_t {
+    int32_t  burst;
+    int32_t  cap;
+    int32_t  min;
+    int32_t  siz;
+    uint64_t decay_base_ns;
+    uint64_t decay_ns;    // clean playback needed before a shrink
+    uint64_t last_ns;     // last xrun or size change
+    int32_t  xruns;       // last seen xrun counter
+    bool     shrunk_last; // the last change was a shrink
+
+    // metrics
+    uint64_t ngrow;
+    uint64_t nshrink;
+    int32_t  xruns_total;
+    int32_t  siz_max;
+    size_t   nhist; // decisions so far; the last `BUFCTL_HIST` are kept
+    struct bufctl_event_t hist[BUFCTL_HIST];
+};
+
+/**
+ * `siz` is the stream's current (or a learned) size, `mode` the
+ * `ncap_config.aaudio_optimize` code: low latency may shrink to two bursts
+ * after 3 s clean, none to two bursts after 5 s, and power saving never
+ * below the size the stream opened with, after 10 s.
+ */
+extern void bufctl_init (struct bufctl_t *_Nonnull this, int32_t burst,
+                         int32_t cap, int32_t siz, uint8_t mode,
+                         uint64_t now_ns);
+
+/**
+ * feeds the stream's xrun counter.
+ *
+ * @return a new size to apply, or 0 to keep the current one
+ */
+extern int32_t bufctl_update (struct bufctl_t *_Nonnull this, int32_t xruns,
+                              uint64_t now_ns);
+
+/** records the size the stream actually took, which it may clamp */
+extern void bufctl_applied (struct bufctl_t *_Nonnull this, int32_t siz);
+
+/** the most recent decision, or NULL */
+extern const struct bufctl_event_t *_Nullable bufctl_last (
+    const struct bufctl_t *_Nonnull this);
+
+#endif // !BUFCTL_H
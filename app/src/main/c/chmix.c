@@ -0,0 +1,759 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "chmix.h"
+#include "properties.h"
+
+/** -3 dB */
+#define M3DB 0.70710678f
+
+/** the layouts libav takes for a channel count, 1 to `CHMIX_MAX_IN` */
+static const uint64_t layouts[CHMIX_MAX_IN + 1] = {
+    0,
+    CHMIX_FC,                                         // mono
+    CHMIX_FL | CHMIX_FR,                              // stereo
+    CHMIX_FL | CHMIX_FR | CHMIX_LFE,                  // 2.1
+    CHMIX_FL | CHMIX_FR | CHMIX_FC | CHMIX_BC,        // 4.0
+    CHMIX_FL | CHMIX_FR | CHMIX_FC | CHMIX_BL | CHMIX_BR, // 5.0
+    CHMIX_FL | CHMIX_FR | CHMIX_FC | CHMIX_LFE | CHMIX_BL | CHMIX_BR, // 5.1
+    CHMIX_FL | CHMIX_FR | CHMIX_FC | CHMIX_LFE | CHMIX_BC | CHMIX_SL
+        | CHMIX_SR, // 6.1
+    CHMIX_FL | CHMIX_FR | CHMIX_FC | CHMIX_LFE | CHMIX_BL | CHMIX_BR
+        | CHMIX_SL | CHMIX_SR, // 7.1
+};
+
+/** where a speaker goes in stereo, before the scaling down */
+static void
+place (uint64_t bit, float *l, float *r)
+{
+    *l = *r = 0;
+
+    if (bit & (CHMIX_FL | CHMIX_FLC | CHMIX_TFL))
+        *l = 1;
+    else if (bit & (CHMIX_FR | CHMIX_FRC | CHMIX_TFR))
+        *r = 1;
+    else if (bit & (CHMIX_FC | CHMIX_TC | CHMIX_TFC))
+        *l = *r = M3DB;
+    else if (bit & (CHMIX_BL | CHMIX_SL | CHMIX_TBL))
+        *l = M3DB;
+    else if (bit & (CHMIX_BR | CHMIX_SR | CHMIX_TBR))
+        *r = M3DB;
+    else if (bit & (CHMIX_BC | CHMIX_TBC))
+        *l = *r = M3DB * M3DB;
+
+    // LFE and the rest are dropped
+}
+
+/** the matrix before `mono` and `balance` */
+static void
+downmix (const struct chmix_t *this, float m[CHMIX_MAX_OUT][CHMIX_MAX_IN])
+{
+    memset (m, 0, sizeof (float[CHMIX_MAX_OUT][CHMIX_MAX_IN]));
+
+    if (this->in == this->out) {
+        for (uint32_t c = 0; c < this->out; ++c)
+            m[c][c] = 1;
+
+        return;
+    }
+
+    uint64_t rest = this->layout;
+    float    suml = 0, sumr = 0;
+
+    for (uint32_t i = 0; i < this->in; ++i) {
+        const uint64_t bit = rest & -rest;
+
+        rest &= rest - 1;
+        place (bit, &m[0][i], &m[1][i]);
+        suml += m[0][i];
+        sumr += m[1][i];
+    }
+
+    // full scale on every channel at once is full scale out
+    const float sum = suml > sumr ? suml : sumr;
+
+    for (uint32_t i = 0; sum > 1 && i < this->in; ++i) {
+        m[0][i] /= sum;
+        m[1][i] /= sum;
+    }
+}
+
+/** `m` to the fixed path's coefficients */
+static void
+quantize_m (struct chmix_t *this)
+{
+    for (uint32_t o = 0; o < this->out; ++o)
+        for (uint32_t i = 0; i < this->in; ++i) {
+            const long      q15 = lrintf (this->m[o][i] * 32768.0f);
+            const long long q31 = llrintf (this->m[o][i] * 2147483648.0f);
+
+            this->m15[o][i] = q15 > INT16_MAX ? INT16_MAX : q15;
+            this->m31[o][i] = q31 > INT32_MAX ? INT32_MAX : q31;
+        }
+}
+
+int
+chmix_init (struct chmix_t *this, uint32_t channels, uint64_t layout)
+{
+    if (channels == 0 || channels > CHMIX_MAX_IN)
+        return CHMIX_ERR;
+
+    memset (this, 0, sizeof *this);
+    this->in     = channels;
+    this->out    = channels > CHMIX_MAX_OUT ? CHMIX_MAX_OUT : channels;
+    this->layout = __builtin_popcountll (layout) == (int)channels
+                       ? layout
+                       : layouts[channels];
+
+    downmix (this, this->m);
+    memcpy (this->target, this->m, sizeof this->m);
+    quantize_m (this);
+
+    return CHMIX_OK;
+}
+
+void
+chmix_set (struct chmix_t *this, bool mono, int8_t balance)
+{
+    float(*const t)[CHMIX_MAX_IN] = this->target;
+
+    this->mono    = mono;
+    this->balance = balance < -100 ? -100 : balance > 100 ? 100 : balance;
+
+    downmix (this, t);
+
+    if (this->out == 2) {
+        const float gl = this->balance > 0 ? 1 - this->balance / 100.0f : 1;
+        const float gr = this->balance < 0 ? 1 + this->balance / 100.0f : 1;
+
+        for (uint32_t i = 0; i < this->in; ++i) {
+            if (mono)
+                t[0][i] = t[1][i] = (t[0][i] + t[1][i]) / 2;
+
+            t[0][i] *= gl;
+            t[1][i] *= gr;
+        }
+    }
+
+    if (this->set) {
+        this->steps = CHMIX_GLIDE;
+    } else {
+        memcpy (this->m, t, sizeof this->m);
+        quantize_m (this);
+        this->set = true;
+    }
+}
+
+bool
+chmix_active (const struct chmix_t *this)
+{
+    if (this->steps > 0 || this->in != this->out)
+        return true;
+
+    for (uint32_t o = 0; o < this->out; ++o)
+        for (uint32_t i = 0; i < this->in; ++i)
+            if (this->m[o][i] != (o == i))
+                return true;
+
+    return false;
+}
+
+/** moves `m` a step of the glide towards `target`, landing on the last */
+static void
+glide_m (struct chmix_t *this)
+{
+    for (uint32_t o = 0; o < this->out; ++o)
+        for (uint32_t i = 0; i < this->in; ++i)
+            this->m[o][i]
+                += (this->target[o][i] - this->m[o][i]) / this->steps;
+
+    --this->steps;
+    quantize_m (this);
+}
+
+/** any shape, a frame at a time. the frame is read before it is written */
+static void
+mix_any (const struct chmix_t *this, const float *src, float *dst,
+         size_t nframes)
+{
+    const uint32_t in = this->in, out = this->out;
+
+    for (size_t f = 0; f < nframes; ++f, src += in, dst += out) {
+        float x[CHMIX_MAX_IN];
+        float y[CHMIX_MAX_OUT] = { 0 };
+
+        memcpy (x, src, in * sizeof *x);
+
+        for (uint32_t o = 0; o < out; ++o)
+            for (uint32_t i = 0; i < in; ++i)
+                y[o] += this->m[o][i] * x[i];
+
+        memcpy (dst, y, out * sizeof *y);
+    }
+}
+
+/**
+ * 2->2. two frames L0 R0 L1 R1 to a vector: each output is the vector
+ * times the diagonal plus its pairs swapped times the other diagonal
+ */
+static void
+mix_2_2 (const struct chmix_t *this, const float *src, float *dst,
+         size_t nframes)
+{
+    const float (*const m)[CHMIX_MAX_IN] = this->m;
+    const size_t n                       = nframes * 2;
+    size_t       i                       = 0;
+
+#if defined(__ARM_NEON)
+    const float       dg[4] = { m[0][0], m[1][1], m[0][0], m[1][1] };
+    const float       sw[4] = { m[0][1], m[1][0], m[0][1], m[1][0] };
+    const float32x4_t vd    = vld1q_f32 (dg);
+    const float32x4_t vs    = vld1q_f32 (sw);
+
+    for (; i + 8 <= n; i += 8) {
+        const float32x4_t x0 = vld1q_f32 (src + i);
+        const float32x4_t x1 = vld1q_f32 (src + i + 4);
+
+        vst1q_f32 (dst + i,
+                   vmlaq_f32 (vmulq_f32 (x0, vd), vrev64q_f32 (x0), vs));
+        vst1q_f32 (dst + i + 4,
+                   vmlaq_f32 (vmulq_f32 (x1, vd), vrev64q_f32 (x1), vs));
+    }
+#elif defined(__SSE2__)
+    const __m128 vd = _mm_setr_ps (m[0][0], m[1][1], m[0][0], m[1][1]);
+    const __m128 vs = _mm_setr_ps (m[0][1], m[1][0], m[0][1], m[1][0]);
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128 x0 = _mm_loadu_ps (src + i);
+        const __m128 x1 = _mm_loadu_ps (src + i + 4);
+        const __m128 s0 = _mm_shuffle_ps (x0, x0, _MM_SHUFFLE (2, 3, 0, 1));
+        const __m128 s1 = _mm_shuffle_ps (x1, x1, _MM_SHUFFLE (2, 3, 0, 1));
+
+        _mm_storeu_ps (dst + i, _mm_add_ps (_mm_mul_ps (x0, vd),
+                                            _mm_mul_ps (s0, vs)));
+        _mm_storeu_ps (dst + i + 4, _mm_add_ps (_mm_mul_ps (x1, vd),
+                                                _mm_mul_ps (s1, vs)));
+    }
+#endif
+
+    for (; i < n; i += 2) {
+        const float l = src[i], r = src[i + 1];
+
+        dst[i]     = m[0][0] * l + m[0][1] * r;
+        dst[i + 1] = m[1][0] * l + m[1][1] * r;
+    }
+}
+
+/**
+ * 2*`npairs`->2, two frames at a time: the inputs in pairs, as in
+ * `mix_2_2`, a pair of each frame to a vector. both frames are read before
+ * their outputs are stored over the first.
+ */
+static inline void
+mix_pairs (const struct chmix_t *this, const float *src, float *dst,
+           size_t nframes, const uint32_t npairs)
+{
+    const float (*const m)[CHMIX_MAX_IN] = this->m;
+    const size_t in                      = 2 * npairs;
+    size_t       f                       = 0;
+
+#if defined(__ARM_NEON)
+    float32x4_t vd[CHMIX_MAX_IN / 2], vs[CHMIX_MAX_IN / 2];
+
+    for (uint32_t k = 0; k < npairs; ++k) {
+        const float dg[4] = { m[0][2 * k], m[1][2 * k + 1], m[0][2 * k],
+                              m[1][2 * k + 1] };
+        const float sw[4] = { m[0][2 * k + 1], m[1][2 * k], m[0][2 * k + 1],
+                              m[1][2 * k] };
+
+        vd[k] = vld1q_f32 (dg);
+        vs[k] = vld1q_f32 (sw);
+    }
+
+    for (; f + 2 <= nframes; f += 2) {
+        const float *const a   = src + f * in;
+        float32x4_t        acc = vdupq_n_f32 (0);
+
+        for (uint32_t k = 0; k < npairs; ++k) {
+            const float32x4_t x = vcombine_f32 (vld1_f32 (a + 2 * k),
+                                                vld1_f32 (a + in + 2 * k));
+
+            acc = vmlaq_f32 (acc, x, vd[k]);
+            acc = vmlaq_f32 (acc, vrev64q_f32 (x), vs[k]);
+        }
+
+        vst1q_f32 (dst + f * 2, acc);
+    }
+#elif defined(__SSE2__)
+    __m128 vd[CHMIX_MAX_IN / 2], vs[CHMIX_MAX_IN / 2];
+
+    for (uint32_t k = 0; k < npairs; ++k) {
+        vd[k] = _mm_setr_ps (m[0][2 * k], m[1][2 * k + 1], m[0][2 * k],
+                             m[1][2 * k + 1]);
+        vs[k] = _mm_setr_ps (m[0][2 * k + 1], m[1][2 * k], m[0][2 * k + 1],
+                             m[1][2 * k]);
+    }
+
+    for (; f + 2 <= nframes; f += 2) {
+        const float *const a   = src + f * in;
+        __m128             acc = _mm_setzero_ps ();
+
+        for (uint32_t k = 0; k < npairs; ++k) {
+            const __m128 x = _mm_castpd_ps (
+                _mm_loadh_pd (_mm_load_sd ((const double *)(a + 2 * k)),
+                              (const double *)(a + in + 2 * k)));
+            const __m128 s = _mm_shuffle_ps (x, x, _MM_SHUFFLE (2, 3, 0, 1));
+
+            acc = _mm_add_ps (acc, _mm_add_ps (_mm_mul_ps (x, vd[k]),
+                                               _mm_mul_ps (s, vs[k])));
+        }
+
+        _mm_storeu_ps (dst + f * 2, acc);
+    }
+#endif
+
+    mix_any (this, src + f * in, dst + f * 2, nframes - f);
+}
+
+static void
+mix_6_2 (const struct chmix_t *this, const float *src, float *dst,
+         size_t nframes)
+{
+    mix_pairs (this, src, dst, nframes, 3);
+}
+
+static void
+mix_8_2 (const struct chmix_t *this, const float *src, float *dst,
+         size_t nframes)
+{
+    mix_pairs (this, src, dst, nframes, 4);
+}
+
+static void
+mix (const struct chmix_t *this, const float *src, float *dst,
+     size_t nframes)
+{
+    if (this->out != 2)
+        mix_any (this, src, dst, nframes);
+    else if (this->in == 2)
+        mix_2_2 (this, src, dst, nframes);
+    else if (this->in == 6)
+        mix_6_2 (this, src, dst, nframes);
+    else if (this->in == 8)
+        mix_8_2 (this, src, dst, nframes);
+    else
+        mix_any (this, src, dst, nframes);
+}
+
+static void
+from_s16 (float *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16 (src + i);
+
+        vst1q_f32 (dst + i, vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (x))));
+        vst1q_f32 (dst + i + 4,
+                   vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (x))));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128 ((const __m128i *)(src + i));
+
+        _mm_storeu_ps (dst + i, _mm_cvtepi32_ps (_mm_srai_epi32 (
+                                    _mm_unpacklo_epi16 (x, x), 16)));
+        _mm_storeu_ps (dst + i + 4, _mm_cvtepi32_ps (_mm_srai_epi32 (
+                                        _mm_unpackhi_epi16 (x, x), 16)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i];
+}
+
+static inline int16_t
+round_s16 (float v)
+{
+    return v >= INT16_MAX   ? INT16_MAX
+           : v <= INT16_MIN ? INT16_MIN
+                            : lrintf (v);
+}
+
+/** rounds to nearest even, as `lrintf`, and saturates */
+static void
+to_s16 (int16_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        const int32x4_t lo = vcvtnq_s32_f32 (vld1q_f32 (src + i));
+        const int32x4_t hi = vcvtnq_s32_f32 (vld1q_f32 (src + i + 4));
+
+        vst1q_s16 (dst + i, vcombine_s16 (vqmovn_s32 (lo), vqmovn_s32 (hi)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i lo = _mm_cvtps_epi32 (_mm_loadu_ps (src + i));
+        const __m128i hi = _mm_cvtps_epi32 (_mm_loadu_ps (src + i + 4));
+
+        _mm_storeu_si128 ((__m128i *)(dst + i), _mm_packs_epi32 (lo, hi));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = round_s16 (src[i]);
+}
+
+/** the largest float below 2^31 is 2^31 - 128 */
+static inline int32_t
+round_s32 (float v)
+{
+    return v >= 2147483648.0f ? INT32_MAX : v < -2147483648.0f ? INT32_MIN
+                                                               : lrintf (v);
+}
+
+static void
+from_s32 (float *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32 (dst + i, vcvtq_f32_s32 (vld1q_s32 (src + i)));
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps (dst + i, _mm_cvtepi32_ps (_mm_loadu_si128 (
+                                    (const __m128i *)(src + i))));
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i];
+}
+
+/** as `to_s16`. SSE2 gives `INT32_MIN` past either end, so the top is cut */
+static void
+to_s32 (int32_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32 (dst + i, vcvtnq_s32_f32 (vld1q_f32 (src + i)));
+#elif defined(__SSE2__)
+    const __m128 top = _mm_set1_ps (2147483520.0f);
+
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128 ((__m128i *)(dst + i),
+                          _mm_cvtps_epi32 (
+                              _mm_min_ps (_mm_loadu_ps (src + i), top)));
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = round_s32 (src[i]);
+}
+
+static inline int16_t
+sat_q15 (int32_t v)
+{
+    return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+}
+
+static inline int32_t
+sat_q31 (int64_t v)
+{
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : v;
+}
+
+/**
+ * S16 by `m15`, any shape, a frame at a time, rounding half up as
+ * `vqrshrn` does. the frame is read before it is written
+ */
+static void
+mix_any_q15 (const struct chmix_t *this, const int16_t *src, int16_t *dst,
+             size_t nframes)
+{
+    const uint32_t in = this->in, out = this->out;
+
+    for (size_t f = 0; f < nframes; ++f, src += in, dst += out) {
+        int32_t y[CHMIX_MAX_OUT] = { 0 };
+
+        for (uint32_t o = 0; o < out; ++o)
+            for (uint32_t i = 0; i < in; ++i)
+                y[o] += this->m15[o][i] * src[i];
+
+        for (uint32_t o = 0; o < out; ++o)
+            dst[o] = sat_q15 ((y[o] + (1 << 14)) >> 15);
+    }
+}
+
+/** S32 by `m31`, as `mix_any_q15` */
+static void
+mix_any_q31 (const struct chmix_t *this, const int32_t *src, int32_t *dst,
+             size_t nframes)
+{
+    const uint32_t in = this->in, out = this->out;
+
+    for (size_t f = 0; f < nframes; ++f, src += in, dst += out) {
+        int64_t y[CHMIX_MAX_OUT] = { 0 };
+
+        for (uint32_t o = 0; o < out; ++o)
+            for (uint32_t i = 0; i < in; ++i)
+                y[o] += (int64_t)this->m31[o][i] * src[i];
+
+        for (uint32_t o = 0; o < out; ++o)
+            dst[o] = sat_q31 ((y[o] + (1ll << 30)) >> 31);
+    }
+}
+
+/** 2->2 on S16, four frames to a vector, widened as in `mix_2_2` */
+static void
+mix_2_2_q15 (const struct chmix_t *this, const int16_t *src, int16_t *dst,
+             size_t nframes)
+{
+    const size_t n = nframes * 2;
+    size_t       i = 0;
+
+#if defined(__ARM_NEON)
+    const int16_t(*const m)[CHMIX_MAX_IN] = this->m15;
+    const int16_t   dg[4] = { m[0][0], m[1][1], m[0][0], m[1][1] };
+    const int16_t   sw[4] = { m[0][1], m[1][0], m[0][1], m[1][0] };
+    const int16x4_t vd    = vld1_s16 (dg);
+    const int16x4_t vs    = vld1_s16 (sw);
+
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16 (src + i);
+        const int16x8_t s = vrev32q_s16 (x);
+        const int32x4_t lo
+            = vmlal_s16 (vmull_s16 (vget_low_s16 (x), vd), vget_low_s16 (s),
+                         vs);
+        const int32x4_t hi = vmlal_s16 (vmull_s16 (vget_high_s16 (x), vd),
+                                        vget_high_s16 (s), vs);
+
+        vst1q_s16 (dst + i, vcombine_s16 (vqrshrn_n_s32 (lo, 15),
+                                          vqrshrn_n_s32 (hi, 15)));
+    }
+#endif
+
+    mix_any_q15 (this, src + i, dst + i, (n - i) / 2);
+}
+
+/** 2*`npairs`->2 on S16, two frames at a time as in `mix_pairs` */
+static inline void
+mix_pairs_q15 (const struct chmix_t *this, const int16_t *src, int16_t *dst,
+               size_t nframes, const uint32_t npairs)
+{
+    const size_t in = 2 * npairs;
+    size_t       f  = 0;
+
+#if defined(__ARM_NEON)
+    const int16_t(*const m)[CHMIX_MAX_IN] = this->m15;
+    int16x4_t vd[CHMIX_MAX_IN / 2], vs[CHMIX_MAX_IN / 2];
+
+    for (uint32_t k = 0; k < npairs; ++k) {
+        const int16_t dg[4] = { m[0][2 * k], m[1][2 * k + 1], m[0][2 * k],
+                                m[1][2 * k + 1] };
+        const int16_t sw[4] = { m[0][2 * k + 1], m[1][2 * k],
+                                m[0][2 * k + 1], m[1][2 * k] };
+
+        vd[k] = vld1_s16 (dg);
+        vs[k] = vld1_s16 (sw);
+    }
+
+    for (; f + 2 <= nframes; f += 2) {
+        const int16_t *const a   = src + f * in;
+        int32x4_t            acc = vdupq_n_s32 (0);
+
+        for (uint32_t k = 0; k < npairs; ++k) {
+            // a pair of each frame, a 32-bit lane each
+            int32x2_t p = vld1_dup_s32 ((const int32_t *)(a + 2 * k));
+
+            p = vld1_lane_s32 ((const int32_t *)(a + in + 2 * k), p, 1);
+
+            const int16x4_t x = vreinterpret_s16_s32 (p);
+
+            acc = vmlal_s16 (acc, x, vd[k]);
+            acc = vmlal_s16 (acc, vrev32_s16 (x), vs[k]);
+        }
+
+        vst1_s16 (dst + f * 2, vqrshrn_n_s32 (acc, 15));
+    }
+#endif
+
+    mix_any_q15 (this, src + f * in, dst + f * 2, nframes - f);
+}
+
+/** 2->2 on S32, two frames to a vector */
+static void
+mix_2_2_q31 (const struct chmix_t *this, const int32_t *src, int32_t *dst,
+             size_t nframes)
+{
+    const size_t n = nframes * 2;
+    size_t       i = 0;
+
+#if defined(__ARM_NEON)
+    const int32_t(*const m)[CHMIX_MAX_IN] = this->m31;
+    const int32_t   dg[2] = { m[0][0], m[1][1] };
+    const int32_t   sw[2] = { m[0][1], m[1][0] };
+    const int32x2_t vd    = vld1_s32 (dg);
+    const int32x2_t vs    = vld1_s32 (sw);
+
+    for (; i + 4 <= n; i += 4) {
+        const int32x4_t x = vld1q_s32 (src + i);
+        const int32x4_t s = vrev64q_s32 (x);
+        const int64x2_t lo
+            = vmlal_s32 (vmull_s32 (vget_low_s32 (x), vd), vget_low_s32 (s),
+                         vs);
+        const int64x2_t hi = vmlal_s32 (vmull_s32 (vget_high_s32 (x), vd),
+                                        vget_high_s32 (s), vs);
+
+        vst1q_s32 (dst + i, vcombine_s32 (vqrshrn_n_s64 (lo, 31),
+                                          vqrshrn_n_s64 (hi, 31)));
+    }
+#endif
+
+    mix_any_q31 (this, src + i, dst + i, (n - i) / 2);
+}
+
+/** 2*`npairs`->2 on S32, a frame at a time */
+static inline void
+mix_pairs_q31 (const struct chmix_t *this, const int32_t *src, int32_t *dst,
+               size_t nframes, const uint32_t npairs)
+{
+    const size_t in = 2 * npairs;
+    size_t       f  = 0;
+
+#if defined(__ARM_NEON)
+    const int32_t(*const m)[CHMIX_MAX_IN] = this->m31;
+    int32x2_t vd[CHMIX_MAX_IN / 2], vs[CHMIX_MAX_IN / 2];
+
+    for (uint32_t k = 0; k < npairs; ++k) {
+        const int32_t dg[2] = { m[0][2 * k], m[1][2 * k + 1] };
+        const int32_t sw[2] = { m[0][2 * k + 1], m[1][2 * k] };
+
+        vd[k] = vld1_s32 (dg);
+        vs[k] = vld1_s32 (sw);
+    }
+
+    for (; f < nframes; ++f) {
+        const int32_t *const a   = src + f * in;
+        int64x2_t            acc = vdupq_n_s64 (0);
+
+        for (uint32_t k = 0; k < npairs; ++k) {
+            const int32x2_t x = vld1_s32 (a + 2 * k);
+
+            acc = vmlal_s32 (acc, x, vd[k]);
+            acc = vmlal_s32 (acc, vrev64_s32 (x), vs[k]);
+        }
+
+        vst1_s32 (dst + f * 2, vqrshrn_n_s64 (acc, 31));
+    }
+#endif
+
+    mix_any_q31 (this, src + f * in, dst + f * 2, nframes - f);
+}
+
+static void
+mix_q15 (const struct chmix_t *this, const int16_t *src, int16_t *dst,
+         size_t nframes)
+{
+    if (this->out != 2)
+        mix_any_q15 (this, src, dst, nframes);
+    else if (this->in == 2)
+        mix_2_2_q15 (this, src, dst, nframes);
+    else if (this->in == 6)
+        mix_pairs_q15 (this, src, dst, nframes, 3);
+    else if (this->in == 8)
+        mix_pairs_q15 (this, src, dst, nframes, 4);
+    else
+        mix_any_q15 (this, src, dst, nframes);
+}
+
+static void
+mix_q31 (const struct chmix_t *this, const int32_t *src, int32_t *dst,
+         size_t nframes)
+{
+    if (this->out != 2)
+        mix_any_q31 (this, src, dst, nframes);
+    else if (this->in == 2)
+        mix_2_2_q31 (this, src, dst, nframes);
+    else if (this->in == 6)
+        mix_pairs_q31 (this, src, dst, nframes, 3);
+    else if (this->in == 8)
+        mix_pairs_q31 (this, src, dst, nframes, 4);
+    else
+        mix_any_q31 (this, src, dst, nframes);
+}
+
+static void
+mix_blocks_flt (struct chmix_t *this, void *buf, int fmt, size_t nframes)
+{
+    float          tmp[CHMIX_BLK * CHMIX_MAX_IN];
+    const uint32_t in = this->in, out = this->out;
+
+    // each block's output ends before the next block's input starts
+    for (size_t f = 0; f < nframes; f += CHMIX_BLK) {
+        const size_t n = nframes - f < CHMIX_BLK ? nframes - f : CHMIX_BLK;
+
+        if (this->steps > 0)
+            glide_m (this);
+
+        if (fmt == 1) {
+            from_s16 (tmp, (int16_t *)buf + f * in, n * in);
+            mix (this, tmp, tmp, n);
+            to_s16 ((int16_t *)buf + f * out, tmp, n * out);
+        } else if (fmt == 2) {
+            from_s32 (tmp, (int32_t *)buf + f * in, n * in);
+            mix (this, tmp, tmp, n);
+            to_s32 ((int32_t *)buf + f * out, tmp, n * out);
+        } else {
+            mix (this, (float *)buf + f * in, (float *)buf + f * out, n);
+        }
+    }
+}
+
+/** the integer formats in place, without float. float stays float */
+static void
+mix_blocks_fixed (struct chmix_t *this, void *buf, int fmt, size_t nframes)
+{
+    const uint32_t in = this->in, out = this->out;
+
+    for (size_t f = 0; f < nframes; f += CHMIX_BLK) {
+        const size_t n = nframes - f < CHMIX_BLK ? nframes - f : CHMIX_BLK;
+
+        if (this->steps > 0)
+            glide_m (this);
+
+        if (fmt == 1)
+            mix_q15 (this, (int16_t *)buf + f * in,
+                     (int16_t *)buf + f * out, n);
+        else if (fmt == 2)
+            mix_q31 (this, (int32_t *)buf + f * in,
+                     (int32_t *)buf + f * out, n);
+        else
+            mix (this, (float *)buf + f * in, (float *)buf + f * out, n);
+    }
+}
+
+void
+chmix_apply (struct chmix_t *this, void *buf, int fmt, size_t nframes)
+{
+    if (fmt < 1 || fmt > 3 || !chmix_active (this))
+        return;
+
+    if (NCAP_DSP_FIXED)
+        mix_blocks_fixed (this, buf, fmt, nframes);
+    else
+        mix_blocks_flt (this, buf, fmt, nframes);
+}
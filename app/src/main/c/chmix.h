@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef CHMIX_H
+#define CHMIX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * channel matrix between the decoder and the output. more than two
+ * channels are downmixed to stereo with the usual coefficients: centers at
+ * -3 dB to both sides, surrounds at -3 dB to their own, LFE dropped, all
+ * scaled down so nothing clips. stereo can be folded to mono on both sides
+ * for listening on one earbud, and balanced left or right.
+ *
+ * runs in float on interleaved frames, integer samples keeping their scale,
+ * with vector kernels for the 2->2, 6->2 and 8->2 shapes. a change glides
+ * over `CHMIX_GLIDE` blocks instead of jumping.
+ *
+ * with `NCAP_DSP_FIXED` S16 and S32 are mixed as they are instead, with
+ * Q15 and Q31 coefficients and one rounding per output. the gains of each
+ * output add up to no more than 1, so the sums cannot overflow.
+ */
+
+#define CHMIX_OK  0
+#define CHMIX_ERR -1
+
+#define CHMIX_MAX_IN  8
+#define CHMIX_MAX_OUT 2
+
+/** frames converted to float and mixed at a time */
+#define CHMIX_BLK 64
+
+/** blocks a change of the matrix is spread over */
+#define CHMIX_GLIDE 8
+
+/**
+ * cost of one 192-frame 8->2 burst (4 ms at 48 kHz) in any format, kept to
+ * 0.5% of its period on an arm64 little core. bench_chmix.c checks it
+ */
+#define CHMIX_BUDGET_NS 20000
+
+/**
+ * largest difference between the fixed and the float path, in LSB of S16:
+ * Q15 gains off by half a step each, on eight inputs at full scale.
+ * test_chmix.c checks it on every shape
+ */
+#define CHMIX_FIXED_ERR_LSB 4
+
+/** speaker positions, the same bits as libav's `AV_CH_*` */
+#define CHMIX_FL  0x1ull
+#define CHMIX_FR  0x2ull
+#define CHMIX_FC  0x4ull
+#define CHMIX_LFE 0x8ull
+#define CHMIX_BL  0x10ull
+#define CHMIX_BR  0x20ull
+#define CHMIX_FLC 0x40ull
+#define CHMIX_FRC 0x80ull
+#define CHMIX_BC  0x100ull
+#define CHMIX_SL  0x200ull
+#define CHMIX_SR  0x400ull
+#define CHMIX_TC  0x800ull
+#define CHMIX_TFL 0x1000ull
+#define CHMIX_TFC 0x2000ull
+#define CHMIX_TFR 0x4000ull
+#define CHMIX_TBL 0x8000ull
+#define CHMIX_TBC 0x10000ull
+#define CHMIX_TBR 0x20000ull
+
+struct chmix_t {
+    uint32_t in; // channels
+    uint32_t out;
+    uint64_t layout; // `CHMIX_*` bits of the input, in channel order
+    bool     mono;
+    int8_t   balance;
+    bool     set;   // `chmix_set` was called; the first one is not glided
+    int      steps; // blocks left of the glide to `target`
+    float    m[CHMIX_MAX_OUT][CHMIX_MAX_IN]; // gain of input i in output o
+    float    target[CHMIX_MAX_OUT][CHMIX_MAX_IN];
+
+    // the fixed path's: `m` in Q15 and Q31, 1 saturated to just under
+    int16_t m15[CHMIX_MAX_OUT][CHMIX_MAX_IN];
+    int32_t m31[CHMIX_MAX_OUT][CHMIX_MAX_IN];
+};
+
+/**
+ * a matrix for `channels` input channels at `layout`, or the usual layout
+ * for that many if `layout` is 0 or does not match. more than two are
+ * downmixed to two; fewer go through as they are.
+ *
+ * @return `CHMIX_OK`, or `CHMIX_ERR` for no channels or more than
+ * `CHMIX_MAX_IN`
+ */
+extern int chmix_init (struct chmix_t *_Nonnull this, uint32_t channels,
+                       uint64_t layout);
+
+/**
+ * glides to the downmix folded to `mono` and at `balance`, -100 for the
+ * left side only to 100 for the right. both only apply to stereo output.
+ */
+extern void chmix_set (struct chmix_t *_Nonnull this, bool mono,
+                       int8_t balance);
+
+/** @return whether `chmix_apply` would change anything */
+extern bool chmix_active (const struct chmix_t *_Nonnull this);
+
+/**
+ * mixes `nframes` interleaved frames of WAV format `fmt` (1 S16, 2 S32,
+ * 3 FLT; others are left alone) of `in` channels into as many of `out`
+ * channels, in place. integer formats saturate.
+ */
+extern void chmix_apply (struct chmix_t *_Nonnull this, void *_Nonnull buf,
+                         int fmt, size_t nframes);
+
+#endif // !CHMIX_H
@@ -1,6 +1,8 @@
 #include <errno.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,22 +10,11 @@
 
 #ifndef NCAP_ISTEST
 #include <aaudio/AAudio.h>
-#include "logging.h"
-#else // NCAP_ISTEST
-#define loge(fmt)       puts (fmt)
-#define logw(fmt)       puts (fmt)
-#define logi(fmt)       puts (fmt)
-#define logd(fmt)       puts (fmt)
-#define logv(fmt)       puts (fmt)
-#define logef(fmt, ...) printf (fmt, __VA_ARGS__)
-#define logwf(fmt, ...) printf (fmt, __VA_ARGS__)
-#define logif(fmt, ...) printf (fmt, __VA_ARGS__)
-#define logdf(fmt, ...) printf (fmt, __VA_ARGS__)
-#define logvf(fmt, ...) printf (fmt, __VA_ARGS__)
 #endif // NCAP_ISTEST
 
 #include "algs.h"
 #include "config.h"
+#include "logging.h"
 
 static const char *FILENAME = "config.c";
 
@@ -31,11 +22,26 @@ struct config_t ncap_config;
 FILE           *ncap_config_fp = NULL;
 
 /** set to NULL when unused/freed */
-static char    *pathbuf = NULL;
-static uint8_t *volsbuf = NULL;
+static char     *pathbuf = NULL;
+static uint8_t  *volsbuf = NULL;
+static uint32_t *tordbuf = NULL; // the saved shuffle order, until taken
 
 pthread_mutex_t config_mx = PTHREAD_MUTEX_INITIALIZER;
 
+/** over `ncap_config_fp`, taken after `config_mx` if both are held */
+static pthread_mutex_t file_mx = PTHREAD_MUTEX_INITIALIZER;
+
+size_t       *config_tord   = NULL;
+size_t       *config_tord_r = NULL;
+static size_t tord_len;
+
+pthread_mutex_t config_tord_mx = PTHREAD_MUTEX_INITIALIZER;
+
+_Atomic uint32_t config_vol_gen   = 0;
+_Atomic uint32_t config_eq_gen    = 0;
+_Atomic uint32_t config_speed_gen = 0;
+_Atomic uint32_t config_mix_gen   = 0;
+
 #define CONFIG_LOCK_MX                                                        \
     do {                                                                      \
         if ((pth_ret = pthread_mutex_lock (&config_mx)) != 0) {               \
@@ -86,8 +92,10 @@ config_deinit (void)
 
     free (pathbuf);
     free (volsbuf);
+    free (tordbuf);
     pathbuf = NULL;
     volsbuf = NULL;
+    tordbuf = NULL;
 
     int ret = CONFIG_OK;
 
@@ -108,6 +116,19 @@ config_read (void)
     int pth_ret;
 
     CONFIG_LOCK_MX;
+    pthread_mutex_lock (&file_mx);
+
+    uint32_t version = 0;
+    fseek (ncap_config_fp, 0, SEEK_SET);
+    fread (&version, sizeof version, 1, ncap_config_fp);
+
+    if (version != NCAP_CONFIG_VERSION) {
+        logwf ("WARN: config version is %#x, expected %#x", version,
+               NCAP_CONFIG_VERSION);
+        pthread_mutex_unlock (&file_mx);
+        CONFIG_UNLOCK_MX;
+        return CONFIG_EVER;
+    }
 
     fseek (ncap_config_fp, 0, SEEK_SET);
     fread (&ncap_config, NCAP_CONFIG_SIZ, 1, ncap_config_fp);
@@ -117,8 +138,11 @@ config_read (void)
     if (pathbuf != NULL)
         free (pathbuf);
 
-    if ((pathbuf = malloc (ncap_config.track_path_len)) == NULL)
+    if ((pathbuf = malloc (ncap_config.track_path_len)) == NULL) {
+        pthread_mutex_unlock (&file_mx);
+        CONFIG_UNLOCK_MX;
         return CONFIG_EMEM;
+    }
 
     fread (pathbuf, sizeof (char), ncap_config.track_path_len, ncap_config_fp);
     ncap_config.track_path = pathbuf;
@@ -128,13 +152,37 @@ config_read (void)
     if (volsbuf != NULL)
         free (volsbuf);
 
-    if ((volsbuf = malloc (ncap_config.ntracks)) == NULL)
+    if ((volsbuf = malloc (ncap_config.ntracks)) == NULL) {
+        pthread_mutex_unlock (&file_mx);
+        CONFIG_UNLOCK_MX;
         return CONFIG_EMEM;
+    }
 
     fread (volsbuf, sizeof (uint8_t), ncap_config.ntracks, ncap_config_fp);
     ncap_config.track_vols = volsbuf;
 
+    // shuffle order, kept for `config_tord_init`
+
+    free (tordbuf);
+    tordbuf = NULL;
+
+    if (ncap_config.tord_len > 0
+        && ((tordbuf = malloc (ncap_config.tord_len * sizeof *tordbuf))
+                == NULL
+            || fread (tordbuf, sizeof *tordbuf, ncap_config.tord_len,
+                      ncap_config_fp)
+                   != ncap_config.tord_len)) {
+        free (tordbuf);
+        tordbuf              = NULL;
+        ncap_config.tord_len = 0;
+    }
+
+    pthread_mutex_unlock (&file_mx);
     CONFIG_UNLOCK_MX;
+    config_vol_touch ();
+    config_eq_touch ();
+    config_speed_touch ();
+    config_mix_touch ();
     return CONFIG_OK;
 }
 
@@ -145,6 +193,12 @@ config_write (void)
 
     CONFIG_LOCK_MX;
 
+    // the shuffle order too, so a restart plays on through the same one
+    const bool tord = pthread_mutex_lock (&config_tord_mx) == 0;
+
+    ncap_config.tord_len = tord && config_tord != NULL ? tord_len : 0;
+
+    pthread_mutex_lock (&file_mx);
     fseek (ncap_config_fp, 0, SEEK_SET);
     fwrite (&ncap_config, NCAP_CONFIG_SIZ, 1, ncap_config_fp);
     fwrite (ncap_config.track_path, sizeof (char), ncap_config.track_path_len,
@@ -152,10 +206,57 @@ config_write (void)
     fwrite (ncap_config.track_vols, sizeof (uint8_t), ncap_config.ntracks,
             ncap_config_fp);
 
+    for (uint32_t i = 0; i < ncap_config.tord_len; ++i) {
+        const uint32_t t = config_tord[i];
+        fwrite (&t, sizeof t, 1, ncap_config_fp);
+    }
+
+    pthread_mutex_unlock (&file_mx);
+
+    if (tord)
+        pthread_mutex_unlock (&config_tord_mx);
+
     CONFIG_UNLOCK_MX;
     return CONFIG_OK;
 }
 
+int
+config_write_pos (uint64_t key, uint64_t frame)
+{
+    int pth_ret;
+
+    CONFIG_LOCK_MX;
+
+    ncap_config.cur_key   = key;
+    ncap_config.cur_frame = frame;
+
+    // copied, so `config_mx` is not held across the write
+    const uint32_t track  = ncap_config.cur_track;
+    const uint64_t pos[2] = { key, frame };
+
+    CONFIG_UNLOCK_MX;
+
+    if (ncap_config_fp == NULL)
+        return CONFIG_ERR;
+
+    static_assert (offsetof (struct config_t, cur_frame)
+                       == offsetof (struct config_t, cur_key)
+                              + sizeof ncap_config.cur_key,
+                   "cur_key and cur_frame should be written in one go");
+
+    pthread_mutex_lock (&file_mx);
+
+    fseek (ncap_config_fp, offsetof (struct config_t, cur_track), SEEK_SET);
+    fwrite (&track, sizeof track, 1, ncap_config_fp);
+    fseek (ncap_config_fp, offsetof (struct config_t, cur_key), SEEK_SET);
+    fwrite (pos, sizeof pos, 1, ncap_config_fp);
+
+    const int ret = fflush (ncap_config_fp) == 0 ? CONFIG_OK : CONFIG_ERR;
+
+    pthread_mutex_unlock (&file_mx);
+    return ret;
+}
+
 int
 config_upd_vols (uint32_t ntracks, uint8_t def)
 {
@@ -179,6 +280,7 @@ config_upd_vols (uint32_t ntracks, uint8_t def)
     }
 
     CONFIG_UNLOCK_MX;
+    config_vol_touch ();
     return CONFIG_OK;
 }
 
@@ -193,7 +295,16 @@ config_logdump (void)
     logif ("isshuffle:\t%hhu", ncap_config.isshuffle);
     logif ("aaudio_optimize:\t%hhu", ncap_config.aaudio_optimize);
     logif ("volume:\t%hhu", ncap_config.volume);
+    logif ("trim_silence:\t%hhu", ncap_config.trim_silence);
+    logif ("silence_keep_ms:\t%hu", ncap_config.silence_keep_ms);
+    logif ("eq_on:\t%hhu", ncap_config.eq_on);
+    logif ("eq_preset:\t%hhu", ncap_config.eq_preset);
+    logif ("speed:\t%hu", ncap_config.speed);
+    logif ("mono:\t%hhu", ncap_config.mono);
+    logif ("balance:\t%hhd", ncap_config.balance);
+    logif ("dither:\t%hhu", ncap_config.dither);
     logif ("cur_track:\t%u", ncap_config.cur_track);
+    logif ("cur_frame:\t%llu", (unsigned long long)ncap_config.cur_frame);
     logif ("track_path_len:\t%u", ncap_config.track_path_len);
     logif ("track_path:\t%s", ncap_config.track_path);
 
@@ -204,12 +315,6 @@ config_logdump (void)
 #undef CONFIG_LOCK_MX
 #undef CONFIG_UNLOCK_MX
 
-size_t       *config_tord   = NULL;
-size_t       *config_tord_r = NULL;
-static size_t tord_len;
-
-pthread_mutex_t config_tord_mx = PTHREAD_MUTEX_INITIALIZER;
-
 #define CONFIG_LOCK_TORD_MX                                                   \
     do {                                                                      \
         if ((pth_ret = pthread_mutex_lock (&config_tord_mx)) != 0) {          \
@@ -237,6 +342,29 @@ config_tord_init (size_t ntracks, unsigned int seed)
         return CONFIG_EMEM;
     }
 
+    int ret = CONFIG_OK;
+
+    // the saved order, if it is a permutation of as many tracks
+    if (tordbuf != NULL && ncap_config.tord_len == ntracks) {
+        for (size_t i = 0; i < ntracks; ++i)
+            config_tord_r[i] = SIZE_MAX;
+
+        for (size_t i = 0; ret == CONFIG_OK && i < ntracks; ++i) {
+            if (tordbuf[i] >= ntracks || config_tord_r[tordbuf[i]] != SIZE_MAX)
+                ret = CONFIG_ERR;
+            else
+                config_tord_r[config_tord[i] = tordbuf[i]] = i;
+        }
+
+        ret = ret == CONFIG_OK ? CONFIG_TORD_SAVED : CONFIG_OK;
+    }
+
+    free (tordbuf);
+    tordbuf = NULL;
+
+    if (ret == CONFIG_TORD_SAVED)
+        return ret;
+
     for (size_t i = 0; i < ntracks; ++i)
         config_tord[i] = i;
 
@@ -254,6 +382,8 @@ config_tord_deinit (void)
 {
     free (config_tord);
     free (config_tord_r);
+    config_tord   = NULL;
+    config_tord_r = NULL;
     return CONFIG_OK;
 }
 
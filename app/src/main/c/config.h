@@ -5,16 +5,24 @@
 
 #include <assert.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#include "eq.h"
+
 extern pthread_mutex_t config_mx;
 
+/** "NC" and the layout version. bump when `struct config_t` changes */
+#define NCAP_CONFIG_VERSION 0x4e430003u
+
 /**
  * struct config_t should be packed
  */
 extern struct config_t {
-    uint8_t isrepeat;  // bool
+    uint32_t version; // NCAP_CONFIG_VERSION
+    uint8_t  isrepeat;  // bool
     uint8_t isshuffle; // bool
     /**
      * 0: none (AAUDIO_PERFORMANCE_MODE_NONE)
@@ -28,6 +36,23 @@ extern struct config_t {
     uint32_t cur_track;
     uint32_t track_path_len; // includes the null byte
     uint32_t ntracks;
+    uint8_t  trim_silence;    // bool. drop leading/trailing silence
+    uint8_t  mono;            // bool. both sides play both channels
+    uint16_t silence_keep_ms; // silence kept at each end when trimming
+    uint8_t  eq_on;           // bool
+    uint8_t  eq_preset;       // `EQ_PRESET_*`
+    uint8_t  eq_nbands;       // bands of the custom preset
+    int8_t   balance;         // -100 left only to 100 right only
+    int16_t  eq_preamp; // dB * 10, custom preset
+    uint16_t speed;     // percent, `STRETCH_MIN` to `STRETCH_MAX`. 0 is 100
+    struct eq_band_t eq_bands[EQ_MAX_BANDS]; // the custom preset
+    uint32_t tord_len;  // shuffle order entries stored after `track_vols`
+    uint8_t  dither;    // `DITHER_*` float and S32 get to S16 with when
+                        // power saving. `DITHER_OFF` keeps their format
+    uint8_t  reserved3;
+    uint16_t reserved4;
+    uint64_t cur_key;   // trackdb key of the track `cur_frame` is in
+    uint64_t cur_frame; // source frames of it played, see `config_write_pos`
     char *_Nullable track_path;    // path to media
     uint8_t *_Nullable track_vols; // volume for each track
                                    // NOTE: memsets will not work if this is
@@ -37,14 +62,19 @@ extern struct config_t {
 #define NCAP_CONFIG_SIZ                                                       \
     (sizeof (struct config_t) - (sizeof (char *) + sizeof (uint8_t *)))
 
+static_assert (NCAP_CONFIG_SIZ == offsetof (struct config_t, track_path),
+               "struct config_t has padding before its pointers");
+
 extern FILE *_Nullable ncap_config_fp;
 
+#define CONFIG_EVER        -4
 #define CONFIG_ETHRD       -3
 #define CONFIG_EMEM        -2
 #define CONFIG_ERR         -1
 #define CONFIG_OK          0
 #define CONFIG_INIT_CREAT  1
 #define CONFIG_INIT_EXISTS 2
+#define CONFIG_TORD_SAVED  3
 
 /** not thread safe */
 extern int config_init (const char *_Nonnull fn);
@@ -52,9 +82,22 @@ extern int config_init (const char *_Nonnull fn);
 /** not thread safe */
 extern int config_deinit (void);
 
+/**
+ * @return `CONFIG_EVER` if the file was written by another layout version.
+ * `ncap_config` is left unchanged in that case.
+ */
 extern int config_read (void);
 extern int config_write (void);
 
+/**
+ * sets `cur_key` and `cur_frame` and writes just them and `cur_track`,
+ * flushed to the kernel so they survive the process being killed. cheap
+ * enough to call every few seconds while playing. `config_mx` is held to
+ * set them, not across the write. one caller at a time: two at once may
+ * write in another order than they set.
+ */
+extern int config_write_pos (uint64_t key, uint64_t frame);
+
 #define config_get(val, field, pth_ret)                                       \
     do {                                                                      \
         (pth_ret) = pthread_mutex_lock (&config_mx);                          \
@@ -89,6 +132,33 @@ extern int config_write (void);
         } while (pth_ret_ != 0);                                              \
     } while (0);
 
+/**
+ * bumped after every change to `volume` or `track_vols`, so the output loop
+ * only takes `config_mx` when there is something new to read
+ */
+extern _Atomic uint32_t config_vol_gen;
+
+#define config_vol_touch()                                                    \
+    atomic_fetch_add_explicit (&config_vol_gen, 1, memory_order_release)
+
+/** the same for the `eq_*` fields */
+extern _Atomic uint32_t config_eq_gen;
+
+#define config_eq_touch()                                                     \
+    atomic_fetch_add_explicit (&config_eq_gen, 1, memory_order_release)
+
+/** and for `speed` */
+extern _Atomic uint32_t config_speed_gen;
+
+#define config_speed_touch()                                                  \
+    atomic_fetch_add_explicit (&config_speed_gen, 1, memory_order_release)
+
+/** and for `mono` and `balance` */
+extern _Atomic uint32_t config_mix_gen;
+
+#define config_mix_touch()                                                    \
+    atomic_fetch_add_explicit (&config_mix_gen, 1, memory_order_release)
+
 /**
  * `ncap_config.track_vols` should be `NULL` or allocated with `malloc`.
  */
@@ -96,7 +166,13 @@ extern int config_upd_vols (uint32_t newsiz, uint8_t def);
 
 extern int config_logdump (void);
 
-/** not thread safe */
+/**
+ * not thread safe. takes the order `config_read` found if it is for
+ * `ntracks` tracks, else shuffles one from `seed`.
+ *
+ * @return `CONFIG_TORD_SAVED` if the saved order was taken, else `CONFIG_OK`
+ * or an error code
+ */
 extern int config_tord_init (size_t ntracks, unsigned int seed);
 
 /** not thread safe */
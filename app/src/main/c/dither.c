@@ -0,0 +1,227 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "dither.h"
+
+int
+dither_init (struct dither_t *this, int fmt, uint32_t channels, int mode)
+{
+    if ((fmt != 2 && fmt != 3) || channels == 0 || channels > DITHER_MAX_CH
+        || (mode != DITHER_TPDF && mode != DITHER_SHAPED))
+        return DITHER_ERR;
+
+    memset (this, 0, sizeof *this);
+    this->fmt      = fmt;
+    this->channels = channels;
+    this->mode     = mode;
+
+    // any nonzero seeds, different per lane
+    for (uint32_t k = 0; k < 4; ++k) {
+        this->rng[0][k] = 0x9e3779b9u * (k + 1);
+        this->rng[1][k] = 0x85ebca6bu * (k + 5);
+    }
+
+    return DITHER_OK;
+}
+
+/**
+ * `n`, rounded up to a multiple of 4, triangular draws in (-1, 1) steps
+ * into `d`. the vector and scalar paths draw the same numbers
+ */
+static void
+noise (struct dither_t *this, float *d, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    uint32x4_t        a   = vld1q_u32 (this->rng[0]);
+    uint32x4_t        b   = vld1q_u32 (this->rng[1]);
+    const float32x4_t scl = vdupq_n_f32 (0x1p-32f);
+
+    for (; i < n; i += 4) {
+        a = veorq_u32 (a, vshlq_n_u32 (a, 13));
+        a = veorq_u32 (a, vshrq_n_u32 (a, 17));
+        a = veorq_u32 (a, vshlq_n_u32 (a, 5));
+        b = veorq_u32 (b, vshlq_n_u32 (b, 13));
+        b = veorq_u32 (b, vshrq_n_u32 (b, 17));
+        b = veorq_u32 (b, vshlq_n_u32 (b, 5));
+
+        const float32x4_t fa = vcvtq_f32_s32 (vreinterpretq_s32_u32 (a));
+        const float32x4_t fb = vcvtq_f32_s32 (vreinterpretq_s32_u32 (b));
+
+        vst1q_f32 (d + i, vmulq_f32 (vaddq_f32 (fa, fb), scl));
+    }
+
+    vst1q_u32 (this->rng[0], a);
+    vst1q_u32 (this->rng[1], b);
+#elif defined(__SSE2__)
+    __m128i      a   = _mm_loadu_si128 ((const __m128i *)this->rng[0]);
+    __m128i      b   = _mm_loadu_si128 ((const __m128i *)this->rng[1]);
+    const __m128 scl = _mm_set1_ps (0x1p-32f);
+
+    for (; i < n; i += 4) {
+        a = _mm_xor_si128 (a, _mm_slli_epi32 (a, 13));
+        a = _mm_xor_si128 (a, _mm_srli_epi32 (a, 17));
+        a = _mm_xor_si128 (a, _mm_slli_epi32 (a, 5));
+        b = _mm_xor_si128 (b, _mm_slli_epi32 (b, 13));
+        b = _mm_xor_si128 (b, _mm_srli_epi32 (b, 17));
+        b = _mm_xor_si128 (b, _mm_slli_epi32 (b, 5));
+
+        _mm_storeu_ps (d + i, _mm_mul_ps (_mm_add_ps (_mm_cvtepi32_ps (a),
+                                                      _mm_cvtepi32_ps (b)),
+                                          scl));
+    }
+
+    _mm_storeu_si128 ((__m128i *)this->rng[0], a);
+    _mm_storeu_si128 ((__m128i *)this->rng[1], b);
+#else
+    for (; i < n; i += 4)
+        for (uint32_t k = 0; k < 4; ++k) {
+            uint32_t a = this->rng[0][k], b = this->rng[1][k];
+
+            a ^= a << 13;
+            a ^= a >> 17;
+            a ^= a << 5;
+            b ^= b << 13;
+            b ^= b >> 17;
+            b ^= b << 5;
+
+            this->rng[0][k] = a;
+            this->rng[1][k] = b;
+            d[i + k]
+                = ((float)(int32_t)a + (float)(int32_t)b) * 0x1p-32f;
+        }
+#endif
+}
+
+static inline int16_t
+quant_s16 (float v)
+{
+    return v >= INT16_MAX   ? INT16_MAX
+           : v <= INT16_MIN ? INT16_MIN
+                            : lrintf (v);
+}
+
+/** `n` samples scaled by `scl` plus `d`, rounded to nearest even */
+static void
+convert (int16_t *dst, const void *src, int fmt, float scl, const float *d,
+         size_t n)
+{
+    const int32_t *const s32 = src;
+    const float *const   flt = src;
+    size_t               i   = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t vscl = vdupq_n_f32 (scl);
+
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo, hi;
+
+        if (fmt == 2) {
+            lo = vcvtq_f32_s32 (vld1q_s32 (s32 + i));
+            hi = vcvtq_f32_s32 (vld1q_s32 (s32 + i + 4));
+        } else {
+            lo = vld1q_f32 (flt + i);
+            hi = vld1q_f32 (flt + i + 4);
+        }
+
+        lo = vmlaq_f32 (vld1q_f32 (d + i), lo, vscl);
+        hi = vmlaq_f32 (vld1q_f32 (d + i + 4), hi, vscl);
+
+        // the conversion and the narrowing both saturate
+        vst1q_s16 (dst + i,
+                   vcombine_s16 (vqmovn_s32 (vcvtnq_s32_f32 (lo)),
+                                 vqmovn_s32 (vcvtnq_s32_f32 (hi))));
+    }
+#elif defined(__SSE2__)
+    const __m128 vscl = _mm_set1_ps (scl);
+    const __m128 top  = _mm_set1_ps (32768.0f);
+    const __m128 bot  = _mm_set1_ps (-32769.0f);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128 lo, hi;
+
+        if (fmt == 2) {
+            lo = _mm_cvtepi32_ps (
+                _mm_loadu_si128 ((const __m128i *)(s32 + i)));
+            hi = _mm_cvtepi32_ps (
+                _mm_loadu_si128 ((const __m128i *)(s32 + i + 4)));
+        } else {
+            lo = _mm_loadu_ps (flt + i);
+            hi = _mm_loadu_ps (flt + i + 4);
+        }
+
+        // in range of int32 before the conversion, then packs saturates
+        lo = _mm_add_ps (_mm_mul_ps (lo, vscl), _mm_loadu_ps (d + i));
+        hi = _mm_add_ps (_mm_mul_ps (hi, vscl), _mm_loadu_ps (d + i + 4));
+        lo = _mm_max_ps (_mm_min_ps (lo, top), bot);
+        hi = _mm_max_ps (_mm_min_ps (hi, top), bot);
+
+        _mm_storeu_si128 ((__m128i *)(dst + i),
+                          _mm_packs_epi32 (_mm_cvtps_epi32 (lo),
+                                           _mm_cvtps_epi32 (hi)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i]
+            = quant_s16 ((fmt == 2 ? (float)s32[i] : flt[i]) * scl + d[i]);
+}
+
+/** as `convert`, less each channel's last error, which is kept */
+static void
+convert_shaped (struct dither_t *this, int16_t *dst, const void *src,
+                float scl, const float *d, size_t nframes)
+{
+    const int32_t *const s32 = src;
+    const float *const   flt = src;
+    const uint32_t       ch  = this->channels;
+    float                err[DITHER_MAX_CH];
+
+    memcpy (err, this->err, sizeof err);
+
+    for (size_t f = 0, i = 0; f < nframes; ++f)
+        for (uint32_t c = 0; c < ch; ++c, ++i) {
+            const float x = this->fmt == 2 ? (float)s32[i] : flt[i];
+            const float v = x * scl - err[c];
+            const long  q = lrintf (v + d[i]);
+
+            // the error before saturation, which stays within 1.5 steps
+            err[c] = (float)q - v;
+            dst[i] = q > INT16_MAX ? INT16_MAX : q < INT16_MIN ? INT16_MIN : q;
+        }
+
+    memcpy (this->err, err, sizeof err);
+}
+
+void
+dither_apply (struct dither_t *this, int16_t *dst, const void *src,
+              size_t nframes)
+{
+    float          d[DITHER_BLK * DITHER_MAX_CH];
+    const uint32_t ch  = this->channels;
+    const float    scl = this->fmt == 2 ? 1 / 65536.0f : 32768.0f;
+    const size_t   w   = this->fmt == 2 ? sizeof (int32_t) : sizeof (float);
+
+    // each block's output ends before the next block's input starts
+    for (size_t f = 0; f < nframes; f += DITHER_BLK) {
+        const size_t n = nframes - f < DITHER_BLK ? nframes - f : DITHER_BLK;
+        const void  *s = (const uint8_t *)src + f * ch * w;
+
+        noise (this, d, n * ch);
+
+        if (this->mode == DITHER_SHAPED)
+            convert_shaped (this, dst + f * ch, s, scl, d, n);
+        else
+            convert (dst + f * ch, s, this->fmt, scl, d, n * ch);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * float and S32 output reduced to S16, for streams that trade resolution
+ * for half the buffer bandwidth. each sample gets TPDF dither of up to one
+ * step either way before it is rounded, so the error is noise that does not
+ * follow the signal instead of distortion that does, which is what a plain
+ * conversion leaves at low volume. shaped dither also feeds each channel's
+ * error back into its next sample, moving the noise up to where the ear is
+ * least sensitive.
+ *
+ * the noise comes from four xorshift32 generators stepped as one vector;
+ * the plain path converts a vector at a time, the shaped one a sample at a
+ * time, since each sample depends on the last.
+ */
+
+#define DITHER_OK  0
+#define DITHER_ERR -1
+
+/** `config_t.dither`. anything but off reduces to S16 when power saving */
+#define DITHER_OFF    0
+#define DITHER_TPDF   1
+#define DITHER_SHAPED 2
+
+#define DITHER_MAX_CH 8
+
+/** frames converted at a time, their noise drawn first */
+#define DITHER_BLK 64
+
+/**
+ * cost of one stereo 192-frame burst (4 ms at 48 kHz), shaped, kept to 0.25%
+ * of its period on an arm64 little core. bench_dither.c checks it
+ */
+#define DITHER_BUDGET_NS 10000
+
+struct dither_t {
+    int      fmt;    // WAV format code of the input, 2 S32 or 3 FLT
+    uint32_t channels;
+    int      mode;   // `DITHER_TPDF` or `DITHER_SHAPED`
+    uint32_t rng[2][4]; // two sets of lanes, summed to one triangular draw
+    float    err[DITHER_MAX_CH]; // each channel's last error, shaped only
+};
+
+/**
+ * @return `DITHER_OK`, or `DITHER_ERR` for inputs other than S32 and FLT,
+ * no channels or more than `DITHER_MAX_CH`, or a mode that is off
+ */
+extern int dither_init (struct dither_t *_Nonnull this, int fmt,
+                        uint32_t channels, int mode);
+
+/**
+ * converts `nframes` interleaved frames from `src` to S16 in `dst`, which
+ * may be `src`. saturates.
+ */
+extern void dither_apply (struct dither_t *_Nonnull this,
+                          int16_t *_Nonnull dst, const void *_Nonnull src,
+                          size_t nframes);
+
+#endif // !DITHER_H
@@ -0,0 +1,623 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "eq.h"
+#include "properties.h"
+
+// clang-format off
+const char *const eq_preset_names[EQ_NPRESETS + 1] = {
+    "flat", "bass", "vocal", "treble", "loudness", "custom",
+};
+
+const struct eq_band_t eq_presets[EQ_NPRESETS][EQ_MAX_BANDS] = {
+    [EQ_PRESET_FLAT]   = { { 0 } },
+    [EQ_PRESET_BASS]   = { { EQ_LOSHELF, 0,  60,   105,  70 },
+                           { EQ_PEAK,    0, -15,   400, 100 } },
+    [EQ_PRESET_VOCAL]  = { { EQ_PEAK,    0, -20,   250, 100 },
+                           { EQ_PEAK,    0,  30,  2500, 120 },
+                           { EQ_PEAK,    0,  15,  5000, 150 },
+                           { EQ_HISHELF, 0, -10, 10000,  70 } },
+    [EQ_PRESET_TREBLE] = { { EQ_PEAK,    0,  15,  3000, 100 },
+                           { EQ_HISHELF, 0,  50,  6000,  70 } },
+    [EQ_PRESET_LOUD]   = { { EQ_LOSHELF, 0,  60,    80,  70 },
+                           { EQ_PEAK,    0, -10,  1000,  70 },
+                           { EQ_HISHELF, 0,  40, 10000,  70 } },
+};
+// clang-format on
+
+/** per `EQ_BLK` frames, the part of the way to the target taken */
+#define GLIDE     0.3f
+#define GLIDE_EPS 1e-6f
+
+static const float flat[5] = { 1, 0, 0, 0, 0 };
+
+static bool
+isflat (const float c[5])
+{
+    return memcmp (c, flat, sizeof flat) == 0;
+}
+
+/** coefficients of the fixed path: Q27, so up to 16 for +24 dB peaks */
+#define Q_COEF 27
+
+/** samples of the fixed path: Q23, leaving 48 dB of headroom in 32 bits */
+#define Q_SIG 23
+
+static int32_t
+q27 (float c)
+{
+    const float v = c * (float)(1 << Q_COEF);
+
+    return v >= 2147483520.0f ? INT32_MAX : v <= -2147483648.0f ? INT32_MIN
+                                                                : lrintf (v);
+}
+
+/** keeps `cq` in step with `c` */
+static void
+quantize (struct eq_t *this)
+{
+    for (size_t k = 0; k < EQ_MAX_BANDS; ++k)
+        for (int i = 0; i < 5; ++i)
+            this->cq[k][i] = q27 (this->c[k][i]);
+}
+
+/** the cookbook formulas of robert bristow-johnson's audio eq cookbook */
+static void
+design (float c[5], const struct eq_band_t *band, uint32_t sample_rate)
+{
+    const double db   = fmax (-24, fmin (24, band->gain / 10.0));
+    const double q    = band->q ? band->q / 100.0 : M_SQRT1_2;
+    const double f    = fmax (10, fmin (sample_rate * 0.45, band->freq));
+    const double A    = pow (10, db / 40);
+    const double w0   = 2 * M_PI * f / sample_rate;
+    const double cw   = cos (w0);
+    const double sw   = sin (w0);
+    const double sqA2 = 2 * sqrt (A);
+    double       b0, b1, b2, a0, a1, a2, alpha;
+
+    if (band->type == EQ_OFF || band->gain == 0) {
+        memcpy (c, flat, sizeof flat);
+        return;
+    }
+
+    switch (band->type) {
+        case EQ_LOSHELF:
+            alpha = sw / 2 * sqrt ((A + 1 / A) * (1 / q - 1) + 2);
+            b0    = A * ((A + 1) - (A - 1) * cw + sqA2 * alpha);
+            b1    = 2 * A * ((A - 1) - (A + 1) * cw);
+            b2    = A * ((A + 1) - (A - 1) * cw - sqA2 * alpha);
+            a0    = (A + 1) + (A - 1) * cw + sqA2 * alpha;
+            a1    = -2 * ((A - 1) + (A + 1) * cw);
+            a2    = (A + 1) + (A - 1) * cw - sqA2 * alpha;
+            break;
+        case EQ_HISHELF:
+            alpha = sw / 2 * sqrt ((A + 1 / A) * (1 / q - 1) + 2);
+            b0    = A * ((A + 1) + (A - 1) * cw + sqA2 * alpha);
+            b1    = -2 * A * ((A - 1) + (A + 1) * cw);
+            b2    = A * ((A + 1) + (A - 1) * cw - sqA2 * alpha);
+            a0    = (A + 1) - (A - 1) * cw + sqA2 * alpha;
+            a1    = 2 * ((A - 1) - (A + 1) * cw);
+            a2    = (A + 1) - (A - 1) * cw - sqA2 * alpha;
+            break;
+        case EQ_PEAK:
+        default:
+            alpha = sw / (2 * q);
+            b0    = 1 + alpha * A;
+            b1    = -2 * cw;
+            b2    = 1 - alpha * A;
+            a0    = 1 + alpha / A;
+            a1    = -2 * cw;
+            a2    = 1 - alpha / A;
+            break;
+    }
+
+    c[0] = b0 / a0;
+    c[1] = b1 / a0;
+    c[2] = b2 / a0;
+    c[3] = a1 / a0;
+    c[4] = a2 / a0;
+}
+
+/** bands past the last one that is flat both now and at the target idle */
+static void
+count_bands (struct eq_t *this)
+{
+    this->nbands = 0;
+
+    for (uint32_t k = EQ_MAX_BANDS; k > 0; --k)
+        if (!isflat (this->c[k - 1]) || !isflat (this->target[k - 1])) {
+            this->nbands = k;
+            break;
+        }
+}
+
+int
+eq_init (struct eq_t *this, uint32_t channels, uint32_t sample_rate)
+{
+    memset (this, 0, sizeof *this);
+
+    if (channels == 0 || channels > EQ_MAX_CH || sample_rate == 0)
+        return EQ_ERR;
+
+    this->channels    = channels;
+    this->sample_rate = sample_rate;
+
+    for (size_t k = 0; k < EQ_MAX_BANDS; ++k) {
+        memcpy (this->c[k], flat, sizeof flat);
+        memcpy (this->target[k], flat, sizeof flat);
+    }
+
+    quantize (this);
+
+    return EQ_OK;
+}
+
+void
+eq_set (struct eq_t *this, const struct eq_band_t *bands, size_t nbands,
+        int16_t preamp)
+{
+    const struct eq_band_t off = { .type = EQ_OFF };
+
+    if (this->channels == 0)
+        return;
+
+    for (size_t k = 0; k < EQ_MAX_BANDS; ++k)
+        design (this->target[k], k < nbands ? &bands[k] : &off,
+                this->sample_rate);
+
+    // the preamp is folded into the first band's zeros
+    if (preamp != 0) {
+        const float g = powf (10, preamp / 200.0f);
+
+        for (int i = 0; i < 3; ++i)
+            this->target[0][i] *= g;
+    }
+
+    this->gliding = memcmp (this->c, this->target, sizeof this->c) != 0;
+    count_bands (this);
+}
+
+bool
+eq_active (const struct eq_t *this)
+{
+    return this->nbands > 0;
+}
+
+/** moves `c` a step towards `target`, snapping once it is close */
+static void
+glide (struct eq_t *this)
+{
+    float dmax = 0;
+
+    for (uint32_t k = 0; k < this->nbands; ++k)
+        for (int i = 0; i < 5; ++i) {
+            const float d = this->target[k][i] - this->c[k][i];
+
+            this->c[k][i] += d * GLIDE;
+            dmax = fmaxf (dmax, fabsf (d));
+        }
+
+    if (dmax < GLIDE_EPS) {
+        memcpy (this->c, this->target, sizeof this->c);
+        this->gliding = false;
+        count_bands (this);
+    }
+
+    quantize (this);
+}
+
+/**
+ * one band over `nframes` interleaved stereo frames of `x`, in place. the
+ * two channels share a vector; the frames depend on each other.
+ */
+static void
+band_stereo (const float c[5], float z1[2], float z2[2], float *x,
+             size_t nframes)
+{
+#if defined(__ARM_NEON)
+    const float32x2_t b0 = vdup_n_f32 (c[0]);
+    const float32x2_t b1 = vdup_n_f32 (c[1]);
+    const float32x2_t b2 = vdup_n_f32 (c[2]);
+    const float32x2_t a1 = vdup_n_f32 (c[3]);
+    const float32x2_t a2 = vdup_n_f32 (c[4]);
+    float32x2_t       s1 = vld1_f32 (z1);
+    float32x2_t       s2 = vld1_f32 (z2);
+
+    for (size_t f = 0; f < nframes; ++f, x += 2) {
+        const float32x2_t in = vld1_f32 (x);
+        const float32x2_t y  = vmla_f32 (s1, b0, in);
+
+        s1 = vmls_f32 (vmla_f32 (s2, b1, in), a1, y);
+        s2 = vmls_f32 (vmul_f32 (b2, in), a2, y);
+        vst1_f32 (x, y);
+    }
+
+    vst1_f32 (z1, s1);
+    vst1_f32 (z2, s2);
+#elif defined(__SSE2__)
+    const __m128 b0 = _mm_set1_ps (c[0]);
+    const __m128 b1 = _mm_set1_ps (c[1]);
+    const __m128 b2 = _mm_set1_ps (c[2]);
+    const __m128 a1 = _mm_set1_ps (c[3]);
+    const __m128 a2 = _mm_set1_ps (c[4]);
+    __m128       s1 = _mm_castpd_ps (_mm_load_sd ((const double *)z1));
+    __m128       s2 = _mm_castpd_ps (_mm_load_sd ((const double *)z2));
+
+    for (size_t f = 0; f < nframes; ++f, x += 2) {
+        const __m128 in = _mm_castpd_ps (_mm_load_sd ((const double *)x));
+        const __m128 y  = _mm_add_ps (s1, _mm_mul_ps (b0, in));
+
+        s1 = _mm_sub_ps (_mm_add_ps (s2, _mm_mul_ps (b1, in)),
+                         _mm_mul_ps (a1, y));
+        s2 = _mm_sub_ps (_mm_mul_ps (b2, in), _mm_mul_ps (a2, y));
+        _mm_store_sd ((double *)x, _mm_castps_pd (y));
+    }
+
+    _mm_store_sd ((double *)z1, _mm_castps_pd (s1));
+    _mm_store_sd ((double *)z2, _mm_castps_pd (s2));
+#else
+    for (size_t f = 0; f < nframes; ++f, x += 2)
+        for (int ch = 0; ch < 2; ++ch) {
+            const float in = x[ch];
+            const float y  = c[0] * in + z1[ch];
+
+            z1[ch] = z2[ch] + c[1] * in - c[3] * y;
+            z2[ch] = c[2] * in - c[4] * y;
+            x[ch]  = y;
+        }
+#endif
+}
+
+/** one band over any other channel count */
+static void
+band_scalar (const float c[5], float *z1, float *z2, float *x,
+             size_t nframes, uint32_t channels)
+{
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        float s1 = z1[ch];
+        float s2 = z2[ch];
+
+        for (size_t f = 0; f < nframes; ++f) {
+            const float in = x[f * channels + ch];
+            const float y  = c[0] * in + s1;
+
+            s1 = s2 + c[1] * in - c[3] * y;
+            s2 = c[2] * in - c[4] * y;
+
+            x[f * channels + ch] = y;
+        }
+
+        z1[ch] = s1;
+        z2[ch] = s2;
+    }
+}
+
+/** runs the cascade band by band over a block that stays in L1 */
+static void
+cascade (struct eq_t *this, float *x, size_t nframes)
+{
+    for (uint32_t k = 0; k < this->nbands; ++k) {
+        float *const z1 = this->z1[k];
+        float *const z2 = this->z2[k];
+
+        if (isflat (this->c[k]))
+            continue;
+
+        if (this->channels == 2)
+            band_stereo (this->c[k], z1, z2, x, nframes);
+        else
+            band_scalar (this->c[k], z1, z2, x, nframes, this->channels);
+
+        // decaying state would turn denormal in silence, which is slow
+        for (uint32_t ch = 0; ch < this->channels; ++ch) {
+            if (fabsf (z1[ch]) < 1e-20f)
+                z1[ch] = 0;
+            if (fabsf (z2[ch]) < 1e-20f)
+                z2[ch] = 0;
+        }
+    }
+}
+
+static inline int16_t
+sat_s16 (float v)
+{
+    return v >= INT16_MAX   ? INT16_MAX
+           : v <= INT16_MIN ? INT16_MIN
+                            : lrintf (v);
+}
+
+/** the largest float below 2^31 is 2^31 - 128 */
+static inline int32_t
+sat_s32 (float v)
+{
+    return v >= 2147483648.0f ? INT32_MAX : v < -2147483648.0f ? INT32_MIN
+                                                               : lrintf (v);
+}
+
+static void
+apply_flt (struct eq_t *this, void *buf, int fmt, size_t nframes)
+{
+    float          tmp[EQ_BLK * EQ_MAX_CH];
+    const uint32_t ch = this->channels;
+
+    if (fmt < 1 || fmt > 3)
+        return;
+
+    for (size_t f = 0; f < nframes && eq_active (this); f += EQ_BLK) {
+        const size_t n = nframes - f < EQ_BLK ? nframes - f : EQ_BLK;
+        const size_t m = n * ch;
+
+        if (this->gliding)
+            glide (this);
+
+        // integer samples keep their scale; the filters are linear
+        if (fmt == 1) {
+            int16_t *const s = (int16_t *)buf + f * ch;
+
+            for (size_t i = 0; i < m; ++i)
+                tmp[i] = s[i];
+
+            cascade (this, tmp, n);
+
+            for (size_t i = 0; i < m; ++i)
+                s[i] = sat_s16 (tmp[i]);
+        } else if (fmt == 2) {
+            int32_t *const s = (int32_t *)buf + f * ch;
+
+            for (size_t i = 0; i < m; ++i)
+                tmp[i] = s[i];
+
+            cascade (this, tmp, n);
+
+            for (size_t i = 0; i < m; ++i)
+                s[i] = sat_s32 (tmp[i]);
+        } else {
+            cascade (this, (float *)buf + f * ch, n);
+        }
+    }
+}
+
+/**
+ * the fixed path: Q23 samples through Q27 coefficients in direct form I. a
+ * 64-bit accumulator rounds once per output, where the transposed form
+ * would round both of its states every frame. the state `q` is x1, x2, y1
+ * and y2, `EQ_MAX_CH` apart.
+ */
+static void
+band_q_scalar (const int32_t c[5], int32_t *q, int32_t *x, size_t nframes,
+               uint32_t channels)
+{
+    const int64_t rnd = 1ll << (Q_COEF - 1);
+
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        int32_t x1 = q[ch], x2 = q[EQ_MAX_CH + ch];
+        int32_t y1 = q[2 * EQ_MAX_CH + ch], y2 = q[3 * EQ_MAX_CH + ch];
+
+        for (size_t f = 0; f < nframes; ++f) {
+            const int32_t in = x[f * channels + ch];
+            const int64_t acc
+                = (int64_t)c[0] * in + (int64_t)c[1] * x1
+                  + (int64_t)c[2] * x2 - (int64_t)c[3] * y1
+                  - (int64_t)c[4] * y2;
+            const int64_t v = (acc + rnd) >> Q_COEF;
+            const int32_t y = v > INT32_MAX   ? INT32_MAX
+                              : v < INT32_MIN ? INT32_MIN
+                                              : (int32_t)v;
+
+            x2 = x1;
+            x1 = in;
+            y2 = y1;
+            y1 = y;
+
+            x[f * channels + ch] = y;
+        }
+
+        q[ch]                 = x1;
+        q[EQ_MAX_CH + ch]     = x2;
+        q[2 * EQ_MAX_CH + ch] = y1;
+        q[3 * EQ_MAX_CH + ch] = y2;
+    }
+}
+
+static void
+band_q_stereo (const int32_t c[5], int32_t *q, int32_t *x, size_t nframes)
+{
+#if defined(__ARM_NEON)
+    const int32x2_t b0  = vdup_n_s32 (c[0]);
+    const int32x2_t b1  = vdup_n_s32 (c[1]);
+    const int32x2_t b2  = vdup_n_s32 (c[2]);
+    const int32x2_t a1  = vdup_n_s32 (c[3]);
+    const int32x2_t a2  = vdup_n_s32 (c[4]);
+    int32x2_t       vx1 = vld1_s32 (q);
+    int32x2_t       vx2 = vld1_s32 (q + EQ_MAX_CH);
+    int32x2_t       vy1 = vld1_s32 (q + 2 * EQ_MAX_CH);
+    int32x2_t       vy2 = vld1_s32 (q + 3 * EQ_MAX_CH);
+
+    for (size_t f = 0; f < nframes; ++f, x += 2) {
+        const int32x2_t in  = vld1_s32 (x);
+        int64x2_t       acc = vmull_s32 (in, b0);
+
+        acc = vmlal_s32 (acc, vx1, b1);
+        acc = vmlal_s32 (acc, vx2, b2);
+        acc = vmlsl_s32 (acc, vy1, a1);
+        acc = vmlsl_s32 (acc, vy2, a2);
+
+        // saturating, rounding narrow back to 32 bits
+        const int32x2_t y = vqrshrn_n_s64 (acc, Q_COEF);
+
+        vx2 = vx1;
+        vx1 = in;
+        vy2 = vy1;
+        vy1 = y;
+        vst1_s32 (x, y);
+    }
+
+    vst1_s32 (q, vx1);
+    vst1_s32 (q + EQ_MAX_CH, vx2);
+    vst1_s32 (q + 2 * EQ_MAX_CH, vy1);
+    vst1_s32 (q + 3 * EQ_MAX_CH, vy2);
+#else
+    // SSE2 has no signed 32x32->64 multiply
+    band_q_scalar (c, q, x, nframes, 2);
+#endif
+}
+
+static void
+cascade_q (struct eq_t *this, int32_t *x, size_t nframes)
+{
+    for (uint32_t k = 0; k < this->nbands; ++k) {
+        if (isflat (this->c[k]))
+            continue;
+
+        if (this->channels == 2)
+            band_q_stereo (this->cq[k], this->q[k], x, nframes);
+        else
+            band_q_scalar (this->cq[k], this->q[k], x, nframes,
+                           this->channels);
+    }
+}
+
+/** float to Q23 and back, saturating */
+static void
+flt_to_q (int32_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32 (dst + i, vcvtq_n_s32_f32 (vld1q_f32 (src + i), Q_SIG));
+#endif
+
+    for (; i < n; ++i) {
+        const float v = src[i] * (float)(1 << Q_SIG);
+
+        dst[i] = v >= 2147483520.0f ? INT32_MAX : v <= -2147483648.0f
+                                                      ? INT32_MIN
+                                                      : (int32_t)v;
+    }
+}
+
+static void
+q_to_flt (float *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32 (dst + i, vcvtq_n_f32_s32 (vld1q_s32 (src + i), Q_SIG));
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] * (1.0f / (1 << Q_SIG));
+}
+
+/** S16 is Q15, so Q23 is 8 bits up; S32 is Q31, 8 bits down */
+static void
+s16_to_q (int32_t *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32 (dst + i, vshll_n_s16 (vld1_s16 (src + i), 8));
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] * 256;
+}
+
+static void
+q_to_s16 (int16_t *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1_s16 (dst + i, vqrshrn_n_s32 (vld1q_s32 (src + i), 8));
+#endif
+
+    for (; i < n; ++i) {
+        const int32_t v = (int32_t)(((int64_t)src[i] + 128) >> 8);
+
+        dst[i] = v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+    }
+}
+
+static void
+s32_to_q (int32_t *dst, const int32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = src[i] >> 8;
+}
+
+static void
+q_to_s32 (int32_t *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32 (dst + i, vqshlq_n_s32 (vld1q_s32 (src + i), 8));
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] >= 1 << 23    ? INT32_MAX
+                 : src[i] < -(1 << 23) ? INT32_MIN
+                                       : src[i] * 256;
+}
+
+static void
+apply_fixed (struct eq_t *this, void *buf, int fmt, size_t nframes)
+{
+    int32_t        tmp[EQ_BLK * EQ_MAX_CH];
+    const uint32_t ch = this->channels;
+
+    if (fmt < 1 || fmt > 3)
+        return;
+
+    for (size_t f = 0; f < nframes && eq_active (this); f += EQ_BLK) {
+        const size_t n = nframes - f < EQ_BLK ? nframes - f : EQ_BLK;
+        const size_t m = n * ch;
+
+        if (this->gliding)
+            glide (this);
+
+        if (fmt == 1) {
+            int16_t *const s = (int16_t *)buf + f * ch;
+
+            s16_to_q (tmp, s, m);
+            cascade_q (this, tmp, n);
+            q_to_s16 (s, tmp, m);
+        } else if (fmt == 2) {
+            int32_t *const s = (int32_t *)buf + f * ch;
+
+            s32_to_q (tmp, s, m);
+            cascade_q (this, tmp, n);
+            q_to_s32 (s, tmp, m);
+        } else {
+            float *const s = (float *)buf + f * ch;
+
+            flt_to_q (tmp, s, m);
+            cascade_q (this, tmp, n);
+            q_to_flt (s, tmp, m);
+        }
+    }
+}
+
+void
+eq_apply (struct eq_t *this, void *buf, int fmt, size_t nframes)
+{
+    if (NCAP_DSP_FIXED)
+        apply_fixed (this, buf, fmt, nframes);
+    else
+        apply_flt (this, buf, fmt, nframes);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef EQ_H
+#define EQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * parametric equalizer. a cascade of biquads in transposed direct form II,
+ * run in float on interleaved frames ahead of the volume. new settings are
+ * glided to, one coefficient set every `EQ_BLK` frames, instead of jumping.
+ *
+ * with `NCAP_DSP_FIXED` the biquads run in direct form I on Q23 samples
+ * and Q27 coefficients instead, for cores where float is slow.
+ */
+
+#define EQ_OK  0
+#define EQ_ERR -1
+
+#define EQ_MAX_BANDS 10
+#define EQ_MAX_CH    8
+
+/** frames converted to float and filtered at a time */
+#define EQ_BLK 64
+
+/**
+ * cost of one 192-frame stereo burst (4 ms at 48 kHz) through all
+ * `EQ_MAX_BANDS` bands, kept to 2.5% of its period on an armeabi-v7a core.
+ * bench_eq.c checks it
+ */
+#define EQ_BUDGET_NS 100000
+
+/**
+ * largest difference between the fixed and the float path on S16, in LSB
+ * (-78 dBFS). test_eq.c checks it on every preset
+ */
+#define EQ_FIXED_ERR_LSB 4
+
+#define EQ_OFF     0
+#define EQ_PEAK    1
+#define EQ_LOSHELF 2
+#define EQ_HISHELF 3
+
+/** one band as kept in `config_t`. 8 bytes, no padding */
+struct eq_band_t {
+    uint8_t  type; // `EQ_OFF`, ...
+    uint8_t  reserved;
+    int16_t  gain; // dB * 10
+    uint16_t freq; // Hz, the center or the shelf's midpoint
+    uint16_t q;    // Q * 100, the slope for shelves. 0 for the default
+};
+
+#define EQ_PRESET_FLAT   0
+#define EQ_PRESET_BASS   1
+#define EQ_PRESET_VOCAL  2
+#define EQ_PRESET_TREBLE 3
+#define EQ_PRESET_LOUD   4
+#define EQ_NPRESETS      5 // built in
+#define EQ_PRESET_CUSTOM 5 // `config_t.eq_bands`
+
+extern const char *const _Nonnull eq_preset_names[EQ_NPRESETS + 1];
+extern const struct eq_band_t eq_presets[EQ_NPRESETS][EQ_MAX_BANDS];
+
+struct eq_t {
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint32_t nbands;  // up to the last band that is not flat
+    bool     gliding; // `c` is still on its way to `target`
+    float    c[EQ_MAX_BANDS][5]; // b0 b1 b2 a1 a2, normalized
+    float    target[EQ_MAX_BANDS][5];
+    float    z1[EQ_MAX_BANDS][EQ_MAX_CH];
+    float    z2[EQ_MAX_BANDS][EQ_MAX_CH];
+
+    // the fixed path's
+    int32_t cq[EQ_MAX_BANDS][5];                // `c` in Q27
+    int32_t q[EQ_MAX_BANDS][4 * EQ_MAX_CH];     // x1 x2 y1 y2
+};
+
+/** a flat equalizer for a stream */
+extern int eq_init (struct eq_t *_Nonnull this, uint32_t channels,
+                    uint32_t sample_rate);
+
+/**
+ * glides to `nbands` bands, `EQ_OFF` ones being flat, after a gain of
+ * `preamp` dB * 10. `bands` may be NULL for none: flat, once glided.
+ */
+extern void eq_set (struct eq_t *_Nonnull this,
+                    const struct eq_band_t *_Nullable bands, size_t nbands,
+                    int16_t preamp);
+
+/** @return whether `eq_apply` would change anything */
+extern bool eq_active (const struct eq_t *_Nonnull this);
+
+/**
+ * filters `nframes` interleaved frames of WAV format `fmt` (1 S16, 2 S32,
+ * 3 FLT; others are left alone) in place. integer formats saturate.
+ */
+extern void eq_apply (struct eq_t *_Nonnull this, void *_Nonnull buf,
+                      int fmt, size_t nframes);
+
+#endif // !EQ_H
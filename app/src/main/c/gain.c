@@ -0,0 +1,257 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "gain.h"
+
+/**
+ * `psi(I) + n = psi(kI)` => `k = (n/I^a + 1)^(1/a)`.
+ * k in `[0, 1]` => n in `[-I^a, 0]`.
+ * decreases by -I^a/10 every time (proportional to intensity).
+ *
+ * stevens's power law: `https://en.wikipedia.org/wiki/Stevens%27s_power_law`.
+ */
+float
+gain_scale (uint8_t vol, uint8_t svol)
+{
+    return powf ((vol * svol) / 10000.0f, GAIN_STEVENS_a_RECIP);
+}
+
+void
+gain_init (struct gain_t *this)
+{
+    memset (this, 0, sizeof *this);
+}
+
+bool
+gain_set (struct gain_t *this, uint8_t vol, uint8_t svol)
+{
+    if (this->valid && vol == this->vol && svol == this->svol)
+        return false;
+
+    this->vol    = vol;
+    this->svol   = svol;
+    this->target = gain_scale (vol, svol);
+
+    if (!this->valid)
+        this->cur = this->target;
+
+    this->valid = true;
+
+    return true;
+}
+
+/** gains in [0, 1] only, so products stay in range */
+static inline int16_t
+q15 (float g)
+{
+    const int32_t v = g * 32768.0f + 0.5f;
+    return v > INT16_MAX ? INT16_MAX : v;
+}
+
+static inline int32_t
+q31 (float g)
+{
+    const int64_t v = g * 2147483648.0 + 0.5;
+    return v > INT32_MAX ? INT32_MAX : v;
+}
+
+/** rounding Q15 multiply, saturated like `vqrdmulh` */
+static inline int16_t
+mul_s16 (int16_t x, int16_t g)
+{
+    const int32_t v = ((int32_t)x * g + (1 << 14)) >> 15;
+    return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+}
+
+static inline int32_t
+mul_s32 (int32_t x, int32_t g)
+{
+    const int64_t v = ((int64_t)x * g + (1ll << 30)) >> 31;
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : v;
+}
+
+static void
+scale_s16 (int16_t *dst, const int16_t *src, size_t n, int16_t g)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const int16x8_t vg = vdupq_n_s16 (g);
+
+    for (; i + 16 <= n; i += 16) {
+        vst1q_s16 (dst + i, vqrdmulhq_s16 (vld1q_s16 (src + i), vg));
+        vst1q_s16 (dst + i + 8, vqrdmulhq_s16 (vld1q_s16 (src + i + 8), vg));
+    }
+#elif defined(__SSE2__)
+    const __m128i vg  = _mm_set1_epi16 (g);
+    const __m128i rnd = _mm_set1_epi32 (1 << 14);
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x  = _mm_loadu_si128 ((const __m128i *)(src + i));
+        const __m128i lo = _mm_mullo_epi16 (x, vg);
+        const __m128i hi = _mm_mulhi_epi16 (x, vg);
+        const __m128i p0 = _mm_srai_epi32 (
+            _mm_add_epi32 (_mm_unpacklo_epi16 (lo, hi), rnd), 15);
+        const __m128i p1 = _mm_srai_epi32 (
+            _mm_add_epi32 (_mm_unpackhi_epi16 (lo, hi), rnd), 15);
+
+        _mm_storeu_si128 ((__m128i *)(dst + i), _mm_packs_epi32 (p0, p1));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = mul_s16 (src[i], g);
+}
+
+static void
+scale_s32 (int32_t *dst, const int32_t *src, size_t n, int32_t g)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const int32x4_t vg = vdupq_n_s32 (g);
+
+    for (; i + 8 <= n; i += 8) {
+        vst1q_s32 (dst + i, vqrdmulhq_s32 (vld1q_s32 (src + i), vg));
+        vst1q_s32 (dst + i + 4, vqrdmulhq_s32 (vld1q_s32 (src + i + 4), vg));
+    }
+#elif defined(__SSE2__)
+    // SSE2 only multiplies unsigned 32x32->64, so negative samples get
+    // `g << 32` taken back off. `g` is below 1, so nothing can overflow
+    const __m128i vg  = _mm_set1_epi32 (g);
+    const __m128i rnd = _mm_set1_epi64x (1ll << 30);
+    const __m128i odd = _mm_set_epi32 (-1, 0, -1, 0);
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128i x = _mm_loadu_si128 ((const __m128i *)(src + i));
+        const __m128i t = _mm_and_si128 (_mm_srai_epi32 (x, 31), vg);
+
+        __m128i pe = _mm_sub_epi64 (_mm_mul_epu32 (x, vg),
+                                    _mm_slli_epi64 (t, 32));
+        __m128i po
+            = _mm_sub_epi64 (_mm_mul_epu32 (_mm_srli_epi64 (x, 32), vg),
+                             _mm_and_si128 (t, odd));
+
+        pe = _mm_srli_epi64 (_mm_add_epi64 (pe, rnd), 31);
+        po = _mm_srli_epi64 (_mm_add_epi64 (po, rnd), 31);
+
+        pe = _mm_shuffle_epi32 (pe, _MM_SHUFFLE (3, 1, 2, 0));
+        po = _mm_shuffle_epi32 (po, _MM_SHUFFLE (3, 1, 2, 0));
+
+        _mm_storeu_si128 ((__m128i *)(dst + i), _mm_unpacklo_epi32 (pe, po));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = mul_s32 (src[i], g);
+}
+
+static void
+scale_flt (float *dst, const float *src, size_t n, float g)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t vg = vdupq_n_f32 (g);
+
+    for (; i + 8 <= n; i += 8) {
+        vst1q_f32 (dst + i, vmulq_f32 (vld1q_f32 (src + i), vg));
+        vst1q_f32 (dst + i + 4, vmulq_f32 (vld1q_f32 (src + i + 4), vg));
+    }
+#elif defined(__SSE2__)
+    const __m128 vg = _mm_set1_ps (g);
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_loadu_ps (src + i), vg));
+        _mm_storeu_ps (dst + i + 4,
+                       _mm_mul_ps (_mm_loadu_ps (src + i + 4), vg));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] * g;
+}
+
+/**
+ * only runs on the burst after a volume change or during a fade, so it
+ * stays scalar.
+ */
+#define RAMP(type, dst, src, nframes, channels, g0, step, gain_of, mul)       \
+    do {                                                                      \
+        type       *d_ = (dst);                                               \
+        const type *s_ = (src);                                               \
+        for (size_t f_ = 0; f_ < (nframes); ++f_) {                           \
+            const float g_ = (g0) + (step) * (f_ + 1);                        \
+            const __typeof__ (gain_of (g_)) q_ = gain_of (g_);                \
+            for (uint32_t c_ = 0; c_ < (channels); ++c_, ++d_, ++s_)          \
+                *d_ = mul (*s_, q_);                                          \
+        }                                                                     \
+    } while (0)
+
+#define ID(g)         (g)
+#define MUL_FLT(x, g) ((x) * (g))
+
+void
+gain_ramp (void *dst, const void *src, int fmt, size_t nframes,
+           uint32_t channels, float g0, float g1)
+{
+    const float step = (g1 - g0) / nframes;
+
+    switch (fmt) {
+        case 1:
+            RAMP (int16_t, dst, src, nframes, channels, g0, step, q15,
+                  mul_s16);
+            break;
+        case 2:
+            RAMP (int32_t, dst, src, nframes, channels, g0, step, q31,
+                  mul_s32);
+            break;
+        case 3:
+            RAMP (float, dst, src, nframes, channels, g0, step, ID, MUL_FLT);
+            break;
+    }
+}
+
+#undef RAMP
+#undef ID
+#undef MUL_FLT
+
+void
+gain_apply (struct gain_t *this, void *dst, const void *src, int fmt,
+            size_t nframes, uint32_t channels)
+{
+    const size_t n     = nframes * channels;
+    const size_t width = fmt == 1 ? 2 : 4;
+    const float  g     = this->target;
+
+    if (fmt < 1 || fmt > 3)
+        return;
+
+    if (this->cur != g && nframes) {
+        gain_ramp (dst, src, fmt, nframes, channels, this->cur, g);
+        this->cur = g;
+        return;
+    }
+
+    if (g >= 1.0f) {
+        if (dst != src)
+            memcpy (dst, src, n * width);
+    } else if (g <= 0.0f) {
+        memset (dst, 0, n * width);
+    } else if (fmt == 1) {
+        scale_s16 (dst, src, n, q15 (g));
+    } else if (fmt == 2) {
+        scale_s32 (dst, src, n, q31 (g));
+    } else {
+        scale_flt (dst, src, n, g);
+    }
+}
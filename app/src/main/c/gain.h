@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef GAIN_H
+#define GAIN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * output volume. the scale factor follows stevens's power law over the
+ * global and per-track volume and is only recomputed when either changes.
+ * a change is ramped linearly across the next burst instead of jumping.
+ */
+
+/** `1/a` of stevens's power law for loudness */
+#define GAIN_STEVENS_a_RECIP 0.67f
+
+struct gain_t {
+    float    cur;    // gain at the start of the next burst
+    float    target; // gain at its end
+    uint8_t  vol;
+    uint8_t  svol;
+    bool     valid;  // `target` is set; the first one is not ramped to
+    uint32_t gen;    // caller's change counter `target` was computed at
+};
+
+/** `(vol * svol / 10000)^(1/a)`, in [0, 1] for volumes in [0, 100] */
+extern float gain_scale (uint8_t vol, uint8_t svol);
+
+extern void gain_init (struct gain_t *_Nonnull this);
+
+/** @return whether the volumes changed and the scale was recomputed */
+extern bool gain_set (struct gain_t *_Nonnull this, uint8_t vol,
+                      uint8_t svol);
+
+/**
+ * scales `nframes` interleaved frames of WAV format `fmt` (1 S16, 2 S32,
+ * 3 FLT; others are left alone) from `src` into `dst`, which may be `src`.
+ * integer formats saturate. unity gain is a plain copy.
+ */
+extern void gain_apply (struct gain_t *_Nonnull this, void *_Nonnull dst,
+                        const void *_Nonnull src, int fmt, size_t nframes,
+                        uint32_t channels);
+
+/**
+ * per-frame linear ramp of `nframes` frames from gain `g0` to `g1`, reaching
+ * `g1` on the last frame. for fades; it takes no locks.
+ */
+extern void gain_ramp (void *_Nonnull dst, const void *_Nonnull src, int fmt,
+                       size_t nframes, uint32_t channels, float g0,
+                       float g1);
+
+#endif // !GAIN_H
@@ -0,0 +1,281 @@
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio.h"
+#include "config.h"
+#include "headcache.h"
+#include "logging.h"
+#include "pipeline.h"
+#include "properties.h"
+#include "strvec.h"
+#include "thrctl.h"
+#include "trackdb.h"
+
+static const char *FILENAME = "headcache.c";
+
+/** frames read from the pipeline at a time, so a stop is noticed */
+#define HEAD_CHUNK 4096
+
+struct head_t {
+    uint64_t key;     // trackdb key of the track, 0 if empty
+    bool     busy;    // being decoded into by the head thread
+    bool     trim;    // `trim_silence` it was decoded with
+    uint16_t keep_ms; // and `silence_keep_ms`
+    int      fmt;
+    uint32_t channels;
+    uint64_t layout;
+    uint32_t sample_rate;
+    size_t   blk;
+    size_t   nframes;
+    uint8_t *data; // `NCAP_HEAD_MAX_BYTES`, allocated on first use
+    uint64_t used; // `tick` when last filled or primed from
+};
+
+static pthread_t       head_tid;
+static bool            started = false;
+static atomic_bool     stop    = false;
+static pthread_mutex_t mx      = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  cv      = PTHREAD_COND_INITIALIZER;
+static struct head_t   heads[NCAP_HEAD_SLOTS];
+static size_t          want[NCAP_HEAD_SLOTS]; // tracks asked for, next first
+static size_t          nwant;
+static uint64_t        tick;
+static const char     *prefix;
+static const strvec_t *tracks;
+
+/**
+ * under `mx`. @return the slot to decode the head of `key` into, marked
+ * busy, or NULL if it is already cached
+ */
+static struct head_t *
+slot_for (uint64_t key, bool trim, uint16_t keep_ms)
+{
+    struct head_t *victim = NULL;
+
+    for (size_t k = 0; k < NCAP_HEAD_SLOTS; ++k) {
+        struct head_t *const h = &heads[k];
+
+        if (h->key == key && h->trim == trim && h->keep_ms == keep_ms) {
+            h->used = ++tick;
+            return NULL;
+        }
+
+        if (!h->busy && (victim == NULL || h->used < victim->used))
+            victim = h;
+    }
+
+    victim->key  = 0;
+    victim->busy = true;
+
+    return victim;
+}
+
+/** decodes the head of `fn` into `h`. @return whether it has one */
+static bool
+fill (struct head_t *h, const char *fn)
+{
+    struct pipeline_t pl;
+
+    if (h->data == NULL && (h->data = malloc (NCAP_HEAD_MAX_BYTES)) == NULL) {
+        loge ("ERROR: malloc failed for a head");
+        return false;
+    }
+
+    if (pipeline_open (&pl, fn, NULL, 0) != NCAP_OK) {
+        logwf ("WARN: no head for `%s', pipeline_open failed", fn);
+        return false;
+    }
+
+    size_t cap = (size_t)pl.sample_rate * NCAP_HEAD_MS / 1000;
+    size_t n   = 0;
+    size_t got = 1;
+
+    if (cap > NCAP_HEAD_MAX_BYTES / pl.blk)
+        cap = NCAP_HEAD_MAX_BYTES / pl.blk;
+
+    while (n < cap && got > 0 && !atomic_load (&stop)) {
+        got = pipeline_read (&pl, h->data + n * pl.blk,
+                             cap - n < HEAD_CHUNK ? cap - n : HEAD_CHUNK);
+        n += got;
+    }
+
+    h->fmt         = pl.fmt;
+    h->channels    = pl.channels;
+    h->layout      = pl.layout;
+    h->sample_rate = pl.sample_rate;
+    h->blk         = pl.blk;
+    h->nframes     = n;
+
+    pipeline_close (&pl);
+
+    logvf ("cached a head of %zu frames for `%s'", n, fn);
+
+    return n > 0 && !atomic_load (&stop);
+}
+
+static void *
+tfn_head (void *arg)
+{
+    (void)arg;
+
+    char fn[PATH_MAX];
+
+    // background work, as the analysis is
+    thrctl_apply (THRCTL_ANALYSIS);
+
+    pthread_mutex_lock (&mx);
+
+    while (true) {
+        while (nwant == 0 && !atomic_load (&stop))
+            pthread_cond_wait (&cv, &mx);
+
+        if (atomic_load (&stop))
+            break;
+
+        const size_t i = want[0];
+
+        memmove (want, want + 1, --nwant * sizeof *want);
+        pthread_mutex_unlock (&mx);
+
+        uint8_t  trim;
+        uint16_t keep_ms;
+
+        config_get_force (trim, trim_silence);
+        config_get_force (keep_ms, silence_keep_ms);
+        snprintf (fn, sizeof fn, "%s/%s", prefix, tracks->ptr[i]);
+
+        const uint64_t key = trackdb_key (fn);
+
+        pthread_mutex_lock (&mx);
+
+        struct head_t *const h = slot_for (key, trim, keep_ms);
+
+        if (h == NULL)
+            continue;
+
+        pthread_mutex_unlock (&mx);
+
+        const bool ok = fill (h, fn);
+
+        pthread_mutex_lock (&mx);
+        h->busy    = false;
+        h->key     = ok ? key : 0;
+        h->trim    = trim;
+        h->keep_ms = keep_ms;
+        h->used    = ++tick;
+    }
+
+    pthread_mutex_unlock (&mx);
+
+    return NULL;
+}
+
+int
+headcache_start (const char *prefix_, const strvec_t *sv)
+{
+    prefix = prefix_;
+    tracks = sv;
+    nwant  = 0;
+    atomic_store (&stop, false);
+
+    int pth_ret;
+
+    if ((pth_ret = pthread_create (&head_tid, NULL, tfn_head, NULL)) != 0)
+        return pth_ret;
+
+    started = true;
+
+    return 0;
+}
+
+void
+headcache_want (size_t i, bool now)
+{
+    if (!started || i >= tracks->siz)
+        return;
+
+    pthread_mutex_lock (&mx);
+
+    // asked for again, it moves
+    for (size_t k = 0; k < nwant; ++k)
+        if (want[k] == i) {
+            memmove (want + k, want + k + 1, (nwant - k - 1) * sizeof *want);
+            --nwant;
+            break;
+        }
+
+    if (now) {
+        nwant -= nwant == NCAP_HEAD_SLOTS;
+        memmove (want + 1, want, nwant * sizeof *want);
+        want[0] = i;
+        ++nwant;
+    } else if (nwant < NCAP_HEAD_SLOTS) {
+        want[nwant++] = i;
+    }
+
+    pthread_cond_signal (&cv);
+    pthread_mutex_unlock (&mx);
+}
+
+size_t
+headcache_prime (struct pipeline_t *pl)
+{
+    size_t n = 0;
+
+    if (!pl->top || pl->read > 0)
+        return 0;
+
+    pthread_mutex_lock (&mx);
+
+    for (size_t k = 0; k < NCAP_HEAD_SLOTS; ++k) {
+        struct head_t *const h = &heads[k];
+
+        if (h->key != pl->key || h->busy || h->trim != pl->trim
+            || (uint64_t)h->keep_ms * pl->sample_rate / 1000 != pl->keep
+            || h->fmt != pl->fmt || h->channels != pl->channels
+            || h->layout != pl->layout || h->sample_rate != pl->sample_rate)
+            continue;
+
+        if (pipeline_prime (pl, h->data, h->nframes) == NCAP_OK)
+            n = h->nframes;
+
+        h->used = ++tick;
+        break;
+    }
+
+    pthread_mutex_unlock (&mx);
+
+    if (n > 0)
+        logif ("playing %zu frames of the head cache first", n);
+
+    return n;
+}
+
+void
+headcache_deinit (void)
+{
+    if (started) {
+        pthread_mutex_lock (&mx);
+        atomic_store (&stop, true);
+        pthread_cond_signal (&cv);
+        pthread_mutex_unlock (&mx);
+
+        pthread_join (head_tid, NULL);
+        started = false;
+    }
+
+    for (size_t k = 0; k < NCAP_HEAD_SLOTS; ++k)
+        free (heads[k].data);
+
+    memset (heads, 0, sizeof heads);
+    nwant = 0;
+    tick  = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef HEADCACHE_H
+#define HEADCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pipeline.h"
+#include "strvec.h"
+
+/**
+ * track heads. a background thread decodes the first `NCAP_HEAD_MS` of the
+ * tracks most likely to be played next into memory: the next ones in play
+ * order, and the one under a finger as soon as it touches down, before the
+ * tap is released. a track opened at the top with its head cached plays
+ * the head while the stages decode their way past it, so its audio does not
+ * wait on the first decode.
+ *
+ * a head is only used with the silence trimming it was decoded with, as
+ * that decides which frames come first.
+ */
+
+/**
+ * starts the head thread for the tracks in `sv` under `prefix`, which must
+ * outlive `headcache_deinit`.
+ *
+ * @return 0 or a pthread error code
+ */
+extern int headcache_start (const char *_Nonnull prefix,
+                            const strvec_t *_Nonnull sv);
+
+/**
+ * asks for the head of track `i` of `sv`, ahead of all others if `now`,
+ * else after them. at most `NCAP_HEAD_SLOTS` asks wait, the last dropped
+ * past that. thread safe and nonblocking.
+ */
+extern void headcache_want (size_t i, bool now);
+
+/**
+ * primes `pl`, just opened at the top, with its head if there is one for
+ * its format and trimming, see `pipeline_prime`.
+ *
+ * @return frames primed
+ */
+extern size_t headcache_prime (struct pipeline_t *_Nonnull pl);
+
+/** stops and joins the head thread and frees everything */
+extern void headcache_deinit (void);
+
+#endif // !HEADCACHE_H
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef LIBAV_BIND_H
+#define LIBAV_BIND_H
+
+#include "libav_dl.h"
+
+/**
+ * loads libav if needed, opens `fn` and an opened decoder for its best audio
+ * stream, whose index is stored in `stream`.
+ *
+ * @return `NCAP_OK` or an `NCAP_E*` code. both contexts are NULL on error
+ */
+extern int libav_open (const char *_Nonnull fn,
+                       AVFormatContext *_Nullable *_Nonnull fctx,
+                       AVCodecContext *_Nullable *_Nonnull cctx,
+                       int *_Nonnull stream);
+
+/** closes what `libav_open` opened and NULLs the pointers */
+extern void libav_close (AVFormatContext *_Nullable *_Nonnull fctx,
+                         AVCodecContext *_Nullable *_Nonnull cctx);
+
+#endif // !LIBAV_BIND_H
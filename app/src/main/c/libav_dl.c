@@ -0,0 +1,96 @@
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "audio.h"
+#include "libav_dl.h"
+#include "logging.h"
+
+static const char *FILENAME = "libav_dl.c";
+
+#if NCAP_LAZY_LIBAV
+
+struct libav_fns_t libav_fns;
+
+/** in dependency order */
+enum libav_lib_e {
+    LIB_avutil,
+    LIB_avcodec,
+    LIB_avformat,
+    LIB_CNT,
+};
+
+static const char *const LIB_NAMES[LIB_CNT] = {
+    [LIB_avutil]   = "libavutil.so",
+    [LIB_avcodec]  = "libavcodec.so",
+    [LIB_avformat] = "libavformat.so",
+};
+
+static void          *handles[LIB_CNT];
+static pthread_once_t load_once = PTHREAD_ONCE_INIT;
+static int            load_ret  = NCAP_EGEN;
+
+static void
+load (void)
+{
+    struct timespec ts_start, ts_end;
+    clock_gettime (CLOCK_MONOTONIC, &ts_start);
+
+    for (size_t i = 0; i < LIB_CNT; ++i) {
+        if ((handles[i] = dlopen (LIB_NAMES[i], RTLD_NOW | RTLD_LOCAL))
+            == NULL) {
+            logef ("ERROR: dlopen `%s' failed: %s", LIB_NAMES[i], dlerror ());
+            return;
+        }
+    }
+
+#define LIBAV_FN_RESOLVE(lib, fn)                                             \
+    if ((libav_fns.fn = dlsym (handles[LIB_##lib], #fn)) == NULL) {           \
+        logef ("ERROR: dlsym `%s' in `%s' failed: %s", #fn,                   \
+               LIB_NAMES[LIB_##lib], dlerror ());                             \
+        return;                                                               \
+    }
+
+    LIBAV_FNS (LIBAV_FN_RESOLVE)
+
+#undef LIBAV_FN_RESOLVE
+
+    clock_gettime (CLOCK_MONOTONIC, &ts_end);
+
+    logif ("libav loaded in %.2f ms",
+           (ts_end.tv_sec - ts_start.tv_sec) * 1e3
+               + (ts_end.tv_nsec - ts_start.tv_nsec) / 1e6);
+
+    load_ret = NCAP_OK;
+}
+
+int
+libav_load (void)
+{
+    pthread_once (&load_once, load);
+    return load_ret;
+}
+
+bool
+libav_loaded (void)
+{
+    return load_ret == NCAP_OK;
+}
+
+#else // !NCAP_LAZY_LIBAV
+
+int
+libav_load (void)
+{
+    return NCAP_OK;
+}
+
+bool
+libav_loaded (void)
+{
+    return true;
+}
+
+#endif // NCAP_LAZY_LIBAV
@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef LIBAV_DL_H
+#define LIBAV_DL_H
+
+#include <stdbool.h>
+
+#include <libavutil/error.h>
+#include <libavutil/frame.h>
+
+#include <libavcodec/avcodec.h>
+
+#include <libavformat/avformat.h>
+
+#include "properties.h"
+
+/**
+ * every libav entry point NCAP calls, with the library it lives in.
+ * add new calls here and use them through `LIBAV (fn)`.
+ */
+#define LIBAV_FNS(X)                                                          \
+    X (avutil, av_strerror)                                                   \
+    X (avutil, av_get_bytes_per_sample)                                       \
+    X (avutil, av_sample_fmt_is_planar)                                       \
+    X (avutil, av_dict_get)                                                   \
+    X (avutil, av_frame_alloc)                                                \
+    X (avutil, av_frame_free)                                                 \
+    X (avutil, av_frame_unref)                                                \
+    X (avutil, av_frame_move_ref)                                             \
+    X (avutil, av_rescale_q)                                                  \
+    X (avcodec, av_packet_alloc)                                              \
+    X (avcodec, av_packet_free)                                               \
+    X (avcodec, av_packet_unref)                                              \
+    X (avcodec, avcodec_find_decoder)                                         \
+    X (avcodec, avcodec_alloc_context3)                                       \
+    X (avcodec, avcodec_free_context)                                         \
+    X (avcodec, avcodec_parameters_to_context)                                \
+    X (avcodec, avcodec_open2)                                                \
+    X (avcodec, avcodec_send_packet)                                          \
+    X (avcodec, avcodec_receive_frame)                                        \
+    X (avcodec, avcodec_flush_buffers)                                        \
+    X (avformat, avformat_alloc_context)                                      \
+    X (avformat, avformat_open_input)                                         \
+    X (avformat, avformat_find_stream_info)                                   \
+    X (avformat, avformat_close_input)                                        \
+    X (avformat, av_read_frame)                                               \
+    X (avformat, avformat_seek_file)                                          \
+    X (avformat, av_find_best_stream)
+
+#if NCAP_LAZY_LIBAV
+
+#define LIBAV_FN_DECL(lib, fn) __typeof__ (fn) *fn;
+
+/**
+ * filled by `libav_load`. do not call through it before `libav_load`
+ * returned `NCAP_OK`.
+ */
+extern struct libav_fns_t {
+    LIBAV_FNS (LIBAV_FN_DECL)
+} libav_fns;
+
+#undef LIBAV_FN_DECL
+
+#define LIBAV(fn) (libav_fns.fn)
+
+#else // !NCAP_LAZY_LIBAV
+
+#define LIBAV(fn) fn
+
+#endif // NCAP_LAZY_LIBAV
+
+/**
+ * `dlopen`s libav and resolves `libav_fns` on the first call; later calls
+ * return the result of the first. thread safe.
+ *
+ * no-op returning `NCAP_OK` when `NCAP_LAZY_LIBAV` is 0.
+ *
+ * @return `NCAP_OK` or `NCAP_EGEN`
+ */
+extern int libav_load (void);
+
+extern bool libav_loaded (void);
+
+static inline const char *_Nonnull
+libav_strerror (char *_Nonnull buf, int errnum)
+{
+    LIBAV (av_strerror) (errnum, buf, AV_ERROR_MAX_STRING_SIZE);
+    return buf;
+}
+
+/**
+ * `av_err2str` calls `av_strerror` directly, which is not linked when
+ * `NCAP_LAZY_LIBAV` is set. use this instead.
+ */
+#define libav_err2str(errnum)                                                 \
+    libav_strerror ((char[AV_ERROR_MAX_STRING_SIZE]) { 0 }, (errnum))
+
+#endif // !LIBAV_DL_H
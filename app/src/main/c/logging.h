@@ -3,10 +3,12 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
-#include <android/log.h>
-
 #include "properties.h"
 
+#ifndef NCAP_ISTEST
+
+#include <android/log.h>
+
 // clang-format off
 #define loge(fmt) __android_log_print (ANDROID_LOG_ERROR, APPID, "%s: %s: " fmt, FILENAME, __func__)
 #define logw(fmt) __android_log_print (ANDROID_LOG_WARN, APPID, "%s: %s: " fmt, FILENAME, __func__)
@@ -33,4 +35,21 @@
 #endif
 // clang-format on
 
+#else // NCAP_ISTEST
+
+#include <stdio.h>
+
+#define loge(fmt)       puts (fmt)
+#define logw(fmt)       puts (fmt)
+#define logi(fmt)       puts (fmt)
+#define logd(fmt)       puts (fmt)
+#define logv(fmt)       puts (fmt)
+#define logef(fmt, ...) printf (fmt "\n", __VA_ARGS__)
+#define logwf(fmt, ...) printf (fmt "\n", __VA_ARGS__)
+#define logif(fmt, ...) printf (fmt "\n", __VA_ARGS__)
+#define logdf(fmt, ...) printf (fmt "\n", __VA_ARGS__)
+#define logvf(fmt, ...) printf (fmt "\n", __VA_ARGS__)
+
+#endif // !NCAP_ISTEST
+
 #endif // !LOGGING_H
@@ -1,19 +1,28 @@
 #include <dirent.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <jni.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "art.h"
 #include "audio.h"
 #include "config.h"
+#include "dither.h"
+#include "headcache.h"
 #include "logging.h"
+#include "pipeline.h"
 #include "properties.h"
 #include "render.h"
 #include "strvec.h"
+#include "thrctl.h"
+#include "trackdb.h"
 
 static const char *FILENAME = "main.c";
 
@@ -80,9 +89,40 @@ load_dir (strvec_t *sv, const char *path)
 struct audio_play_args_t {
     const char *const prefix;
     strvec_t *const   sv;
+    bool              tord_saved; // the last run's shuffle order was kept
     int               errstat;
 };
 
+/** set by the main thread to stop `tfn_save`, after `audio_save_wake` */
+static _Atomic bool save_stop;
+
+/**
+ * saves the playback position and what changed in the track database every
+ * `NCAP_AUDIO_POS_SAVE_MS`, and at once when the audio thread asks, so a
+ * kill loses little and the output thread never waits on a file. saves once
+ * more on stopping, after the audio thread is joined
+ */
+static void *
+tfn_save (void *arg)
+{
+    (void)arg;
+
+    thrctl_apply (THRCTL_IO);
+
+    bool stop;
+
+    do {
+        audio_save_wait (NCAP_AUDIO_POS_SAVE_MS);
+        stop = atomic_load (&save_stop);
+        audio_save_pos ();
+
+        if (trackdb_write () != TRACKDB_OK)
+            logw ("WARN: trackdb_write failed");
+    } while (!stop);
+
+    return NULL;
+}
+
 static void *
 tfn_audio_play (void *args_vp)
 {
@@ -91,6 +131,8 @@ tfn_audio_play (void *args_vp)
     const size_t              ntracks = sv->siz;
     int                       pth_ret;
 
+    thrctl_apply (THRCTL_OUTPUT);
+
     logd ("fixing volume config...");
 
     if ((pth_ret = config_upd_vols (ntracks, 100)) != CONFIG_OK) {
@@ -102,8 +144,11 @@ tfn_audio_play (void *args_vp)
     uint8_t isshuffle;
     config_get (isshuffle, isshuffle, pth_ret);
 
-    if (pth_ret == 0 && isshuffle)
+    // a restart plays on through the last run's order
+    if (pth_ret == 0 && isshuffle && !args->tord_saved) {
         config_tord_reshuffle (ntracks);
+        config_write ();
+    }
 
     int ret;
 
@@ -119,6 +164,7 @@ tfn_audio_play (void *args_vp)
 
     size_t  i;
     uint8_t pisshuffle = UINT8_MAX;
+    bool    resume     = true;
 
     for (; true; pisshuffle = isshuffle) {
         config_get_force (i, cur_track);
@@ -143,22 +189,55 @@ tfn_audio_play (void *args_vp)
         path_concat (fn_out, activity->internalDataPath,
                      NCAP_AUDIO_CACHE_FILE);
 
-        // get PCM
+        // the first track picks up where the last run saved it, if it is
+        // still the same file
+        uint64_t start = 0;
 
-        logif ("converting `%s' to WAV file `%s'...", fn_in, fn_out);
+        if (resume) {
+            uint64_t key;
 
-        if ((args->errstat = libav_cvt_cwav (fn_in, fn_out)) != NCAP_OK) {
-            logef ("ERROR: libav_cvt_wav failed with code %d. aborting...\n",
+            config_get_force (key, cur_key);
+
+            if (key == trackdb_key (fn_in))
+                config_get_force (start, cur_frame);
+
+            resume = false;
+        }
+
+        // decode and play
+
+        logif ("streaming `%s' from frame %" PRIu64 ", caching PCM to "
+               "`%s'...",
+               fn_in, start, fn_out);
+
+        struct pipeline_t pl;
+
+        if ((args->errstat = pipeline_open (&pl, fn_in, fn_out, start))
+            != NCAP_OK) {
+            logef ("ERROR: pipeline_open failed with code %d. aborting...\n",
                    args->errstat);
             goto exit;
         }
 
-        // play audio
+        // the head plays while the first decode catches up, and the next
+        // tracks get theirs
+        headcache_prime (&pl);
+
+        for (size_t k = 1; k <= NCAP_HEAD_AHEAD && k < ntracks; ++k)
+            headcache_want (isshuffle
+                                ? config_tord_at ((i + k) % ntracks, NULL)
+                                : (i + k) % ntracks,
+                            false);
 
         logi ("playing audio...");
 
-        if ((args->errstat = audio_play (fn_out, ct)) < NCAP_OK) {
-            logef ("ERROR: libav_cvt_wav failed with code %d. aborting...\n",
+        args->errstat = audio_play (&pl, ct);
+
+        pipeline_logstats (&pl);
+        pipeline_close (&pl);
+
+        if (args->errstat < NCAP_OK) {
+            logef ("ERROR: audio_play failed with code %d. aborting...\n",
                    args->errstat);
             goto exit;
         }
@@ -192,9 +271,14 @@ tfn_audio_play (void *args_vp)
 
             config_get (isshuffle, isshuffle, pth_ret);
 
-            if (pth_ret == 0 && isshuffle)
+            if (pth_ret == 0 && isshuffle) {
                 config_tord_reshuffle (ntracks);
+                config_write ();
+            }
         }
+
+        // the next track from its top, should the app be killed now
+        audio_save_top ();
     }
 
     if (i == ntracks) {
@@ -204,12 +288,47 @@ tfn_audio_play (void *args_vp)
     }
 
 exit:
+    audio_deinit ();
     pthread_exit (NULL);
 }
 
+static void
+config_defaults (void)
+{
+    ncap_config.version         = NCAP_CONFIG_VERSION;
+    ncap_config.aaudio_optimize = 2; // power saving
+    ncap_config.cur_track       = 0;
+    ncap_config.isrepeat        = 0; // false
+    ncap_config.isshuffle       = 0; // false
+    ncap_config.volume          = 100;
+    ncap_config.trim_silence    = 1; // true
+    ncap_config.silence_keep_ms = 250;
+    ncap_config.eq_on           = 0; // false
+    ncap_config.eq_preset       = EQ_PRESET_FLAT;
+    ncap_config.eq_nbands       = 0;
+    ncap_config.eq_preamp       = 0;
+    memset (ncap_config.eq_bands, 0, sizeof ncap_config.eq_bands);
+    ncap_config.speed           = 100;
+    ncap_config.mono            = 0; // false
+    ncap_config.balance         = 0;
+    ncap_config.dither          = DITHER_SHAPED;
+    ncap_config.track_path      = NCAP_DEFAULT_TRACK_PATH;
+    ncap_config.track_path_len  = strlen (ncap_config.track_path) + 1;
+    ncap_config.ntracks         = 0;
+    ncap_config.track_vols      = NULL;
+    ncap_config.tord_len        = 0;
+    ncap_config.cur_key         = 0;
+    ncap_config.cur_frame       = 0;
+    config_write ();
+}
+
 int
 main (void)
 {
+    // before any threads, which place themselves on it
+    thrctl_init (THRCTL_SYSFS);
+    thrctl_apply (THRCTL_RENDER);
+
     audio_init ();
     render_init ();
 
@@ -221,23 +340,21 @@ main (void)
     // remove (cfgfile);
     switch (config_init (cfgfile)) {
         case CONFIG_INIT_CREAT:
-            ncap_config.aaudio_optimize = 2; // power saving
-            ncap_config.cur_track       = 0;
-            ncap_config.isrepeat        = 0; // false
-            ncap_config.isshuffle       = 0; // false
-            ncap_config.volume          = 100;
-            ncap_config.track_path      = NCAP_DEFAULT_TRACK_PATH;
-            ncap_config.track_path_len  = strlen (ncap_config.track_path) + 1;
-            ncap_config.ntracks         = 0;
-            ncap_config.track_vols      = NULL;
-            config_write ();
+            config_defaults ();
             break;
         case CONFIG_INIT_EXISTS:
             logi ("config exists. reading config...");
 
-            if (config_read () < 0) {
-                loge ("ERROR: config_read failed. aborting...");
-                return 1;
+            switch (config_read ()) {
+                case CONFIG_OK:
+                    break;
+                case CONFIG_EVER:
+                    logw ("WARN: config layout changed. using defaults...");
+                    config_defaults ();
+                    break;
+                default:
+                    loge ("ERROR: config_read failed. aborting...");
+                    return 1;
             }
 
             break;
@@ -248,6 +365,13 @@ main (void)
 
     config_logdump ();
 
+    static char dbfile[MAX_PATH_LEN];
+    path_concat (dbfile, activity->internalDataPath, NCAP_TRACKDB_FILE);
+    logdf ("initializing track database `%s'", dbfile);
+
+    if (trackdb_init (dbfile) != TRACKDB_OK)
+        logw ("WARN: trackdb_init failed. per-track data will not persist");
+
     logif ("loading tracks in configured directory `%s'...",
            ncap_config.track_path);
     strvec_t sv;
@@ -256,15 +380,41 @@ main (void)
     int loadret = load_dir (&sv, ncap_config.track_path);
     int ctoret  = config_tord_init (sv.siz, 1314520);
 
-    pthread_t                audio_tid;
+    pthread_t                audio_tid, save_tid;
     struct audio_play_args_t audio_args = {
         .prefix = ncap_config.track_path,
         .sv     = &sv,
     };
 
-    if (loadret >= 0 && ctoret == NCAP_OK) {
+    int pth_ret;
+
+    static char atlasfile[MAX_PATH_LEN];
+    path_concat (atlasfile, activity->internalDataPath, NCAP_ART_ATLAS_FILE);
+
+    if (loadret >= 0
+        && (pth_ret = art_start (ncap_config.track_path, &sv, atlasfile,
+                                 RENDER_ROW_SIZ))
+               != 0) {
+        logwf ("WARN: art_start failed with error code %d: %s. no album "
+               "art",
+               pth_ret, strerror (pth_ret));
+    }
+
+    if (loadret >= 0
+        && (pth_ret = headcache_start (ncap_config.track_path, &sv)) != 0) {
+        logwf ("WARN: headcache_start failed with error code %d: %s. tracks "
+               "start on their first decode",
+               pth_ret, strerror (pth_ret));
+    }
+
+    audio_args.tord_saved = ctoret == CONFIG_TORD_SAVED;
+
+    if (loadret >= 0 && ctoret >= CONFIG_OK) {
         pthread_create (&audio_tid, NULL, tfn_audio_play, &audio_args);
         logi ("spawned audio_play thread");
+        atomic_store (&save_stop, false);
+        pthread_create (&save_tid, NULL, tfn_save, NULL);
+        logi ("spawned save thread");
     } else {
         logef ("ERROR: not playing audio, load_dir returned %d and "
                "config_tord_init returned %d",
@@ -280,6 +430,22 @@ main (void)
                audio_args.errstat);
     }
 
+    if (loadret >= 0 && ctoret >= CONFIG_OK) {
+        atomic_store (&save_stop, true);
+        audio_save_wake ();
+        pthread_join (save_tid, NULL);
+        logi ("save thread joined");
+    }
+
+    logi ("deinit album art...");
+    art_deinit ();
+
+    logi ("deinit head cache...");
+    headcache_deinit ();
+
+    logi ("deinit pipeline pools...");
+    pipeline_deinit ();
+
     logi ("updating config...");
     config_write ();
 
@@ -289,6 +455,10 @@ main (void)
     logi ("deinit config_tord");
     config_tord_deinit ();
 
+    logi ("deinit trackdb...");
+    if (trackdb_deinit () != TRACKDB_OK)
+        logw ("WARN: trackdb_deinit failed");
+
     logi ("deinit config...");
     if (config_deinit () != CONFIG_OK)
         logw ("WARN: config_deinit failed");
@@ -0,0 +1,1274 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libavutil/error.h>
+#include <libavutil/frame.h>
+
+#include <libavcodec/avcodec.h>
+
+#include <libavformat/avformat.h>
+
+#include "analyze.h"
+#include "arena.h"
+#include "audio.h"
+#include "config.h"
+#include "libav_bind.h"
+#include "libav_dl.h"
+#include "logging.h"
+#include "pipeline.h"
+#include "properties.h"
+#include "silence.h"
+#include "spscq.h"
+#include "thrctl.h"
+#include "trackdb.h"
+
+static const char *FILENAME = "pipeline.c";
+
+/** packets allocated by the demux stage, at most */
+#define PKT_MAX (PIPELINE_PKTQ_CAP + 4)
+
+/** blocks the trailing silence holdback may keep, at most */
+#define HOLD_MAX 512
+
+/** blocks allocated by the decode stage, at most */
+#define BLK_MAX (PIPELINE_BLKQ_CAP + HOLD_MAX + 4)
+
+/**
+ * blocks and packets kept between tracks for the next one's stages, and
+ * heads for `pipeline_prime`, so starting a track does not allocate them
+ * again. two heads: the track playing and the one opening next.
+ */
+#define BLK_KEEP  (PIPELINE_BLKQ_CAP + 4)
+#define PKT_KEEP  PKT_MAX
+#define HEAD_KEEP 2
+
+/**
+ * a run of interleaved frames. `data` points into `frame` for packed formats
+ * (a reference, not a copy) and into `ibuf` otherwise.
+ */
+struct pcm_blk_t {
+    AVFrame       *frame;
+    const uint8_t *data;
+    size_t         nframes;
+    uint8_t       *ibuf;
+    size_t         ibuf_siz;
+};
+
+/** trailing silence not let through yet, decode thread only */
+struct hold_t {
+    struct pcm_blk_t *blks[HOLD_MAX];
+    size_t            first;
+    size_t            n;
+    uint64_t          frames;
+    uint64_t          frames_max;
+    uint64_t          run; // silent frames let through since the last loud
+};
+
+static void *blk_kept[BLK_KEEP];
+static void *pkt_kept[PKT_KEEP];
+static void *head_kept[HEAD_KEEP];
+
+static struct pool_t blk_pool  = POOL_INITIALIZER (blk_kept);
+static struct pool_t pkt_pool  = POOL_INITIALIZER (pkt_kept);
+static struct pool_t head_pool = POOL_INITIALIZER (head_kept);
+
+static void
+seterr (struct pipeline_t *this, int err)
+{
+    int expected = NCAP_OK;
+    atomic_compare_exchange_strong (&this->errstat, &expected, err);
+}
+
+static bool
+stopping (struct pipeline_t *this)
+{
+    return atomic_load_explicit (&this->stop, memory_order_relaxed);
+}
+
+static void
+blk_unref (struct pcm_blk_t *blk)
+{
+    LIBAV (av_frame_unref) (blk->frame);
+    blk->data    = NULL;
+    blk->nframes = 0;
+}
+
+static void
+blk_destroy (struct pcm_blk_t *blk)
+{
+    LIBAV (av_frame_free) (&blk->frame);
+    free (blk->ibuf);
+    free (blk);
+}
+
+/** keeps `blk` for the next track, or frees it if enough are kept */
+static void
+blk_free (struct pcm_blk_t *blk)
+{
+    if (blk == NULL)
+        return;
+
+    blk_unref (blk);
+
+    if (!pool_put (&blk_pool, blk))
+        blk_destroy (blk);
+}
+
+/** and `pkt` */
+static void
+pkt_free (AVPacket *pkt)
+{
+    LIBAV (av_packet_unref) (pkt);
+
+    if (!pool_put (&pkt_pool, pkt))
+        LIBAV (av_packet_free) (&pkt);
+}
+
+static int
+blk_reserve (struct pcm_blk_t *blk, size_t nbytes)
+{
+    if (blk->ibuf_siz >= nbytes)
+        return NCAP_OK;
+
+    uint8_t *tmp = realloc (blk->ibuf, nbytes);
+
+    if (tmp == NULL)
+        return NCAP_EALLOC;
+
+    blk->ibuf     = tmp;
+    blk->ibuf_siz = nbytes;
+
+    return NCAP_OK;
+}
+
+/**
+ * decode thread. recycled block if there is one, otherwise one kept from
+ * the last track or a new one while under `BLK_MAX`, otherwise waits for
+ * the output stage to hand one back.
+ */
+static struct pcm_blk_t *
+blk_get (struct pipeline_t *this, struct pcm_blk_t **spare)
+{
+    struct pcm_blk_t *blk;
+
+    if ((blk = *spare) != NULL) {
+        *spare = NULL;
+        return blk;
+    }
+
+    if ((blk = spscq_trypop (&this->blk_free)) != NULL)
+        return blk;
+
+    if (this->nblks < BLK_MAX && (blk = pool_get (&blk_pool)) != NULL) {
+        ++this->nblks;
+        return blk;
+    }
+
+    if (this->nblks < BLK_MAX) {
+        if ((blk = calloc (1, sizeof *blk)) == NULL)
+            return NULL;
+
+        if ((blk->frame = LIBAV (av_frame_alloc) ()) == NULL) {
+            free (blk);
+            return NULL;
+        }
+
+        ++this->nblks;
+        return blk;
+    }
+
+    return spscq_pop (&this->blk_free);
+}
+
+/**
+ * call once the stream format is known
+ */
+static void
+gen_wav_header (struct cwav_header_t *header, const struct pipeline_t *pl,
+                uint64_t frames)
+{
+    const uint32_t datasiz = frames * pl->blk;
+
+    // RIFF chunk
+    strncpy (header->riff.ckID, "RIFF", 4);
+    strncpy (header->riff.WAVEID, "WAVE", 4);
+    header->riff.cksize = datasiz + CWAV_HEADER_SIZ - 8;
+
+    // data fmt chunk
+    // clang-format off
+    strncpy (header->fmt.ckID, "fmt\0", 4);
+    header->fmt.cksize          = 16; // 16 is for PCM
+    header->fmt.wFormatTag      = pl->fmt;
+    header->fmt.nChannels       = pl->channels;
+    header->fmt.nSamplesPerSec  = pl->sample_rate;
+    header->fmt.wBitsPerSample  = pl->width << 3;
+    header->fmt.nAvgBytesPerSec = pl->sample_rate * pl->blk;
+    header->fmt.nBlockAlign     = pl->blk;
+    // clang-format on
+
+    // sampled data chunk
+    strncpy (header->data.ckID, "data", sizeof header->data.ckID);
+    header->data.cksize = datasiz;
+}
+
+/** hands a block to the output stage and the WAV cache */
+static int
+emit (struct pipeline_t *this, struct pcm_blk_t *blk)
+{
+    if (this->cache_fp != NULL)
+        fwrite (blk->data, this->blk, blk->nframes, this->cache_fp);
+
+    this->emitted += blk->nframes;
+
+    if (spscq_push (&this->blkq, blk) != SPSCQ_OK) {
+        blk_free (blk);
+        return SPSCQ_CLOSD;
+    }
+
+    atomic_fetch_add_explicit (&this->decode_items, 1, memory_order_relaxed);
+
+    return SPSCQ_OK;
+}
+
+static int
+hold_release (struct pipeline_t *this, struct hold_t *hold)
+{
+    int ret = SPSCQ_OK;
+
+    for (; hold->n; --hold->n) {
+        struct pcm_blk_t *blk = hold->blks[hold->first];
+
+        hold->first = (hold->first + 1) % HOLD_MAX;
+        hold->frames -= blk->nframes;
+        hold->run += blk->nframes;
+
+        if (ret == SPSCQ_OK)
+            ret = emit (this, blk);
+        else
+            blk_free (blk);
+    }
+
+    return ret;
+}
+
+/**
+ * holds back a silent block that is past the kept pad. lets the oldest held
+ * blocks through once there is more than `PIPELINE_HOLD_MS` of them.
+ */
+static int
+hold_push (struct pipeline_t *this, struct hold_t *hold,
+           struct pcm_blk_t *blk)
+{
+    int ret = SPSCQ_OK;
+
+    while (ret == SPSCQ_OK && hold->n
+           && (hold->n == HOLD_MAX
+               || hold->frames + blk->nframes > hold->frames_max)) {
+        struct pcm_blk_t *old = hold->blks[hold->first];
+
+        hold->first = (hold->first + 1) % HOLD_MAX;
+        --hold->n;
+        hold->frames -= old->nframes;
+        hold->run += old->nframes;
+
+        ret = emit (this, old);
+    }
+
+    hold->blks[(hold->first + hold->n++) % HOLD_MAX] = blk;
+    hold->frames += blk->nframes;
+
+    return ret;
+}
+
+/**
+ * end of track. lets the held blocks through up to the kept pad and drops
+ * the rest.
+ */
+static int
+hold_end (struct pipeline_t *this, struct hold_t *hold)
+{
+    int ret = SPSCQ_OK;
+
+    for (; hold->n; --hold->n) {
+        struct pcm_blk_t *blk = hold->blks[hold->first];
+        const uint64_t    pad = hold->run < this->keep
+                                    ? this->keep - hold->run
+                                    : 0;
+
+        hold->first = (hold->first + 1) % HOLD_MAX;
+
+        if (pad == 0 || ret != SPSCQ_OK) {
+            blk_free (blk);
+            continue;
+        }
+
+        if (blk->nframes > pad)
+            blk->nframes = pad;
+
+        hold->run += blk->nframes;
+        ret = emit (this, blk);
+    }
+
+    hold->frames = 0;
+
+    return ret;
+}
+
+/**
+ * trims leading and trailing silence off `blk`, then emits it.
+ * takes ownership of `blk`.
+ */
+static int
+trim_emit (struct pipeline_t *this, struct hold_t *hold,
+           struct pcm_blk_t *blk, struct pcm_blk_t **spare)
+{
+    if (this->skip > 0) {
+        const size_t n
+            = this->skip < blk->nframes ? this->skip : blk->nframes;
+
+        this->skip -= n;
+        blk->data += n * this->blk;
+        blk->nframes -= n;
+
+        if (blk->nframes == 0) {
+            blk_unref (blk);
+            *spare = blk;
+            return SPSCQ_OK;
+        }
+    }
+
+    // analyzers see the whole track, trimmed or not
+    analyze_feed (&this->an, blk->data, this->fmt, blk->nframes);
+
+    if (!this->trim)
+        return emit (this, blk);
+
+    // a track trimmed before is cut where it was, without scanning it
+    if (this->cut_to > 0) {
+        const uint64_t pos = this->sil.pos;
+
+        this->sil.pos += blk->nframes;
+
+        const uint64_t from = pos > this->cut_from ? pos : this->cut_from;
+        const uint64_t to
+            = this->sil.pos < this->cut_to ? this->sil.pos : this->cut_to;
+
+        if (from >= to) {
+            blk_unref (blk);
+            *spare = blk;
+            return SPSCQ_OK;
+        }
+
+        blk->data += (from - pos) * this->blk;
+        blk->nframes = to - from;
+
+        return emit (this, blk);
+    }
+
+    const uint64_t pos  = this->sil.pos;
+    const uint64_t loud = this->sil.end_loud;
+    const bool     lead = this->sil.first_loud == SILENCE_NONE;
+    const size_t   first = silence_scan (&this->sil, blk->data, this->fmt,
+                                         blk->nframes, this->channels);
+
+    if (lead) {
+        if (first == blk->nframes) {
+            blk_unref (blk);
+            *spare = blk;
+            return SPSCQ_OK;
+        }
+
+        // the kept lead-in is below the threshold anyway, so emit it as
+        // digital silence instead of holding on to it
+        const uint64_t pad = pos + first < this->keep ? pos + first
+                                                      : this->keep;
+
+        this->head = pos + first - pad;
+
+        if (pad) {
+            struct pcm_blk_t *zblk = blk_get (this, spare);
+
+            if (zblk == NULL || blk_reserve (zblk, pad * this->blk) != 0) {
+                blk_free (zblk);
+                seterr (this, NCAP_EALLOC);
+                blk_free (blk);
+                return SPSCQ_CLOSD;
+            }
+
+            memset (zblk->ibuf, 0, pad * this->blk);
+            zblk->data    = zblk->ibuf;
+            zblk->nframes = pad;
+
+            if (emit (this, zblk) != SPSCQ_OK) {
+                blk_free (blk);
+                return SPSCQ_CLOSD;
+            }
+        }
+
+        blk->data += first * this->blk;
+        blk->nframes -= first;
+    }
+
+    if (this->sil.end_loud != loud || lead) {
+        int ret;
+
+        if ((ret = hold_release (this, hold)) != SPSCQ_OK) {
+            blk_free (blk);
+            return ret;
+        }
+
+        hold->run = this->sil.pos - this->sil.end_loud;
+        return emit (this, blk);
+    }
+
+    if (hold->n == 0 && hold->run + blk->nframes <= this->keep) {
+        hold->run += blk->nframes;
+        return emit (this, blk);
+    }
+
+    return hold_push (this, hold, blk);
+}
+
+/**
+ * the frames to drop before `start`, from where the first decoded frame
+ * landed after the seek
+ */
+static void
+skip_find (struct pipeline_t *this, const AVFrame *frame)
+{
+    const AVFormatContext *fctx = this->fctx;
+    const AVStream        *st   = fctx->streams[this->stream];
+
+    this->skip_known = true;
+
+    if (!this->seeked) {
+        this->skip = this->start;
+        return;
+    }
+
+    if (frame->pts == AV_NOPTS_VALUE) {
+        logw ("WARN: no timestamp after the seek. starting where it landed");
+        this->skip = 0;
+        return;
+    }
+
+    const int64_t pos = LIBAV (av_rescale_q) (
+        frame->pts, st->time_base,
+        (AVRational){ 1, (int)this->sample_rate });
+
+    this->skip = pos < 0                       ? this->start
+                 : (uint64_t)pos < this->start ? this->start - pos
+                                               : 0;
+
+    logdf ("seek landed %" PRIu64 " frames before the start", this->skip);
+}
+
+/**
+ * turns one decoded frame into a block. packed frames are moved, planar ones
+ * interleaved into the block's own buffer.
+ */
+static int
+frame_emit (struct pipeline_t *this, struct hold_t *hold, AVFrame *frame,
+            struct pcm_blk_t **spare)
+{
+    // the stream is set up for the first frame's channels. a frame with
+    // others would be read past its planes or out of step
+    if (frame->ch_layout.nb_channels != (int)this->channels) {
+        logwf ("WARN: dropping a frame of %d channels in a %" PRIu32
+               "-channel stream",
+               frame->ch_layout.nb_channels, this->channels);
+        LIBAV (av_frame_unref) (frame);
+        return SPSCQ_OK;
+    }
+
+    if (!this->skip_known)
+        skip_find (this, frame);
+
+    struct pcm_blk_t *blk = blk_get (this, spare);
+
+    if (blk == NULL) {
+        LIBAV (av_frame_unref) (frame);
+        return stopping (this) ? SPSCQ_CLOSD : NCAP_EALLOC;
+    }
+
+    const AVCodecContext *cctx = this->cctx;
+
+    blk->nframes = frame->nb_samples;
+
+    if (!LIBAV (av_sample_fmt_is_planar) (cctx->sample_fmt)) {
+        LIBAV (av_frame_move_ref) (blk->frame, frame);
+        blk->data = blk->frame->data[0];
+
+        return trim_emit (this, hold, blk, spare);
+    }
+
+    if (blk_reserve (blk, blk->nframes * this->blk) != NCAP_OK) {
+        LIBAV (av_frame_unref) (frame);
+        blk_free (blk);
+        return NCAP_EALLOC;
+    }
+
+    // extended_data has every plane, data only the first
+    // AV_NUM_DATA_POINTERS, so planes past 8 (7.1) are only found there
+    for (uint32_t ch = 0; ch < this->channels; ++ch) {
+        const uint8_t *src = frame->extended_data[ch];
+        uint8_t       *dst = blk->ibuf + ch * this->width;
+
+        for (size_t f = 0; f < blk->nframes;
+             ++f, src += this->width, dst += this->blk)
+            memcpy (dst, src, this->width);
+    }
+
+    LIBAV (av_frame_unref) (frame);
+    blk->data = blk->ibuf;
+
+    return trim_emit (this, hold, blk, spare);
+}
+
+/**
+ * @return `SPSCQ_OK`, `SPSCQ_CLOSD` once the output side is gone, or an
+ * error code
+ */
+static int
+decode (struct pipeline_t *this, struct hold_t *hold, const AVPacket *pkt,
+        AVFrame *frame, struct pcm_blk_t **spare)
+{
+    AVCodecContext *cctx  = this->cctx;
+    int             avret = LIBAV (avcodec_send_packet) (cctx, pkt);
+
+    if (avret < 0) {
+        logef ("ERROR: avcodec_send_packet failed with code %d: %s\n", avret,
+               libav_err2str (avret));
+        return NCAP_EGEN;
+    }
+
+    // read all the output frames (in general there may be any number of them)
+    while (true) {
+        avret = LIBAV (avcodec_receive_frame) (cctx, frame);
+
+        if (avret == AVERROR (EAGAIN) || avret == AVERROR_EOF) {
+            return SPSCQ_OK;
+        } else if (avret < 0) {
+            logef ("ERROR: Decode error with code %d: %s\n", avret,
+                   libav_err2str (avret));
+            return NCAP_EGEN;
+        }
+
+        int ret;
+
+        if ((ret = frame_emit (this, hold, frame, spare)) != SPSCQ_OK)
+            return ret;
+    }
+}
+
+static void *
+tfn_demux (void *arg)
+{
+    struct pipeline_t *this = arg;
+    size_t             npkts = 0;
+    AVPacket          *pkt;
+
+    thrctl_apply (THRCTL_IO);
+
+    while (!stopping (this)) {
+        if ((pkt = spscq_trypop (&this->pkt_free)) == NULL) {
+            if (npkts < PKT_MAX) {
+                if ((pkt = pool_get (&pkt_pool)) == NULL
+                    && (pkt = LIBAV (av_packet_alloc) ()) == NULL) {
+                    loge ("ERROR: av_packet_alloc failed");
+                    seterr (this, NCAP_EALLOC);
+                    break;
+                }
+
+                ++npkts;
+            } else if ((pkt = spscq_pop (&this->pkt_free)) == NULL) {
+                break;
+            }
+        }
+
+        int avret;
+
+        // other streams and empty packets are skipped in place
+        while ((avret = LIBAV (av_read_frame) (this->fctx, pkt)) >= 0
+               && (pkt->stream_index != this->stream || pkt->size <= 0))
+            LIBAV (av_packet_unref) (pkt);
+
+        if (avret < 0) {
+            pkt_free (pkt);
+            break;
+        }
+
+        atomic_fetch_add_explicit (&this->demux_items, 1,
+                                   memory_order_relaxed);
+
+        if (spscq_push (&this->pktq, pkt) != SPSCQ_OK) {
+            pkt_free (pkt);
+            break;
+        }
+    }
+
+    spscq_close (&this->pktq);
+
+    return NULL;
+}
+
+static void *
+tfn_decode (void *arg)
+{
+    struct pipeline_t *this  = arg;
+    struct pcm_blk_t  *spare = NULL;
+    AVFrame           *frame = LIBAV (av_frame_alloc) ();
+    struct hold_t     *hold  = calloc (1, sizeof *hold);
+    AVPacket          *pkt;
+    int                ret   = SPSCQ_OK;
+
+    thrctl_apply (THRCTL_DECODE);
+
+    if (frame == NULL || hold == NULL) {
+        loge ("ERROR: could not allocate decode state");
+        seterr (this, NCAP_EALLOC);
+        goto exit;
+    }
+
+    hold->frames_max = (uint64_t)PIPELINE_HOLD_MS * this->sample_rate / 1000;
+
+    size_t                          nan;
+    const struct analyzer_t *const *an = analyze_registered (&nan);
+
+    if (analyze_begin (&this->an, this->key, an, nan, this->sample_rate,
+                       this->channels, NCAP_ANALYZE_THREADED)
+        != ANALYZE_OK)
+        logw ("WARN: analyze_begin failed. not analyzing this track");
+
+    while ((pkt = spscq_pop (&this->pktq)) != NULL) {
+        ret = decode (this, hold, pkt, frame, &spare);
+
+        LIBAV (av_packet_unref) (pkt);
+
+        if (spscq_push (&this->pkt_free, pkt) != SPSCQ_OK)
+            pkt_free (pkt);
+
+        if (ret == NCAP_EGEN) {
+            // a corrupt packet should not end the track
+            ret = SPSCQ_OK;
+        } else if (ret != SPSCQ_OK) {
+            break;
+        }
+    }
+
+    if (ret == SPSCQ_OK && !stopping (this)) {
+        // flush the decoder
+        ret = decode (this, hold, NULL, frame, &spare);
+    }
+
+    if (ret == SPSCQ_OK && !stopping (this))
+        ret = hold_end (this, hold);
+    else
+        hold_release (this, hold);
+
+    if (ret != SPSCQ_OK && ret != SPSCQ_CLOSD)
+        seterr (this, ret);
+
+    this->ended = ret == SPSCQ_OK && !stopping (this);
+
+    // results of a partly decoded track would be wrong
+    const bool done = this->ended && this->start == 0;
+
+    analyze_end (&this->an, this->key, done);
+
+    if (this->trim && done) {
+        const struct cwav_trim_t trimrec = {
+            .frames = this->sil.pos,
+            .head   = this->head,
+            .tail   = this->sil.pos - this->head - this->emitted,
+            .keep   = this->keep,
+        };
+
+        logif ("trimmed %" PRIu64 " head and %" PRIu64 " tail frames of "
+               "%" PRIu64,
+               trimrec.head, trimrec.tail, trimrec.frames);
+
+        trackdb_put (this->key, CWAV_TRIM_TAG, CWAV_TRIM_VER, &trimrec,
+                     sizeof trimrec);
+    }
+
+exit:
+    spscq_close (&this->blkq);
+
+    blk_free (spare);
+    free (hold);
+    LIBAV (av_frame_free) (&frame);
+
+    return NULL;
+}
+
+static void
+cache_end (struct pipeline_t *this)
+{
+    if (this->cache_fp == NULL)
+        return;
+
+    struct cwav_header_t header;
+    gen_wav_header (&header, this, this->emitted);
+
+    fseek (this->cache_fp, 0, SEEK_SET);
+    fwrite (&header, CWAV_HEADER_SIZ, 1, this->cache_fp);
+    fclose (this->cache_fp);
+    this->cache_fp = NULL;
+
+    if (this->cache_rd != NULL) {
+        fclose (this->cache_rd);
+        this->cache_rd = NULL;
+    }
+
+    logvf ("WAV cache data size:\t%u", header.data.cksize);
+}
+
+/**
+ * seeks the demuxer to the last index entry at or before `start`, or back
+ * to the top if that fails. the decode stage finds out where it landed.
+ */
+static void
+seek_start (struct pipeline_t *this)
+{
+    AVFormatContext *fctx = this->fctx;
+    const int64_t    ts   = LIBAV (av_rescale_q) (
+        (int64_t)this->start, (AVRational){ 1, (int)this->sample_rate },
+        fctx->streams[this->stream]->time_base);
+    const int avret = LIBAV (avformat_seek_file) (fctx, this->stream,
+                                                  INT64_MIN, ts, ts, 0);
+
+    this->seeked = avret >= 0;
+
+    if (this->seeked) {
+        logif ("seeked to frame %" PRIu64, this->start);
+        return;
+    }
+
+    logwf ("WARN: seek to frame %" PRIu64 " failed with code %d: %s. "
+           "decoding up to it...",
+           this->start, avret, libav_err2str (avret));
+
+    // a no-op right after the open
+    LIBAV (avformat_seek_file) (fctx, this->stream, INT64_MIN, 0, 0, 0);
+}
+
+/** the stream's length in frames, 0 if unknown */
+static uint64_t
+length_find (const struct pipeline_t *this)
+{
+    const AVFormatContext *fctx = this->fctx;
+    const AVStream        *st   = fctx->streams[this->stream];
+    const AVRational       tb   = { 1, (int)this->sample_rate };
+
+    if (st->duration != AV_NOPTS_VALUE && st->duration > 0)
+        return LIBAV (av_rescale_q) (st->duration, st->time_base, tb);
+
+    if (fctx->duration != AV_NOPTS_VALUE && fctx->duration > 0)
+        return LIBAV (av_rescale_q) (fctx->duration,
+                                     (AVRational){ 1, AV_TIME_BASE }, tb);
+
+    return 0;
+}
+
+/** sets up the queues and starts the demux and decode threads */
+static int
+stages_start (struct pipeline_t *this)
+{
+    int ret = NCAP_EALLOC;
+
+    atomic_store (&this->stop, false);
+    this->nblks = 0;
+
+    if (spscq_init (&this->pktq, PIPELINE_PKTQ_CAP) != SPSCQ_OK)
+        return ret;
+
+    if (spscq_init (&this->pkt_free, PKT_MAX) != SPSCQ_OK)
+        goto deinit_pktq;
+
+    if (spscq_init (&this->blkq, PIPELINE_BLKQ_CAP) != SPSCQ_OK)
+        goto deinit_pkt_free;
+
+    if (spscq_init (&this->blk_free, BLK_MAX) != SPSCQ_OK)
+        goto deinit_blkq;
+
+    if ((ret = pthread_create (&this->demux_tid, NULL, tfn_demux, this))
+        != 0) {
+        logef ("ERROR: pthread_create failed for demux: %s", strerror (ret));
+        ret = NCAP_EGEN;
+        goto deinit_blk_free;
+    }
+
+    if ((ret = pthread_create (&this->decode_tid, NULL, tfn_decode, this))
+        != 0) {
+        logef ("ERROR: pthread_create failed for decode: %s", strerror (ret));
+        atomic_store (&this->stop, true);
+        spscq_close (&this->pkt_free);
+        spscq_close (&this->pktq);
+        pthread_join (this->demux_tid, NULL);
+
+        // packets left in the queues are reclaimed below
+        for (AVPacket *pkt; (pkt = spscq_trypop (&this->pktq)) != NULL;)
+            pkt_free (pkt);
+
+        for (AVPacket *pkt; (pkt = spscq_trypop (&this->pkt_free)) != NULL;)
+            pkt_free (pkt);
+
+        ret = NCAP_EGEN;
+        goto deinit_blk_free;
+    }
+
+    this->running = true;
+
+    return NCAP_OK;
+
+deinit_blk_free:
+    spscq_deinit (&this->blk_free);
+deinit_blkq:
+    spscq_deinit (&this->blkq);
+deinit_pkt_free:
+    spscq_deinit (&this->pkt_free);
+deinit_pktq:
+    spscq_deinit (&this->pktq);
+
+    return ret;
+}
+
+/**
+ * stops and joins the stage threads, then frees what was in flight and the
+ * queues. the WAV cache stays open.
+ */
+static void
+stages_stop (struct pipeline_t *this)
+{
+    if (!this->running)
+        return;
+
+    atomic_store (&this->stop, true);
+
+    spscq_close (&this->pktq);
+    spscq_close (&this->pkt_free);
+    spscq_close (&this->blkq);
+    spscq_close (&this->blk_free);
+
+    pthread_join (this->demux_tid, NULL);
+    pthread_join (this->decode_tid, NULL);
+
+    for (AVPacket *pkt; (pkt = spscq_trypop (&this->pktq)) != NULL;)
+        pkt_free (pkt);
+
+    for (AVPacket *pkt; (pkt = spscq_trypop (&this->pkt_free)) != NULL;)
+        pkt_free (pkt);
+
+    for (struct pcm_blk_t *blk; (blk = spscq_trypop (&this->blkq)) != NULL;)
+        blk_free (blk);
+
+    for (struct pcm_blk_t *blk;
+         (blk = spscq_trypop (&this->blk_free)) != NULL;)
+        blk_free (blk);
+
+    blk_free (this->cur);
+    this->cur = NULL;
+
+    spscq_deinit (&this->pktq);
+    spscq_deinit (&this->pkt_free);
+    spscq_deinit (&this->blkq);
+    spscq_deinit (&this->blk_free);
+
+    this->running = false;
+}
+
+int
+pipeline_open (struct pipeline_t *this, const char *fn_in,
+               const char *fn_cache, uint64_t start)
+{
+    int ret;
+
+    memset (this, 0, sizeof *this);
+    atomic_init (&this->stop, false);
+    atomic_init (&this->errstat, NCAP_OK);
+
+    AVFormatContext *fctx;
+    AVCodecContext  *cctx;
+
+    if ((ret = libav_open (fn_in, &fctx, &cctx, &this->stream)) != NCAP_OK)
+        return ret;
+
+    this->fctx        = fctx;
+    this->cctx        = cctx;
+    this->key         = trackdb_key (fn_in);
+    this->fmt         = (int)cctx->sample_fmt % 5;
+    this->channels    = cctx->ch_layout.nb_channels;
+    this->layout      = cctx->ch_layout.order == AV_CHANNEL_ORDER_NATIVE
+                            ? cctx->ch_layout.u.mask
+                            : 0;
+    this->sample_rate = cctx->sample_rate;
+    this->width       = LIBAV (av_get_bytes_per_sample) (cctx->sample_fmt);
+    this->blk         = this->channels * this->width;
+
+    uint8_t  trim;
+    uint16_t keep_ms;
+    config_get_force (trim, trim_silence);
+    config_get_force (keep_ms, silence_keep_ms);
+
+    this->trim = trim;
+    this->keep = (uint64_t)keep_ms * this->sample_rate / 1000;
+    silence_init (&this->sil, SILENCE_THRESH_DEF);
+
+    if (this->blk == 0) {
+        logef ("ERROR: unsupported sample format %d", cctx->sample_fmt);
+        ret = NCAP_EGEN;
+        goto deinit_libav;
+    }
+
+    this->start  = start;
+    this->head   = start;
+    this->top    = start == 0;
+    this->base   = UINT64_MAX;
+    this->length = length_find (this);
+
+    struct cwav_trim_t trimrec;
+
+    if (this->trim
+        && trackdb_get (this->key, CWAV_TRIM_TAG, CWAV_TRIM_VER, &trimrec,
+                        sizeof trimrec)
+               == sizeof trimrec
+        && trimrec.keep == this->keep
+        && trimrec.head + trimrec.tail < trimrec.frames) {
+        this->cut_from = trimrec.head;
+        this->cut_to   = trimrec.frames - trimrec.tail;
+        this->length   = this->cut_to;
+
+        if (this->head < this->cut_from)
+            this->head = this->cut_from;
+
+        logif ("cutting to frames %" PRIu64 " to %" PRIu64 " as trimmed "
+               "before",
+               this->cut_from, this->cut_to);
+    }
+
+    if (start > 0) {
+        seek_start (this);
+
+        // mid-track, so there is no leading silence to look for
+        this->sil.pos        = start;
+        this->sil.first_loud = start;
+        this->sil.end_loud   = start;
+    }
+
+    if (fn_cache != NULL) {
+        logdf ("opening file `%s' for wb...", fn_cache);
+
+        if ((this->cache_fp = fopen (fn_cache, "wb")) == NULL) {
+            logef ("ERROR: fopen `%s' failed for wb: errno %d: %s", fn_cache,
+                   errno, strerror (errno));
+            ret = NCAP_EIO;
+            goto deinit_libav;
+        }
+
+        // allocate space for WAV header
+        fseek (this->cache_fp, CWAV_HEADER_SIZ, SEEK_SET);
+
+        // a seek back reads it from here. it only makes that slower if not
+        if ((this->cache_rd = fopen (fn_cache, "rb")) == NULL)
+            logwf ("WARN: fopen `%s' failed for rb: errno %d: %s. seeking "
+                   "back decodes again",
+                   fn_cache, errno, strerror (errno));
+    }
+
+    if ((ret = stages_start (this)) != NCAP_OK)
+        goto deinit_cache;
+
+    logif ("pipeline started for `%s'", fn_in);
+
+    return NCAP_OK;
+
+deinit_cache:
+    if (this->cache_rd != NULL) {
+        fclose (this->cache_rd);
+        this->cache_rd = NULL;
+    }
+
+    if (this->cache_fp != NULL) {
+        fclose (this->cache_fp);
+        this->cache_fp = NULL;
+    }
+deinit_libav:
+    libav_close (&fctx, &cctx);
+    this->fctx = NULL;
+    this->cctx = NULL;
+
+    return ret;
+}
+
+size_t
+pipeline_read (struct pipeline_t *this, void *buf, size_t nframes)
+{
+    uint8_t *dst  = buf;
+    size_t   done = 0;
+
+    if (this->mem_pos < this->mem_frames) {
+        const size_t left = this->mem_frames - this->mem_pos;
+
+        done = left < nframes ? left : nframes;
+        memcpy (dst, this->mem + this->mem_pos * this->blk, done * this->blk);
+        this->mem_pos += done;
+        this->read += done;
+    }
+
+    if (this->replay > 0 && done < nframes) {
+        const size_t want = this->replay < nframes - done ? this->replay
+                                                          : nframes - done;
+        const size_t got
+            = fread (dst + done * this->blk, this->blk, want, this->cache_rd);
+
+        // a short read leaves a jump in the audio, not a stall
+        this->replay = got < want ? 0 : this->replay - got;
+        this->read += got;
+        done += got;
+    }
+
+    while (done < nframes) {
+        if (this->cur == NULL) {
+            if (!this->running
+                || (this->cur = spscq_pop (&this->blkq)) == NULL)
+                break;
+
+            this->cur_off = 0;
+        }
+
+        struct pcm_blk_t *blk = this->cur;
+
+        // played from `mem` already. a block left empty is handed back below
+        if (this->drop > 0) {
+            const size_t k = blk->nframes - this->cur_off < this->drop
+                                 ? blk->nframes - this->cur_off
+                                 : this->drop;
+
+            this->cur_off += k;
+            this->drop -= k;
+        }
+
+        const size_t left = blk->nframes - this->cur_off;
+        const size_t      n    = left < nframes - done ? left
+                                                       : nframes - done;
+
+        memcpy (dst + done * this->blk, blk->data + this->cur_off * this->blk,
+                n * this->blk);
+
+        done += n;
+        this->read += n;
+        this->cur_off += n;
+
+        if (this->cur_off == blk->nframes) {
+            blk_unref (blk);
+
+            // `blk_free` holds every block there is, so this cannot fail
+            spscq_trypush (&this->blk_free, blk);
+            this->cur = NULL;
+
+            atomic_fetch_add_explicit (&this->output_items, 1,
+                                       memory_order_relaxed);
+        }
+    }
+
+    return done;
+}
+
+uint64_t
+pipeline_pos (const struct pipeline_t *this, uint64_t back)
+{
+    // `head` is only known once something was read
+    if (this->base != UINT64_MAX)
+        return this->base + (this->read > back ? this->read - back : 0);
+
+    if (this->read == 0)
+        return this->start;
+
+    return this->head + (this->read > back ? this->read - back : 0);
+}
+
+/** hands `mem` back to the heads kept between tracks */
+static void
+mem_free (struct pipeline_t *this)
+{
+    if (this->mem != NULL && !pool_put (&head_pool, this->mem))
+        free (this->mem);
+
+    this->mem = NULL;
+}
+
+int
+pipeline_prime (struct pipeline_t *this, const void *pcm, size_t nframes)
+{
+    this->mem_frames = 0;
+    this->mem_pos    = 0;
+    this->drop       = 0;
+
+    if (nframes * this->blk > NCAP_HEAD_MAX_BYTES)
+        return NCAP_EALLOC;
+
+    if (this->mem == NULL && (this->mem = pool_get (&head_pool)) == NULL
+        && (this->mem = malloc (NCAP_HEAD_MAX_BYTES)) == NULL) {
+        loge ("ERROR: malloc failed for the head");
+        return NCAP_EALLOC;
+    }
+
+    memcpy (this->mem, pcm, nframes * this->blk);
+    this->mem_frames = nframes;
+    this->drop       = nframes;
+
+    return NCAP_OK;
+}
+
+int
+pipeline_seek (struct pipeline_t *this, uint64_t frame)
+{
+    stages_stop (this);
+
+    // the stages restart at `frame`, so there is nothing to drop
+    this->mem_frames = 0;
+    this->drop       = 0;
+
+    if (this->top && frame < this->head)
+        frame = this->head;
+
+    if (this->cut_to > 0) {
+        if (frame < this->cut_from)
+            frame = this->cut_from;
+        else if (frame > this->cut_to)
+            frame = this->cut_to;
+    }
+
+    // source frame after the last one cached
+    const uint64_t cached = this->head + this->emitted;
+
+    this->read   = 0;
+    this->replay = 0;
+    this->base   = frame;
+
+    if (this->cache_rd != NULL && frame >= this->head && frame < cached) {
+        fflush (this->cache_fp);
+
+        if (fseek (this->cache_rd,
+                   CWAV_HEADER_SIZ + (long)((frame - this->head) * this->blk),
+                   SEEK_SET)
+            == 0) {
+            this->replay = cached - frame;
+            frame        = cached;
+        }
+    }
+
+    if (this->replay == 0) {
+        // the cache would have a gap
+        cache_end (this);
+    } else if (this->ended) {
+        logif ("seeked to frame %" PRIu64 " in the cache, which has the rest",
+               this->base);
+        return NCAP_OK;
+    }
+
+    this->start      = frame;
+    this->skip       = 0;
+    this->skip_known = false;
+    this->ended      = false;
+
+    seek_start (this);
+    LIBAV (avcodec_flush_buffers) (this->cctx);
+
+    // mid-track, so there is no leading silence to look for
+    this->sil.pos        = frame;
+    this->sil.first_loud = frame;
+    this->sil.end_loud   = frame;
+
+    if (this->replay > 0)
+        logif ("seeked to frame %" PRIu64 " in the cache, decoding on from "
+               "%" PRIu64,
+               this->base, frame);
+
+    return stages_start (this);
+}
+
+void
+pipeline_close (struct pipeline_t *this)
+{
+    stages_stop (this);
+    cache_end (this);
+
+    mem_free (this);
+
+    AVFormatContext *fctx = this->fctx;
+    AVCodecContext  *cctx = this->cctx;
+    libav_close (&fctx, &cctx);
+    this->fctx = NULL;
+    this->cctx = NULL;
+}
+
+void
+pipeline_stats (struct pipeline_t *this, struct pipeline_stats_t *stats)
+{
+    // clang-format off
+    *stats = (struct pipeline_stats_t){
+        .demux = {
+            .items        = atomic_load (&this->demux_items),
+            .stall_out_ns = atomic_load (&this->pktq.push_stall_ns),
+        },
+        .decode = {
+            .items        = atomic_load (&this->decode_items),
+            .stall_in_ns  = atomic_load (&this->pktq.pop_stall_ns),
+            .stall_out_ns = atomic_load (&this->blkq.push_stall_ns),
+        },
+        .output = {
+            .items        = atomic_load (&this->output_items),
+            .stall_in_ns  = atomic_load (&this->blkq.pop_stall_ns),
+        },
+        .pktq_depth     = spscq_depth (&this->pktq),
+        .pktq_depth_max = this->pktq.depth_max,
+        .blkq_depth     = spscq_depth (&this->blkq),
+        .blkq_depth_max = this->blkq.depth_max,
+    };
+    // clang-format on
+}
+
+void
+pipeline_logstats (struct pipeline_t *this)
+{
+    struct pipeline_stats_t st;
+    pipeline_stats (this, &st);
+
+    // clang-format off
+    logif ("pipeline demux: %" PRIu64 " pkts, stalled %" PRIu64 " us out",
+           st.demux.items, st.demux.stall_out_ns / 1000);
+    logif ("pipeline decode: %" PRIu64 " blks, stalled %" PRIu64 " us in, "
+           "%" PRIu64 " us out",
+           st.decode.items, st.decode.stall_in_ns / 1000,
+           st.decode.stall_out_ns / 1000);
+    logif ("pipeline output: %" PRIu64 " blks, stalled %" PRIu64 " us in",
+           st.output.items, st.output.stall_in_ns / 1000);
+    logif ("pipeline pktq depth %zu (max %zu), blkq depth %zu (max %zu)",
+           st.pktq_depth, st.pktq_depth_max, st.blkq_depth,
+           st.blkq_depth_max);
+    // clang-format on
+}
+
+void
+pipeline_deinit (void)
+{
+    for (void *p; (p = pool_get (&blk_pool)) != NULL;)
+        blk_destroy (p);
+
+    for (AVPacket *pkt; (pkt = pool_get (&pkt_pool)) != NULL;)
+        LIBAV (av_packet_free) (&pkt);
+
+    for (void *p; (p = pool_get (&head_pool)) != NULL;)
+        free (p);
+}
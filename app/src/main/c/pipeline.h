@@ -0,0 +1,210 @@
+#pragma once
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "analyze.h"
+#include "silence.h"
+#include "spscq.h"
+
+/**
+ * demux -> decode -> output, one thread per stage.
+ *
+ * the demux thread reads `AVPacket`s into `pktq`. the decode thread turns
+ * them into blocks of interleaved PCM in `blkq`, trimming silence and
+ * writing the WAV cache on the way. the output stage is whoever calls
+ * `pipeline_read`, normally `audio_play`.
+ *
+ * packets and blocks are pooled and handed back through the `*_free` queues,
+ * so after warm up nothing is allocated and packed sample data is never
+ * copied before `pipeline_read`.
+ *
+ * `pipeline_seek` restarts the stages elsewhere in the track. what the WAV
+ * cache already holds is read back from it instead of decoded again.
+ */
+
+/** packets in flight between demux and decode */
+#define PIPELINE_PKTQ_CAP 64
+
+/** PCM blocks in flight between decode and output */
+#define PIPELINE_BLKQ_CAP 64
+
+/** most trailing silence held back before it is let through anyway */
+#define PIPELINE_HOLD_MS 10000
+
+struct pipeline_stage_stats_t {
+    uint64_t items;        // packets or blocks produced/consumed
+    uint64_t stall_in_ns;  // waited on an empty input queue
+    uint64_t stall_out_ns; // waited on a full output queue (backpressure)
+};
+
+struct pipeline_stats_t {
+    struct pipeline_stage_stats_t demux;
+    struct pipeline_stage_stats_t decode;
+    struct pipeline_stage_stats_t output;
+
+    size_t pktq_depth;
+    size_t pktq_depth_max;
+    size_t blkq_depth;
+    size_t blkq_depth_max;
+};
+
+struct pcm_blk_t;
+
+struct pipeline_t {
+    // stream format, valid after `pipeline_open`
+    int      fmt; // WAV format code, see `cwav_header_t.fmt.wFormatTag`
+    uint32_t channels;
+    uint64_t layout; // libav's `AV_CH_*` bits, 0 if not in native order
+    uint32_t sample_rate;
+    size_t   width; // bytes per sample
+    size_t   blk;   // bytes per frame
+
+    // libav state, owned by the demux/decode threads while they run
+    void *_Nullable fctx; // AVFormatContext
+    void *_Nullable cctx; // AVCodecContext
+    int             stream;
+    uint64_t        key;    // trackdb key of the source
+    uint64_t        start;  // source frame decoding starts at
+    bool            seeked; // the demuxer was seeked towards `start`
+    bool            top;    // opened at the top of the track
+    uint64_t        length; // source frames, 0 if the container does not say.
+                            // a known cut's end, see `cut_to`
+
+    struct spscq_t pktq;
+    struct spscq_t pkt_free;
+    struct spscq_t blkq;
+    struct spscq_t blk_free;
+    size_t         nblks; // blocks allocated, decode thread only
+
+    pthread_t   demux_tid;
+    pthread_t   decode_tid;
+    bool        running; // the queues are set up and the threads started
+    bool        ended;   // the decode stage got to the end of the track
+    atomic_bool stop;
+    atomic_int  errstat; // first stage error, NCAP_*
+
+    // frames before `start` still to drop, decode thread only
+    uint64_t skip;
+    bool     skip_known;
+
+    // silence trimming, decode thread only
+    bool             trim;
+    uint64_t         keep;
+    uint64_t         head; // source frame of the first frame output
+    struct silence_t sil;
+    uint64_t         cut_from; // a track trimmed before is cut to these
+    uint64_t         cut_to;   // source frames, from its record. 0 if not
+
+    // per-track analysis, decode thread only
+    struct analyze_t an;
+
+    // WAV cache, decode thread only
+    FILE *_Nullable cache_fp;
+    uint64_t        emitted; // frames pushed to `blkq`
+
+    // output side
+    struct pcm_blk_t *_Nullable cur;
+    size_t                      cur_off;
+    uint64_t                    read;     // frames `pipeline_read` returned
+    uint64_t                    base;     // source frame of the first, or
+                                          // `UINT64_MAX` for `head`
+    FILE *_Nullable             cache_rd; // the cache, read after a seek
+    uint64_t                    replay;   // frames to read from it first
+    uint8_t *_Nullable          mem;      // the head, see `pipeline_prime`
+    size_t                      mem_frames;
+    size_t                      mem_pos;
+    uint64_t                    drop; // frames of the stages' `mem` stood in
+                                      // for, still to drop
+
+    _Atomic uint64_t demux_items;
+    _Atomic uint64_t decode_items;
+    _Atomic uint64_t output_items;
+};
+
+/**
+ * opens `fn_in` and starts the demux and decode threads. decoded PCM is also
+ * written as a WAV file to `fn_cache` unless it is NULL.
+ *
+ * output begins at source frame `start`, counted before silence trimming,
+ * which the demuxer seeks to through the container's index; the decoder
+ * then drops frames up to the exact one by their timestamps. without an
+ * index it decodes from the top and drops everything before `start`.
+ * silence is not trimmed off the head of a track started mid-way, and
+ * neither is it analyzed. a track with a `CWAV_TRIM_TAG` record for the
+ * same kept pad is cut where that says instead of being scanned, from any
+ * `start`.
+ *
+ * @return `NCAP_OK` or an `NCAP_E*` code; nothing needs closing on error
+ */
+extern int pipeline_open (struct pipeline_t *_Nonnull this,
+                          const char *_Nonnull fn_in,
+                          const char *_Nullable fn_cache, uint64_t start);
+
+/**
+ * output stage. copies up to `nframes` interleaved frames into `buf`,
+ * waiting for the decode stage as needed.
+ *
+ * @return frames copied; less than `nframes` only at the end of the track
+ */
+extern size_t pipeline_read (struct pipeline_t *_Nonnull this,
+                             void *_Nonnull buf, size_t nframes);
+
+/**
+ * output side, before the first `pipeline_read` of a track opened at the
+ * top. `nframes` frames of `pcm`, which must be the first the stages will
+ * output, are read first and as many of theirs dropped, so playback starts
+ * without waiting on the first decode. `pcm` is copied, into a buffer kept
+ * between tracks.
+ *
+ * @return `NCAP_OK` or `NCAP_EALLOC`, also for more than
+ * `NCAP_HEAD_MAX_BYTES`, after which nothing is primed
+ */
+extern int pipeline_prime (struct pipeline_t *_Nonnull this,
+                           const void *_Nonnull pcm, size_t nframes);
+
+/**
+ * output side. stops the stages and restarts them at source frame `frame`,
+ * dropping everything in flight. `frame` is clamped to the trimmed head of
+ * a track opened at the top, and to the known cut of one trimmed before.
+ *
+ * frames the WAV cache holds are read straight back from it, after one
+ * seek on the file, and the decode stage goes on from where it got to.
+ * anywhere else the demuxer seeks through the container's index as
+ * `pipeline_open` does, and the cache is ended there as it would have a
+ * gap.
+ *
+ * @return `NCAP_OK` or an `NCAP_E*` code, after which `pipeline_read`
+ * returns nothing more
+ */
+extern int pipeline_seek (struct pipeline_t *_Nonnull this, uint64_t frame);
+
+/**
+ * output side. @return the source frame, counted before silence trimming,
+ * of the frame `back` frames before the next one `pipeline_read` returns
+ */
+extern uint64_t pipeline_pos (const struct pipeline_t *_Nonnull this,
+                              uint64_t back);
+
+/**
+ * stops and joins the stage threads and frees everything, but for the
+ * blocks, packets and head kept for the next track
+ */
+extern void pipeline_close (struct pipeline_t *_Nonnull this);
+
+/** frees what the closed pipelines kept. none may be open */
+extern void pipeline_deinit (void);
+
+extern void pipeline_stats (struct pipeline_t *_Nonnull this,
+                            struct pipeline_stats_t *_Nonnull stats);
+
+extern void pipeline_logstats (struct pipeline_t *_Nonnull this);
+
+#endif // !PIPELINE_H
@@ -0,0 +1,157 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "playctl.h"
+
+#ifdef __linux__
+
+/** `ts` is relative, NULL for no timeout */
+static inline void
+futex_wait (_Atomic uint32_t *addr, uint32_t val, const struct timespec *ts)
+{
+    syscall (SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, ts, NULL, 0);
+}
+
+static inline void
+futex_wake (_Atomic uint32_t *addr)
+{
+    syscall (SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+#else // !__linux__
+
+/** no futex: poll, which only costs anything while paused */
+static inline void
+futex_wait (_Atomic uint32_t *addr, uint32_t val, const struct timespec *ts)
+{
+    static const struct timespec poll = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    (void)addr;
+    (void)val;
+    nanosleep (ts != NULL && ts->tv_sec == 0 && ts->tv_nsec < poll.tv_nsec
+                   ? ts
+                   : &poll,
+               NULL);
+}
+
+static inline void
+futex_wake (_Atomic uint32_t *addr)
+{
+    (void)addr;
+}
+
+#endif // __linux__
+
+void
+playctl_init (struct playctl_t *this, uint32_t word)
+{
+    atomic_init (&this->word, word & ~PLAYCTL_WAITERS);
+}
+
+uint32_t
+playctl_get (struct playctl_t *this)
+{
+    return atomic_load_explicit (&this->word, memory_order_acquire)
+           & ~PLAYCTL_WAITERS;
+}
+
+uint32_t
+playctl_set (struct playctl_t *this, uint32_t bits)
+{
+    const uint32_t prev
+        = atomic_fetch_or_explicit (&this->word, bits, memory_order_acq_rel);
+
+    // the syscall only when someone sleeps
+    if (prev & PLAYCTL_WAITERS)
+        futex_wake (&this->word);
+
+    return prev & ~PLAYCTL_WAITERS;
+}
+
+uint32_t
+playctl_clear (struct playctl_t *this, uint32_t bits)
+{
+    const uint32_t prev = atomic_fetch_and_explicit (&this->word, ~bits,
+                                                     memory_order_acq_rel);
+
+    // `playctl_sleep` also wakes on cleared bits
+    if (prev & PLAYCTL_WAITERS && prev & bits)
+        futex_wake (&this->word);
+
+    return prev & ~PLAYCTL_WAITERS;
+}
+
+bool
+playctl_take (struct playctl_t *this, uint32_t bit)
+{
+    return playctl_clear (this, bit) & bit;
+}
+
+uint32_t
+playctl_wait (struct playctl_t *this, uint32_t bits)
+{
+    uint32_t w = atomic_load_explicit (&this->word, memory_order_acquire);
+
+    while (!(w & bits)) {
+        // announce the sleep; a set racing with this fails the exchange
+        if (!(w & PLAYCTL_WAITERS)
+            && !atomic_compare_exchange_weak_explicit (
+                &this->word, &w, w | PLAYCTL_WAITERS, memory_order_acq_rel,
+                memory_order_acquire))
+            continue;
+
+        // returns at once if the word changed since
+        futex_wait (&this->word, w | PLAYCTL_WAITERS, NULL);
+        w = atomic_load_explicit (&this->word, memory_order_acquire);
+    }
+
+    atomic_fetch_and_explicit (&this->word, ~PLAYCTL_WAITERS,
+                               memory_order_relaxed);
+
+    return w & ~PLAYCTL_WAITERS;
+}
+
+uint32_t
+playctl_sleep (struct playctl_t *this, uint32_t word, uint64_t ns)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    const uint64_t end = now.tv_sec * 1000000000ull + now.tv_nsec + ns;
+    uint32_t       w   = atomic_load_explicit (&this->word,
+                                               memory_order_acquire);
+
+    while ((w & ~PLAYCTL_WAITERS) == word) {
+        clock_gettime (CLOCK_MONOTONIC, &now);
+
+        const uint64_t t = now.tv_sec * 1000000000ull + now.tv_nsec;
+
+        if (t >= end)
+            break;
+
+        if (!(w & PLAYCTL_WAITERS)
+            && !atomic_compare_exchange_weak_explicit (
+                &this->word, &w, w | PLAYCTL_WAITERS, memory_order_acq_rel,
+                memory_order_acquire))
+            continue;
+
+        const struct timespec ts = { .tv_sec  = (end - t) / 1000000000,
+                                     .tv_nsec = (end - t) % 1000000000 };
+
+        futex_wait (&this->word, w | PLAYCTL_WAITERS, &ts);
+        w = atomic_load_explicit (&this->word, memory_order_acquire);
+    }
+
+    atomic_fetch_and_explicit (&this->word, ~PLAYCTL_WAITERS,
+                               memory_order_relaxed);
+
+    return w & ~PLAYCTL_WAITERS;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef PLAYCTL_H
+#define PLAYCTL_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * playback control state in one atomic word, so the output loop checks it
+ * with a single load per burst. a paused player sleeps on the word itself (a
+ * futex on Linux/Android) and is woken by the next `playctl_set`.
+ */
+
+#define PLAYCTL_PLAY  0x1u // playing, not paused
+#define PLAYCTL_INT   0x2u // skip to the next track
+#define PLAYCTL_CLOSE 0x4u // window closing, stop for good
+#define PLAYCTL_SEEK  0x8u // jump within the track, see `audio_seek`
+#define PLAYCTL_DISC  0x10u // the output device went away; reopen
+
+/** internal: someone sleeps in `playctl_wait` or `playctl_sleep` */
+#define PLAYCTL_WAITERS 0x80000000u
+
+/** padded to its own cache line, away from render-thread data */
+struct playctl_t {
+    alignas (64) _Atomic uint32_t word;
+    uint8_t pad[64 - sizeof (uint32_t)];
+};
+
+/** not thread safe */
+extern void playctl_init (struct playctl_t *_Nonnull this, uint32_t word);
+
+/** @return the control bits */
+extern uint32_t playctl_get (struct playctl_t *_Nonnull this);
+
+/** sets `bits` and wakes a waiter. @return the previous control bits */
+extern uint32_t playctl_set (struct playctl_t *_Nonnull this, uint32_t bits);
+
+/** @return the previous control bits */
+extern uint32_t playctl_clear (struct playctl_t *_Nonnull this,
+                               uint32_t bits);
+
+/** clears `bit`. @return whether it was set */
+extern bool playctl_take (struct playctl_t *_Nonnull this, uint32_t bit);
+
+/**
+ * sleeps until any of `bits` is set. one waiter at a time.
+ *
+ * @return the control bits
+ */
+extern uint32_t playctl_wait (struct playctl_t *_Nonnull this, uint32_t bits);
+
+/**
+ * sleeps for `ns` or until the control bits are no longer `word`, whichever
+ * comes first. one waiter at a time.
+ *
+ * @return the control bits
+ */
+extern uint32_t playctl_sleep (struct playctl_t *_Nonnull this, uint32_t word,
+                               uint64_t ns);
+
+#endif // !PLAYCTL_H
@@ -12,6 +12,10 @@
 
 #define NCAP_CONFIG_FILE "ncaprc"
 
+#define NCAP_TRACKDB_FILE "trackdb"
+
+#define NCAP_ART_ATLAS_FILE "art.atlas"
+
 #include "config.h"
 
 extern struct config_t ncap_config;
@@ -24,4 +28,100 @@ extern struct config_t ncap_config;
 /** for audio debugging: plays each track for max 5 seconds */
 #define DEBUG_TIMED 0
 
+/**
+ * pull audio with an AAudio data callback fed from a lock-free ring instead
+ * of blocking writes. falls back to the write loop if the stream won't open
+ */
+#define NCAP_AUDIO_CALLBACK 1
+
+/** audio buffered ahead of the data callback */
+#define NCAP_AUDIO_RING_MS 100
+
+/**
+ * with `aaudio_optimize` set to power saving, fill the whole device buffer
+ * per wakeup and sleep until it runs low, instead of writing every burst
+ */
+#define NCAP_AUDIO_DEEP 1
+
+/** deep-buffer mode refills when this much audio is left */
+#define NCAP_AUDIO_DEEP_LOW_MS 50
+
+/** pausing fades out over this long, and resuming fades back in */
+#define NCAP_AUDIO_FADE_MS 5
+
+/**
+ * the playback position is saved this often by the save thread, and at once
+ * on pause and at the ends of a track, so a restart after the app was
+ * killed resumes about where it stopped
+ */
+#define NCAP_AUDIO_POS_SAVE_MS 5000
+
+/** the position shown on the seek bar is updated this often */
+#define NCAP_AUDIO_POS_UI_MS 50
+
+/**
+ * target from a seek to its first audio going to the sink. a seek that takes
+ * longer is logged as a warning
+ */
+#define NCAP_AUDIO_SEEK_MS 50
+
+/**
+ * target from the output device going away, on an unplug or a Bluetooth
+ * connect, to audio on the new one. a reopen that takes longer is logged
+ * as a warning
+ */
+#define NCAP_AUDIO_RECOVER_MS 100
+
+/** a stream that will not reopen after that is tried this many times */
+#define NCAP_AUDIO_RECOVER_TRIES 3
+
+/**
+ * the stream's buffers are carved out of chunks of at least this, kept from
+ * one stream to the next
+ */
+#define NCAP_AUDIO_ARENA_BYTES (256 << 10)
+
+/**
+ * target from a tap on a track to its first audio going to the sink. a track
+ * that takes longer is logged as a warning
+ */
+#define NCAP_AUDIO_TAP_MS 150
+
+/** the head of a track kept decoded in memory, so a tap starts at once */
+#define NCAP_HEAD_MS 2000
+
+/** and at most this much of it, for wide or high-rate tracks */
+#define NCAP_HEAD_MAX_BYTES (1 << 20)
+
+/** heads kept at once, the least recently used making room */
+#define NCAP_HEAD_SLOTS 4
+
+/** tracks after the one playing, in play order, whose heads are kept */
+#define NCAP_HEAD_AHEAD 2
+
+/** a line of output latency and timing stats is logged this often */
+#define NCAP_AUDIO_TIMING_LOG_MS 10000
+
+/**
+ * place threads on cores and priorities by role, see `thrctl_roles`. off,
+ * they are only named
+ */
+#define NCAP_THRCTL 1
+
+/**
+ * run the float DSP kernels in fixed point instead. normally set by
+ * CMakeLists.txt, per ABI
+ */
+#ifndef NCAP_DSP_FIXED
+#define NCAP_DSP_FIXED 0
+#endif
+
+/** run the per-track analyzers on their own thread instead of decode's */
+#define NCAP_ANALYZE_THREADED 1
+
+/** dlopen libav on first decode. normally set by CMakeLists.txt */
+#ifndef NCAP_LAZY_LIBAV
+#define NCAP_LAZY_LIBAV 1
+#endif
+
 #endif // !PROPERTIES_H
@@ -6,9 +6,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "art.h"
+#include "atlas.h"
 #include "audio.h"
 #include "config.h"
+#include "headcache.h"
 #include "logging.h"
 #include "render.h"
 #include "strvec.h"
@@ -28,7 +32,7 @@ int             render_atrid    = -1;
 
 static const int FPS_ACTIVE = 30;
 static const int FPS_STATIC = 10;
-static const int FONTSIZ    = 60;
+static const int FONTSIZ    = RENDER_FONTSIZ;
 static int       fps        = FPS_STATIC;
 static int       cur_track;
 static size_t    ntracks;
@@ -36,6 +40,63 @@ static size_t    ntracks;
 static const struct timespec retry_ts
     = { .tv_sec = 0, .tv_nsec = 250000000 }; // 250 ms
 
+/**
+ * @return milliseconds since the process was started, or -1 on failure.
+ * resolution is one clock tick (usually 10 ms).
+ */
+static double
+proc_age_ms (void)
+{
+    char  buf[512];
+    FILE *fp = fopen ("/proc/self/stat", "r");
+
+    if (fp == NULL)
+        return -1;
+
+    const size_t len = fread (buf, 1, sizeof buf - 1, fp);
+    fclose (fp);
+    buf[len] = '\0';
+
+    // comm (field 2) may contain spaces, so count fields from its closing
+    // paren. starttime is field 22.
+    char *p = strrchr (buf, ')');
+
+    if (p == NULL)
+        return -1;
+
+    for (int field = 2; field < 22 && p != NULL; ++field)
+        p = strchr (p + 1, ' ');
+
+    if (p == NULL)
+        return -1;
+
+    const unsigned long long starttime = strtoull (p + 1, NULL, 10);
+
+    struct timespec now;
+    clock_gettime (CLOCK_BOOTTIME, &now);
+
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6
+           - starttime * 1e3 / sysconf (_SC_CLK_TCK);
+}
+
+/**
+ * logs process start to first frame once. compare across NCAP_LAZY_LIBAV,
+ * and see tests/bench_libav_dl.c
+ */
+static void
+log_cold_start (void)
+{
+    static bool logged = false;
+
+    if (logged)
+        return;
+
+    logged = true;
+    logif ("cold start: first frame %.0f ms after process start "
+           "(NCAP_LAZY_LIBAV=%d)",
+           proc_age_ms (), NCAP_LAZY_LIBAV);
+}
+
 void
 render_init (void)
 {
@@ -124,6 +185,8 @@ act_incvol (struct obj_t *this)
             return;
         }
 
+        config_vol_touch ();
+
         sprintf (linkpar->str, "%3hhu%%", vol);
     }
 }
@@ -155,6 +218,8 @@ act_decvol (struct obj_t *this)
             return;
         }
 
+        config_vol_touch ();
+
         sprintf (linkpar->str, "%3hhu%%", vol);
     }
 }
@@ -188,6 +253,8 @@ act_incsvol (struct obj_t *this)
             return;
         }
 
+        config_vol_touch ();
+
         sprintf (linkpar->str, "%3hhu%%", vol);
     }
 }
@@ -221,6 +288,8 @@ act_decsvol (struct obj_t *this)
             return;
         }
 
+        config_vol_touch ();
+
         sprintf (linkpar->str, "%3hhu%%", vol);
     }
 }
@@ -290,6 +359,11 @@ static struct rl_rect_arg_t rectbg;
 static struct obj_t        *playback_obj;
 static char                 svol_str[5] = "???%";
 
+/** the seek bar left of the close button, tappable over its full height */
+static Rectangle seekbar;
+static bool      seeking;   // the knob is being dragged
+static float     seek_frac; // to here
+
 static void
 init_objs (const int SCW, const int SCH)
 {
@@ -341,6 +415,13 @@ init_objs (const int SCW, const int SCH)
     rectarg->pos.y = y - 16;
     rectarg->color = RED;
 
+    // seek bar
+
+    seekbar.x      = 90;
+    seekbar.y      = rectarg->pos.y;
+    seekbar.width  = rectarg->pos.x - 90 - seekbar.x;
+    seekbar.height = rectarg->siz.y;
+
     // play/pause text
 
     static struct rl_text_arg_t objs4;
@@ -692,6 +773,7 @@ truncpos (char *buf, size_t siz, const int fontsiz, const int width)
 struct draw_tracks_params_t {
     const int     pad;
     const int     txtpad;
+    const int     artsiz; // album art square at the start of each row
     const int     fontsiz;
     const Vector2 rectpos;
     const Vector2 rectsiz;
@@ -703,6 +785,7 @@ init_draw_tracks_params (int pad, int fontsiz)
     const struct draw_tracks_params_t params = {
         .pad     = pad,
         .txtpad  = fontsiz >> 1,
+        .artsiz  = fontsiz + fontsiz,
         .fontsiz = fontsiz,
         .rectpos = { .x = rectbg.pos.x + pad, .y = rectbg.pos.y + pad },
         .rectsiz = { .x = rectbg.siz.x - (pad << 1), .y = fontsiz + fontsiz },
@@ -716,6 +799,38 @@ static struct {
     Rectangle rect;
 } track_rects[MAX_OBJS];
 
+/** album art atlas, uploaded once the art thread is done */
+static Texture2D art_tex;
+static bool      art_loaded = false;
+
+/**
+ * the atlas is already RGBA at row size, so this is a plain upload. after
+ * it, drawing art is one textured quad per row out of a single texture.
+ */
+static void
+load_art (void)
+{
+    const struct atlas_t *atlas = art_atlas ();
+
+    art_loaded = true;
+
+    if (atlas->ncells == 0 || atlas->pixels == NULL)
+        return;
+
+    const Image img = {
+        .data    = atlas->pixels,
+        .width   = atlas_width (atlas),
+        .height  = atlas_height (atlas),
+        .mipmaps = 1,
+        .format  = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+
+    art_tex = LoadTextureFromImage (img);
+    art_drop_pixels ();
+
+    logif ("uploaded %dx%d album art atlas", art_tex.width, art_tex.height);
+}
+
 static void
 draw_tracks (const char *_Nonnull const *_Nonnull tracks, size_t len,
              const struct draw_tracks_params_t *_Nonnull restrict par)
@@ -726,8 +841,20 @@ draw_tracks (const char *_Nonnull const *_Nonnull tracks, size_t len,
     for (size_t i = 0; i < len; ++i) {
         DrawRectangleV (rectpos, par->rectsiz,
                         i == cur_track ? YELLOW : BLACK);
-        DrawText (tracks[i], rectpos.x + par->txtpad, rectpos.y + par->txtpad,
-                  par->fontsiz, i == cur_track ? BLACK : WHITE);
+
+        const uint32_t cell = art_tex.id ? art_cell (i) : ATLAS_NONE;
+
+        if (cell != ATLAS_NONE) {
+            uint32_t x, y;
+            atlas_pos (art_atlas (), cell, &x, &y);
+
+            const Rectangle src = { x, y, par->artsiz, par->artsiz };
+            DrawTextureRec (art_tex, src, rectpos, WHITE);
+        }
+
+        DrawText (tracks[i], rectpos.x + par->artsiz + par->txtpad,
+                  rectpos.y + par->txtpad, par->fontsiz,
+                  i == cur_track ? BLACK : WHITE);
 
         track_rects[i].rect.x      = rectpos.x;
         track_rects[i].rect.y      = rectpos.y;
@@ -739,6 +866,46 @@ draw_tracks (const char *_Nonnull const *_Nonnull tracks, size_t len,
     }
 }
 
+/** the playing position, or where the knob is dragged to */
+static void
+draw_seekbar (void)
+{
+    uint64_t pos, len;
+    audio_position (&pos, &len);
+
+    if (len == 0)
+        return;
+
+    const float   frac = seeking    ? seek_frac
+                         : pos < len ? (float)pos / len
+                                     : 1;
+    const Vector2 bar  = { seekbar.x, seekbar.y + seekbar.height / 2 - 4 };
+
+    DrawRectangleV (bar, (Vector2){ seekbar.width, 8 }, DARKGRAY);
+    DrawRectangleV (bar, (Vector2){ seekbar.width * frac, 8 }, YELLOW);
+    DrawCircleV ((Vector2){ bar.x + seekbar.width * frac, bar.y + 4 },
+                 seeking ? 24 : 16, YELLOW);
+}
+
+/** follows a drag on the seek bar, which starts with `down` on it */
+static void
+drag_seekbar (Vector2 tpos, bool down)
+{
+    uint64_t pos, len;
+    audio_position (&pos, &len);
+
+    const float a = tpos.x - seekbar.x;
+    const float b = tpos.y - seekbar.y;
+
+    // and then goes anywhere
+    if (down && len > 0 && a >= 0 && b >= 0 && a <= seekbar.width
+        && b <= seekbar.height)
+        seeking = true;
+
+    if (seeking)
+        seek_frac = a < 0 ? 0 : a > seekbar.width ? 1 : a / seekbar.width;
+}
+
 static void
 upd_svol (int i)
 {
@@ -803,7 +970,8 @@ render (const strvec_t *sv)
     for (size_t i = 0; i < ntracks; ++i) {
         const size_t pos = truncpos (
             sv->ptr[i], strlen (sv->ptr[i]) + 1, draw_tracks_par.fontsiz,
-            draw_tracks_par.rectsiz.x - (draw_tracks_par.txtpad << 1));
+            draw_tracks_par.rectsiz.x - draw_tracks_par.artsiz
+                - (draw_tracks_par.txtpad << 1));
 
         tracks_trunc[i] = malloc (pos + 1);
         memcpy (tracks_trunc[i], sv->ptr[i], pos);
@@ -819,6 +987,9 @@ render (const strvec_t *sv)
          ptouched = touched, ptpos = tpos, pcur_trid = cur_trid) {
         touched = GetTouchPointCount ();
 
+        if (!art_loaded && art_ready ())
+            load_art ();
+
         config_get (cur_trid, cur_track, pth_ret);
 
         if (pth_ret != 0) {
@@ -851,8 +1022,10 @@ render (const strvec_t *sv)
                     draw (&objs[i]);
 
                 draw_tracks (tracks_trunc, ntracks, &draw_tracks_par);
+                draw_seekbar ();
             }
             EndDrawing ();
+            log_cold_start ();
             continue;
         }
 
@@ -864,6 +1037,26 @@ render (const strvec_t *sv)
         // check touch on touch release
         if (touched) {
             tpos = GetTouchPosition (0);
+            drag_seekbar (tpos, !ptouched);
+
+            // a tap on a track is likely: start on its head while the
+            // finger is still down
+            for (size_t i = 0; !ptouched && i < ntracks; ++i) {
+                float a = tpos.x - track_rects[i].rect.x;
+                float b = tpos.y - track_rects[i].rect.y;
+                if (a >= 0 && b >= 0 && a <= track_rects[i].rect.width
+                    && b <= track_rects[i].rect.height)
+                    headcache_want (track_rects[i].id, true);
+            }
+        } else if (seeking) {
+            // let go of the knob: seek there. it was no tap
+            uint64_t pos, len;
+            audio_position (&pos, &len);
+            audio_seek ((uint64_t)(seek_frac * len));
+
+            seeking = false;
+            tpos.x  = -1;
+            tpos.y  = -1;
         } else {
             tpos.x = -1;
             tpos.y = -1;
@@ -936,10 +1129,15 @@ render (const strvec_t *sv)
                 draw (&objs[i]);
 
             draw_tracks (tracks_trunc, sv->siz, &draw_tracks_par);
+            draw_seekbar ();
         }
         EndDrawing ();
+        log_cold_start ();
     }
 
+    if (art_tex.id)
+        UnloadTexture (art_tex);
+
     logi ("Closing raylib window...");
     CloseWindow ();
 
@@ -961,6 +1159,9 @@ render_close (void)
 
     pthread_mutex_unlock (&render_wclose_mx);
 
+    // the output loop watches audio_ctl, not wclose
+    audio_close ();
+
     // reset play/pause text
 
     memcpy (((struct rl_text_arg_t *)playback_obj->link->params)->str, " play",
@@ -14,6 +14,11 @@
 // NOTE: nullability unspecified by raylib
 extern struct android_app *GetAndroidApp (void);
 
+#define RENDER_FONTSIZ 60
+
+/** height of a track row, also the album art thumbnail size */
+#define RENDER_ROW_SIZ (RENDER_FONTSIZ << 1)
+
 #define MAX_OBJS    32
 #define OBJ_BUF_SIZ 1024
 
@@ -0,0 +1,147 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring.h"
+
+int
+ring_init (struct ring_t *this, size_t cap)
+{
+    size_t pow2 = 1;
+
+    while (pow2 < cap)
+        pow2 <<= 1;
+
+    if ((this->buf = malloc (pow2)) == NULL)
+        return RING_EMEM;
+
+    this->mask = pow2 - 1;
+    ring_reset (this);
+
+    return RING_OK;
+}
+
+void
+ring_deinit (struct ring_t *this)
+{
+    free (this->buf);
+    this->buf = NULL;
+}
+
+void
+ring_reset (struct ring_t *this)
+{
+    this->tail_cache = 0;
+    this->head_cache = 0;
+    atomic_init (&this->head, 0);
+    atomic_init (&this->tail, 0);
+}
+
+/** copies `n` bytes at ring offset `off`, in at most two pieces */
+static inline void
+copy_in (struct ring_t *this, size_t off, const uint8_t *src, size_t n)
+{
+    const size_t i     = off & this->mask;
+    const size_t first = n < this->mask + 1 - i ? n : this->mask + 1 - i;
+
+    memcpy (this->buf + i, src, first);
+    memcpy (this->buf, src + first, n - first);
+}
+
+static inline void
+copy_out (const struct ring_t *this, size_t off, uint8_t *dst, size_t n)
+{
+    const size_t i     = off & this->mask;
+    const size_t first = n < this->mask + 1 - i ? n : this->mask + 1 - i;
+
+    memcpy (dst, this->buf + i, first);
+    memcpy (dst + first, this->buf, n - first);
+}
+
+size_t
+ring_write (struct ring_t *this, const void *src, size_t n)
+{
+    const size_t tail
+        = atomic_load_explicit (&this->tail, memory_order_relaxed);
+    size_t room = this->mask + 1 - (tail - this->head_cache);
+
+    if (room < n) {
+        this->head_cache
+            = atomic_load_explicit (&this->head, memory_order_acquire);
+        room = this->mask + 1 - (tail - this->head_cache);
+    }
+
+    if (n > room)
+        n = room;
+
+    if (n == 0)
+        return 0;
+
+    copy_in (this, tail, src, n);
+    atomic_store_explicit (&this->tail, tail + n, memory_order_release);
+
+    return n;
+}
+
+size_t
+ring_read (struct ring_t *this, void *dst, size_t n)
+{
+    const size_t head
+        = atomic_load_explicit (&this->head, memory_order_relaxed);
+    size_t avail = this->tail_cache - head;
+
+    if (avail < n) {
+        this->tail_cache
+            = atomic_load_explicit (&this->tail, memory_order_acquire);
+        avail = this->tail_cache - head;
+    }
+
+    if (n > avail)
+        n = avail;
+
+    if (n == 0)
+        return 0;
+
+    copy_out (this, head, dst, n);
+    atomic_store_explicit (&this->head, head + n, memory_order_release);
+
+    return n;
+}
+
+size_t
+ring_pos (struct ring_t *this)
+{
+    return atomic_load_explicit (&this->tail, memory_order_relaxed);
+}
+
+void
+ring_drop_to (struct ring_t *this, size_t pos)
+{
+    const size_t head
+        = atomic_load_explicit (&this->head, memory_order_relaxed);
+
+    // positions only grow, so a stale `pos` is behind `head`
+    if ((ptrdiff_t)(pos - head) <= 0)
+        return;
+
+    // `pos` was written, so the cached tail may just be caught up to it
+    if ((ptrdiff_t)(pos - this->tail_cache) > 0)
+        this->tail_cache = pos;
+
+    atomic_store_explicit (&this->head, pos, memory_order_release);
+}
+
+size_t
+ring_used (struct ring_t *this)
+{
+    return atomic_load_explicit (&this->tail, memory_order_acquire)
+           - atomic_load_explicit (&this->head, memory_order_acquire);
+}
+
+size_t
+ring_cap (const struct ring_t *this)
+{
+    return this->mask + 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_OK   0
+#define RING_EMEM -2
+
+/**
+ * bounded wait-free single-producer/single-consumer byte ring. both sides
+ * only ever do a bounded copy and one release store, so the consumer can be
+ * a real-time audio callback: no locks, no allocation, no syscalls.
+ */
+struct ring_t {
+    // written by the consumer
+    alignas (64) _Atomic size_t head;
+    size_t tail_cache;
+
+    // written by the producer
+    alignas (64) _Atomic size_t tail;
+    size_t head_cache;
+
+    alignas (64) size_t mask;
+    uint8_t *_Nullable buf;
+};
+
+/** `cap` bytes, rounded up to a power of two. not thread safe */
+extern int ring_init (struct ring_t *_Nonnull this, size_t cap);
+
+/** not thread safe */
+extern void ring_deinit (struct ring_t *_Nonnull this);
+
+/** not thread safe. drops everything buffered */
+extern void ring_reset (struct ring_t *_Nonnull this);
+
+/** producer only. @return bytes copied in, up to `n` */
+extern size_t ring_write (struct ring_t *_Nonnull this,
+                          const void *_Nonnull src, size_t n);
+
+/** consumer only. @return bytes copied out, up to `n` */
+extern size_t ring_read (struct ring_t *_Nonnull this, void *_Nonnull dst,
+                         size_t n);
+
+/** producer only. @return the write position, for `ring_drop_to` */
+extern size_t ring_pos (struct ring_t *_Nonnull this);
+
+/**
+ * consumer only. drops everything the producer wrote before it was at
+ * `pos`; nothing if that has been read already
+ */
+extern void ring_drop_to (struct ring_t *_Nonnull this, size_t pos);
+
+/** either side, approximate */
+extern size_t ring_used (struct ring_t *_Nonnull this);
+
+extern size_t ring_cap (const struct ring_t *_Nonnull this);
+
+#endif // !RING_H
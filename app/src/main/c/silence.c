@@ -0,0 +1,303 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "silence.h"
+
+#define LOUD(x, thr) ((x) > (thr) || (x) < -(thr))
+
+/** scalar search of `buf[lo, hi)` for the first loud sample, `hi` if none */
+#define SCAN_FIRST(buf, lo, hi, thr)                                          \
+    do {                                                                      \
+        for (size_t j_ = (lo); j_ < (hi); ++j_)                               \
+            if (LOUD ((buf)[j_], thr))                                        \
+                return j_;                                                    \
+    } while (0)
+
+/** scalar search of `buf[lo, hi)` for the last loud sample, returns idx + 1 */
+#define SCAN_LAST(buf, lo, hi, thr)                                           \
+    do {                                                                      \
+        for (size_t j_ = (hi); j_ > (lo); --j_)                               \
+            if (LOUD ((buf)[j_ - 1], thr))                                    \
+                return j_;                                                    \
+    } while (0)
+
+#if defined(__ARM_NEON)
+
+static inline bool
+any_u16 (uint16x8_t m)
+{
+#if defined(__aarch64__)
+    return vmaxvq_u16 (m) != 0;
+#else
+    const uint16x4_t h = vorr_u16 (vget_low_u16 (m), vget_high_u16 (m));
+    return vget_lane_u64 (vreinterpret_u64_u16 (h), 0) != 0;
+#endif
+}
+
+static inline bool
+any_u32 (uint32x4_t m)
+{
+#if defined(__aarch64__)
+    return vmaxvq_u32 (m) != 0;
+#else
+    const uint32x2_t h = vorr_u32 (vget_low_u32 (m), vget_high_u32 (m));
+    return vget_lane_u64 (vreinterpret_u64_u32 (h), 0) != 0;
+#endif
+}
+
+#define LOUD_S16(v, hi, lo)                                                   \
+    any_u16 (vorrq_u16 (vcgtq_s16 (v, hi), vcltq_s16 (v, lo)))
+#define LOUD_S32(v, hi, lo)                                                   \
+    any_u32 (vorrq_u32 (vcgtq_s32 (v, hi), vcltq_s32 (v, lo)))
+#define LOUD_FLT(v, hi) any_u32 (vcagtq_f32 (v, hi))
+
+#endif // __ARM_NEON
+
+size_t
+silence_first_s16 (const int16_t *buf, size_t n, int16_t thr)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const int16x8_t hi = vdupq_n_s16 (thr);
+    const int16x8_t lo = vdupq_n_s16 (-thr);
+
+    for (; i + 8 <= n; i += 8)
+        if (LOUD_S16 (vld1q_s16 (buf + i), hi, lo))
+            SCAN_FIRST (buf, i, i + 8, thr);
+#elif defined(__SSE2__)
+    const __m128i hi = _mm_set1_epi16 (thr);
+    const __m128i lo = _mm_set1_epi16 (-thr);
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(buf + i));
+        const int     m = _mm_movemask_epi8 (
+            _mm_or_si128 (_mm_cmpgt_epi16 (v, hi), _mm_cmplt_epi16 (v, lo)));
+
+        if (m)
+            return i + (__builtin_ctz (m) >> 1);
+    }
+#endif
+
+    SCAN_FIRST (buf, i, n, thr);
+    return n;
+}
+
+size_t
+silence_last_s16 (const int16_t *buf, size_t n, int16_t thr)
+{
+    size_t i = n & ~(size_t)7;
+
+    SCAN_LAST (buf, i, n, thr);
+
+#if defined(__ARM_NEON)
+    const int16x8_t hi = vdupq_n_s16 (thr);
+    const int16x8_t lo = vdupq_n_s16 (-thr);
+
+    for (; i; i -= 8)
+        if (LOUD_S16 (vld1q_s16 (buf + i - 8), hi, lo))
+            SCAN_LAST (buf, i - 8, i, thr);
+#elif defined(__SSE2__)
+    const __m128i hi = _mm_set1_epi16 (thr);
+    const __m128i lo = _mm_set1_epi16 (-thr);
+
+    for (; i; i -= 8) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(buf + i - 8));
+        const int     m = _mm_movemask_epi8 (
+            _mm_or_si128 (_mm_cmpgt_epi16 (v, hi), _mm_cmplt_epi16 (v, lo)));
+
+        if (m)
+            return i - 8 + ((31 - __builtin_clz (m)) >> 1) + 1;
+    }
+#else
+    SCAN_LAST (buf, 0, i, thr);
+#endif
+
+    return 0;
+}
+
+size_t
+silence_first_s32 (const int32_t *buf, size_t n, int32_t thr)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const int32x4_t hi = vdupq_n_s32 (thr);
+    const int32x4_t lo = vdupq_n_s32 (-thr);
+
+    for (; i + 4 <= n; i += 4)
+        if (LOUD_S32 (vld1q_s32 (buf + i), hi, lo))
+            SCAN_FIRST (buf, i, i + 4, thr);
+#elif defined(__SSE2__)
+    const __m128i hi = _mm_set1_epi32 (thr);
+    const __m128i lo = _mm_set1_epi32 (-thr);
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(buf + i));
+        const int     m = _mm_movemask_epi8 (
+            _mm_or_si128 (_mm_cmpgt_epi32 (v, hi), _mm_cmplt_epi32 (v, lo)));
+
+        if (m)
+            return i + (__builtin_ctz (m) >> 2);
+    }
+#endif
+
+    SCAN_FIRST (buf, i, n, thr);
+    return n;
+}
+
+size_t
+silence_last_s32 (const int32_t *buf, size_t n, int32_t thr)
+{
+    size_t i = n & ~(size_t)3;
+
+    SCAN_LAST (buf, i, n, thr);
+
+#if defined(__ARM_NEON)
+    const int32x4_t hi = vdupq_n_s32 (thr);
+    const int32x4_t lo = vdupq_n_s32 (-thr);
+
+    for (; i; i -= 4)
+        if (LOUD_S32 (vld1q_s32 (buf + i - 4), hi, lo))
+            SCAN_LAST (buf, i - 4, i, thr);
+#elif defined(__SSE2__)
+    const __m128i hi = _mm_set1_epi32 (thr);
+    const __m128i lo = _mm_set1_epi32 (-thr);
+
+    for (; i; i -= 4) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(buf + i - 4));
+        const int     m = _mm_movemask_epi8 (
+            _mm_or_si128 (_mm_cmpgt_epi32 (v, hi), _mm_cmplt_epi32 (v, lo)));
+
+        if (m)
+            return i - 4 + ((31 - __builtin_clz (m)) >> 2) + 1;
+    }
+#else
+    SCAN_LAST (buf, 0, i, thr);
+#endif
+
+    return 0;
+}
+
+size_t
+silence_first_flt (const float *buf, size_t n, float thr)
+{
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    const float32x4_t hi = vdupq_n_f32 (thr);
+
+    for (; i + 4 <= n; i += 4)
+        if (LOUD_FLT (vld1q_f32 (buf + i), hi))
+            SCAN_FIRST (buf, i, i + 4, thr);
+#elif defined(__SSE2__)
+    const __m128 hi   = _mm_set1_ps (thr);
+    const __m128 sign = _mm_set1_ps (-0.0f);
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_andnot_ps (sign, _mm_loadu_ps (buf + i));
+        const int    m = _mm_movemask_ps (_mm_cmpgt_ps (v, hi));
+
+        if (m)
+            return i + __builtin_ctz (m);
+    }
+#endif
+
+    SCAN_FIRST (buf, i, n, thr);
+    return n;
+}
+
+size_t
+silence_last_flt (const float *buf, size_t n, float thr)
+{
+    size_t i = n & ~(size_t)3;
+
+    SCAN_LAST (buf, i, n, thr);
+
+#if defined(__ARM_NEON)
+    const float32x4_t hi = vdupq_n_f32 (thr);
+
+    for (; i; i -= 4)
+        if (LOUD_FLT (vld1q_f32 (buf + i - 4), hi))
+            SCAN_LAST (buf, i - 4, i, thr);
+#elif defined(__SSE2__)
+    const __m128 hi   = _mm_set1_ps (thr);
+    const __m128 sign = _mm_set1_ps (-0.0f);
+
+    for (; i; i -= 4) {
+        const __m128 v = _mm_andnot_ps (sign, _mm_loadu_ps (buf + i - 4));
+        const int    m = _mm_movemask_ps (_mm_cmpgt_ps (v, hi));
+
+        if (m)
+            return i - 4 + (31 - __builtin_clz (m)) + 1;
+    }
+#else
+    SCAN_LAST (buf, 0, i, thr);
+#endif
+
+    return 0;
+}
+
+#undef SCAN_FIRST
+#undef SCAN_LAST
+#undef LOUD
+
+void
+silence_init (struct silence_t *this, float thresh)
+{
+    this->thresh     = thresh;
+    this->thresh_s16 = thresh * INT16_MAX;
+    this->thresh_s32 = (double)thresh * INT32_MAX;
+    this->pos        = 0;
+    this->first_loud = SILENCE_NONE;
+    this->end_loud   = 0;
+}
+
+size_t
+silence_scan (struct silence_t *this, const void *buf, int fmt,
+              size_t nframes, uint32_t channels)
+{
+    const size_t n = nframes * channels;
+    size_t       first, last;
+
+    switch (fmt) {
+        case 1: // S16
+            first = silence_first_s16 (buf, n, this->thresh_s16);
+            last  = first == n ? 0
+                               : silence_last_s16 (buf, n, this->thresh_s16);
+            break;
+        case 2: // S32
+            first = silence_first_s32 (buf, n, this->thresh_s32);
+            last  = first == n ? 0
+                               : silence_last_s32 (buf, n, this->thresh_s32);
+            break;
+        case 3: // FLT
+            first = silence_first_flt (buf, n, this->thresh);
+            last  = first == n ? 0 : silence_last_flt (buf, n, this->thresh);
+            break;
+        default:
+            first = 0;
+            last  = n;
+    }
+
+    // sample to frame indices
+    first /= channels;
+    last = (last + channels - 1) / channels;
+
+    if (first < nframes) {
+        if (this->first_loud == SILENCE_NONE)
+            this->first_loud = this->pos + first;
+
+        this->end_loud = this->pos + last;
+    }
+
+    this->pos += nframes;
+    return first;
+}
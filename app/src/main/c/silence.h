@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef SILENCE_H
+#define SILENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** marks "no loud frame seen yet" in `struct silence_t` */
+#define SILENCE_NONE UINT64_MAX
+
+/** linear amplitude, about -72 dBFS (8 LSB at 16 bit) */
+#define SILENCE_THRESH_DEF 2.5e-4f
+
+/**
+ * tracks leading/trailing silence across the blocks of one track. a frame is
+ * loud when any of its samples exceeds the threshold in magnitude.
+ */
+struct silence_t {
+    float    thresh;     // linear, relative to full scale
+    int16_t  thresh_s16; // `thresh` converted, cached for the kernels
+    int32_t  thresh_s32;
+    uint64_t pos;        // frames scanned so far
+    uint64_t first_loud; // first loud frame, `SILENCE_NONE` if none yet
+    uint64_t end_loud;   // one past the last loud frame, 0 if none yet
+};
+
+extern void silence_init (struct silence_t *_Nonnull this, float thresh);
+
+/**
+ * scans `nframes` interleaved frames of WAV format `fmt` (see
+ * `cwav_header_t.fmt.wFormatTag`) and advances `this->pos`. unsupported
+ * formats are treated as loud so nothing gets trimmed.
+ *
+ * @return index of the first loud frame in the block, `nframes` if all silent
+ */
+extern size_t silence_scan (struct silence_t *_Nonnull this,
+                            const void *_Nonnull buf, int fmt, size_t nframes,
+                            uint32_t channels);
+
+/**
+ * vectorized kernels on `n` samples. `first` returns the index of the first
+ * loud sample or `n`; `last` returns one past the last loud sample or 0.
+ */
+extern size_t silence_first_s16 (const int16_t *_Nonnull buf, size_t n,
+                                 int16_t thr);
+extern size_t silence_last_s16 (const int16_t *_Nonnull buf, size_t n,
+                                int16_t thr);
+extern size_t silence_first_s32 (const int32_t *_Nonnull buf, size_t n,
+                                 int32_t thr);
+extern size_t silence_last_s32 (const int32_t *_Nonnull buf, size_t n,
+                                int32_t thr);
+extern size_t silence_first_flt (const float *_Nonnull buf, size_t n,
+                                 float thr);
+extern size_t silence_last_flt (const float *_Nonnull buf, size_t n,
+                                float thr);
+
+#endif // !SILENCE_H
@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * audio output backends. the playback engine in audio.c only talks to a
+ * `sink_ops_t`, so it runs the same on AAudio (aaudio_bind.c) and on the
+ * host sinks of sink_host.c, which need no sound hardware.
+ *
+ * a sink is either pushed to with `write` or, when opened with a `pull`
+ * function, pulls from it on its own thread. all functions but `pull` and
+ * `error` are called from one thread.
+ */
+
+#define SINK_OK    0
+#define SINK_ERR   -1
+#define SINK_EMEM  -2
+#define SINK_EDISC -3 // device went away; reopen
+
+#define SINK_STOPPED      0
+#define SINK_STARTED      1
+#define SINK_PAUSED       2
+#define SINK_DISCONNECTED 3
+
+/**
+ * fills `buf` with `nframes` frames, padding with silence if it has to.
+ * called on the sink's thread, often real-time: no locks, allocation or
+ * logging.
+ */
+typedef void (*sink_pull_fn) (void *_Nullable user, void *_Nonnull buf,
+                              size_t nframes);
+
+/**
+ * told that the stream failed on its own, `SINK_EDISC` when its device went
+ * away, as on a headphone unplug or a Bluetooth connect. called once, on a
+ * thread of the sink's: it should only flag the failure for the thread that
+ * owns the sink, which closes it and opens another.
+ */
+typedef void (*sink_error_fn) (void *_Nullable user, int err);
+
+struct sink_cfg_t {
+    int      fmt; // WAV format code, see `cwav_header_t.fmt.wFormatTag`
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint8_t  perf; // `ncap_config.aaudio_optimize` code
+
+    sink_pull_fn _Nullable pull; // NULL for `write`
+    sink_error_fn _Nullable error;
+    void *_Nullable user; // for `pull` and `error`
+};
+
+struct sink_ops_t;
+
+struct sink_t {
+    const struct sink_ops_t *_Nullable ops;
+    const char *_Nullable arg; // backend specific, e.g. the WAV sink's file
+    void *_Nullable impl;
+
+    // set by `open`
+    int32_t burst; // frames per burst
+    int32_t cap;   // largest buffer size in frames
+    int32_t device;
+};
+
+struct sink_ops_t {
+    const char *_Nonnull name;
+
+    /**
+     * @return `SINK_OK`, or `SINK_ERR` if the format or mode is not
+     * supported. nothing needs closing on error
+     */
+    int (*_Nonnull open) (struct sink_t *_Nonnull this,
+                          const struct sink_cfg_t *_Nonnull cfg);
+
+    void (*_Nonnull close) (struct sink_t *_Nonnull this);
+
+    int (*_Nonnull start) (struct sink_t *_Nonnull this);
+
+    /** stops playing, keeping what is buffered */
+    int (*_Nonnull pause) (struct sink_t *_Nonnull this);
+
+    int (*_Nonnull stop) (struct sink_t *_Nonnull this);
+
+    /**
+     * drops what is buffered, so a restart plays the next write at once.
+     * only while paused.
+     *
+     * @return frames dropped, or `SINK_ERR`
+     */
+    long (*_Nonnull flush) (struct sink_t *_Nonnull this);
+
+    /**
+     * blocks until `nframes` are queued or `timeout_ns` passes.
+     *
+     * @return frames queued, or `SINK_ERR`/`SINK_EDISC`
+     */
+    long (*_Nonnull write) (struct sink_t *_Nonnull this,
+                            const void *_Nonnull buf, size_t nframes,
+                            uint64_t timeout_ns);
+
+    /** `SINK_STOPPED`, `SINK_STARTED`, ... */
+    int (*_Nonnull state) (struct sink_t *_Nonnull this);
+
+    /** underruns since `open` */
+    int32_t (*_Nonnull xruns) (struct sink_t *_Nonnull this);
+
+    int32_t (*_Nonnull get_buf) (struct sink_t *_Nonnull this);
+
+    /** @return the size actually set, which may be clamped */
+    int32_t (*_Nonnull set_buf) (struct sink_t *_Nonnull this, int32_t siz);
+
+    /**
+     * frame `*frames` was presented at `*ns`, `CLOCK_MONOTONIC`.
+     *
+     * @return `SINK_OK`, or `SINK_ERR` if nothing was presented yet
+     */
+    int (*_Nonnull timestamp) (struct sink_t *_Nonnull this,
+                               int64_t *_Nonnull frames, int64_t *_Nonnull ns);
+
+    /**
+     * frames the sink took since `open`, by `write` or `pull`, and frames
+     * its device read out of the buffer. a flush counts as read.
+     */
+    int (*_Nonnull counters) (struct sink_t *_Nonnull this,
+                              int64_t *_Nonnull written,
+                              int64_t *_Nonnull read);
+};
+
+/** AAudio, Android only */
+extern const struct sink_ops_t sink_aaudio;
+
+/** takes everything at once and throws it away. write only */
+extern const struct sink_ops_t sink_null;
+
+/** writes a WAV file to `sink_t.arg` as fast as it is fed. write only */
+extern const struct sink_ops_t sink_wav;
+
+/**
+ * a device thread that consumes a burst per burst period of wall time. with
+ * `sink_t.arg` "disc=<ms>", each stream's device goes away after that much
+ * audio, and each open is on a new one
+ */
+extern const struct sink_ops_t sink_paced;
+
+#endif // !SINK_H
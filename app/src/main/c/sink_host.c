@@ -0,0 +1,653 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio.h"
+#include "logging.h"
+#include "ring.h"
+#include "sink.h"
+
+static const char *FILENAME = "sink_host.c";
+
+/** burst of the host sinks, in ms */
+#define HOST_BURST_MS 4
+
+/** buffer capacity of the host sinks, in bursts */
+#define HOST_CAP_BURSTS 64
+
+static inline uint64_t
+host_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static size_t
+host_width (int fmt)
+{
+    switch (fmt) {
+        case 1: // S16
+            return 2;
+        case 2: // S32
+        case 3: // FLT
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/** state of the null and WAV sinks, which take every write at once */
+struct file_sink_t {
+    FILE *_Nullable fp;
+    size_t   blk;
+    int      state;
+    int32_t  buf_siz;
+    int64_t  frames;
+    uint64_t ts_ns;
+    struct cwav_header_t hdr;
+};
+
+static int
+file_open (struct sink_t *this, const struct sink_cfg_t *cfg, bool wav)
+{
+    const size_t width = host_width (cfg->fmt);
+
+    // nothing would pace a callback
+    if (cfg->pull != NULL || width == 0 || cfg->channels == 0)
+        return SINK_ERR;
+
+    if (wav && this->arg == NULL)
+        return SINK_ERR;
+
+    struct file_sink_t *fs = calloc (1, sizeof *fs);
+
+    if (fs == NULL)
+        return SINK_EMEM;
+
+    this->burst  = cfg->sample_rate * HOST_BURST_MS / 1000;
+    this->cap    = this->burst * HOST_CAP_BURSTS;
+    this->device = 0;
+
+    fs->blk     = width * cfg->channels;
+    fs->state   = SINK_STOPPED;
+    fs->buf_siz = 2 * this->burst;
+
+    if (wav) {
+        if ((fs->fp = fopen (this->arg, "wb")) == NULL) {
+            logef ("ERROR: fopen `%s' failed for wb", this->arg);
+            free (fs);
+            return SINK_ERR;
+        }
+
+        struct cwav_header_t *h = &fs->hdr;
+
+        memcpy (h->riff.ckID, "RIFF", 4);
+        memcpy (h->riff.WAVEID, "WAVE", 4);
+        memcpy (h->fmt.ckID, "fmt ", 4);
+        memcpy (h->data.ckID, "data", 4);
+
+        h->fmt.cksize          = 16;
+        h->fmt.wFormatTag      = cfg->fmt;
+        h->fmt.nChannels       = cfg->channels;
+        h->fmt.nSamplesPerSec  = cfg->sample_rate;
+        h->fmt.nAvgBytesPerSec = cfg->sample_rate * fs->blk;
+        h->fmt.nBlockAlign     = fs->blk;
+        h->fmt.wBitsPerSample  = width * 8;
+        h->riff.cksize         = CWAV_HEADER_SIZ - 8;
+
+        // sizes are filled in by `file_close`
+        fwrite (h, CWAV_HEADER_SIZ, 1, fs->fp);
+    }
+
+    this->impl = fs;
+
+    return SINK_OK;
+}
+
+static int
+null_open (struct sink_t *this, const struct sink_cfg_t *cfg)
+{
+    return file_open (this, cfg, false);
+}
+
+static int
+wav_open (struct sink_t *this, const struct sink_cfg_t *cfg)
+{
+    return file_open (this, cfg, true);
+}
+
+static void
+file_close (struct sink_t *this)
+{
+    struct file_sink_t *fs = this->impl;
+
+    if (fs == NULL)
+        return;
+
+    if (fs->fp != NULL) {
+        fs->hdr.data.cksize = fs->frames * fs->blk;
+        fs->hdr.riff.cksize = CWAV_HEADER_SIZ - 8 + fs->hdr.data.cksize;
+
+        if (fseek (fs->fp, 0, SEEK_SET) != 0
+            || fwrite (&fs->hdr, CWAV_HEADER_SIZ, 1, fs->fp) != 1)
+            logef ("ERROR: could not finish the WAV header of `%s'",
+                   this->arg);
+
+        fclose (fs->fp);
+    }
+
+    free (fs);
+    this->impl = NULL;
+}
+
+static int
+file_start (struct sink_t *this)
+{
+    ((struct file_sink_t *)this->impl)->state = SINK_STARTED;
+    return SINK_OK;
+}
+
+static int
+file_pause (struct sink_t *this)
+{
+    ((struct file_sink_t *)this->impl)->state = SINK_PAUSED;
+    return SINK_OK;
+}
+
+static int
+file_stop (struct sink_t *this)
+{
+    ((struct file_sink_t *)this->impl)->state = SINK_STOPPED;
+    return SINK_OK;
+}
+
+static long
+file_flush (struct sink_t *this)
+{
+    (void)this;
+    return 0; // nothing is held back
+}
+
+static long
+file_write (struct sink_t *this, const void *buf, size_t nframes,
+            uint64_t timeout_ns)
+{
+    (void)timeout_ns;
+
+    struct file_sink_t *fs = this->impl;
+
+    if (fs->fp != NULL && fwrite (buf, fs->blk, nframes, fs->fp) != nframes)
+        return SINK_ERR;
+
+    fs->frames += nframes;
+    fs->ts_ns = host_now ();
+
+    return nframes;
+}
+
+static int
+file_state (struct sink_t *this)
+{
+    return ((struct file_sink_t *)this->impl)->state;
+}
+
+static int32_t
+file_xruns (struct sink_t *this)
+{
+    (void)this;
+    return 0;
+}
+
+static int32_t
+file_get_buf (struct sink_t *this)
+{
+    return ((struct file_sink_t *)this->impl)->buf_siz;
+}
+
+static int32_t
+file_set_buf (struct sink_t *this, int32_t siz)
+{
+    struct file_sink_t *fs = this->impl;
+
+    fs->buf_siz = siz < this->burst ? this->burst
+                  : siz > this->cap ? this->cap
+                                    : siz;
+
+    return fs->buf_siz;
+}
+
+static int
+file_timestamp (struct sink_t *this, int64_t *frames, int64_t *ns)
+{
+    const struct file_sink_t *fs = this->impl;
+
+    if (fs->frames == 0)
+        return SINK_ERR;
+
+    *frames = fs->frames;
+    *ns     = fs->ts_ns;
+
+    return SINK_OK;
+}
+
+static int
+file_counters (struct sink_t *this, int64_t *written, int64_t *read)
+{
+    const struct file_sink_t *fs = this->impl;
+
+    *written = *read = fs->frames;
+
+    return SINK_OK;
+}
+
+const struct sink_ops_t sink_null = {
+    .name      = "null",
+    .open      = null_open,
+    .close     = file_close,
+    .start     = file_start,
+    .pause     = file_pause,
+    .stop      = file_stop,
+    .flush     = file_flush,
+    .write     = file_write,
+    .state     = file_state,
+    .xruns     = file_xruns,
+    .get_buf   = file_get_buf,
+    .set_buf   = file_set_buf,
+    .timestamp = file_timestamp,
+    .counters  = file_counters,
+};
+
+const struct sink_ops_t sink_wav = {
+    .name      = "wav",
+    .open      = wav_open,
+    .close     = file_close,
+    .start     = file_start,
+    .pause     = file_pause,
+    .stop      = file_stop,
+    .flush     = file_flush,
+    .write     = file_write,
+    .state     = file_state,
+    .xruns     = file_xruns,
+    .get_buf   = file_get_buf,
+    .set_buf   = file_set_buf,
+    .timestamp = file_timestamp,
+    .counters  = file_counters,
+};
+
+/**
+ * a device thread that takes a burst every burst period, from `pull` or
+ * from a ring the writer fills up to the buffer size. an empty ring while
+ * started is an xrun, as on a real device.
+ */
+struct paced_sink_t {
+    pthread_t       tid;
+    pthread_mutex_t mx;
+    pthread_cond_t  cv;
+    _Atomic int     state;
+    bool            quit;
+    bool            parked; // the thread waits for a start, under `mx`
+
+    sink_pull_fn _Nullable pull;
+    sink_error_fn _Nullable error;
+    void *_Nullable user;
+    struct ring_t   ring;
+    size_t          blk;
+    uint64_t        period_ns;
+    _Atomic int32_t buf_siz;
+    _Atomic int32_t xruns;
+    uint8_t        *buf;     // one burst
+    int64_t         disc_at; // frames presented before the device goes, or 0
+
+    // last presented burst, under `mx`
+    int64_t  frames;
+    uint64_t ts_ns;
+    int64_t  flushed; // frames dropped by `flush`
+};
+
+static void *
+tfn_paced (void *arg)
+{
+    struct sink_t       *this  = arg;
+    struct paced_sink_t *ps    = this->impl;
+    const size_t         burst = (size_t)this->burst * ps->blk;
+    struct timespec      next;
+    bool                 run = false;
+
+    for (;;) {
+        if (atomic_load (&ps->state) != SINK_STARTED) {
+            pthread_mutex_lock (&ps->mx);
+            ps->parked = true;
+            pthread_cond_broadcast (&ps->cv);
+
+            while (!ps->quit && atomic_load (&ps->state) != SINK_STARTED)
+                pthread_cond_wait (&ps->cv, &ps->mx);
+
+            const bool quit = ps->quit;
+            ps->parked      = false;
+            pthread_mutex_unlock (&ps->mx);
+
+            if (quit)
+                break;
+
+            run = false;
+        }
+
+        if (!run) {
+            clock_gettime (CLOCK_MONOTONIC, &next);
+            run = true;
+        }
+
+        next.tv_nsec += ps->period_ns;
+
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            ++next.tv_sec;
+        }
+
+        clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        if (ps->pull != NULL) {
+            ps->pull (ps->user, ps->buf, this->burst);
+        } else {
+            size_t avail = ring_used (&ps->ring);
+
+            avail -= avail % ps->blk;
+
+            if (ring_read (&ps->ring, ps->buf, avail < burst ? avail : burst)
+                < burst)
+                atomic_fetch_add (&ps->xruns, 1);
+        }
+
+        pthread_mutex_lock (&ps->mx);
+        ps->frames += this->burst;
+        ps->ts_ns = host_now ();
+
+        // the device went away: parks for good, as AAudio's stream does
+        const bool disc = ps->disc_at > 0 && ps->frames >= ps->disc_at;
+
+        if (disc)
+            atomic_store (&ps->state, SINK_DISCONNECTED);
+
+        pthread_mutex_unlock (&ps->mx);
+
+        if (disc && ps->error != NULL)
+            ps->error (ps->user, SINK_EDISC);
+    }
+
+    return NULL;
+}
+
+/** devices the faulty paced sink went through */
+static _Atomic int32_t paced_devices;
+
+static int
+paced_open (struct sink_t *this, const struct sink_cfg_t *cfg)
+{
+    const size_t width = host_width (cfg->fmt);
+    unsigned     disc_ms;
+
+    if (width == 0 || cfg->channels == 0 || cfg->sample_rate == 0)
+        return SINK_ERR;
+
+    struct paced_sink_t *ps = calloc (1, sizeof *ps);
+
+    if (ps == NULL)
+        return SINK_EMEM;
+
+    ps->pull      = cfg->pull;
+    ps->error     = cfg->error;
+    ps->user      = cfg->user;
+    ps->blk       = width * cfg->channels;
+    this->burst   = cfg->sample_rate * HOST_BURST_MS / 1000;
+    this->device  = 0;
+    ps->period_ns = (uint64_t)this->burst * 1000000000 / cfg->sample_rate;
+
+    if (this->arg != NULL && sscanf (this->arg, "disc=%u", &disc_ms) == 1
+        && disc_ms > 0) {
+        ps->disc_at  = (int64_t)disc_ms * cfg->sample_rate / 1000;
+        this->device = atomic_fetch_add (&paced_devices, 1) + 1;
+    }
+
+    atomic_init (&ps->state, SINK_STOPPED);
+    atomic_init (&ps->xruns, 0);
+    atomic_init (&ps->buf_siz, (cfg->perf == 1 ? 2 : 8) * this->burst);
+
+    if ((ps->buf = malloc ((size_t)this->burst * ps->blk)) == NULL
+        || ring_init (&ps->ring, (size_t)this->burst * HOST_CAP_BURSTS
+                                     * ps->blk)
+               != RING_OK) {
+        free (ps->buf);
+        free (ps);
+        return SINK_EMEM;
+    }
+
+    this->cap  = ring_cap (&ps->ring) / ps->blk;
+    this->impl = ps;
+
+    pthread_mutex_init (&ps->mx, NULL);
+    pthread_cond_init (&ps->cv, NULL);
+
+    if (pthread_create (&ps->tid, NULL, tfn_paced, this) != 0) {
+        pthread_mutex_destroy (&ps->mx);
+        pthread_cond_destroy (&ps->cv);
+        ring_deinit (&ps->ring);
+        free (ps->buf);
+        free (ps);
+        this->impl = NULL;
+        return SINK_ERR;
+    }
+
+    return SINK_OK;
+}
+
+static void
+paced_close (struct sink_t *this)
+{
+    struct paced_sink_t *ps = this->impl;
+
+    if (ps == NULL)
+        return;
+
+    pthread_mutex_lock (&ps->mx);
+    ps->quit = true;
+    atomic_store (&ps->state, SINK_STOPPED);
+    pthread_cond_broadcast (&ps->cv);
+    pthread_mutex_unlock (&ps->mx);
+    pthread_join (ps->tid, NULL);
+
+    pthread_mutex_destroy (&ps->mx);
+    pthread_cond_destroy (&ps->cv);
+    ring_deinit (&ps->ring);
+    free (ps->buf);
+    free (ps);
+    this->impl = NULL;
+}
+
+/**
+ * leaving `SINK_STARTED` waits out the burst the thread is on. nothing
+ * leaves `SINK_DISCONNECTED` but a close
+ */
+static int
+paced_set_state (struct sink_t *this, int state)
+{
+    struct paced_sink_t *ps = this->impl;
+
+    pthread_mutex_lock (&ps->mx);
+
+    if (atomic_load (&ps->state) == SINK_DISCONNECTED) {
+        pthread_mutex_unlock (&ps->mx);
+        return SINK_EDISC;
+    }
+    atomic_store (&ps->state, state);
+    pthread_cond_broadcast (&ps->cv);
+
+    while (state != SINK_STARTED && !ps->parked)
+        pthread_cond_wait (&ps->cv, &ps->mx);
+
+    pthread_mutex_unlock (&ps->mx);
+
+    return SINK_OK;
+}
+
+static int
+paced_start (struct sink_t *this)
+{
+    return paced_set_state (this, SINK_STARTED);
+}
+
+static int
+paced_pause (struct sink_t *this)
+{
+    return paced_set_state (this, SINK_PAUSED);
+}
+
+static int
+paced_stop (struct sink_t *this)
+{
+    return paced_set_state (this, SINK_STOPPED);
+}
+
+static long
+paced_flush (struct sink_t *this)
+{
+    struct paced_sink_t *ps = this->impl;
+
+    if (atomic_load (&ps->state) == SINK_STARTED)
+        return SINK_ERR;
+
+    // the thread is parked, so the ring's read side is free to take
+    const size_t used = ring_used (&ps->ring);
+
+    ring_drop_to (&ps->ring, ring_pos (&ps->ring));
+
+    pthread_mutex_lock (&ps->mx);
+    ps->flushed += used / ps->blk;
+    pthread_mutex_unlock (&ps->mx);
+
+    return used / ps->blk;
+}
+
+static long
+paced_write (struct sink_t *this, const void *buf, size_t nframes,
+             uint64_t timeout_ns)
+{
+    struct paced_sink_t  *ps  = this->impl;
+    const uint64_t        end = host_now () + timeout_ns;
+    const struct timespec nap  = { .tv_sec = 0, .tv_nsec = ps->period_ns / 4 };
+    size_t                done = 0;
+
+    if (ps->pull != NULL)
+        return SINK_ERR;
+
+    while (done < nframes) {
+        if (atomic_load (&ps->state) == SINK_DISCONNECTED)
+            return SINK_EDISC;
+
+        const size_t siz  = (size_t)atomic_load (&ps->buf_siz) * ps->blk;
+        const size_t used = ring_used (&ps->ring);
+        size_t       room = used < siz ? (siz - used) / ps->blk : 0;
+
+        if (room > nframes - done)
+            room = nframes - done;
+
+        if (room > 0) {
+            ring_write (&ps->ring, (const uint8_t *)buf + done * ps->blk,
+                        room * ps->blk);
+            done += room;
+        } else if (host_now () >= end) {
+            break;
+        } else {
+            nanosleep (&nap, NULL);
+        }
+    }
+
+    return done;
+}
+
+static int
+paced_state (struct sink_t *this)
+{
+    return atomic_load (&((struct paced_sink_t *)this->impl)->state);
+}
+
+static int32_t
+paced_xruns (struct sink_t *this)
+{
+    return atomic_load (&((struct paced_sink_t *)this->impl)->xruns);
+}
+
+static int32_t
+paced_get_buf (struct sink_t *this)
+{
+    return atomic_load (&((struct paced_sink_t *)this->impl)->buf_siz);
+}
+
+static int32_t
+paced_set_buf (struct sink_t *this, int32_t siz)
+{
+    struct paced_sink_t *ps = this->impl;
+
+    siz = siz < this->burst ? this->burst : siz > this->cap ? this->cap : siz;
+    atomic_store (&ps->buf_siz, siz);
+
+    return siz;
+}
+
+static int
+paced_timestamp (struct sink_t *this, int64_t *frames, int64_t *ns)
+{
+    struct paced_sink_t *ps  = this->impl;
+    int                  ret = SINK_ERR;
+
+    pthread_mutex_lock (&ps->mx);
+
+    // a flush moves the position on past what it dropped, as on AAudio
+    if (ps->frames > 0) {
+        *frames = ps->frames + ps->flushed;
+        *ns     = ps->ts_ns;
+        ret     = SINK_OK;
+    }
+
+    pthread_mutex_unlock (&ps->mx);
+
+    return ret;
+}
+
+/** what the ring holds was written but not read yet */
+static int
+paced_counters (struct sink_t *this, int64_t *written, int64_t *read)
+{
+    struct paced_sink_t *ps = this->impl;
+
+    pthread_mutex_lock (&ps->mx);
+    *read = ps->frames + ps->flushed;
+    pthread_mutex_unlock (&ps->mx);
+
+    *written = *read + (int64_t)(ring_used (&ps->ring) / ps->blk);
+
+    return SINK_OK;
+}
+
+const struct sink_ops_t sink_paced = {
+    .name      = "paced",
+    .open      = paced_open,
+    .close     = paced_close,
+    .start     = paced_start,
+    .pause     = paced_pause,
+    .stop      = paced_stop,
+    .flush     = paced_flush,
+    .write     = paced_write,
+    .state     = paced_state,
+    .xruns     = paced_xruns,
+    .get_buf   = paced_get_buf,
+    .set_buf   = paced_set_buf,
+    .timestamp = paced_timestamp,
+    .counters  = paced_counters,
+};
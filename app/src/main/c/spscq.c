@@ -0,0 +1,176 @@
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "spscq.h"
+
+/** spins with `sched_yield` first, then sleeps */
+#define SPIN_YIELDS 64
+
+static const struct timespec backoff_ts
+    = { .tv_sec = 0, .tv_nsec = 200000 }; // 200 us
+
+static inline uint64_t
+now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void
+backoff (unsigned *spins)
+{
+    if (*spins < SPIN_YIELDS) {
+        ++*spins;
+        sched_yield ();
+    } else {
+        nanosleep (&backoff_ts, NULL);
+    }
+}
+
+int
+spscq_init (struct spscq_t *this, size_t cap)
+{
+    size_t pow2 = 1;
+
+    while (pow2 < cap)
+        pow2 <<= 1;
+
+    if ((this->buf = malloc (pow2 * sizeof (void *))) == NULL)
+        return SPSCQ_EMEM;
+
+    this->mask       = pow2 - 1;
+    this->tail_cache = 0;
+    this->head_cache = 0;
+    this->depth_max  = 0;
+    atomic_init (&this->head, 0);
+    atomic_init (&this->tail, 0);
+    atomic_init (&this->closed, false);
+    atomic_init (&this->push_stall_ns, 0);
+    atomic_init (&this->pop_stall_ns, 0);
+
+    return SPSCQ_OK;
+}
+
+void
+spscq_deinit (struct spscq_t *this)
+{
+    free (this->buf);
+    this->buf = NULL;
+}
+
+bool
+spscq_trypush (struct spscq_t *this, void *p)
+{
+    const size_t tail
+        = atomic_load_explicit (&this->tail, memory_order_relaxed);
+
+    if (tail - this->head_cache > this->mask) {
+        this->head_cache
+            = atomic_load_explicit (&this->head, memory_order_acquire);
+
+        if (tail - this->head_cache > this->mask)
+            return false;
+    }
+
+    this->buf[tail & this->mask] = p;
+    atomic_store_explicit (&this->tail, tail + 1, memory_order_release);
+
+    if (tail + 1 - this->head_cache > this->depth_max)
+        this->depth_max = tail + 1 - this->head_cache;
+
+    return true;
+}
+
+void *
+spscq_trypop (struct spscq_t *this)
+{
+    const size_t head
+        = atomic_load_explicit (&this->head, memory_order_relaxed);
+
+    if (head == this->tail_cache) {
+        this->tail_cache
+            = atomic_load_explicit (&this->tail, memory_order_acquire);
+
+        if (head == this->tail_cache)
+            return NULL;
+    }
+
+    void *p = this->buf[head & this->mask];
+    atomic_store_explicit (&this->head, head + 1, memory_order_release);
+
+    return p;
+}
+
+int
+spscq_push (struct spscq_t *this, void *p)
+{
+    if (spscq_closed (this))
+        return SPSCQ_CLOSD;
+
+    if (spscq_trypush (this, p))
+        return SPSCQ_OK;
+
+    const uint64_t start = now_ns ();
+    unsigned       spins = 0;
+    int            ret   = SPSCQ_OK;
+
+    while (!spscq_trypush (this, p)) {
+        if (spscq_closed (this)) {
+            ret = SPSCQ_CLOSD;
+            break;
+        }
+
+        backoff (&spins);
+    }
+
+    atomic_fetch_add_explicit (&this->push_stall_ns, now_ns () - start,
+                               memory_order_relaxed);
+    return ret;
+}
+
+void *
+spscq_pop (struct spscq_t *this)
+{
+    void *p = spscq_trypop (this);
+
+    if (p != NULL)
+        return p;
+
+    const uint64_t start = now_ns ();
+    unsigned       spins = 0;
+
+    // check closed before the last pop so nothing pushed before the close is
+    // lost
+    for (bool closed = false; (p = spscq_trypop (this)) == NULL && !closed;
+         backoff (&spins))
+        closed = spscq_closed (this);
+
+    atomic_fetch_add_explicit (&this->pop_stall_ns, now_ns () - start,
+                               memory_order_relaxed);
+    return p;
+}
+
+void
+spscq_close (struct spscq_t *this)
+{
+    atomic_store_explicit (&this->closed, true, memory_order_release);
+}
+
+bool
+spscq_closed (struct spscq_t *this)
+{
+    return atomic_load_explicit (&this->closed, memory_order_acquire);
+}
+
+size_t
+spscq_depth (struct spscq_t *this)
+{
+    return atomic_load_explicit (&this->tail, memory_order_acquire)
+           - atomic_load_explicit (&this->head, memory_order_acquire);
+}
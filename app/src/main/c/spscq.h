@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef SPSCQ_H
+#define SPSCQ_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPSCQ_OK    0
+#define SPSCQ_EMEM  -2
+#define SPSCQ_CLOSD -3
+
+/**
+ * bounded lock-free single-producer/single-consumer queue of pointers.
+ *
+ * `trypush`/`trypop` never block. `push`/`pop` back off until they can make
+ * progress or the queue is closed, and add the time they waited to the stall
+ * counters, which is how a pipeline stage reports backpressure.
+ */
+struct spscq_t {
+    // written by the consumer
+    alignas (64) _Atomic size_t head;
+    size_t tail_cache;
+
+    // written by the producer
+    alignas (64) _Atomic size_t tail;
+    size_t head_cache;
+    size_t depth_max;
+
+    alignas (64) _Atomic bool closed;
+    _Atomic uint64_t push_stall_ns; // producer waited on a full queue
+    _Atomic uint64_t pop_stall_ns;  // consumer waited on an empty queue
+
+    size_t mask;
+    void *_Nullable *_Nullable buf;
+};
+
+/** `cap` is rounded up to a power of two. not thread safe */
+extern int spscq_init (struct spscq_t *_Nonnull this, size_t cap);
+
+/** not thread safe. does not free the queued pointers */
+extern void spscq_deinit (struct spscq_t *_Nonnull this);
+
+/** producer only */
+extern bool spscq_trypush (struct spscq_t *_Nonnull this, void *_Nonnull p);
+
+/** consumer only. @return NULL if empty */
+extern void *_Nullable spscq_trypop (struct spscq_t *_Nonnull this);
+
+/**
+ * producer only. waits while full.
+ *
+ * @return `SPSCQ_OK` or `SPSCQ_CLOSD` if the queue was closed; `p` is not
+ * queued in that case
+ */
+extern int spscq_push (struct spscq_t *_Nonnull this, void *_Nonnull p);
+
+/**
+ * consumer only. waits while empty.
+ *
+ * @return NULL once the queue is closed and drained
+ */
+extern void *_Nullable spscq_pop (struct spscq_t *_Nonnull this);
+
+/**
+ * either side. wakes waiters; pushes fail from now on, pops drain what is
+ * left.
+ */
+extern void spscq_close (struct spscq_t *_Nonnull this);
+
+extern bool spscq_closed (struct spscq_t *_Nonnull this);
+
+/** either side, approximate */
+extern size_t spscq_depth (struct spscq_t *_Nonnull this);
+
+#endif // !SPSCQ_H
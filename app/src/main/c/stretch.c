@@ -0,0 +1,392 @@
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "stretch.h"
+
+static_assert ((STRETCH_SEQ_MS - STRETCH_OVL_MS) * STRETCH_MIN / 100
+                   >= STRETCH_WIN_MS / 2,
+               "the first step skips back half a window");
+
+/** @return the dot product of `n` floats. the search spends its time here */
+static float
+dot (const float *a, const float *b, size_t n)
+{
+    size_t i   = 0;
+    float  sum = 0;
+
+    // two accumulators hide the latency of the multiply-adds
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32 (0);
+    float32x4_t acc1 = vdupq_n_f32 (0);
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32 (acc0, vld1q_f32 (a + i), vld1q_f32 (b + i));
+        acc1 = vmlaq_f32 (acc1, vld1q_f32 (a + i + 4), vld1q_f32 (b + i + 4));
+    }
+
+    float s[4];
+    vst1q_f32 (s, vaddq_f32 (acc0, acc1));
+    sum = s[0] + s[1] + s[2] + s[3];
+#elif defined(__SSE2__)
+    __m128 acc0 = _mm_setzero_ps ();
+    __m128 acc1 = _mm_setzero_ps ();
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps (a + i),
+                                             _mm_loadu_ps (b + i)));
+        acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps (a + i + 4),
+                                             _mm_loadu_ps (b + i + 4)));
+    }
+
+    float s[4];
+    _mm_storeu_ps (s, _mm_add_ps (acc0, acc1));
+    sum = s[0] + s[1] + s[2] + s[3];
+#endif
+
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+static inline int16_t
+clip_s16 (float v)
+{
+    return v >= INT16_MAX   ? INT16_MAX
+           : v <= INT16_MIN ? INT16_MIN
+                            : lrintf (v);
+}
+
+/** the largest float below 2^31 is 2^31 - 128 */
+static inline int32_t
+clip_s32 (float v)
+{
+    return v >= 2147483648.0f ? INT32_MAX : v < -2147483648.0f ? INT32_MIN
+                                                               : lrintf (v);
+}
+
+static size_t
+sample_siz (int fmt)
+{
+    return fmt == 1 ? sizeof (int16_t) : sizeof (float);
+}
+
+int
+stretch_init (struct stretch_t *this, int fmt, uint32_t channels,
+              uint32_t sample_rate)
+{
+    memset (this, 0, sizeof *this);
+
+    if (fmt < 1 || fmt > 3 || channels == 0)
+        return STRETCH_ERR;
+
+    this->fmt      = fmt;
+    this->channels = channels;
+    this->seq      = (size_t)sample_rate * STRETCH_SEQ_MS / 1000;
+    this->ovl      = (size_t)sample_rate * STRETCH_OVL_MS / 1000;
+    this->win      = (size_t)sample_rate * STRETCH_WIN_MS / 1000;
+    this->speed    = 1;
+
+    if (this->ovl == 0 || this->win == 0)
+        return STRETCH_ERR;
+
+    // a step needs the last one's skip, a window and a sequence
+    this->in_cap = (this->seq - this->ovl) * STRETCH_MAX / 100 + 1
+                   + this->win + this->seq;
+    this->in     = malloc (this->in_cap * channels * sizeof (float));
+    this->mid    = malloc (this->ovl * channels * sizeof (float));
+    this->out = malloc ((this->seq + this->in_cap) * channels * sizeof (float));
+    this->raw = malloc (this->in_cap * channels * sample_siz (fmt));
+
+    if (this->in == NULL || this->mid == NULL || this->out == NULL
+        || this->raw == NULL) {
+        stretch_deinit (this);
+        return STRETCH_ERR;
+    }
+
+    return STRETCH_OK;
+}
+
+void
+stretch_deinit (struct stretch_t *this)
+{
+    free (this->in);
+    free (this->mid);
+    free (this->out);
+    free (this->raw);
+
+    this->in  = NULL;
+    this->mid = NULL;
+    this->out = NULL;
+    this->raw = NULL;
+}
+
+void
+stretch_reset (struct stretch_t *this)
+{
+    this->acc     = 0;
+    this->primed  = false;
+    this->next    = 0;
+    this->skip    = 0;
+    this->in_len  = 0;
+    this->out_pos = 0;
+    this->out_len = 0;
+}
+
+void
+stretch_set (struct stretch_t *this, uint16_t pct)
+{
+    if (pct == 0)
+        pct = 100;
+
+    pct = pct < STRETCH_MIN ? STRETCH_MIN : pct > STRETCH_MAX ? STRETCH_MAX
+                                                               : pct;
+
+    this->speed = pct / 100.0f;
+}
+
+size_t
+stretch_want (const struct stretch_t *this)
+{
+    const size_t need
+        = this->skip + (this->primed ? this->win + this->seq : this->seq);
+
+    return need > this->in_len ? need - this->in_len : 0;
+}
+
+void
+stretch_put (struct stretch_t *this, const void *src, size_t nframes)
+{
+    const size_t ch = this->channels;
+
+    if (nframes > this->in_cap - this->in_len)
+        nframes = this->in_cap - this->in_len;
+
+    float *const dst = this->in + this->in_len * ch;
+    const size_t m   = nframes * ch;
+
+    if (this->fmt == 1) {
+        const int16_t *s = src;
+
+        for (size_t i = 0; i < m; ++i)
+            dst[i] = s[i];
+    } else if (this->fmt == 2) {
+        const int32_t *s = src;
+
+        for (size_t i = 0; i < m; ++i)
+            dst[i] = s[i];
+    } else {
+        memcpy (dst, src, m * sizeof (float));
+    }
+
+    this->in_len += nframes;
+}
+
+/**
+ * @return the offset in [0, `win`) at which the overlap's worth of input
+ * correlates best with `mid`, normalized by the input's energy only since
+ * `mid` is the same for all of them
+ */
+static size_t
+best_offset (const struct stretch_t *this)
+{
+    const size_t       ch  = this->channels;
+    const size_t       n   = this->ovl * ch;
+    const float *const in  = this->in;
+    double             e   = dot (in, in, n);
+    float              top = -INFINITY;
+    size_t             ret = 0;
+
+    for (size_t o = 0; o < this->win; ++o) {
+        const float *const c     = in + o * ch;
+        const float        r     = dot (this->mid, c, n);
+        const float        score = e > 0 ? r / sqrt (e) : 0;
+
+        if (score > top) {
+            top = score;
+            ret = o;
+        }
+
+        // slide the energy by a frame
+        for (size_t k = 0; k < ch; ++k)
+            e += (double)c[n + k] * c[n + k] - (double)c[k] * c[k];
+
+        if (e < 0)
+            e = 0;
+    }
+
+    return ret;
+}
+
+/**
+ * makes the next `seq - ovl` frames of output into the empty `out`. the
+ * last step's input is only dropped here, once there is enough after it,
+ * so `stretch_drain` can still play it.
+ *
+ * @return false if it needs more input
+ */
+static bool
+step (struct stretch_t *this)
+{
+    const size_t ch   = this->channels;
+    const size_t seq  = this->seq;
+    const size_t ovl  = this->ovl;
+    const size_t skip = this->skip;
+    const size_t need = this->primed ? this->win + seq : seq;
+    size_t       o    = 0;
+
+    if (this->in_len < skip + need)
+        return false;
+
+    memmove (this->in, this->in + skip * ch,
+             (this->in_len - skip) * ch * sizeof (float));
+    this->in_len -= skip;
+    this->skip = 0;
+
+    float *const       dst = this->out;
+    const float *const mid = this->mid;
+
+    if (this->primed) {
+        o = best_offset (this);
+
+        const float *const src = this->in + o * ch;
+
+        for (size_t f = 0; f < ovl; ++f) {
+            const float t = (float)f / ovl;
+
+            for (size_t k = 0; k < ch; ++k) {
+                const size_t i = f * ch + k;
+                dst[i]         = mid[i] + (src[i] - mid[i]) * t;
+            }
+        }
+
+        memcpy (dst + ovl * ch, src + ovl * ch,
+                (seq - 2 * ovl) * ch * sizeof (float));
+    } else {
+        // the first sequence has nothing to overlap
+        memcpy (dst, this->in, (seq - ovl) * ch * sizeof (float));
+    }
+
+    this->out_pos = 0;
+    this->out_len = seq - ovl;
+
+    memcpy (this->mid, this->in + (o + seq - ovl) * ch,
+            ovl * ch * sizeof (float));
+    this->next = o + seq;
+
+    // the next nominal place is `speed` sequences on, and half a window
+    // past the start of the search so it can go either way
+    this->acc += (seq - ovl) * (double)this->speed;
+
+    if (!this->primed)
+        this->acc -= this->win / 2;
+
+    this->primed = true;
+
+    this->skip = (size_t)this->acc;
+    this->acc -= this->skip;
+
+    return true;
+}
+
+size_t
+stretch_get (struct stretch_t *this, void *dst, size_t nframes)
+{
+    const size_t ch   = this->channels;
+    size_t       done = 0;
+
+    while (done < nframes) {
+        if (this->out_pos == this->out_len && !step (this))
+            break;
+
+        size_t n = this->out_len - this->out_pos;
+
+        if (n > nframes - done)
+            n = nframes - done;
+
+        const float *const s = this->out + this->out_pos * ch;
+        const size_t       m = n * ch;
+
+        if (this->fmt == 1) {
+            int16_t *const d = (int16_t *)dst + done * ch;
+
+            for (size_t i = 0; i < m; ++i)
+                d[i] = clip_s16 (s[i]);
+        } else if (this->fmt == 2) {
+            int32_t *const d = (int32_t *)dst + done * ch;
+
+            for (size_t i = 0; i < m; ++i)
+                d[i] = clip_s32 (s[i]);
+        } else {
+            memcpy ((float *)dst + done * ch, s, m * sizeof (float));
+        }
+
+        this->out_pos += n;
+        done += n;
+    }
+
+    return done;
+}
+
+void
+stretch_drain (struct stretch_t *this)
+{
+    const size_t ch   = this->channels;
+    const size_t left = this->out_len - this->out_pos;
+    size_t       from = 0;
+
+    memmove (this->out, this->out + this->out_pos * ch,
+             left * ch * sizeof (float));
+    this->out_pos = 0;
+    this->out_len = left;
+
+    if (this->primed) {
+        memcpy (this->out + this->out_len * ch, this->mid,
+                this->ovl * ch * sizeof (float));
+        this->out_len += this->ovl;
+        from = this->next;
+    }
+
+    if (from < this->in_len) {
+        memcpy (this->out + this->out_len * ch, this->in + from * ch,
+                (this->in_len - from) * ch * sizeof (float));
+        this->out_len += this->in_len - from;
+    }
+
+    this->acc    = 0;
+    this->primed = false;
+    this->next   = 0;
+    this->skip   = 0;
+    this->in_len = 0;
+}
+
+bool
+stretch_held (const struct stretch_t *this)
+{
+    return this->in_len > 0 || this->out_pos < this->out_len
+           || this->primed;
+}
+
+uint64_t
+stretch_behind (const struct stretch_t *this)
+{
+    // output is copied from the input, a sequence at a time, so the frames
+    // in `out` stand for as many of it
+    uint64_t n = this->out_len - this->out_pos + this->in_len;
+
+    if (this->primed)
+        n = n + this->ovl - this->next;
+
+    return n;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef STRETCH_H
+#define STRETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * playback speed without a change of pitch, by WSOLA. the input is cut
+ * into sequences of `STRETCH_SEQ_MS` that overlap by `STRETCH_OVL_MS`;
+ * each one starts where, within `STRETCH_WIN_MS` of its nominal place, it
+ * correlates best with the end of the last, and is crossfaded into it over
+ * the overlap. the nominal places are `speed` times the output apart, so
+ * input is consumed `speed` times as fast as output is made.
+ *
+ * runs in float on interleaved frames, integer samples keeping their scale
+ * as in the equalizer.
+ */
+
+#define STRETCH_OK  0
+#define STRETCH_ERR -1
+
+#define STRETCH_SEQ_MS 40
+#define STRETCH_OVL_MS 8
+#define STRETCH_WIN_MS 15
+
+/** speeds in percent, as kept in `config_t.speed` */
+#define STRETCH_MIN 50
+#define STRETCH_MAX 300
+
+/**
+ * cost of one second of stereo output at 48 kHz at any speed, kept to 2%
+ * of it on an arm64 little core. bench_stretch.c checks it
+ */
+#define STRETCH_BUDGET_NS 20000000
+
+struct stretch_t {
+    int      fmt; // WAV format code
+    uint32_t channels;
+    size_t   seq; // frames
+    size_t   ovl;
+    size_t   win;
+    float    speed;
+    double   acc;    // input owed to the nominal place, in frames
+    bool     primed; // `mid` holds the end of a sequence
+    size_t   next;   // where in `in` the frame after `mid` is
+    size_t   skip;   // input the next step starts past
+
+    float *_Nullable in; // input, `in_cap` frames
+    size_t in_len;
+    size_t in_cap;
+    float *_Nullable mid; // the last sequence's overlap, `ovl` frames
+    float *_Nullable out; // output not yet taken
+    size_t out_pos;
+    size_t out_len;
+    void *_Nullable raw; // `in_cap` frames in `fmt` for callers to read into
+};
+
+/**
+ * allocates a stretch of `fmt` (1 S16, 2 S32, 3 FLT) frames at normal
+ * speed. fails for other formats.
+ */
+extern int stretch_init (struct stretch_t *_Nonnull this, int fmt,
+                         uint32_t channels, uint32_t sample_rate);
+
+extern void stretch_deinit (struct stretch_t *_Nonnull this);
+
+/** forgets all input, for a seek or a new track */
+extern void stretch_reset (struct stretch_t *_Nonnull this);
+
+/** `pct` percent, clamped to [`STRETCH_MIN`, `STRETCH_MAX`] */
+extern void stretch_set (struct stretch_t *_Nonnull this, uint16_t pct);
+
+/**
+ * @return input frames the next step needs before `stretch_get` makes more
+ * output: about `speed` times what it makes, a step at a time
+ */
+extern size_t stretch_want (const struct stretch_t *_Nonnull this);
+
+/** appends input frames in `fmt`, up to `in_cap` held */
+extern void stretch_put (struct stretch_t *_Nonnull this,
+                         const void *_Nonnull src, size_t nframes);
+
+/**
+ * moves up to `nframes` frames of output in `fmt` to `dst`.
+ *
+ * @return frames moved; fewer when it needs more input
+ */
+extern size_t stretch_get (struct stretch_t *_Nonnull this,
+                           void *_Nonnull dst, size_t nframes);
+
+/**
+ * makes all input held into output for `stretch_get`, without stretching
+ * what is left: at the end of the input, or to leave the stretch without a
+ * gap. that is at most `in_cap` frames, a few steps' worth.
+ */
+extern void stretch_drain (struct stretch_t *_Nonnull this);
+
+/** @return whether any input or output is held */
+extern bool stretch_held (const struct stretch_t *_Nonnull this);
+
+/** @return input frames read but not yet out of `stretch_get` */
+extern uint64_t stretch_behind (const struct stretch_t *_Nonnull this);
+
+#endif // !STRETCH_H
@@ -3,8 +3,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "strvec.h"
 
+/** bytes of names allocated at a time */
+#define NAMES_CHUNK 4096
+
 #define bytecap(this) (this->cap * sizeof (char *))
 
 #define expand(this)                                                          \
@@ -25,16 +29,16 @@ strvec_init (strvec_t *this)
     this->cap = 1;
     this->siz = 0;
     this->ptr = malloc (sizeof (char *));
+    arena_init (&this->names, NAMES_CHUNK);
     return this->ptr == NULL ? STRQUEUE_ENULL : STRQUEUE_OK;
 }
 
 void
 strvec_deinit (strvec_t *this)
 {
-    while (this->siz)
-        free (this->ptr[--this->siz]);
-
+    this->siz = 0;
     free (this->ptr);
+    arena_deinit (&this->names);
 }
 
 int
@@ -43,7 +47,7 @@ strvec_pushb (strvec_t *this, const char *str, size_t len)
     if (this->siz == this->cap)
         expand (this);
 
-    char *p = this->ptr[this->siz++] = malloc (len + 1);
+    char *p = this->ptr[this->siz++] = arena_alloc (&this->names, len + 1);
 
     if (p == NULL)
         return STRQUEUE_ENULL;
@@ -55,7 +59,7 @@ strvec_pushb (strvec_t *this, const char *str, size_t len)
 void
 strvec_popb (strvec_t *this)
 {
-    free (this->ptr[--this->siz]);
+    --this->siz;
 
     if (this->cap >= this->siz << 1)
         shrink (this)
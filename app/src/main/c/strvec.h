@@ -5,10 +5,14 @@
 
 #include <stddef.h>
 
+#include "arena.h"
+
+/** the strings live in `names`, a few allocations for a whole directory */
 typedef struct strvec_struct {
     size_t cap;
     size_t siz;
     char *_Nullable *_Nullable ptr;
+    struct arena_t names;
 } strvec_t;
 
 #define STRQUEUE_OK    0
@@ -23,6 +27,7 @@ extern void strvec_deinit (strvec_t *_Nonnull this);
 extern int strvec_pushb (strvec_t *_Nonnull this, const char *_Nonnull str,
                          size_t len);
 
+/** the string's memory is only given back by `strvec_deinit` */
 extern void strvec_popb (strvec_t *_Nonnull this);
 
 /**
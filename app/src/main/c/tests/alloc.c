@@ -0,0 +1,56 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * counts heap allocations, for tests that check a loop makes none. the
+ * test binary's own `malloc` family stands in for glibc's, which it calls
+ * through, so every allocation in the process is counted, libc's own
+ * included.
+ */
+
+extern void *__libc_malloc (size_t siz);
+extern void *__libc_calloc (size_t n, size_t siz);
+extern void *__libc_realloc (void *p, size_t siz);
+extern void  __libc_free (void *p);
+
+/** allocations and frees since the start, any thread */
+_Atomic uint64_t alloc_count = 0;
+_Atomic uint64_t alloc_frees = 0;
+
+void *
+malloc (size_t siz)
+{
+    atomic_fetch_add_explicit (&alloc_count, 1, memory_order_relaxed);
+    return __libc_malloc (siz);
+}
+
+void *
+calloc (size_t n, size_t siz)
+{
+    atomic_fetch_add_explicit (&alloc_count, 1, memory_order_relaxed);
+    return __libc_calloc (n, siz);
+}
+
+void *
+realloc (void *p, size_t siz)
+{
+    atomic_fetch_add_explicit (&alloc_count, 1, memory_order_relaxed);
+    return __libc_realloc (p, siz);
+}
+
+void
+free (void *p)
+{
+    if (p != NULL)
+        atomic_fetch_add_explicit (&alloc_frees, 1, memory_order_relaxed);
+
+    __libc_free (p);
+}
+
+/** @return allocations and frees since the start */
+static inline uint64_t
+alloc_calls (void)
+{
+    return atomic_load (&alloc_count) + atomic_load (&alloc_frees);
+}
@@ -0,0 +1,52 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/** total ns of the last `bench` run */
+double bench_ns = 0;
+
+/** ns per unit of the last `bench` run */
+double bench_ns_per = 0;
+
+/** failed `bench_check`s */
+size_t bench_fails = 0;
+
+/** failed `bench_check`s */
+static inline uint64_t
+bench_now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/** keeps the optimizer from dropping the computation of `p` */
+#define bench_keep(p) __asm__ volatile ("" : : "g"(p) : "memory")
+
+/**
+ * runs `body` `iters` times and reports the time per unit, where one
+ * iteration is `units` units of work (samples, frames, ...). memory is
+ * clobbered between iterations so loop-invariant calls are not hoisted.
+ */
+#define bench(name, iters, units, body)                                       \
+    do {                                                                      \
+        const uint64_t t0_ = bench_now_ns ();                                 \
+        for (size_t it_ = 0; it_ < (size_t)(iters); ++it_) {                  \
+            __asm__ volatile ("" : : : "memory");                             \
+            body;                                                             \
+        }                                                                     \
+        bench_ns     = bench_now_ns () - t0_;                                 \
+        bench_ns_per = bench_ns / ((double)(iters) * (units));                \
+        printf ("%-44s %10.3f ns/unit %10.1f ms\n", name, bench_ns_per,       \
+                bench_ns / 1e6);                                              \
+    } while (0)
+
+/** fails the bench run when `cond` does not hold, like `assert_nonfatal` */
+#define bench_check(cond, msg)                                                \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fputs ("Budget check failed:\t" msg "\n", stderr);                \
+            bench_fails++;                                                    \
+        }                                                                     \
+    } while (0)
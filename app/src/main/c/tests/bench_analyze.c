@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+// each module has its own `FILENAME`, for logging on Android alone
+#define FILENAME FILENAME_analyze __attribute__ ((unused))
+#include "../analyze.c"
+#undef FILENAME
+#include "../spscq.c"
+
+#define FILENAME FILENAME_trackdb __attribute__ ((unused))
+#include "../trackdb.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_thrctl __attribute__ ((unused))
+#include "../thrctl.c"
+#undef FILENAME
+
+/** does nothing, so threaded runs measure the handoff alone */
+static void
+noop_init (void *state, uint32_t sample_rate, uint32_t channels)
+{
+    (void)state;
+    (void)sample_rate;
+    (void)channels;
+}
+
+static void
+noop_process (void *state, const float *buf, size_t nframes)
+{
+    (void)state;
+    (void)buf;
+    (void)nframes;
+}
+
+static uint16_t
+noop_finalize (void *state, void *res)
+{
+    (void)state;
+    (void)res;
+    return 0;
+}
+
+static const struct analyzer_t analyzer_noop = {
+    .name      = "noop",
+    .tag       = TRACKDB_TAG ('N', 'O', 'O', 'P'),
+    .ver       = 1,
+    .state_siz = 1,
+    .init      = noop_init,
+    .process   = noop_process,
+    .finalize  = noop_finalize,
+};
+
+#define BLK   1024
+#define NBLKS 470 // about 10 s of 48 kHz
+#define ITERS 20
+
+static double
+track (const struct analyzer_t *const *an, size_t n, bool threaded,
+       const void *buf, int fmt, const char *name)
+{
+    struct analyze_t a;
+    uint64_t         key = 0;
+
+    bench (name, ITERS, NBLKS * BLK, {
+        analyze_begin (&a, ++key, an, n, 48000, 2, threaded);
+
+        for (size_t b = 0; b < NBLKS; ++b)
+            analyze_feed (&a, buf, fmt, BLK);
+
+        analyze_end (&a, key, false);
+    });
+
+    return bench_ns_per;
+}
+
+int
+main (void)
+{
+    static int16_t s16[BLK * 2];
+    static float   flt[BLK * 2];
+
+    for (size_t i = 0; i < BLK * 2; ++i)
+        flt[i] = (s16[i] = (int16_t)(i * 2654435761u >> 16)) / 32768.0f;
+
+    trackdb_init ("build/bench_analyze.trackdb");
+
+    const struct analyzer_t *several[] = { &analyzer_peak, &analyzer_rms,
+                                           &analyzer_peak, &analyzer_rms };
+
+    const double none = track (several, 0, false, s16, 1, "0 analyzers, s16");
+    track (several, 1, false, s16, 1, "1 analyzer, s16");
+    const double four = track (several, 4, false, s16, 1, "4 analyzers, s16");
+    track (several, 4, false, flt, 3, "4 analyzers, float (in place)");
+    track (several, 0, true, s16, 1, "0 analyzers, s16, threaded");
+    track (several, 1, true, s16, 1, "1 analyzer, s16, threaded");
+    track (several, 4, true, s16, 1, "4 analyzers, s16, threaded");
+
+    const struct analyzer_t *noop[] = { &analyzer_noop };
+    const double             handoff
+        = track (noop, 1, true, s16, 1, "handoff only (noop, threaded)");
+
+    trackdb_deinit ();
+
+    // per second of 48 kHz stereo
+    printf ("\n4 analyzers inline:\t%.1f us per second of audio\n",
+            four * 48000 / 1e3);
+    printf ("threaded handoff:\t%.1f us per second of audio on decode\n",
+            handoff * 48000 / 1e3);
+
+    bench_check (none < 1, "no analyzers should cost next to nothing");
+    bench_check (four * 48000 < 2e6, "4 analyzers should cost < 0.2% of a core");
+
+    return bench_fails != 0;
+}
@@ -0,0 +1,218 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.c"
+
+#include "../arena.c"
+#include "../bufctl.c"
+#include "../chmix.c"
+#include "../dither.c"
+#include "../eq.c"
+#include "../gain.c"
+#include "../playctl.c"
+#include "../ring.c"
+#include "../stretch.c"
+#include "../timing.c"
+
+// each module has its own `FILENAME`, for logging on Android alone
+#define FILENAME FILENAME_audio __attribute__ ((unused))
+#include "../audio.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_sink_host __attribute__ ((unused))
+#include "../sink_host.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_trackdb __attribute__ ((unused))
+#include "../trackdb.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_config __attribute__ ((unused))
+#include "../algs.c"
+#include "../config.c"
+#undef FILENAME
+
+/**
+ * the whole playback engine on the host sinks, with a pipeline that copies
+ * out of memory: per-frame cost of a track through the null sink in each
+ * format, then feeder CPU for a second of audio on the paced sink, which
+ * consumes in real time like a device, then launch to resumed audio: the
+ * saved position read back and a stream opened and started from it, then a
+ * device going away to audio on the next. the seek and the first decode
+ * are libav's and only show in the device log.
+ */
+
+#define TRACK  (48000 * 4) // frames
+#define PACED  48000
+#define ITERS  10
+
+/** launch to resumed audio, the engine's part, in ms */
+#define RESUME_BUDGET_MS 20
+
+static uint8_t src[TRACK * 2 * 4];
+static size_t  src_frames;
+static size_t  src_pos;
+
+size_t
+pipeline_read (struct pipeline_t *pl, void *buf, size_t nframes)
+{
+    if (nframes > src_frames - src_pos)
+        nframes = src_frames - src_pos;
+
+    memcpy (buf, src + src_pos * pl->blk, nframes * pl->blk);
+    src_pos += nframes;
+
+    return nframes;
+}
+
+uint64_t
+pipeline_pos (const struct pipeline_t *pl, uint64_t back)
+{
+    return pl->start + (src_pos > back ? src_pos - back : 0);
+}
+
+int
+pipeline_seek (struct pipeline_t *pl, uint64_t frame)
+{
+    (void)pl;
+
+    src_pos = frame < src_frames ? frame : src_frames;
+
+    return NCAP_OK;
+}
+
+void
+render_sync_playback_button (void)
+{
+}
+
+static void
+play (struct pipeline_t *pl, size_t nframes)
+{
+    src_frames = nframes;
+    src_pos    = 0;
+    audio_play (pl, 0);
+}
+
+int
+main (void)
+{
+    struct pipeline_t pl = { .channels = 2, .sample_rate = 48000 };
+    const char *const names[] = { "s16", "s32", "flt" };
+    char              name[64];
+
+    for (size_t i = 0; i < sizeof src / 2; ++i)
+        ((int16_t *)src)[i] = (int16_t)(i * 331);
+
+    ncap_config.volume          = 70;
+    ncap_config.aaudio_optimize = 1;
+
+    audio_init ();
+    audio_resume ();
+    audio_set_sink (&sink_null, NULL);
+
+    double s16_ns = 0;
+
+    for (int f = 0; f < 3; ++f) {
+        pl.fmt   = f + 1;
+        pl.width = f ? 4 : 2;
+        pl.blk   = pl.width * pl.channels;
+
+        // float samples from the integer pattern are denormal-free
+        if (f == 2)
+            for (size_t i = 0; i < sizeof src / 4; ++i)
+                ((float *)src)[i] = (int16_t)(i * 331) / 32768.0f;
+
+        snprintf (name, sizeof name, "engine %s, null sink", names[f]);
+        bench (name, ITERS, TRACK, play (&pl, TRACK));
+
+        if (f == 0)
+            s16_ns = bench_ns_per;
+    }
+
+    audio_deinit ();
+
+    // the paced sink runs in real time: one second of audio
+    pl.fmt   = 1;
+    pl.width = 2;
+    pl.blk   = 4;
+    audio_set_sink (&sink_paced, NULL);
+
+    const uint64_t t0 = now_ns (CLOCK_THREAD_CPUTIME_ID);
+    play (&pl, PACED);
+    const double cpu_ms = (now_ns (CLOCK_THREAD_CPUTIME_ID) - t0) / 1e6;
+    const int    xruns  = out.sink.ops->xruns (&out.sink);
+
+    audio_deinit ();
+
+    // the device goes away every 100 ms of a second of audio
+    audio_set_sink (&sink_paced, "disc=100");
+    play (&pl, PACED);
+
+    const uint64_t nrecover   = out.nrecover;
+    const double   recover_ms = out.recover_ns / 1e6;
+
+    audio_deinit ();
+
+    // a restart: the position saved by the last run, played on from
+    const char *const cfgfn = "build/bench_audio.cfg";
+
+    ncap_config.version        = NCAP_CONFIG_VERSION;
+    ncap_config.track_path     = "";
+    ncap_config.track_path_len = 1;
+
+    remove (cfgfn);
+    config_init (cfgfn);
+    config_write ();
+    config_write_pos (1, 48000 * 60);
+
+    double resume_ms = 0;
+
+    for (int i = 0; i < ITERS; ++i) {
+        audio_init ();
+        audio_resume ();
+
+        if (config_read () != CONFIG_OK)
+            break;
+
+        pl.key   = ncap_config.cur_key;
+        pl.start = ncap_config.cur_frame;
+        play (&pl, 4800);
+        resume_ms += out.resume_ns / 1e6 / ITERS;
+
+        audio_deinit ();
+        config_write_pos (1, 48000 * 60);
+    }
+
+    config_deinit ();
+    remove (cfgfn);
+
+    printf ("\nengine s16: %.2f ns/frame, %.3f%% of a core at 48 kHz\n",
+            s16_ns, s16_ns * 48000 / 1e7);
+    printf ("paced sink, 1 s in %s mode: feeder cpu %.2f ms, %d xruns\n",
+            NCAP_AUDIO_CALLBACK ? "callback" : "write", cpu_ms, xruns);
+
+    bench_check (s16_ns < 50, "the engine should stay under 50 ns/frame");
+    bench_check (xruns == 0, "the paced sink should not underrun");
+
+    printf ("launch to resumed audio on the paced sink: %.2f ms, budget %d "
+            "ms\n",
+            resume_ms, RESUME_BUDGET_MS);
+
+    bench_check (resume_ms > 0 && resume_ms < RESUME_BUDGET_MS,
+                 "resuming after a restart should stay in budget");
+
+    printf ("lost device to audio on the next, paced sink: %.2f ms over "
+            "%" PRIu64 " reopens, target %d ms\n",
+            recover_ms, nrecover, NCAP_AUDIO_RECOVER_MS);
+
+    bench_check (nrecover > 0 && recover_ms > 0
+                     && recover_ms < NCAP_AUDIO_RECOVER_MS,
+                 "a reopen should be audible within NCAP_AUDIO_RECOVER_MS");
+
+    return bench_fails != 0;
+}
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+#include "../chmix.c"
+
+#define FRAMES 192 // one burst
+#define ITERS  20000
+
+/**
+ * a burst through each specialized shape, 2->2 balanced and folded to mono,
+ * 6->2 and 8->2, in each format and on the float and the fixed path,
+ * against `CHMIX_BUDGET_NS`, and the scalar kernel on the same shapes for
+ * the vector ones to beat. only this build's path is held to the budget.
+ * the mix is in place, so each burst mixes a fresh copy of the input.
+ */
+int
+main (void)
+{
+    static int16_t s16[FRAMES * CHMIX_MAX_IN], w16[FRAMES * CHMIX_MAX_IN];
+    static int32_t s32[FRAMES * CHMIX_MAX_IN], w32[FRAMES * CHMIX_MAX_IN];
+    static float   flt[FRAMES * CHMIX_MAX_IN], wflt[FRAMES * CHMIX_MAX_IN];
+    static float   out[FRAMES * CHMIX_MAX_OUT];
+
+    for (int i = 0; i < FRAMES * CHMIX_MAX_IN; ++i) {
+        s16[i] = (int16_t)(i * 331) / 4;
+        s32[i] = s16[i] * 65536;
+        flt[i] = s16[i] / 32768.0f;
+    }
+
+    const char *const names[] = { "s16", "s32", "flt" };
+    const void *const srcs[]  = { s16, s32, flt };
+    void *const       bufs[]  = { w16, w32, wflt };
+    const size_t      width[] = { 2, 4, 4 };
+
+    void (*const paths[]) (struct chmix_t *, void *, int, size_t)
+        = { mix_blocks_flt, mix_blocks_fixed };
+    const char *const path_names[] = { "float", "fixed" };
+
+    const struct {
+        const char *name;
+        uint32_t    in;
+        bool        mono;
+        int8_t      balance;
+    } shapes[] = {
+        { "2->2, balance 30", 2, false, 30 },
+        { "2->2, mono", 2, true, 0 },
+        { "6->2", 6, false, 0 },
+        { "8->2", 8, false, 0 },
+    };
+
+    const size_t nshapes = sizeof shapes / sizeof *shapes;
+    double       burst_ns[sizeof shapes / sizeof *shapes][2][3];
+    double       any_ns[sizeof shapes / sizeof *shapes];
+    char         name[64];
+
+    for (size_t s = 0; s < nshapes; ++s) {
+        struct chmix_t mx;
+        const size_t   n = FRAMES * shapes[s].in;
+
+        chmix_init (&mx, shapes[s].in, 0);
+        chmix_set (&mx, shapes[s].mono, shapes[s].balance);
+
+        for (int p = 0; p < 2; ++p)
+            for (int f = 0; f < 3; ++f) {
+                snprintf (name, sizeof name, "chmix %s %s %s", shapes[s].name,
+                          path_names[p], names[f]);
+                bench (name, ITERS, FRAMES, {
+                    memcpy (bufs[f], srcs[f], n * width[f]);
+                    paths[p](&mx, bufs[f], f + 1, FRAMES);
+                });
+                burst_ns[s][p][f] = bench_ns_per * FRAMES;
+            }
+
+        snprintf (name, sizeof name, "mix_any %s flt", shapes[s].name);
+        bench (name, ITERS, FRAMES, mix_any (&mx, flt, out, FRAMES));
+        any_ns[s] = bench_ns_per * FRAMES;
+    }
+
+    bench_keep (w16);
+    bench_keep (w32);
+    bench_keep (wflt);
+    bench_keep (out);
+
+    printf ("\nper %d-frame burst, budget %.1f us\n", FRAMES,
+            CHMIX_BUDGET_NS / 1e3);
+
+    for (size_t s = 0; s < nshapes; ++s) {
+        for (int p = 0; p < 2; ++p)
+            printf ("  %-16s %s%s: s16 %.2f us, s32 %.2f us, flt %.2f us\n",
+                    shapes[s].name, path_names[p],
+                    p == NCAP_DSP_FIXED ? " (this build's)" : "",
+                    burst_ns[s][p][0] / 1e3, burst_ns[s][p][1] / 1e3,
+                    burst_ns[s][p][2] / 1e3);
+        printf ("  %-16s scalar flt %.2f us\n", shapes[s].name,
+                any_ns[s] / 1e3);
+    }
+
+    for (size_t s = 0; s < nshapes; ++s)
+        for (int f = 0; f < 3; ++f)
+            bench_check (burst_ns[s][NCAP_DSP_FIXED][f] < CHMIX_BUDGET_NS,
+                         "a burst through the mix should stay in budget");
+
+    return bench_fails != 0;
+}
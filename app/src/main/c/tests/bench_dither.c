@@ -0,0 +1,97 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+#include "../dither.c"
+
+#define FRAMES 192 // one burst
+#define CH     2
+#define ITERS  20000
+
+/**
+ * plain conversion to S16, the baseline: scaled, rounded and saturated
+ * without dither, a sample at a time as the other integer paths do
+ */
+static void
+plain (int16_t *dst, const void *src, int fmt, size_t n)
+{
+    const float scl = fmt == 2 ? 1 / 65536.0f : 32768.0f;
+
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = quant_s16 (
+            (fmt == 2 ? (float)((const int32_t *)src)[i]
+                      : ((const float *)src)[i])
+            * scl);
+}
+
+/**
+ * a stereo burst of S32 and float reduced to S16: plain, with TPDF dither
+ * and noise shaped, per sample against the plain conversion and per burst
+ * against `DITHER_BUDGET_NS`. the conversion is in place, so each burst
+ * converts a fresh copy of the input.
+ */
+int
+main (void)
+{
+    static int32_t s32[FRAMES * CH], w32[FRAMES * CH];
+    static float   flt[FRAMES * CH], wflt[FRAMES * CH];
+    static int16_t w16[FRAMES * CH];
+
+    for (int i = 0; i < FRAMES * CH; ++i) {
+        s32[i] = (int16_t)(i * 331) * 65536;
+        flt[i] = (int16_t)(i * 331) / 32768.0f;
+    }
+
+    const char *const names[] = { "s32", "flt" };
+    const void *const srcs[]  = { s32, flt };
+    void *const       bufs[]  = { w32, wflt };
+    const char *const modes[] = { "plain", "tpdf", "shaped" };
+    double            sample_ns[2][3];
+    char              name[64];
+
+    for (int f = 0; f < 2; ++f) {
+        snprintf (name, sizeof name, "%s to s16, plain", names[f]);
+        bench (name, ITERS, FRAMES * CH, {
+            memcpy (bufs[f], srcs[f], sizeof s32);
+            plain (w16, bufs[f], f + 2, FRAMES * CH);
+        });
+        sample_ns[f][0] = bench_ns_per;
+
+        for (int m = DITHER_TPDF; m <= DITHER_SHAPED; ++m) {
+            struct dither_t dt;
+
+            dither_init (&dt, f + 2, CH, m);
+            snprintf (name, sizeof name, "%s to s16, %s", names[f],
+                      modes[m]);
+            bench (name, ITERS, FRAMES * CH, {
+                memcpy (bufs[f], srcs[f], sizeof s32);
+                dither_apply (&dt, bufs[f], bufs[f], FRAMES);
+            });
+            sample_ns[f][m] = bench_ns_per;
+        }
+    }
+
+    bench_keep (w16);
+    bench_keep (w32);
+    bench_keep (wflt);
+
+    printf ("\nper sample, and per stereo %d-frame burst against a budget "
+            "of %.1f us\n",
+            FRAMES, DITHER_BUDGET_NS / 1e3);
+
+    for (int f = 0; f < 2; ++f)
+        for (int m = 0; m < 3; ++m)
+            printf ("  %s %-6s %.2f ns, %.2fx plain, %.2f us a burst\n",
+                    names[f], modes[m], sample_ns[f][m],
+                    sample_ns[f][m] / sample_ns[f][0],
+                    sample_ns[f][m] * FRAMES * CH / 1e3);
+
+    for (int f = 0; f < 2; ++f)
+        for (int m = DITHER_TPDF; m <= DITHER_SHAPED; ++m)
+            bench_check (sample_ns[f][m] * FRAMES * CH < DITHER_BUDGET_NS,
+                         "a dithered burst should stay in budget");
+
+    return bench_fails != 0;
+}
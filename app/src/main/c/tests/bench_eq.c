@@ -0,0 +1,109 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+#include "../eq.c"
+
+#define FRAMES 192 // one burst
+#define CH     2
+#define ITERS  20000
+
+/**
+ * a burst through all `EQ_MAX_BANDS` bands, in each format and on both the
+ * float and the fixed path, against `EQ_BUDGET_NS`. each burst filters a
+ * fresh copy of the input, since filtering the output again and again
+ * decays float samples into denormals; the filter state carries over as in
+ * playback.
+ */
+int
+main (void)
+{
+    static int16_t s16[FRAMES * CH], w16[FRAMES * CH];
+    static int32_t s32[FRAMES * CH], w32[FRAMES * CH];
+    static float   flt[FRAMES * CH], wflt[FRAMES * CH];
+
+    for (int i = 0; i < FRAMES * CH; ++i) {
+        s16[i] = (int16_t)(i * 331) / 4;
+        s32[i] = s16[i] * 65536;
+        flt[i] = s16[i] / 32768.0f;
+    }
+
+    struct eq_band_t bands[EQ_MAX_BANDS];
+
+    // octave bands from 31 Hz, alternating boosts and cuts
+    for (int k = 0; k < EQ_MAX_BANDS; ++k)
+        bands[k] = (struct eq_band_t){ .type = EQ_PEAK,
+                                       .gain = k % 2 ? -30 : 30,
+                                       .freq = 31 << k,
+                                       .q    = 141 };
+
+    bands[0].type = EQ_LOSHELF;
+    bands[9].type = EQ_HISHELF;
+
+    struct eq_t eq;
+    eq_init (&eq, CH, 48000);
+    eq_set (&eq, bands, EQ_MAX_BANDS, -60);
+
+    const char *const names[] = { "s16", "s32", "flt" };
+    const void *const srcs[]  = { s16, s32, flt };
+    void *const       bufs[]  = { w16, w32, wflt };
+    const size_t      width[] = { 2, 4, 4 };
+    double            burst_ns[2][3];
+    char              name[64];
+
+    // the first bursts glide in from flat
+    bench ("eq_apply s16, 10 bands, gliding", 1, FRAMES, {
+        memcpy (w16, s16, sizeof s16);
+        eq_apply (&eq, w16, 1, FRAMES);
+    });
+
+    for (int i = 0; i < 100; ++i) {
+        memcpy (w16, s16, sizeof s16);
+        eq_apply (&eq, w16, 1, FRAMES);
+    }
+
+    void (*const paths[]) (struct eq_t *, void *, int, size_t)
+        = { apply_flt, apply_fixed };
+    const char *const path_names[] = { "float", "fixed" };
+
+    for (int p = 0; p < 2; ++p)
+        for (int f = 0; f < 3; ++f) {
+            snprintf (name, sizeof name, "%s %s, 10 bands", path_names[p],
+                      names[f]);
+            bench (name, ITERS, FRAMES, {
+                memcpy (bufs[f], srcs[f], FRAMES * CH * width[f]);
+                paths[p](&eq, bufs[f], f + 1, FRAMES);
+            });
+            burst_ns[p][f] = bench_ns_per * FRAMES;
+        }
+
+    eq_set (&eq, NULL, 0, 0);
+
+    for (int i = 0; i < 100; ++i)
+        eq_apply (&eq, w16, 1, FRAMES);
+
+    bench ("eq_apply s16, bypassed", ITERS, FRAMES,
+           eq_apply (&eq, w16, 1, FRAMES));
+
+    bench_keep (w16);
+    bench_keep (w32);
+    bench_keep (wflt);
+
+    printf ("\nper %d-frame burst, budget %.1f us\n", FRAMES,
+            EQ_BUDGET_NS / 1e3);
+
+    for (int p = 0; p < 2; ++p)
+        printf ("  %s: s16 %.1f us, s32 %.1f us, flt %.1f us%s\n",
+                path_names[p], burst_ns[p][0] / 1e3, burst_ns[p][1] / 1e3,
+                burst_ns[p][2] / 1e3,
+                p == NCAP_DSP_FIXED ? " (this build's)" : "");
+
+    // only the path this ABI builds has to fit
+    for (int f = 0; f < 3; ++f)
+        bench_check (burst_ns[NCAP_DSP_FIXED][f] < EQ_BUDGET_NS,
+                     "a burst through all bands should stay in budget");
+
+    return bench_fails != 0;
+}
@@ -0,0 +1,112 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+#include "../gain.c"
+
+#define FRAMES 192 // one burst
+#define CH     2
+#define ITERS  200000
+
+static pthread_mutex_t config_mx = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t         volume    = 70;
+
+/**
+ * the gain stage this replaces: a `config_get`, `powf` every burst and a
+ * format switch per sample, with WAV format codes in place of AAudio's
+ */
+static void
+sclbuf (char *buf, int fmt, size_t width, size_t len, uint8_t svol)
+{
+    uint8_t vol;
+    pthread_mutex_lock (&config_mx);
+    vol = volume;
+    pthread_mutex_unlock (&config_mx);
+
+    const float scl = powf ((vol * svol) / 10000.0f, 0.67f);
+
+    for (; len--; buf += width) {
+        switch (fmt) {
+            case 1:
+                *(int16_t *)buf *= scl;
+                break;
+            case 2:
+                *(int32_t *)buf *= scl;
+                break;
+            case 3:
+                *(float *)buf *= scl;
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+int
+main (void)
+{
+    static int16_t s16[FRAMES * CH], w16[FRAMES * CH];
+    static int32_t s32[FRAMES * CH], w32[FRAMES * CH];
+    static float   flt[FRAMES * CH], wflt[FRAMES * CH];
+
+    for (int i = 0; i < FRAMES * CH; ++i) {
+        s16[i] = (int16_t)(i * 331);
+        s32[i] = (int32_t)((uint32_t)i * 21170639u);
+        flt[i] = s16[i] / 32768.0f;
+    }
+
+    struct gain_t g;
+    gain_init (&g);
+    gain_set (&g, volume, 90);
+
+    // both scale in place, so each burst starts from a fresh copy;
+    // repeated scaling would otherwise decay float samples into denormals
+    const char *const names[] = { "s16", "s32", "flt" };
+    const void *const srcs[]  = { s16, s32, flt };
+    void *const       bufs[]  = { w16, w32, wflt };
+    const size_t      width[] = { 2, 4, 4 };
+    double            speedup[3];
+    char              name[64];
+
+    for (int f = 0; f < 3; ++f) {
+        snprintf (name, sizeof name, "sclbuf %s", names[f]);
+        bench (name, ITERS, FRAMES, {
+            memcpy (bufs[f], srcs[f], FRAMES * CH * width[f]);
+            sclbuf (bufs[f], f + 1, width[f], FRAMES * CH, 90);
+        });
+        const double old_ns = bench_ns_per;
+
+        snprintf (name, sizeof name, "gain_apply %s", names[f]);
+        bench (name, ITERS, FRAMES, {
+            memcpy (bufs[f], srcs[f], FRAMES * CH * width[f]);
+            gain_apply (&g, bufs[f], bufs[f], f + 1, FRAMES, CH);
+        });
+        speedup[f] = old_ns / bench_ns_per;
+    }
+
+    // a burst right after a volume change
+    bench ("gain_apply s16, ramping", ITERS, FRAMES, {
+        g.cur = 0.5f;
+        gain_apply (&g, w16, s16, 1, FRAMES, CH);
+    });
+
+    gain_set (&g, 100, 100);
+    g.cur = g.target;
+    bench ("gain_apply s16, unity (copy)", ITERS, FRAMES,
+           gain_apply (&g, w16, s16, 1, FRAMES, CH));
+
+    bench_keep (w16);
+    bench_keep (w32);
+    bench_keep (wflt);
+
+    printf ("\nspeedup over sclbuf: s16 %.1fx, s32 %.1fx, flt %.1fx\n",
+            speedup[0], speedup[1], speedup[2]);
+
+    for (int f = 0; f < 3; ++f)
+        bench_check (speedup[f] > 1, "gain_apply should beat sclbuf");
+
+    return bench_fails != 0;
+}
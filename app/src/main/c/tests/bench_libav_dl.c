@@ -0,0 +1,122 @@
+#include <dlfcn.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "bench.c"
+
+/**
+ * cold start against `NCAP_LAZY_LIBAV`. an OFF build links libav, so the
+ * dynamic loader maps and binds it before `main`; a child started with the
+ * libraries preloaded stands in for it. an ON build starts without them
+ * and pays the `dlopen`s of `libav_load` on the first decode instead,
+ * which a child doing only those takes. every child is a new process with
+ * immediate binding, as on Android, and the files are in the page cache
+ * after the first run, so these are warm-cache numbers.
+ *
+ * libav is not on most hosts: `NCAP_BENCH_LIBS` names other libraries to
+ * stand in for it, space separated and in dependency order.
+ */
+
+#define RUNS 40
+
+static const char *const LIBS_DEF
+    = "libavutil.so libavcodec.so libavformat.so";
+
+/** in the child: opens `libs` as `libav_load` does */
+static int
+load (const char *libs)
+{
+    char  buf[1024];
+    char *save;
+
+    snprintf (buf, sizeof buf, "%s", libs);
+
+    for (char *lib = strtok_r (buf, " ", &save); lib != NULL;
+         lib       = strtok_r (NULL, " ", &save))
+        if (dlopen (lib, RTLD_NOW | RTLD_LOCAL) == NULL)
+            return 1;
+
+    return 0;
+}
+
+/**
+ * @return median ns from spawning this binary as `mode` to its exit, with
+ * `preload` loaded before `main` unless it is NULL
+ */
+static double
+spawn_ns (const char *self, const char *mode, const char *libs,
+          const char *preload)
+{
+    char  env_libs[1024], env_pre[1024];
+    char *argv[] = { (char *)self, (char *)mode, NULL };
+    char *envp[] = { "LD_BIND_NOW=1", env_libs, env_pre, NULL };
+    static uint64_t ns[RUNS];
+
+    snprintf (env_libs, sizeof env_libs, "NCAP_BENCH_LIBS=%s", libs);
+    snprintf (env_pre, sizeof env_pre, "LD_PRELOAD=%s",
+              preload != NULL ? preload : "");
+
+    for (size_t i = 0; i < RUNS; ++i) {
+        const uint64_t t0 = bench_now_ns ();
+        pid_t          pid;
+        int            status;
+
+        if (posix_spawn (&pid, self, NULL, NULL, argv, envp) != 0
+            || waitpid (pid, &status, 0) != pid || status != 0)
+            return -1;
+
+        ns[i] = bench_now_ns () - t0;
+    }
+
+    // insertion sort, for the median
+    for (size_t i = 1; i < RUNS; ++i)
+        for (size_t j = i; j > 0 && ns[j - 1] > ns[j]; --j) {
+            const uint64_t t = ns[j];
+            ns[j]            = ns[j - 1];
+            ns[j - 1]        = t;
+        }
+
+    return ns[RUNS / 2];
+}
+
+int
+main (int argc, char **argv)
+{
+    const char *libs = getenv ("NCAP_BENCH_LIBS");
+
+    if (libs == NULL || *libs == '\0')
+        libs = LIBS_DEF;
+
+    if (argc > 1)
+        return strcmp (argv[1], "load") == 0 ? load (libs) : 0;
+
+    // first run warms the page cache, and checks the libraries are there
+    if (spawn_ns (argv[0], "load", libs, NULL) < 0) {
+        printf ("could not load `%s'. set NCAP_BENCH_LIBS. skipping\n",
+                libs);
+        return 0;
+    }
+
+    const double lazy  = spawn_ns (argv[0], "main", libs, NULL);
+    const double eager = spawn_ns (argv[0], "main", libs, libs);
+    const double first = spawn_ns (argv[0], "load", libs, NULL) - lazy;
+
+    printf ("libraries: %s\n", libs);
+    printf ("%-44s %10.3f ms\n", "start to main, lazy (NCAP_LAZY_LIBAV=1)",
+            lazy / 1e6);
+    printf ("%-44s %10.3f ms\n", "start to main, eager (NCAP_LAZY_LIBAV=0)",
+            eager / 1e6);
+    printf ("%-44s %10.3f ms\n", "libav_load on the first decode, lazy",
+            first / 1e6);
+    printf ("\ncold start: %.2f ms saved, %.2f ms moved to the first "
+            "decode\n",
+            (eager - lazy) / 1e6, first / 1e6);
+
+    bench_check (lazy > 0 && lazy < eager,
+                 "a lazy build should reach main sooner");
+
+    return bench_fails != 0;
+}
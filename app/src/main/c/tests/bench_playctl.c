@@ -0,0 +1,149 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bench.c"
+
+#include "../playctl.c"
+
+/**
+ * per-burst cost of the playback checks: the old interrupt lock, pause lock
+ * and window close trylock against one load of the control word. the
+ * contended runs have a render thread polling the same state every frame,
+ * as render.c does, at a much higher rate than real to make it show.
+ */
+
+#define ITERS 2000000
+
+static pthread_mutex_t int_mx    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t play_mx   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t wclose_mx = PTHREAD_MUTEX_INITIALIZER;
+static bool            isint;
+static bool            isplay = true;
+static bool            wclose;
+
+static struct playctl_t ctl;
+
+/** the control word sharing a line with a render-thread counter */
+static struct {
+    alignas (64) _Atomic uint32_t word;
+    _Atomic uint64_t frames;
+} shared;
+
+static atomic_bool stop;
+static int         mode;
+
+/** the three lock round trips the write loop used to make */
+static inline bool
+check_locks (void)
+{
+    bool run = true;
+
+    pthread_mutex_lock (&int_mx);
+    run &= !isint;
+    pthread_mutex_unlock (&int_mx);
+
+    pthread_mutex_lock (&play_mx);
+    run &= isplay;
+    pthread_mutex_unlock (&play_mx);
+
+    if (pthread_mutex_trylock (&wclose_mx) == 0) {
+        run &= !wclose;
+        pthread_mutex_unlock (&wclose_mx);
+    }
+
+    return run;
+}
+
+static void *
+render (void *arg)
+{
+    (void)arg;
+
+    static _Atomic uint64_t frames; // on its own line, away from `ctl`
+
+    while (!atomic_load_explicit (&stop, memory_order_relaxed)) {
+        switch (mode) {
+            case 0:
+                check_locks ();
+                break;
+            case 1:
+                bench_keep (playctl_get (&ctl));
+                atomic_fetch_add_explicit (&frames, 1, memory_order_relaxed);
+                break;
+            case 2:
+                atomic_fetch_add_explicit (&shared.frames, 1,
+                                           memory_order_relaxed);
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+static double
+contended (int m, const char *name)
+{
+    pthread_t tid;
+    size_t    n = 0;
+
+    mode = m;
+    atomic_store (&stop, false);
+    pthread_create (&tid, NULL, render, NULL);
+
+    switch (m) {
+        case 0:
+            bench (name, ITERS, 1, n += check_locks ());
+            break;
+        case 1:
+            bench (name, ITERS, 1, n += playctl_get (&ctl) == PLAYCTL_PLAY);
+            break;
+        case 2:
+            bench (name, ITERS, 1,
+                   n += atomic_load_explicit (&shared.word,
+                                              memory_order_acquire)
+                        == PLAYCTL_PLAY);
+            break;
+    }
+
+    atomic_store (&stop, true);
+    pthread_join (tid, NULL);
+    bench_keep (n);
+
+    return bench_ns_per;
+}
+
+int
+main (void)
+{
+    size_t n = 0;
+
+    playctl_init (&ctl, PLAYCTL_PLAY);
+    atomic_init (&shared.word, PLAYCTL_PLAY);
+
+    bench ("mutexes, uncontended", ITERS, 1, n += check_locks ());
+    const double locks_ns = bench_ns_per;
+
+    bench ("control word, uncontended", ITERS, 1,
+           n += playctl_get (&ctl) == PLAYCTL_PLAY);
+    const double word_ns = bench_ns_per;
+
+    bench_keep (n);
+
+    const double locks_c_ns = contended (0, "mutexes, render polling");
+    const double word_c_ns  = contended (1, "control word, render polling");
+    const double false_ns
+        = contended (2, "control word, shared line (false sharing)");
+
+    printf ("\nper burst: %.1f -> %.1f ns uncontended, %.1f -> %.1f ns "
+            "contended, %.1f ns if the line were shared\n",
+            locks_ns, word_ns, locks_c_ns, word_c_ns, false_ns);
+
+    bench_check (word_ns < locks_ns,
+                 "control word should be cheaper than the locks");
+    bench_check (word_c_ns < locks_c_ns,
+                 "control word should stay cheaper under contention");
+
+    return bench_fails != 0;
+}
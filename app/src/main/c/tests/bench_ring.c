@@ -0,0 +1,231 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.c"
+
+#include "../ring.c"
+
+/**
+ * the two output modes of aaudio_bind.c against a simulated device that
+ * takes one burst every burst period, in real time:
+ *
+ * write: the player blocks in a write into a device buffer two bursts deep,
+ * locking the control mutexes every burst like the write loop does.
+ *
+ * callback: the device pulls from a 100 ms ring; the player keeps it topped
+ * up and sleeps a quarter of it at a time when it is full.
+ *
+ * every `STALL_EVERY` bursts decode stalls for `STALL_MS`, longer than the
+ * write mode's buffer. xruns are bursts the device found short.
+ */
+
+#define RATE        48000
+#define BLK         4 // S16 stereo
+#define BURST       192
+#define BURST_NS    (BURST * 1000000000ull / RATE)
+#define DEV_BURSTS  2
+#define RING_MS     100
+#define SIM_BURSTS  500 // 2 s
+#define STALL_EVERY 100
+#define STALL_MS    12
+
+static pthread_mutex_t ctl_mx[3] = { PTHREAD_MUTEX_INITIALIZER,
+                                     PTHREAD_MUTEX_INITIALIZER,
+                                     PTHREAD_MUTEX_INITIALIZER };
+
+static pthread_mutex_t dev_mx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  dev_cv = PTHREAD_COND_INITIALIZER;
+static size_t          dev_fill; // bursts waiting in the device buffer
+
+static struct ring_t ring;
+static atomic_bool   done;
+static bool          cb_mode;
+
+static uint64_t xruns;
+static uint64_t player_wakeups;
+static uint64_t player_cpu_ns;
+static uint64_t device_cpu_ns;
+
+static inline uint64_t
+cpu_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+sleep_ns (uint64_t ns)
+{
+    const struct timespec ts
+        = { .tv_sec = ns / 1000000000ull, .tv_nsec = ns % 1000000000ull };
+    nanosleep (&ts, NULL);
+}
+
+/** stands in for decode and volume: touches every sample */
+static void
+produce (int16_t *buf, size_t i)
+{
+    if (i % STALL_EVERY == STALL_EVERY - 1)
+        sleep_ns (STALL_MS * 1000000ull);
+
+    for (size_t k = 0; k < BURST * 2; ++k)
+        buf[k] = (int16_t)((i + k) * 7) * 0.8f;
+}
+
+/** the per-burst interrupt, pause and volume checks */
+static void
+ctl (void)
+{
+    for (int m = 0; m < 3; ++m) {
+        pthread_mutex_lock (&ctl_mx[m]);
+        pthread_mutex_unlock (&ctl_mx[m]);
+    }
+}
+
+static void *
+device (void *arg)
+{
+    (void)arg;
+
+    static uint8_t  out[BURST * BLK];
+    const uint64_t  cpu0 = cpu_ns ();
+    struct timespec next;
+
+    clock_gettime (CLOCK_MONOTONIC, &next);
+
+    for (size_t i = 0; i < SIM_BURSTS; ++i) {
+        next.tv_nsec += BURST_NS;
+
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            ++next.tv_sec;
+        }
+
+        clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        if (cb_mode) {
+            // what data_cb does
+            if (ring_read (&ring, out, sizeof out) < sizeof out)
+                ++xruns;
+        } else {
+            pthread_mutex_lock (&dev_mx);
+
+            if (dev_fill == 0)
+                ++xruns;
+            else
+                --dev_fill;
+
+            pthread_cond_signal (&dev_cv);
+            pthread_mutex_unlock (&dev_mx);
+        }
+    }
+
+    atomic_store (&done, true);
+    pthread_cond_signal (&dev_cv);
+    device_cpu_ns = cpu_ns () - cpu0;
+
+    return NULL;
+}
+
+static void
+play_write (void)
+{
+    static int16_t buf[BURST * 2];
+
+    for (size_t i = 0; !atomic_load (&done); ++i) {
+        ctl ();
+        produce (buf, i);
+        bench_keep (buf);
+
+        pthread_mutex_lock (&dev_mx);
+
+        while (dev_fill == DEV_BURSTS && !atomic_load (&done)) {
+            pthread_cond_wait (&dev_cv, &dev_mx);
+            ++player_wakeups;
+        }
+
+        ++dev_fill;
+        pthread_mutex_unlock (&dev_mx);
+    }
+}
+
+static void
+play_callback (void)
+{
+    static int16_t buf[BURST * 2];
+
+    for (size_t i = 0; !atomic_load (&done);) {
+        ctl ();
+
+        if (ring_cap (&ring) - ring_used (&ring) < sizeof buf) {
+            sleep_ns (RING_MS * 1000000ull / 4);
+            ++player_wakeups;
+            continue;
+        }
+
+        produce (buf, i++);
+        ring_write (&ring, buf, sizeof buf);
+    }
+}
+
+static void
+run (bool cb, const char *name)
+{
+    static int16_t buf[BURST * 2];
+
+    cb_mode        = cb;
+    dev_fill       = DEV_BURSTS;
+    xruns          = 0;
+    player_wakeups = 0;
+    atomic_store (&done, false);
+    ring_reset (&ring);
+
+    // primed like audio_play does
+    while (cb && ring_cap (&ring) - ring_used (&ring) >= sizeof buf)
+        ring_write (&ring, buf, sizeof buf);
+
+    pthread_t      tid;
+    const uint64_t wall0 = bench_now_ns ();
+    const uint64_t cpu0  = cpu_ns ();
+
+    pthread_create (&tid, NULL, device, NULL);
+
+    if (cb)
+        play_callback ();
+    else
+        play_write ();
+
+    player_cpu_ns = cpu_ns () - cpu0;
+    pthread_join (tid, NULL);
+
+    const double secs = (bench_now_ns () - wall0) / 1e9;
+
+    printf ("%-10s player %7.1f us/s  device %6.1f us/s  wakeups %5.0f/s  "
+            "xruns %3llu\n",
+            name, player_cpu_ns / 1e3 / secs, device_cpu_ns / 1e3 / secs,
+            player_wakeups / secs, (unsigned long long)xruns);
+}
+
+int
+main (void)
+{
+    ring_init (&ring, RATE * RING_MS / 1000 * BLK);
+
+    run (false, "write");
+    const uint64_t write_wakeups = player_wakeups;
+
+    run (true, "callback");
+
+    bench_check (xruns == 0, "callback mode should ride out decode stalls");
+    bench_check (player_wakeups < write_wakeups,
+                 "callback mode should wake the player less often");
+
+    ring_deinit (&ring);
+
+    return bench_fails != 0;
+}
@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.c"
+
+#include "../silence.c"
+
+#define LEN   (1 << 16)
+#define ITERS 2000
+
+/** plain loop the kernels replace */
+static size_t
+first_s16_scalar (const int16_t *buf, size_t n, int16_t thr)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (buf[i] > thr || buf[i] < -thr)
+            return i;
+
+    return n;
+}
+
+int
+main (void)
+{
+    static int16_t s16[LEN];
+    static int32_t s32[LEN];
+    static float   flt[LEN];
+
+    // all silent: worst case, every sample is visited
+    size_t r = 0;
+
+    bench ("silence_first_s16 (scalar loop)", ITERS, LEN,
+           r += first_s16_scalar (s16, LEN, 8));
+    const double scalar_ns = bench_ns_per;
+
+    bench ("silence_first_s16", ITERS, LEN,
+           r += silence_first_s16 (s16, LEN, 8));
+    const double s16_ns = bench_ns_per;
+
+    bench ("silence_first_s32", ITERS, LEN,
+           r += silence_first_s32 (s32, LEN, 1 << 16));
+    bench ("silence_first_flt", ITERS, LEN,
+           r += silence_first_flt (flt, LEN, 1e-3f));
+    const double flt_ns = bench_ns_per;
+
+    // loud: the common case after the lead-in, exits at once
+    s16[0] = 1000;
+    s16[LEN - 1] = 1000;
+    bench ("silence_first + last s16 (loud block)", ITERS, LEN,
+           r += silence_first_s16 (s16, LEN, 8)
+                + silence_last_s16 (s16, LEN, 8));
+
+    bench_keep (r);
+
+    // cost of scanning one second of 48 kHz stereo against its one second
+    // of playback time
+    const double us_per_s = flt_ns * 48000 * 2 / 1e3;
+
+    printf ("\nvector speedup (s16):\t%.1fx\n", scalar_ns / s16_ns);
+    printf ("worst case, 48 kHz stereo float:\t%.1f us per second of audio "
+            "(%.4f%% of one core)\n",
+            us_per_s, us_per_s / 1e4);
+
+    bench_check (us_per_s < 1000, "silence scan should cost < 0.1% of a core");
+
+    return bench_fails != 0;
+}
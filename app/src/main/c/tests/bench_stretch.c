@@ -0,0 +1,95 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bench.c"
+
+#include "../stretch.c"
+
+#define RATE  48000
+#define CH    2
+#define BURST 192
+#define ITERS 20
+
+/** enough input for a second of output at `STRETCH_MAX` */
+#define IN_FRAMES (RATE * STRETCH_MAX / 100 + RATE)
+
+static int16_t in[IN_FRAMES * CH], out[BURST * CH];
+
+/** one second of output, a burst at a time, as the output loop reads it */
+static void
+second (struct stretch_t *st)
+{
+    size_t pos = 0;
+
+    stretch_reset (st);
+
+    for (size_t done = 0; done < RATE;) {
+        const size_t n = stretch_get (st, out, BURST);
+
+        done += n;
+
+        if (n < BURST) {
+            size_t k = stretch_want (st);
+
+            k = k < IN_FRAMES - pos ? k : IN_FRAMES - pos;
+            stretch_put (st, in + pos * CH, k);
+            pos += k;
+        }
+    }
+}
+
+/**
+ * cpu time per second of stereo S16 output at each speed, against
+ * `STRETCH_BUDGET_NS`. a chord with some noise in it, so the search does
+ * not settle on one period. the correlation kernel alone is shown for
+ * reference: a window of it is most of a step.
+ */
+int
+main (void)
+{
+    static const uint16_t pcts[] = { 50, 100, 125, 150, 200, 300 };
+    struct stretch_t      st;
+    uint32_t              seed  = 1;
+    double                worst = 0;
+
+    for (size_t i = 0; i < IN_FRAMES; ++i) {
+        const double t = (double)i / RATE;
+
+        seed = seed * 1664525 + 1013904223;
+
+        const double v = 0.2 * sin (2 * M_PI * 220 * t)
+                         + 0.2 * sin (2 * M_PI * 277 * t)
+                         + 0.2 * sin (2 * M_PI * 330 * t)
+                         + 0.05 * ((int32_t)seed / 2147483648.0);
+
+        in[i * CH] = in[i * CH + 1] = v * 32767;
+    }
+
+    stretch_init (&st, 1, CH, RATE);
+
+    for (size_t p = 0; p < sizeof pcts / sizeof *pcts; ++p) {
+        char name[64];
+
+        snprintf (name, sizeof name, "per output second at %hu%%", pcts[p]);
+        stretch_set (&st, pcts[p]);
+        bench (name, ITERS, 1, second (&st));
+        worst = bench_ns_per > worst ? bench_ns_per : worst;
+    }
+
+    const size_t n = st.ovl * CH;
+
+    bench ("overlap correlation, per sample", ITERS * 10000, n,
+           bench_keep (dot (st.mid, st.in + it_ % st.win * CH, n)));
+
+    printf ("\nworst %.2f ms per output second, %.2f%% of it; budget %.2f "
+            "ms\n",
+            worst / 1e6, worst / 1e7, STRETCH_BUDGET_NS / 1e6);
+
+    bench_check (worst < STRETCH_BUDGET_NS,
+                 "a second of output should stay in budget at any speed");
+
+    stretch_deinit (&st);
+
+    return bench_fails != 0;
+}
@@ -0,0 +1,61 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "bench.c"
+
+#include "../timing.c"
+
+#define RATE  48000
+#define BURST 192
+#define ITERS 1000000
+
+/**
+ * what timing adds to a burst against `TIMING_BUDGET_NS`: the write loop's
+ * clock read and `timing_burst`, or a callback's `timing_cb`, plus the
+ * check for a due latency sample. the sample itself and the summary run
+ * a few times a second and are shown for reference.
+ */
+int
+main (void)
+{
+    struct timing_t       t;
+    struct timing_stats_t st;
+    char                  line[256];
+    uint64_t              now = 1;
+    double                write_ns, cb_ns;
+
+    timing_init (&t);
+    timing_stream (&t, RATE, BURST);
+
+    bench ("write loop burst", ITERS, 1, {
+        timing_burst (&t, bench_now_ns ());
+        bench_keep (timing_due (&t, now));
+    });
+    write_ns = bench_ns_per;
+
+    // alternating periods, so the histograms spread over a few buckets
+    bench ("callback", ITERS, 1, {
+        now += it_ & 1 ? 3900000 : 4100000;
+        timing_cb (&t, now, now + 20000 + (it_ & 0xff) * 100);
+        bench_keep (timing_due (&t, now));
+    });
+    cb_ns = bench_ns_per;
+
+    bench ("latency sample", ITERS, 1,
+           timing_latency (&t, 4800, 9600, 4800, 4320, now - 5000000, now));
+
+    bench ("stats and summary", ITERS / 100, 1, {
+        timing_stats (&t, &st);
+        timing_summary (&st, line, sizeof line);
+        bench_keep (line);
+    });
+
+    printf ("\nper burst, budget %d ns: write loop %.1f ns, callback %.1f "
+            "ns\n%s\n",
+            TIMING_BUDGET_NS, write_ns, cb_ns, line);
+
+    bench_check (write_ns < TIMING_BUDGET_NS && cb_ns < TIMING_BUDGET_NS,
+                 "timing a burst should stay in budget");
+
+    return bench_fails != 0;
+}
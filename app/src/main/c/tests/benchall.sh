@@ -0,0 +1,3 @@
+#!/bin/sh
+
+find . -name 'bench_*' -exec sh -c 'make bench TARG=$(echo {} | cut -c 9- | rev | cut -c 3- | rev) OPTIMIZE=-O2 CFLAGS_EXTRA=-DNCAP_ISTEST' \;
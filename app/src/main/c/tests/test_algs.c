@@ -1,4 +1,6 @@
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -29,6 +31,23 @@ main (void)
 
     free (arr);
 
+    // wider than the swap's stack buffer, and not a multiple of it
+    uint8_t a[150], b[150];
+
+    for (size_t i = 0; i < sizeof a; ++i) {
+        a[i] = i;
+        b[i] = ~i;
+    }
+
+    memswp (a, b, sizeof a);
+
+    bool swapped = true;
+
+    for (size_t i = 0; i < sizeof a; ++i)
+        swapped = swapped && a[i] == (uint8_t)~i && b[i] == (uint8_t)i;
+
+    assert_nonfatal (swapped, "wide elements should be swapped whole");
+
     report ();
 
     return 0;
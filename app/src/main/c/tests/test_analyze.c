@@ -0,0 +1,133 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.c"
+
+// each module has its own `FILENAME`, for logging on Android alone
+#define FILENAME FILENAME_analyze __attribute__ ((unused))
+#include "../analyze.c"
+#undef FILENAME
+#include "../spscq.c"
+
+#define FILENAME FILENAME_trackdb __attribute__ ((unused))
+#include "../trackdb.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_thrctl __attribute__ ((unused))
+#include "../thrctl.c"
+#undef FILENAME
+
+#define NFRAMES 4800
+
+/** counts what it is fed, to check the threaded path loses nothing */
+struct count_state_t {
+    uint32_t channels;
+    double   sum;
+};
+
+static void
+count_init (void *state, uint32_t sample_rate, uint32_t channels)
+{
+    (void)sample_rate;
+    *(struct count_state_t *)state
+        = (struct count_state_t){ .channels = channels };
+}
+
+static void
+count_process (void *state, const float *buf, size_t nframes)
+{
+    struct count_state_t *st = state;
+
+    for (size_t i = 0; i < nframes * st->channels; ++i)
+        st->sum += buf[i];
+}
+
+static uint16_t
+count_finalize (void *state, void *res)
+{
+    memcpy (res, &((struct count_state_t *)state)->sum, sizeof (double));
+    return sizeof (double);
+}
+
+static const struct analyzer_t analyzer_count = {
+    .name      = "count",
+    .tag       = TRACKDB_TAG ('C', 'N', 'T', '!'),
+    .ver       = 1,
+    .state_siz = sizeof (struct count_state_t),
+    .init      = count_init,
+    .process   = count_process,
+    .finalize  = count_finalize,
+};
+
+static void
+run (uint64_t key, const int16_t *s16, bool threaded, size_t blk)
+{
+    const struct analyzer_t *an[] = { &analyzer_peak, &analyzer_rms,
+                                      &analyzer_count };
+    struct analyze_t         a;
+
+    analyze_begin (&a, key, an, 3, 48000, 2, threaded);
+
+    for (size_t f = 0; f < NFRAMES; f += blk)
+        analyze_feed (&a, s16 + f * 2, 1,
+                      NFRAMES - f < blk ? NFRAMES - f : blk);
+
+    analyze_end (&a, key, true);
+}
+
+int
+main (void)
+{
+    const char *const dbfile = "build/test_analyze.trackdb";
+    remove (dbfile);
+    trackdb_init (dbfile);
+
+    // half-scale square wave with one clipped sample
+    static int16_t s16[NFRAMES * 2];
+    for (size_t i = 0; i < NFRAMES * 2; ++i)
+        s16[i] = i / 96 % 2 ? 16384 : -16384;
+    s16[100] = INT16_MIN;
+
+    struct analyze_peak_t peak;
+    struct analyze_rms_t  rms;
+    double                sum1, sum2;
+    struct analyze_t      a;
+    size_t                n;
+
+    // clang-format off
+    assert_nonfatal (analyze_registered (&n) != NULL && n == 2, "peak and rms should be registered by default");
+
+    run (1, s16, false, 1000);
+    assert_nonfatal (trackdb_get (1, ANALYZE_PEAK_TAG, ANALYZE_PEAK_VER, &peak, sizeof peak) == sizeof peak, "peak should be stored");
+    assert_nonfatal (peak.peak == 1.0f && peak.clipped == 1, "peak should find the clipped sample");
+    assert_nonfatal (trackdb_get (1, ANALYZE_RMS_TAG, ANALYZE_RMS_VER, &rms, sizeof rms) == sizeof rms, "rms should be stored");
+    assert_nonfatal (fabsf (rms.rms_db + 6.02f) < 0.05f, "half scale square should be about -6 dBFS");
+    assert_nonfatal (trackdb_get (1, analyzer_count.tag, 1, &sum1, sizeof sum1) == sizeof sum1, "custom analyzer should be stored");
+
+    run (2, s16, true, 333);
+    assert_nonfatal (trackdb_get (2, analyzer_count.tag, 1, &sum2, sizeof sum2) == sizeof sum2, "threaded results should be stored");
+    assert_nonfatal (sum1 == sum2, "threaded path should see the same samples");
+    assert_nonfatal (trackdb_get (2, ANALYZE_PEAK_TAG, ANALYZE_PEAK_VER, &peak, sizeof peak) == sizeof peak && peak.clipped == 1, "threaded peak should match");
+
+    const struct analyzer_t *an[] = { &analyzer_peak, &analyzer_count };
+    assert_nonfatal (analyze_begin (&a, 1, an, 2, 48000, 2, true) == ANALYZE_OK, "analyze_begin should work");
+    assert_nonfatal (a.n == 0 && !a.threaded, "analyzed tracks should be skipped");
+    analyze_end (&a, 1, true);
+
+    assert_nonfatal (analyze_begin (&a, 3, an, 2, 48000, 2, false) == ANALYZE_OK && a.n == 2, "new tracks should be analyzed");
+    analyze_feed (&a, s16, 1, NFRAMES);
+    analyze_end (&a, 3, false);
+    assert_nonfatal (trackdb_get (3, ANALYZE_PEAK_TAG, ANALYZE_PEAK_VER, &peak, sizeof peak) == TRACKDB_ENOENT, "aborted tracks should not be stored");
+
+    assert_nonfatal (analyze_register (&analyzer_count) == ANALYZE_OK, "analyze_register should work");
+    assert_nonfatal (analyze_registered (&n)[2] == &analyzer_count && n == 3, "registered analyzer should be listed");
+    // clang-format on
+
+    trackdb_deinit ();
+
+    report ();
+
+    return 0;
+}
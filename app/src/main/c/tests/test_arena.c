@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alloc.c"
+#include "test.c"
+
+#include "../arena.c"
+
+#define THREADS 4
+#define ROUNDS  100000
+
+static void        *objs[8];
+static struct pool_t pool = POOL_INITIALIZER (objs);
+
+/** takes objects from `pool` and puts them back, checking none is shared */
+static void *
+churn (void *arg)
+{
+    bool *ok = arg;
+
+    for (int i = 0; i < ROUNDS; ++i) {
+        _Atomic int *obj = pool_get (&pool);
+
+        if (obj == NULL)
+            continue;
+
+        *ok = *ok && atomic_fetch_add (obj, 1) == 0;
+        atomic_fetch_sub (obj, 1);
+        pool_put (&pool, (void *)obj);
+    }
+
+    return NULL;
+}
+
+int
+main (void)
+{
+    struct arena_t a;
+    uint64_t       calls;
+
+    // clang-format off
+    arena_init (&a, 1024);
+    calls = alloc_calls ();
+    assert_nonfatal (alloc_calls () == calls && a.head == NULL, "an arena should allocate nothing until used");
+
+    // aligned for anything, packed into one chunk
+    char *p1 = arena_alloc (&a, 3);
+    char *p2 = arena_alloc (&a, 100);
+    char *p3 = arena_alloc (&a, 8);
+    assert_nonfatal (p1 != NULL && p2 != NULL && p3 != NULL && alloc_calls () == calls + 1, "small pieces should come from one chunk");
+    assert_nonfatal ((uintptr_t)p1 % alignof (max_align_t) == 0 && (uintptr_t)p2 % alignof (max_align_t) == 0 && (uintptr_t)p3 % alignof (max_align_t) == 0, "pieces should be aligned for any type");
+    assert_nonfatal (p2 >= p1 + 3 && p3 >= p2 + 100, "pieces should not overlap");
+    memset (p2, 0xab, 100);
+
+    // a piece too big for the rest of the chunk, or any chunk, gets its own
+    char *p4 = arena_alloc (&a, 1000);
+    char *p5 = arena_alloc (&a, 5000);
+    assert_nonfatal (p4 != NULL && p5 != NULL && alloc_calls () == calls + 3, "a piece that does not fit should get a new chunk");
+    memset (p5, 0xcd, 5000);
+    assert_nonfatal (p2[99] == (char)0xab, "a new chunk should leave the old ones be");
+
+    // after a reset the same round allocates nothing, and gets the same
+    arena_reset (&a);
+    calls = alloc_calls ();
+    bool same = arena_alloc (&a, 3) == p1 && arena_alloc (&a, 100) == p2 && arena_alloc (&a, 8) == p3 && arena_alloc (&a, 1000) == p4 && arena_alloc (&a, 5000) == p5;
+    assert_nonfatal (same && alloc_calls () == calls, "a reset arena should hand out its chunks again without allocating");
+    arena_reset (&a);
+    assert_nonfatal (arena_alloc (&a, 4000) == p5 && alloc_calls () == calls, "a piece should go to the first kept chunk it fits");
+
+    arena_deinit (&a);
+    assert_nonfatal (a.head == NULL && alloc_calls () == calls + 3, "deinit should free every chunk");
+    assert_nonfatal (arena_alloc (&a, 16) != NULL, "an arena should be usable after deinit");
+    arena_deinit (&a);
+
+    // a pool keeps what fits and hands it back last in, first out
+    int ints[9];
+    bool kept = true;
+    for (int i = 0; i < 8; ++i)
+        kept = kept && pool_put (&pool, &ints[i]);
+    assert_nonfatal (kept && !pool_put (&pool, &ints[8]), "a full pool should leave the object to the caller");
+    assert_nonfatal (pool_get (&pool) == &ints[7] && pool_get (&pool) == &ints[6], "the object put last should come first");
+    while (pool_get (&pool) != NULL)
+        ;
+    assert_nonfatal (pool.n == 0, "an empty pool should hand out nothing");
+
+    // and is shared between threads without an object going out twice
+    static _Atomic int shared[8];
+    for (int i = 0; i < 4; ++i)
+        pool_put (&pool, (void *)&shared[i]);
+    pthread_t tids[THREADS];
+    bool      oks[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+        oks[i] = true;
+        pthread_create (&tids[i], NULL, churn, &oks[i]);
+    }
+    bool ok = true;
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join (tids[i], NULL);
+        ok = ok && oks[i];
+    }
+    assert_nonfatal (ok && pool.n == 4, "threads should never share an object from the pool");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../atlas.c"
+
+static const uint8_t *
+pix (const struct atlas_t *a, uint32_t idx, uint32_t x, uint32_t y)
+{
+    uint32_t px, py;
+    atlas_pos (a, idx, &px, &py);
+    return a->pixels + ((size_t)(py + y) * atlas_width (a) + px + x) * 4;
+}
+
+int
+main (void)
+{
+    const char *const fn = "build/test.atlas";
+    remove (fn);
+
+    struct atlas_t a;
+    uint32_t       idx;
+    atlas_init (&a, 8);
+
+    // 30 x 20 solid red RGB24, cropped to the center 20 x 20
+    static uint8_t rgb[20][30][3];
+    for (int y = 0; y < 20; ++y)
+        for (int x = 0; x < 30; ++x)
+            rgb[y][x][0] = x >= 5 && x < 25 ? 200 : 0;
+
+    const struct atlas_src_t src_rgb = {
+        .pix      = ATLAS_PIX_RGB24,
+        .w        = 30,
+        .h        = 20,
+        .plane    = { &rgb[0][0][0] },
+        .linesize = { 30 * 3 },
+    };
+
+    // 16 x 16 black and white checkerboard in full range YUV 4:2:0
+    static uint8_t yp[16][16], up[8][8], vp[8][8];
+    for (int y = 0; y < 16; ++y)
+        for (int x = 0; x < 16; ++x)
+            yp[y][x] = (x + y) & 1 ? 255 : 0;
+    memset (up, 128, sizeof up);
+    memset (vp, 128, sizeof vp);
+
+    const struct atlas_src_t src_yuv = {
+        .pix        = ATLAS_PIX_YUV420,
+        .full_range = true,
+        .w          = 16,
+        .h          = 16,
+        .plane      = { &yp[0][0], &up[0][0], &vp[0][0] },
+        .linesize   = { 16, 8, 8 },
+    };
+
+    const struct atlas_src_t src_bad = { .pix = ATLAS_PIX_YUV444, .w = 4,
+                                         .h = 4, .plane = { &yp[0][0] } };
+
+    // clang-format off
+    assert_nonfatal (a.cols == ATLAS_DIM_MAX / 8, "grid should be as wide as allowed");
+    assert_nonfatal (atlas_find (&a, 1) == ATLAS_NONE, "empty atlas should have no cells");
+    assert_nonfatal (atlas_add (&a, 1, &src_bad, &idx) == ATLAS_ERR, "missing planes should be rejected");
+    assert_nonfatal (atlas_add (&a, 1, &src_rgb, &idx) == ATLAS_OK && idx == 0, "first cell should be 0");
+    assert_nonfatal (atlas_add (&a, 2, &src_yuv, &idx) == ATLAS_OK && idx == 1, "second cell should be 1");
+    assert_nonfatal (atlas_find (&a, 2) == 1, "atlas_find should find added keys");
+    assert_nonfatal (atlas_height (&a) == 8, "one grid row should be allocated");
+
+    const uint8_t *p = pix (&a, 0, 0, 0);
+    assert_nonfatal (p[0] == 200 && p[1] == 0 && p[2] == 0 && p[3] == 255, "crop should keep the centered square");
+    p = pix (&a, 0, 7, 7);
+    assert_nonfatal (p[0] == 200 && p[3] == 255, "crop should keep the centered square");
+    p = pix (&a, 1, 3, 4);
+    assert_nonfatal (p[0] >= 127 && p[0] <= 128 && p[0] == p[1] && p[1] == p[2], "box filter should average the checkerboard to gray");
+
+    // fill the rest of the first row and spill into a second
+    for (uint64_t k = 3; k <= a.cols + 1; ++k)
+        atlas_add (&a, k, &src_rgb, &idx);
+    assert_nonfatal (a.ncells == a.cols + 1 && atlas_height (&a) == 16, "atlas should grow by a grid row");
+
+    assert_nonfatal (atlas_write (&a, fn) == ATLAS_OK, "atlas_write should work");
+
+    struct atlas_t b;
+    atlas_init (&b, 8);
+    assert_nonfatal (atlas_read (&b, fn) == ATLAS_OK, "atlas_read should work");
+    assert_nonfatal (b.ncells == a.ncells && atlas_find (&b, a.cols + 1) == a.cols, "keys should persist");
+    assert_nonfatal (memcmp (a.pixels, b.pixels, (size_t)atlas_width (&a) * atlas_height (&a) * 4) == 0, "pixels should persist");
+    atlas_deinit (&b);
+
+    atlas_init (&b, 16);
+    assert_nonfatal (atlas_read (&b, fn) == ATLAS_EVER, "other cell sizes should be rejected");
+    assert_nonfatal (b.ncells == 0 && b.pixels == NULL, "rejected atlas should be empty");
+    assert_nonfatal (atlas_read (&b, "build/nonexistent.atlas") == ATLAS_ENOENT, "missing file should be ENOENT");
+    atlas_deinit (&b);
+
+    atlas_init (&b, ATLAS_DIM_MAX / 2);
+    assert_nonfatal (atlas_add (&b, 1, &src_rgb, &idx) == ATLAS_OK, "big cells should fit");
+    for (uint64_t k = 2; k <= 4; ++k)
+        atlas_add (&b, k, &src_rgb, &idx);
+    assert_nonfatal (atlas_add (&b, 5, &src_rgb, &idx) == ATLAS_EFULL, "atlas should not outgrow ATLAS_DIM_MAX");
+    atlas_deinit (&b);
+    // clang-format on
+
+    atlas_deinit (&a);
+
+    report ();
+
+    return 0;
+}
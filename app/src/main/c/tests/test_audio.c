@@ -0,0 +1,664 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.c"
+#include "test.c"
+
+#include "../arena.c"
+#include "../bufctl.c"
+#include "../chmix.c"
+#include "../dither.c"
+#include "../eq.c"
+#include "../gain.c"
+#include "../playctl.c"
+#include "../ring.c"
+#include "../stretch.c"
+#include "../timing.c"
+
+// each module has its own `FILENAME`, for logging on Android alone
+#define FILENAME FILENAME_audio __attribute__ ((unused))
+#include "../audio.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_sink_host __attribute__ ((unused))
+#include "../sink_host.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_trackdb __attribute__ ((unused))
+#include "../trackdb.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_config __attribute__ ((unused))
+#include "../algs.c"
+#include "../config.c"
+#undef FILENAME
+
+/** a stereo S16 track of `src_frames` frames, sample `i` being `i & 0x7fff` */
+static size_t src_frames;
+static size_t src_pos;
+
+/** reading frame `pause_at` pauses; when, and the first read after resuming */
+static size_t           pause_at = SIZE_MAX;
+static _Atomic uint64_t pause_ns;
+static _Atomic uint64_t resume_ns;
+static _Atomic uint64_t reread_ns;
+
+/** reading frame `seek_at` seeks to `seek_dst`. the last seek went to `sought` */
+static size_t   seek_at = SIZE_MAX;
+static size_t   seek_dst;
+static uint64_t sought;
+
+size_t
+pipeline_read (struct pipeline_t *pl, void *buf, size_t nframes)
+{
+    int16_t *p = buf;
+    float   *f = buf;
+
+    if (atomic_load (&resume_ns) && !atomic_load (&reread_ns))
+        atomic_store (&reread_ns, now_ns (CLOCK_MONOTONIC));
+
+    if (src_pos <= pause_at && pause_at < src_pos + nframes) {
+        atomic_store (&pause_ns, now_ns (CLOCK_MONOTONIC));
+        audio_pause ();
+    }
+
+    if (src_pos <= seek_at && seek_at < src_pos + nframes) {
+        seek_at = SIZE_MAX;
+        audio_seek (seek_dst);
+    }
+
+    if (nframes > src_frames - src_pos)
+        nframes = src_frames - src_pos;
+
+    for (size_t i = src_pos * pl->channels;
+         i < (src_pos + nframes) * pl->channels; ++i)
+        if (pl->fmt == 3)
+            *f++ = (i & 0x7fff) / 32768.0f;
+        else
+            *p++ = i & 0x7fff;
+
+    src_pos += nframes;
+
+    return nframes;
+}
+
+uint64_t
+pipeline_pos (const struct pipeline_t *pl, uint64_t back)
+{
+    return pl->start + (src_pos > back ? src_pos - back : 0);
+}
+
+int
+pipeline_seek (struct pipeline_t *pl, uint64_t frame)
+{
+    (void)pl;
+
+    sought  = frame;
+    src_pos = frame < src_frames ? frame : src_frames;
+
+    return NCAP_OK;
+}
+
+void
+render_sync_playback_button (void)
+{
+}
+
+static struct pipeline_t pl = {
+    .fmt = 1, .channels = 2, .sample_rate = 48000, .width = 2, .blk = 4
+};
+
+static int play_ret;
+
+/** the paced sink, counting the streams opened */
+static struct sink_ops_t sink_counted;
+static int               nopened;
+
+static int
+counted_open (struct sink_t *this, const struct sink_cfg_t *cfg)
+{
+    ++nopened;
+    return sink_paced.open (this, cfg);
+}
+
+static void *
+tfn_play (void *arg)
+{
+    (void)arg;
+    play_ret = audio_play (&pl, 0);
+    return NULL;
+}
+
+static void
+track (size_t nframes)
+{
+    src_frames = nframes;
+    src_pos    = 0;
+}
+
+static void
+sleep_ms (long ms)
+{
+    const struct timespec ts = { .tv_sec = 0, .tv_nsec = ms * 1000000 };
+    nanosleep (&ts, NULL);
+}
+
+/** @return the position last saved to `fn` */
+static uint64_t
+saved_pos (const char *fn, uint64_t *key)
+{
+    FILE    *fp    = fopen (fn, "rb");
+    uint64_t frame = UINT64_MAX;
+
+    if (fp == NULL)
+        return frame;
+
+    fseek (fp, offsetof (struct config_t, cur_key), SEEK_SET);
+
+    if (fread (key, sizeof *key, 1, fp) != 1
+        || fread (&frame, sizeof frame, 1, fp) != 1)
+        frame = UINT64_MAX;
+
+    fclose (fp);
+
+    return frame;
+}
+
+/**
+ * @return true if `fn` holds `ntracks` test tracks of `n` S16 frames, each
+ * sample within `tol` of the track's
+ */
+static bool
+wav_ok (const char *fn, size_t ntracks, size_t n, int tol)
+{
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL)
+        return false;
+
+    struct cwav_header_t h;
+    bool                 ok = fread (&h, CWAV_HEADER_SIZ, 1, fp) == 1
+              && memcmp (h.data.ckID, "data", 4) == 0
+              && h.fmt.nChannels == 2 && h.fmt.wBitsPerSample == 16
+              && h.data.cksize == ntracks * n * 4;
+
+    int16_t s;
+
+    for (size_t i = 0; ok && i < ntracks * n * 2; ++i)
+        ok = fread (&s, 2, 1, fp) == 1
+             && abs (s - (int16_t)(i % (n * 2) & 0x7fff)) <= tol;
+
+    fclose (fp);
+
+    return ok;
+}
+
+/**
+ * @return true if `fn` holds `n` stereo frames, the same on both sides if
+ * `mono`, none of them silent past the first
+ */
+static bool
+wav_mixed_ok (const char *fn, size_t n, bool mono)
+{
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL)
+        return false;
+
+    struct cwav_header_t h;
+    bool                 ok = fread (&h, CWAV_HEADER_SIZ, 1, fp) == 1
+              && h.fmt.nChannels == 2 && h.data.cksize == n * 4;
+
+    int16_t s[2];
+
+    for (size_t i = 0; ok && i < n; ++i)
+        ok = fread (s, 2, 2, fp) == 2 && (!mono || s[0] == s[1])
+             && (i == 0 || s[0] != 0 || s[1] != 0);
+
+    fclose (fp);
+
+    return ok;
+}
+
+/**
+ * @return true if `fn` holds one test track of `n` frames, whole but for a
+ * fade of `len` frames down to silence and `len` back, each frame's gain a
+ * step of about `1 / len` from the last
+ */
+static bool
+wav_faded_ok (const char *fn, size_t n, size_t len)
+{
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL)
+        return false;
+
+    struct cwav_header_t h;
+    int16_t             *s  = malloc (n * 4);
+    bool                 ok = s != NULL
+              && fread (&h, CWAV_HEADER_SIZ, 1, fp) == 1
+              && h.data.cksize == n * 4 && fread (s, 4, n, fp) == n;
+
+    fclose (fp);
+
+    size_t first = SIZE_MAX, last = 0;
+
+    for (size_t i = 0; ok && i < n * 2; ++i)
+        if (s[i] != (int16_t)(i & 0x7fff)) {
+            first = first < i / 2 ? first : i / 2;
+            last  = i / 2;
+        }
+
+    ok = ok && first != SIZE_MAX && last - first + 2 >= 2 * len
+         && last - first < 2 * len;
+
+    float prev = -1, min = 1;
+
+    for (size_t i = first * 2; ok && i <= last * 2 + 1; ++i) {
+        const int p = i & 0x7fff;
+
+        // the quantization error of small samples swamps the step
+        if (p < 4096) {
+            prev = -1;
+            continue;
+        }
+
+        const float g = (float)s[i] / p;
+        const float d = g > prev ? g - prev : prev - g;
+
+        ok   = s[i] >= 0 && s[i] <= p && (prev < 0 || d <= 1.5f / len);
+        prev = g;
+        min  = g < min ? g : min;
+    }
+
+    free (s);
+
+    return ok && min < 0.01f;
+}
+
+/**
+ * @return true if `fn` holds one test track of `n` frames played up to some
+ * frame and then from `to` on, fading in over `len` frames there
+ */
+static bool
+wav_seeked_ok (const char *fn, size_t n, size_t to, size_t len)
+{
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL)
+        return false;
+
+    struct cwav_header_t h;
+    int16_t             *s  = malloc (n * 4);
+    bool                 ok = s != NULL
+              && fread (&h, CWAV_HEADER_SIZ, 1, fp) == 1
+              && h.data.cksize % 4 == 0 && h.data.cksize / 4 > n - to
+              && h.data.cksize / 4 <= n
+              && fread (s, 4, h.data.cksize / 4, fp) == h.data.cksize / 4;
+
+    fclose (fp);
+
+    // frames before the seek, then the rest of the track from `to`
+    const size_t k = ok ? h.data.cksize / 4 - (n - to) : 0;
+
+    for (size_t i = 0; ok && i < k * 2; ++i)
+        ok = s[i] == (int16_t)(i & 0x7fff);
+
+    for (size_t i = k * 2; ok && i < (k + n - to) * 2; ++i) {
+        const int16_t p = (i - k * 2 + to * 2) & 0x7fff;
+
+        ok = i - k * 2 < len * 2 ? s[i] >= 0 && s[i] <= p : s[i] == p;
+    }
+
+    ok = ok && s[k * 2 + 1] < s[(k + len) * 2 + 1];
+
+    free (s);
+
+    return ok;
+}
+
+int
+main (void)
+{
+    const char *const fn    = "build/test_audio.wav";
+    const char *const cfgfn = "build/test_audio.cfg";
+    int64_t           frames, ns;
+    uint64_t          key;
+    pthread_t         tid;
+
+    ncap_config.version         = NCAP_CONFIG_VERSION;
+    ncap_config.volume          = 100;
+    ncap_config.aaudio_optimize = 1;
+    ncap_config.track_path      = "";
+    ncap_config.track_path_len  = 1;
+
+    remove (cfgfn);
+    config_init (cfgfn);
+    config_write ();
+
+    audio_init ();
+    audio_resume ();
+
+    // clang-format off
+    audio_set_sink (&sink_null, NULL);
+    track (48000);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && src_pos == 48000, "null sink should take the whole track");
+    assert_nonfatal (!out.cbmode, "null sink should fall back to the write loop");
+    assert_nonfatal (sink_null.timestamp (&out.sink, &frames, &ns) == SINK_OK && frames == 48000, "null sink should count frames");
+    struct buf_learned_t l;
+    assert_nonfatal (trackdb_get (out.buf_key, BUF_TAG, BUF_VER, &l, sizeof l) == sizeof l, "buffer size should be learned");
+
+    // two tracks in one stream, as two tracks of the same format play
+    audio_set_sink (&sink_wav, fn);
+    track (10000);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK, "wav sink should play");
+    track (10000);
+    uint64_t allocs = alloc_calls ();
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK, "wav sink should play the next track in the same stream");
+    assert_nonfatal (alloc_calls () == allocs, "a track on an open stream should not allocate");
+    audio_deinit ();
+    assert_nonfatal (wav_ok (fn, 2, 10000, 0), "wav file should hold both tracks unchanged at unity gain");
+
+    // 5.1 is downmixed to a stereo stream, and stereo folded to mono
+    audio_set_sink (&sink_wav, fn);
+    pl.channels = 6;
+    pl.blk      = 12;
+    track (4800);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.channels == 2, "5.1 should play on a stereo stream");
+    audio_deinit ();
+    assert_nonfatal (wav_mixed_ok (fn, 4800, false), "5.1 should be downmixed frame for frame");
+    pl.channels = 2;
+    pl.blk      = 4;
+    ncap_config.mono = 1;
+    config_mix_touch ();
+    audio_set_sink (&sink_wav, fn);
+    track (4800);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK, "mono should play");
+    audio_deinit ();
+    assert_nonfatal (wav_mixed_ok (fn, 4800, true), "mono should put the same on both sides");
+    ncap_config.mono = 0;
+    config_mix_touch ();
+
+    // power saving reduces float to S16, dithered
+    ncap_config.aaudio_optimize = 2;
+    ncap_config.dither          = DITHER_TPDF;
+    audio_set_sink (&sink_wav, fn);
+    pl.fmt   = 3;
+    pl.width = 4;
+    pl.blk   = 8;
+    track (10000);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.sink_fmt == 1 && out.blk == 4, "power saving should play float as S16");
+    audio_deinit ();
+    assert_nonfatal (wav_ok (fn, 1, 10000, 1), "float reduced to S16 should be within a step of the source");
+    ncap_config.aaudio_optimize = 1;
+    pl.fmt   = 1;
+    pl.width = 2;
+    pl.blk   = 4;
+
+    // a pause fades out, and the resume fades in from the next frame
+    audio_set_sink (&sink_wav, fn);
+    track (48000);
+    pause_at = 20000;
+    pthread_create (&tid, NULL, tfn_play, NULL);
+    while (!atomic_load (&pause_ns) || !out.open || sink_wav.state (&out.sink) != SINK_PAUSED)
+        sleep_ms (1);
+    const double pause_ms = (now_ns (CLOCK_MONOTONIC) - atomic_load (&pause_ns)) / 1e6;
+    size_t pos = src_pos;
+    sleep_ms (20);
+    assert_nonfatal (src_pos == pos && src_pos < 48000, "nothing should be decoded while paused");
+    pl.key = 42;
+    assert_nonfatal (audio_save_wait (0), "a pause should ask for the position to be saved");
+    audio_save_pos ();
+    assert_nonfatal (saved_pos (cfgfn, &key) == src_pos && key == 0, "a pause should save the position of the track");
+    pl.key = 0;
+    atomic_store (&resume_ns, now_ns (CLOCK_MONOTONIC));
+    audio_resume ();
+    pthread_join (tid, NULL);
+    audio_deinit ();
+    const double resume_ms = (atomic_load (&reread_ns) - atomic_load (&resume_ns)) / 1e6;
+    printf ("wav sink: paused in %.2f ms, resumed in %.2f ms, %zu-frame fades\n", pause_ms, resume_ms, out.fade.len);
+    assert_nonfatal (pause_ms < 20 && resume_ms < 20, "pausing and resuming should take a burst or so");
+    assert_nonfatal (wav_faded_ok (fn, 48000, out.fade.len), "a pause should fade out and in without a jump or a lost frame");
+    pause_at = SIZE_MAX;
+
+    // starting mid-track, as after a restart: a fade-in, and the position
+    // counts on from there
+    audio_set_sink (&sink_wav, fn);
+    track (4800);
+    pl.start = 123456;
+    pl.key   = 7;
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK, "a track should play from mid-way");
+    audio_deinit ();
+    audio_save_pos ();
+    assert_nonfatal (saved_pos (cfgfn, &key) == 123456 + 4800 && key == 7, "the position should count on from the start");
+    assert_nonfatal (out.resume_ns > 0, "the time to resumed audio should be taken");
+    FILE *fp = fopen (fn, "rb");
+    int16_t s[2 * 8];
+    fseek (fp, CWAV_HEADER_SIZ + 4 * 100, SEEK_SET);
+    assert_nonfatal (fread (s, 2, 2 * 8, fp) == 2 * 8 && s[0] < 200 / 2 && s[2 * 7] > s[0], "a track started mid-way should fade in");
+    fclose (fp);
+    pl.start = 0;
+    pl.key   = 0;
+
+    // seeking: what was queued is dropped and the new position fades in,
+    // then plays on from the frame asked for
+    audio_set_sink (&sink_wav, fn);
+    track (48000);
+    pl.length = 48000;
+    seek_at   = 10000;
+    seek_dst  = 30000;
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && src_pos == 48000, "a seek should play on to the end of the track");
+    audio_deinit ();
+    printf ("wav sink: seek audible in %.2f ms\n", out.seek_ns / 1e6);
+    assert_nonfatal (out.seek_ns > 0 && out.seek_ns < NCAP_AUDIO_SEEK_MS * 1000000ull, "a seek should be audible within NCAP_AUDIO_SEEK_MS");
+    assert_nonfatal (wav_seeked_ok (fn, 48000, 30000, out.fade.len), "a seek should jump to its frame and fade in there");
+    uint64_t shown, len;
+    audio_position (&shown, &len);
+    assert_nonfatal (shown >= 30000 && shown <= 48000 && len == 48000, "the position shown should follow the seek");
+
+    // wall clock pacing, callback mode: 250 ms, of which the ring holds 170.
+    // timing starts over, as the file sinks take writes at once
+    audio_set_sink (&sink_paced, NULL);
+    track (12000);
+    timing_init (&out.timing);
+    uint64_t t0 = now_ns (CLOCK_MONOTONIC);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.cbmode, "paced sink should play in callback mode");
+    const double ms = (now_ns (CLOCK_MONOTONIC) - t0) / 1e6;
+    assert_nonfatal (ms > 60 && ms < 250, "paced sink should take about the track minus the ring");
+    assert_nonfatal (atomic_load (&out.cb.ncb) > 20, "paced sink should pull a burst every 4 ms");
+    assert_nonfatal (sink_paced.timestamp (&out.sink, &frames, &ns) == SINK_OK && frames > 0, "paced sink should report presented frames");
+    struct timing_stats_t st;
+    char line[256];
+    audio_timing (&st);
+    timing_summary (&st, line, sizeof line);
+    printf ("paced sink: %s\n", line);
+    assert_nonfatal (st.callbacks > 20 && st.bursts > 20 && st.period_mean > 3000000 && st.period_mean < 5000000, "callbacks should be timed a burst period apart");
+    assert_nonfatal (st.cb_max > 0 && st.cb_max < 4000000, "callback durations should be taken");
+    assert_nonfatal (st.samples > 0 && st.ring > 0 && st.latency >= st.ring && st.latency_max >= st.latency_min, "latency should be sampled, counting the ring");
+    track (4800);
+    allocs = alloc_calls ();
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.cbmode && alloc_calls () == allocs, "a track on an open stream should not allocate in callback mode");
+
+    // tracks at 48, 48, 44.1 and 44.1 kHz: the stream is kept while the
+    // format is, and reopened once for the change
+    sink_counted      = sink_paced;
+    sink_counted.open = counted_open;
+    audio_set_sink (&sink_counted, NULL);
+    const uint32_t rates[] = { 48000, 48000, 44100, 44100 };
+    bool kept = true;
+    for (size_t k = 0; k < 4; ++k) {
+        const int n = nopened;
+        pl.sample_rate = rates[k];
+        track (4800);
+        audio_play (&pl, 0);
+        kept = kept && out.open && out.sample_rate == rates[k] && nopened - n == (k == 0 || k == 2);
+    }
+    pl.sample_rate = 48000;
+    printf ("paced sink, 4 tracks at 48/48/44.1/44.1 kHz: %d streams opened\n", nopened);
+    assert_nonfatal (kept && nopened == 2, "a stream should be opened only when the format changes");
+    audio_set_sink (&sink_paced, NULL);
+    track (4800);
+    audio_play (&pl, 0);
+
+    // twice the speed: twice the track in the same time, the ring kept fed.
+    // the last 100 ms or so are not stretched
+    ncap_config.speed = 200;
+    config_speed_touch ();
+    track (24000);
+    uint64_t starved = atomic_load (&out.cb.starved);
+    t0 = now_ns (CLOCK_MONOTONIC);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && src_pos == 24000, "2x should read the whole track");
+    const double ms2 = (now_ns (CLOCK_MONOTONIC) - t0) / 1e6;
+    printf ("paced sink at 2x: 500 ms of track in %.1f ms, %" PRIu64 " starved\n", ms2, atomic_load (&out.cb.starved) - starved);
+    assert_nonfatal (ms2 > 60 && ms2 < 350, "2x should take about half the track's time");
+    assert_nonfatal (atomic_load (&out.cb.starved) == starved, "2x should not starve the ring");
+    assert_nonfatal (out.st.speed == 2 && !stretch_held (&out.st), "the stretch should end the track empty");
+    ncap_config.speed = 100;
+    config_speed_touch ();
+
+    // the device goes away every 200 ms of audio, as on an unplug: each new
+    // stream plays on from the frame the last one stopped at, which is 200
+    // ms on as nothing starved
+    audio_set_sink (&sink_paced, "disc=200");
+    track (48000);
+    uint64_t nrecover = out.nrecover;
+    t0 = now_ns (CLOCK_MONOTONIC);
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && src_pos == 48000, "playback should go on to the end across lost devices");
+    const double ms3 = (now_ns (CLOCK_MONOTONIC) - t0) / 1e6;
+    printf ("paced sink, device lost every 200 ms: %" PRIu64 " reopens, the last audible in %.2f ms, 1 s of track in %.1f ms\n", out.nrecover - nrecover, out.recover_ns / 1e6, ms3);
+    assert_nonfatal (out.nrecover - nrecover == 4 && sought == 4 * 9600 && out.sink.device > 4, "each reopen should resume at the frame the lost device stopped at");
+    assert_nonfatal (out.recover_ns > 0 && out.recover_ns < NCAP_AUDIO_RECOVER_MS * 1000000ull, "a reopen should be audible within NCAP_AUDIO_RECOVER_MS");
+    assert_nonfatal (ms3 > 700 && ms3 < 1200, "a reopen should not cost more than a little silence");
+
+    // and in deep-buffer mode, which learns of it from its writes or the
+    // error callback. the second stream has the rest of the track queued
+    // before its device goes
+    ncap_config.aaudio_optimize = 2;
+    audio_deinit ();
+    track (24000);
+    nrecover = out.nrecover;
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && src_pos == 24000 && out.deep, "deep-buffer playback should go on across lost devices");
+    assert_nonfatal (out.nrecover - nrecover == 1 && sought == 9600, "deep-buffer mode should resume at the frame the lost device stopped at");
+    ncap_config.aaudio_optimize = 1;
+    audio_set_sink (&sink_paced, NULL);
+
+    // pause, resume, then skip
+    track (48000 * 10);
+    pthread_create (&tid, NULL, tfn_play, NULL);
+    sleep_ms (50);
+    audio_pause ();
+    sleep_ms (30);
+    assert_nonfatal (sink_paced.state (&out.sink) == SINK_PAUSED, "pausing should pause the sink");
+    assert_nonfatal (atomic_load (&out.cb.held) >= (uint64_t)out.buf.siz, "the callback should fade out to silence before the pause");
+    pos = src_pos;
+    sleep_ms (30);
+    assert_nonfatal (src_pos == pos, "nothing should be decoded while paused");
+    audio_resume ();
+    sleep_ms (30);
+    assert_nonfatal (sink_paced.state (&out.sink) == SINK_STARTED && src_pos > pos, "resuming should restart the sink");
+
+    // the position is written by `audio_save_pos` alone
+    audio_save_pos ();
+    const uint64_t at_pause = saved_pos (cfgfn, &key);
+    sleep_ms (60);
+    assert_nonfatal (saved_pos (cfgfn, &key) == at_pause, "the audio thread should not write the position while playing");
+    uint64_t shown0, shown1;
+    audio_position (&shown0, &len);
+    audio_save_pos ();
+    audio_position (&shown1, &len);
+    const uint64_t at_save = saved_pos (cfgfn, &key);
+    assert_nonfatal (at_save > at_pause && shown0 <= at_save && at_save <= shown1, "audio_save_pos should write the position shown");
+
+    // seeking in callback mode, playing and paused
+    audio_seek (48000 * 5);
+    sleep_ms (30);
+    printf ("paced sink: seek audible in %.2f ms\n", out.seek_ns / 1e6);
+    assert_nonfatal (src_pos > 48000 * 5 && out.seek_ns > 0 && out.seek_ns < NCAP_AUDIO_SEEK_MS * 1000000ull, "a seek should be audible within NCAP_AUDIO_SEEK_MS in callback mode");
+    assert_nonfatal (atomic_load (&out.cb.fade_req) == FADE_IN, "the callback should fade in after a seek");
+    audio_pause ();
+    sleep_ms (30);
+    audio_seek (48000);
+    sleep_ms (10);
+    assert_nonfatal (src_pos == 48000 && sink_paced.state (&out.sink) == SINK_PAUSED, "a seek while paused should stay paused");
+    audio_resume ();
+    sleep_ms (30);
+    assert_nonfatal (sink_paced.state (&out.sink) == SINK_STARTED && src_pos > 48000, "resuming should play from the seek");
+
+    t0 = now_ns (CLOCK_MONOTONIC);
+    audio_interrupt ();
+    pthread_join (tid, NULL);
+    assert_nonfatal (play_ret == NCAP_INT && now_ns (CLOCK_MONOTONIC) - t0 < 200000000, "interrupt should end the track at once");
+
+    // the interrupt was a tap on the next track, timed until it is heard
+    out.tap_ns = 0;
+    track (48000 * 10);
+    pthread_create (&tid, NULL, tfn_play, NULL);
+    sleep_ms (50);
+    printf ("paced sink: tapped track audible in %.2f ms\n", out.tap_ns / 1e6);
+    assert_nonfatal (out.tap_ns > 0 && out.tap_ns < NCAP_AUDIO_TAP_MS * 1000000ull, "a tapped track should be audible within NCAP_AUDIO_TAP_MS");
+    audio_interrupt ();
+    pthread_join (tid, NULL);
+
+    // deep buffer for power saving: a refill every few hundred ms instead
+    // of a write per 4 ms burst
+    ncap_config.aaudio_optimize = 2;
+    audio_deinit ();
+    track (48000);
+    t0 = now_ns (CLOCK_MONOTONIC);
+    uint64_t wakeups = out.wakeups;
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.deep && !out.cbmode, "power saving should play in deep-buffer mode");
+    const double secs = (now_ns (CLOCK_MONOTONIC) - t0) / 1e9;
+    const double rate = (out.wakeups - wakeups) / secs;
+    printf ("deep-buffer: %.1f wakeups/s over %.2f s, %d xruns\n", rate, secs, sink_paced.xruns (&out.sink));
+    assert_nonfatal (secs > 0.5, "deep-buffer mode should still play in real time");
+    assert_nonfatal (rate * 10 <= 48000 / out.sink.burst, "deep-buffer mode should wake 10x less than once a burst");
+    assert_nonfatal (sink_paced.xruns (&out.sink) == 0, "deep-buffer mode should not underrun");
+    assert_nonfatal (out.buf.siz == out.sink.cap, "deep-buffer mode should use the whole buffer");
+    track (4800);
+    allocs = alloc_calls ();
+    assert_nonfatal (audio_play (&pl, 0) == NCAP_OK && out.deep && alloc_calls () == allocs, "a track on an open stream should not allocate in deep-buffer mode");
+
+    track (48000 * 10);
+    pthread_create (&tid, NULL, tfn_play, NULL);
+    sleep_ms (100);
+    audio_pause ();
+    sleep_ms (20);
+    assert_nonfatal (sink_paced.state (&out.sink) == SINK_PAUSED, "pausing should end a deep-buffer sleep");
+    audio_interrupt ();
+    audio_resume ();
+    pthread_join (tid, NULL);
+    assert_nonfatal (play_ret == NCAP_INT, "interrupt should end a deep-buffer track");
+    ncap_config.aaudio_optimize = 1;
+
+    // closing ends playback and the stream, in callback mode
+    audio_deinit ();
+    track (48000 * 10);
+    pthread_create (&tid, NULL, tfn_play, NULL);
+    sleep_ms (20);
+    audio_close ();
+    pthread_join (tid, NULL);
+    assert_nonfatal (play_ret == NCAP_OK && !out.open, "audio_close should close the stream");
+    audio_save_pos ();
+    const uint64_t saved = saved_pos (cfgfn, &key);
+    assert_nonfatal (saved > 0 && saved < src_pos, "closing should save the position less what was still queued");
+
+    // between tracks, the top of no track
+    audio_save_top ();
+    assert_nonfatal (audio_save_wait (0), "the top of no track should be saved at once");
+    audio_save_pos ();
+    assert_nonfatal (saved_pos (cfgfn, &key) == 0 && key == 0, "between tracks, a kill should start the next track from its top");
+    // clang-format on
+
+    audio_deinit ();
+    config_deinit ();
+    remove (fn);
+    remove (cfgfn);
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdint.h>
+
+#include "test.c"
+
+#include "../bufctl.c"
+
+#define BURST  192
+#define CAP    (BURST * 32)
+#define PERIOD 4000000ull // ns per burst at 48 kHz
+
+/**
+ * a device that takes a burst every `PERIOD` and a writer that wakes a
+ * burst after each read, late by a random amount of up to `jitter` periods,
+ * and tops the buffer up to its size. one call runs for `secs` of simulated
+ * time, with the controller seeing the xrun counter every period.
+ */
+struct sink_t {
+    uint64_t t;
+    uint64_t wake; // writer's next wakeup
+    int32_t  level;
+    int32_t  xruns;
+    uint32_t seed;
+};
+
+static uint32_t
+rnd (struct sink_t *s)
+{
+    s->seed = s->seed * 1664525u + 1013904223u;
+    return s->seed >> 8;
+}
+
+/** @return xruns during the run */
+static int32_t
+run (struct sink_t *s, struct bufctl_t *c, double jitter, double secs)
+{
+    const int32_t  xruns0 = s->xruns;
+    const uint64_t end    = s->t + (uint64_t)(secs * 1e9);
+
+    for (; s->t < end; s->t += PERIOD) {
+        // catch up on writer wakeups due before this read
+        while (s->wake <= s->t) {
+            s->level = c->siz;
+
+            const double late = jitter * (rnd (s) & 0xffff) / 0x10000;
+            const uint64_t next = s->wake + PERIOD + (uint64_t)(late * PERIOD);
+
+            s->wake = next > s->t + PERIOD ? next : s->t + PERIOD;
+        }
+
+        if (s->level < BURST)
+            ++s->xruns;
+
+        s->level = s->level > BURST ? s->level - BURST : 0;
+
+        const int32_t siz = bufctl_update (c, s->xruns, s->t);
+
+        if (siz != 0)
+            bufctl_applied (c, siz);
+    }
+
+    return s->xruns - xruns0;
+}
+
+int
+main (void)
+{
+    struct sink_t   s = { .seed = 1 };
+    struct bufctl_t c;
+
+    bufctl_init (&c, BURST, CAP, 2 * BURST, 1, 0);
+
+    // clang-format off
+    assert_nonfatal (c.min == 2 * BURST && c.siz == 2 * BURST, "low latency should start at two bursts");
+    assert_nonfatal (run (&s, &c, 0.5, 10) == 0, "small jitter should not cause xruns");
+    assert_nonfatal (c.ngrow == 0 && c.nshrink == 0, "no xruns should mean no decisions");
+
+    // late wakeups of up to 3 periods need 5 bursts
+    run (&s, &c, 3.5, 2);
+    assert_nonfatal (c.ngrow > 0 && c.siz >= 4 * BURST, "xruns should grow the buffer");
+    assert_nonfatal (run (&s, &c, 3.5, 1) == 0 || c.siz > 4 * BURST, "growth should stop the xruns within a second");
+    const int32_t x = run (&s, &c, 3.5, 60);
+    assert_nonfatal (x <= 5, "a shrink after an xrun should be rare");
+    assert_nonfatal (c.decay_ns > c.decay_base_ns, "shrinks that caused xruns should slow decay");
+    assert_nonfatal (c.siz_max <= 8 * BURST, "growth should not overshoot far");
+    assert_nonfatal (c.ngrow <= 6, "the size should settle instead of oscillating");
+
+    // back to a quiet sink: decay to the floor
+    run (&s, &c, 0.5, 180);
+    assert_nonfatal (c.siz == c.min, "clean playback should decay to the floor");
+    assert_nonfatal (bufctl_last (&c)->why == BUFCTL_SHRINK, "the last decision should be a shrink");
+    assert_nonfatal (c.nhist == c.ngrow + c.nshrink, "every decision should be in the history");
+
+    // capacity and the power saving floor
+    bufctl_init (&c, BURST, 3 * BURST, 2 * BURST, 1, 0);
+    assert_nonfatal (bufctl_update (&c, 1, 1) == 3 * BURST, "growth should stop at capacity");
+    assert_nonfatal (bufctl_update (&c, 5, 2) == 0 && c.siz == 3 * BURST, "growth should stop at capacity");
+
+    bufctl_init (&c, BURST, CAP, 6 * BURST, 2, 0);
+    assert_nonfatal (c.min == 6 * BURST, "power saving should keep the opened size as the floor");
+    assert_nonfatal (bufctl_update (&c, 0, 60000000000ull) == 0, "power saving should not shrink below it");
+    bufctl_init (&c, BURST, CAP, 6 * BURST, 0, 0);
+    assert_nonfatal (bufctl_update (&c, 0, 4000000000ull) == 0, "mode none should wait 5 s");
+    assert_nonfatal (bufctl_update (&c, 0, 5000000000ull) == 5 * BURST, "mode none should then shrink a burst");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../chmix.c"
+
+#define N 203 // frames, an odd tail past whole blocks and pairs
+
+static float   flt[N * CHMIX_MAX_IN], ref[N * CHMIX_MAX_IN];
+static int32_t s32[N * CHMIX_MAX_IN], f32[N * CHMIX_MAX_IN];
+static int16_t s16[N * CHMIX_MAX_IN], f16[N * CHMIX_MAX_IN];
+
+/** @return the largest distance between `a` and `b` */
+static float
+dist (const float *a, const float *b, size_t n)
+{
+    float d = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        d = fabsf (a[i] - b[i]) > d ? fabsf (a[i] - b[i]) : d;
+
+    return d;
+}
+
+/**
+ * @return true if the vector kernels and `chmix_apply` in each format agree
+ * with `mix_any` on noise of `channels` channels
+ */
+static bool
+kernels_ok (uint32_t channels, bool mono, int8_t balance)
+{
+    struct chmix_t mx;
+    uint32_t       seed = channels;
+    bool           ok   = chmix_init (&mx, channels, 0) == CHMIX_OK;
+
+    chmix_set (&mx, mono, balance);
+
+    for (size_t i = 0; i < N * channels; ++i) {
+        seed   = seed * 1664525 + 1013904223;
+        s16[i] = (int16_t)(seed >> 16);
+        s32[i] = (int32_t)s16[i] << 16;
+        flt[i] = s16[i];
+    }
+
+    mix_any (&mx, flt, ref, N);
+    mix_blocks_flt (&mx, flt, 3, N);
+    ok = ok && dist (flt, ref, N * mx.out) < 1e-2f;
+
+    mix_blocks_flt (&mx, s16, 1, N);
+    mix_blocks_flt (&mx, s32, 2, N);
+
+    for (size_t i = 0; ok && i < N * mx.out; ++i)
+        ok = abs (s16[i] - (int16_t)lrintf (ref[i])) <= 1
+             && llabs (s32[i] - (int64_t)(ref[i] * 65536)) <= 65536;
+
+    return ok;
+}
+
+/**
+ * the fixed path against the float one on noise of `channels` channels,
+ * gliding from `mono` and `balance` to the reverse over the first blocks.
+ * raises `e16` and `e32` to the largest differences, in LSB of S16
+ */
+static void
+fixed_err (uint32_t channels, bool mono, int8_t balance, double *e16,
+           double *e32)
+{
+    struct chmix_t mx, fx;
+    uint32_t       seed = channels * 7;
+
+    chmix_init (&mx, channels, 0);
+    chmix_set (&mx, mono, balance);
+    chmix_set (&mx, !mono, -balance);
+    fx = mx;
+
+    for (size_t i = 0; i < N * channels; ++i) {
+        seed   = seed * 1664525 + 1013904223;
+        s16[i] = f16[i] = (int16_t)(seed >> 16);
+        s32[i] = f32[i] = (int32_t)seed;
+    }
+
+    mix_blocks_flt (&mx, s16, 1, N);
+    mix_blocks_fixed (&fx, f16, 1, N);
+    for (size_t i = 0; i < N * mx.out; ++i)
+        *e16 = fmax (*e16, abs (s16[i] - f16[i]));
+
+    chmix_set (&mx, mono, balance);
+    chmix_set (&fx, mono, balance);
+    mix_blocks_flt (&mx, s32, 2, N);
+    mix_blocks_fixed (&fx, f32, 2, N);
+    for (size_t i = 0; i < N * mx.out; ++i)
+        *e32 = fmax (*e32, fabs ((double)s32[i] - f32[i]) / 65536);
+}
+
+int
+main (void)
+{
+    struct chmix_t mx;
+
+    // clang-format off
+    assert_nonfatal (chmix_init (&mx, 0, 0) == CHMIX_ERR && chmix_init (&mx, 9, 0) == CHMIX_ERR, "no channels and more than 8 should fail");
+    assert_nonfatal (chmix_init (&mx, 1, 0) == CHMIX_OK && mx.out == 1 && !chmix_active (&mx), "mono should go through as it is");
+    assert_nonfatal (chmix_init (&mx, 2, 0) == CHMIX_OK && mx.out == 2 && !chmix_active (&mx), "stereo should go through as it is");
+    chmix_set (&mx, false, 0);
+    assert_nonfatal (!chmix_active (&mx), "centered stereo should stay bypassed");
+
+    // 5.1: L R C LFE Ls Rs
+    assert_nonfatal (chmix_init (&mx, 6, 0) == CHMIX_OK && mx.out == 2 && chmix_active (&mx), "5.1 should mix to stereo");
+    const float sum = 1 + 2 * M3DB;
+    assert_nonfatal (fabsf (mx.m[0][0] - 1 / sum) < 1e-6f && mx.m[0][1] == 0 && fabsf (mx.m[0][2] - M3DB / sum) < 1e-6f && mx.m[0][3] == 0 && fabsf (mx.m[0][4] - M3DB / sum) < 1e-6f && mx.m[0][5] == 0, "5.1 should take front, -3 dB center and -3 dB surround to the left, and drop LFE");
+    assert_nonfatal (mx.m[1][1] == mx.m[0][0] && mx.m[1][2] == mx.m[0][2] && mx.m[1][5] == mx.m[0][4] && mx.m[1][0] == 0, "5.1 should mix the right the same way");
+
+    // every channel at full scale at once does not clip
+    for (size_t i = 0; i < 6 * CHMIX_BLK; ++i)
+        s16[i] = INT16_MAX;
+    chmix_apply (&mx, s16, 1, CHMIX_BLK);
+    bool full = true;
+    for (size_t i = 0; i < 2 * CHMIX_BLK; ++i)
+        full = full && s16[i] >= INT16_MAX - 1;
+    for (size_t i = 0; i < 6 * CHMIX_BLK; ++i)
+        s32[i] = INT32_MAX;
+    chmix_apply (&mx, s32, 2, CHMIX_BLK);
+    for (size_t i = 0; i < 2 * CHMIX_BLK; ++i)
+        full = full && s32[i] >= INT32_MAX - 256;
+    assert_nonfatal (full, "5.1 at full scale should be stereo at full scale, without wrapping");
+    for (size_t i = 0; i < 6 * CHMIX_BLK; ++i) {
+        s16[i] = INT16_MIN;
+        s32[i] = INT32_MIN;
+    }
+    mix_blocks_fixed (&mx, s16, 1, CHMIX_BLK);
+    mix_blocks_fixed (&mx, s32, 2, CHMIX_BLK);
+    full = true;
+    for (size_t i = 0; i < 2 * CHMIX_BLK; ++i)
+        full = full && s16[i] <= INT16_MIN + CHMIX_FIXED_ERR_LSB && s32[i] <= INT32_MIN + CHMIX_FIXED_ERR_LSB * 65536;
+    assert_nonfatal (full, "5.1 at negative full scale should not wrap on the fixed path");
+
+    // a layout in another channel order: LFE first
+    chmix_init (&mx, 3, CHMIX_FL | CHMIX_FR | CHMIX_LFE);
+    assert_nonfatal (mx.m[0][2] == 0 && mx.m[0][0] == 1 && mx.m[1][1] == 1, "2.1 should drop LFE and keep the fronts");
+    chmix_init (&mx, 3, CHMIX_FL | CHMIX_FR);
+    assert_nonfatal (mx.layout == layouts[3], "a layout of another channel count should be replaced");
+
+    // mono and balance on stereo, the first set jumping and the next gliding
+    chmix_init (&mx, 2, 0);
+    chmix_set (&mx, true, 0);
+    assert_nonfatal (mx.steps == 0 && mx.m[0][0] == 0.5f && mx.m[0][1] == 0.5f && mx.m[1][0] == 0.5f && mx.m[1][1] == 0.5f, "mono should take half of each side to both");
+    chmix_set (&mx, false, 100);
+    assert_nonfatal (mx.steps == CHMIX_GLIDE && mx.m[0][0] == 0.5f, "a later change should glide");
+    for (size_t i = 0; i < 2 * CHMIX_GLIDE * CHMIX_BLK; ++i)
+        s16[i] = 10000;
+    chmix_apply (&mx, s16, 1, CHMIX_GLIDE * CHMIX_BLK);
+    bool down = true;
+    for (size_t b = 1; b < CHMIX_GLIDE; ++b)
+        down = down && s16[2 * b * CHMIX_BLK] < s16[2 * (b - 1) * CHMIX_BLK];
+    assert_nonfatal (down && mx.steps == 0 && s16[2 * CHMIX_GLIDE * CHMIX_BLK - 2] == 0 && s16[2 * CHMIX_GLIDE * CHMIX_BLK - 1] == 10000, "full right should glide the left down to silence, a block at a time");
+    chmix_set (&mx, false, -100);
+    assert_nonfatal (mx.target[0][0] == 1 && mx.target[1][1] == 0, "full left should silence the right");
+    chmix_set (&mx, false, 50);
+    assert_nonfatal (mx.target[0][0] == 0.5f && mx.target[1][1] == 1, "half right should take the left down 6 dB");
+
+    // the vector kernels against the scalar one, with odd tails
+    assert_nonfatal (kernels_ok (2, false, 30) && kernels_ok (2, true, -70), "2->2 should match the scalar mix in every format");
+    assert_nonfatal (kernels_ok (6, false, 0) && kernels_ok (6, true, 20), "6->2 should match the scalar mix in every format");
+    assert_nonfatal (kernels_ok (8, false, -40) && kernels_ok (8, true, 0), "8->2 should match the scalar mix in every format");
+    assert_nonfatal (kernels_ok (5, false, 10) && kernels_ok (3, true, 0), "other shapes should match the scalar mix in every format");
+
+    // the fixed path against the float one, on every shape and gliding
+    double e16 = 0, e32 = 0;
+    fixed_err (2, false, 30, &e16, &e32);
+    fixed_err (2, true, -70, &e16, &e32);
+    fixed_err (6, false, 0, &e16, &e32);
+    fixed_err (8, false, -40, &e16, &e32);
+    fixed_err (8, true, 0, &e16, &e32);
+    fixed_err (5, false, 10, &e16, &e32);
+    fixed_err (3, true, 0, &e16, &e32);
+    printf ("fixed against float: s16 %.0f LSB, s32 %.2f\n", e16, e32);
+    assert_nonfatal (e16 <= CHMIX_FIXED_ERR_LSB && e32 <= CHMIX_FIXED_ERR_LSB, "the fixed path should match the float one within its bound");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -23,11 +23,14 @@ main (void)
     assert_nonfatal (config_init (cfgfile) == CONFIG_INIT_CREAT,
                      "config file should have been initialized");
 
+    ncap_config.version         = NCAP_CONFIG_VERSION;
     ncap_config.aaudio_optimize = 2; // power saving
     ncap_config.cur_track       = 0;
     ncap_config.isrepeat        = 0; // false
     ncap_config.isshuffle       = 0; // false
     ncap_config.volume          = 80;
+    ncap_config.trim_silence    = 1; // true
+    ncap_config.silence_keep_ms = 250;
     ncap_config.track_path      = "foo/bar";
     ncap_config.track_path_len  = strlen (ncap_config.track_path) + 1;
     ncap_config.ntracks         = 2;
@@ -59,6 +62,16 @@ main (void)
     assert_nonfatal (ncap_config.ntracks == 1, "ntracks should update");
     assert_nonfatal (memcmp (ncap_config.track_vols, vols, ncap_config.ntracks) == 0, "track volumes should match after update");
 
+    assert_nonfatal (config_deinit () == CONFIG_OK, "error with config_deinit");
+
+    FILE *fp = fopen (cfgfile, "rb+");
+    const uint32_t badver = NCAP_CONFIG_VERSION + 1;
+    fwrite (&badver, sizeof badver, 1, fp);
+    fclose (fp);
+    assert_nonfatal (config_init (cfgfile) == CONFIG_INIT_EXISTS, "config file should exist");
+    assert_nonfatal (config_read () == CONFIG_EVER, "config_read should reject other versions");
+    assert_nonfatal (ncap_config.ntracks == 1, "rejected config should not be loaded");
+    assert_nonfatal (config_write () == CONFIG_OK, "config_write should work");
     assert_nonfatal (config_deinit () == CONFIG_OK, "error with config_deinit");
     // clang-format on
 
@@ -74,8 +87,36 @@ main (void)
                          "tord and tord_r should be inverses");
     }
 
-    assert_nonfatal (config_tord_deinit () == CONFIG_OK,
-                     "tord_deinit should work");
+    // the position and the shuffle order survive a restart
+    size_t order[8];
+    for (size_t i = 0; i < ntracks; ++i)
+        order[i] = config_tord_at (i, NULL);
+
+    // clang-format off
+    assert_nonfatal (config_init (cfgfile) == CONFIG_INIT_EXISTS && config_read () == CONFIG_OK, "config should read back");
+    ncap_config.cur_track = 5;
+    assert_nonfatal (config_write () == CONFIG_OK && ncap_config.tord_len == ntracks, "config_write should save the shuffle order");
+    ncap_config.cur_track = 6;
+    assert_nonfatal (config_write_pos (0xfeed, 1234567) == CONFIG_OK, "config_write_pos should work");
+    ncap_config.cur_track = 0;
+    ncap_config.cur_frame = 0;
+    assert_nonfatal (config_tord_deinit () == CONFIG_OK, "tord_deinit should work");
+    assert_nonfatal (config_deinit () == CONFIG_OK, "error with config_deinit");
+
+    assert_nonfatal (config_init (cfgfile) == CONFIG_INIT_EXISTS && config_read () == CONFIG_OK, "config should read back");
+    assert_nonfatal (ncap_config.cur_track == 6 && ncap_config.cur_key == 0xfeed && ncap_config.cur_frame == 1234567, "the saved position should read back");
+    assert_nonfatal (config_tord_init (ntracks, 99) == CONFIG_TORD_SAVED, "tord_init should take the saved order");
+    bool same = true;
+    for (size_t i = 0; i < ntracks; ++i)
+        same &= config_tord_at (i, NULL) == order[i] && config_tord_r_at (order[i], NULL) == i;
+    assert_nonfatal (same, "the saved order should be the one written");
+    assert_nonfatal (config_tord_deinit () == CONFIG_OK, "tord_deinit should work");
+    assert_nonfatal (config_tord_init (ntracks, 99) == CONFIG_OK, "the saved order should only be taken once");
+    assert_nonfatal (config_tord_deinit () == CONFIG_OK, "tord_deinit should work");
+    assert_nonfatal (config_read () == CONFIG_OK && config_tord_init (ntracks + 1, 99) == CONFIG_OK, "a saved order for other tracks should be dropped");
+    assert_nonfatal (config_tord_deinit () == CONFIG_OK, "tord_deinit should work");
+    assert_nonfatal (config_deinit () == CONFIG_OK, "error with config_deinit");
+    // clang-format on
 
     report ();
 
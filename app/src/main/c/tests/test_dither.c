@@ -0,0 +1,140 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../dither.c"
+
+#define N 48003 // samples, an odd tail past whole blocks and vectors
+
+static float   flt[N];
+static int32_t s32[N];
+static int16_t s16[N];
+
+/** @return the mean of `n` samples of `p` */
+static double
+mean (const int16_t *p, size_t n)
+{
+    double sum = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        sum += p[i];
+
+    return sum / n;
+}
+
+int
+main (void)
+{
+    struct dither_t dt, ref;
+
+    // clang-format off
+    assert_nonfatal (dither_init (&dt, 1, 2, DITHER_TPDF) == DITHER_ERR && dither_init (&dt, 3, 0, DITHER_TPDF) == DITHER_ERR && dither_init (&dt, 3, 9, DITHER_TPDF) == DITHER_ERR && dither_init (&dt, 3, 2, DITHER_OFF) == DITHER_ERR, "S16 input, no channels, more than 8 and no dither should fail");
+
+    // the vector generator draws what four scalar xorshift32s would
+    dither_init (&dt, 3, 1, DITHER_TPDF);
+    dither_init (&ref, 3, 1, DITHER_TPDF);
+    float d[DITHER_BLK * DITHER_MAX_CH];
+    bool  same = true, tri = true;
+    double dsum = 0, dsq = 0;
+    for (int r = 0; r < 100; ++r) {
+        noise (&dt, d, 64);
+        for (size_t i = 0; i < 64; ++i) {
+            uint32_t *const a = &ref.rng[0][i % 4], *const b = &ref.rng[1][i % 4];
+            *a ^= *a << 13; *a ^= *a >> 17; *a ^= *a << 5;
+            *b ^= *b << 13; *b ^= *b >> 17; *b ^= *b << 5;
+            same = same && d[i] == ((float)(int32_t)*a + (float)(int32_t)*b) * 0x1p-32f;
+            tri  = tri && d[i] >= -1 && d[i] < 1;
+            dsum += d[i];
+            dsq  += d[i] * d[i];
+        }
+    }
+    printf ("noise: mean %.4f, variance %.4f, 1/6 expected\n", dsum / 6400, dsq / 6400);
+    assert_nonfatal (same, "the vector generator should match the scalar one");
+    assert_nonfatal (tri && fabs (dsum / 6400) < 0.02 && fabs (dsq / 6400 - 1 / 6.0) < 0.01, "noise should be triangular over (-1, 1) steps");
+
+    // silence dithers to -1, 0 and 1, a quarter of it not 0
+    memset (flt, 0, sizeof flt);
+    dither_init (&dt, 3, 2, DITHER_TPDF);
+    dither_apply (&dt, s16, flt, N / 2);
+    size_t loud = 0, nonzero = 0;
+    for (size_t i = 0; i < N / 2 * 2; ++i) {
+        loud += abs (s16[i]) > 1;
+        nonzero += s16[i] != 0;
+    }
+    printf ("silence: %.3f of samples not 0\n", (double)nonzero / (N / 2 * 2));
+    assert_nonfatal (loud == 0 && fabs ((double)nonzero / (N / 2 * 2) - 0.25) < 0.02, "TPDF should add at most a step");
+
+    // a level between steps comes out on average, where rounding loses it
+    for (size_t i = 0; i < N; ++i)
+        flt[i] = 0.3f / 32768;
+    dither_init (&dt, 3, 1, DITHER_TPDF);
+    dither_apply (&dt, s16, flt, N);
+    printf ("0.3 steps: %.4f on average\n", mean (s16, N));
+    assert_nonfatal (fabs (mean (s16, N) - 0.3) < 0.02, "TPDF should keep levels below a step");
+
+    // shaped, the error sums to its last, so the running sum never drifts
+    dither_init (&dt, 3, 1, DITHER_SHAPED);
+    dither_apply (&dt, s16, flt, N);
+    double run = 0, worst = 0;
+    for (size_t i = 0; i < N; ++i) {
+        run  += s16[i] - 0.3;
+        worst = fabs (run) > worst ? fabs (run) : worst;
+    }
+    dither_init (&ref, 3, 1, DITHER_TPDF);
+    dither_apply (&ref, s16, flt, N);
+    double twalk = 0, tworst = 0;
+    for (size_t i = 0; i < N; ++i) {
+        twalk  += s16[i] - 0.3;
+        tworst = fabs (twalk) > tworst ? fabs (twalk) : tworst;
+    }
+    printf ("running error: shaped %.2f, TPDF %.2f steps at most\n", worst, tworst);
+    assert_nonfatal (worst <= 1.5 + 1e-3 && tworst > 10, "shaping should push the error out of the low frequencies");
+
+    // in place, scaled, saturating, and the vector path agrees with the
+    // scalar one on the same noise
+    uint32_t seed = 1;
+    for (size_t i = 0; i < N; ++i) {
+        seed   = seed * 1664525 + 1013904223;
+        s32[i] = (int32_t)seed;
+        flt[i] = (int32_t)seed / 2147483648.0f * 1.25f;
+    }
+    static int32_t w32[N];
+    static float   wflt[N];
+    memcpy (w32, s32, sizeof s32);
+    memcpy (wflt, flt, sizeof flt);
+    dither_init (&dt, 2, 2, DITHER_TPDF);
+    dither_init (&ref, 2, 2, DITHER_TPDF);
+    dither_apply (&dt, (int16_t *)w32, w32, N / 2);
+    bool close = true;
+    for (size_t f = 0; f < N / 2; f += DITHER_BLK) {
+        const size_t n = N / 2 - f < DITHER_BLK ? N / 2 - f : DITHER_BLK;
+        noise (&ref, d, n * 2);
+        for (size_t i = 0; i < n * 2; ++i)
+            close = close && abs (((int16_t *)w32)[f * 2 + i] - quant_s16 (s32[f * 2 + i] / 65536.0f + d[i])) <= 1;
+    }
+    assert_nonfatal (close, "S32 should be scaled down, in place, as the scalar path does");
+    dither_init (&dt, 3, 2, DITHER_TPDF);
+    dither_init (&ref, 3, 2, DITHER_TPDF);
+    dither_apply (&dt, (int16_t *)wflt, wflt, N / 2);
+    close = true;
+    bool sat = true;
+    for (size_t f = 0; f < N / 2; f += DITHER_BLK) {
+        const size_t n = N / 2 - f < DITHER_BLK ? N / 2 - f : DITHER_BLK;
+        noise (&ref, d, n * 2);
+        for (size_t i = 0; i < n * 2; ++i) {
+            const int16_t q = ((int16_t *)wflt)[f * 2 + i];
+            close = close && abs (q - quant_s16 (flt[f * 2 + i] * 32768 + d[i])) <= 1;
+            sat   = sat && (flt[f * 2 + i] < 1.01f || q == INT16_MAX) && (flt[f * 2 + i] > -1.01f || q == INT16_MIN);
+        }
+    }
+    assert_nonfatal (close, "float should be scaled up, in place, as the scalar path does");
+    assert_nonfatal (sat, "float past full scale should saturate");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../eq.c"
+
+#define RATE 48000
+#define N    9600 // frames, 200 ms
+
+static float l[N * 2], m[N];
+
+/** a stereo sine of `freq` Hz at `amp`, both channels alike */
+static void
+sine (float *buf, size_t n, double freq, float amp)
+{
+    for (size_t i = 0; i < n; ++i)
+        buf[2 * i] = buf[2 * i + 1] = amp * sin (2 * M_PI * freq * i / RATE);
+}
+
+/** peak of the second half, past the transient */
+static float
+peak (const float *buf, size_t n)
+{
+    float p = 0;
+
+    for (size_t i = n; i < 2 * n; ++i)
+        p = fmaxf (p, fabsf (buf[i]));
+
+    return p;
+}
+
+/** a stereo eq already on `bands`, with no glide */
+static void
+settled (struct eq_t *eq, const struct eq_band_t *bands, size_t nbands,
+         int16_t preamp)
+{
+    eq_init (eq, 2, RATE);
+    eq_set (eq, bands, nbands, preamp);
+    memcpy (eq->c, eq->target, sizeof eq->c);
+    eq->gliding = false;
+    quantize (eq);
+}
+
+/** @return the gain of `bands` at `freq`, in dB */
+static double
+response (const struct eq_band_t *bands, size_t nbands, double freq)
+{
+    struct eq_t eq;
+
+    settled (&eq, bands, nbands, 0);
+
+    sine (l, N, freq, 0.25f);
+    eq_apply (&eq, l, 3, N);
+
+    return 20 * log10 (peak (l, N) / 0.25f);
+}
+
+int
+main (void)
+{
+    struct eq_t eq;
+
+    const struct eq_band_t peak1k = { EQ_PEAK, 0, 60, 1000, 100 };
+    const struct eq_band_t lo200  = { EQ_LOSHELF, 0, 60, 200, 70 };
+    const struct eq_band_t hi5k   = { EQ_HISHELF, 0, -60, 5000, 70 };
+
+    // clang-format off
+    assert_nonfatal (eq_init (&eq, 2, RATE) == EQ_OK && !eq_active (&eq), "a new eq should be flat");
+    assert_nonfatal (eq_init (&eq, EQ_MAX_CH + 1, RATE) == EQ_ERR, "too many channels should fail");
+
+    // flat is bit exact, and off bands cost nothing
+    static int16_t s16[N * 2], o16[N * 2];
+    for (size_t i = 0; i < N * 2; ++i)
+        s16[i] = o16[i] = (int16_t)(i * 331);
+    eq_init (&eq, 2, RATE);
+    eq_set (&eq, eq_presets[EQ_PRESET_FLAT], EQ_MAX_BANDS, 0);
+    eq_apply (&eq, o16, 1, N);
+    assert_nonfatal (!eq_active (&eq) && memcmp (s16, o16, sizeof s16) == 0, "the flat preset should leave samples alone");
+
+    // magnitude responses of each filter type
+    assert_nonfatal (fabs (response (&peak1k, 1, 1000) - 6) < 0.1, "a 6 dB peak should boost its center by 6 dB");
+    assert_nonfatal (fabs (response (&peak1k, 1, 100)) < 0.3, "a peak should leave far frequencies alone");
+    assert_nonfatal (fabs (response (&lo200, 1, 30) - 6) < 0.3, "a low shelf should boost below its corner");
+    assert_nonfatal (fabs (response (&lo200, 1, 5000)) < 0.1, "a low shelf should leave highs alone");
+    assert_nonfatal (fabs (response (&hi5k, 1, 18000) + 6) < 0.3, "a high shelf should cut above its corner");
+    assert_nonfatal (fabs (response (&hi5k, 1, 200)) < 0.1, "a high shelf should leave lows alone");
+    const struct eq_band_t both[] = { peak1k, { EQ_OFF, 0, 0, 0, 0 }, lo200 };
+    assert_nonfatal (fabs (response (both, 3, 1000) - 6 - response (&lo200, 1, 1000)) < 0.2, "cascaded bands should add in dB");
+
+    // the stereo vector kernel against the scalar one, per channel
+    for (size_t i = 0; i < N; ++i) {
+        l[2 * i]     = sinf (i * 0.05f) * 0.5f;
+        l[2 * i + 1] = m[i] = cosf (i * 0.013f) * 0.5f;
+    }
+    eq_init (&eq, 2, RATE);
+    eq_set (&eq, eq_presets[EQ_PRESET_LOUD], EQ_MAX_BANDS, -30);
+    eq_apply (&eq, l, 3, N);
+    struct eq_t mono;
+    eq_init (&mono, 1, RATE);
+    eq_set (&mono, eq_presets[EQ_PRESET_LOUD], EQ_MAX_BANDS, -30);
+    eq_apply (&mono, m, 3, N);
+    float err = 0;
+    for (size_t i = 0; i < N; ++i)
+        err = fmaxf (err, fabsf (l[2 * i + 1] - m[i]));
+    assert_nonfatal (err < 1e-5f, "the stereo kernel should match the scalar one");
+
+    // new settings glide in instead of stepping
+    eq_init (&eq, 2, RATE);
+    sine (l, N, 1000, 0.25f);
+    eq_set (&eq, &peak1k, 1, 0);
+    assert_nonfatal (eq.gliding && eq_active (&eq), "new settings should glide");
+    eq_apply (&eq, l, 3, EQ_BLK);
+    assert_nonfatal (fabsf (eq.c[0][0] - 1) > 0 && fabsf (eq.c[0][0] - eq.target[0][0]) > 0.5f * fabsf (1 - eq.target[0][0]), "a block should only go part of the way");
+    eq_apply (&eq, l + EQ_BLK * 2, 3, N - EQ_BLK);
+    assert_nonfatal (!eq.gliding && memcmp (eq.c, eq.target, sizeof eq.c) == 0, "the glide should end on the target within 200 ms");
+    float step = 0;
+    for (size_t i = 2; i < N * 2; i += 2)
+        step = fmaxf (step, fabsf (l[i] - l[i - 2]));
+    assert_nonfatal (step < 0.25f * 2 * 2 * M_PI * 1000 / RATE * 1.1, "the glide should not step the waveform");
+
+    eq_set (&eq, NULL, 0, 0);
+    eq_apply (&eq, l, 3, N);
+    assert_nonfatal (!eq_active (&eq), "going flat should glide and then idle");
+
+    // integer formats saturate instead of wrapping
+    for (size_t i = 0; i < N; ++i)
+        s16[2 * i] = s16[2 * i + 1] = 30000 * sin (2 * M_PI * 1000.0 * i / RATE);
+    const struct eq_band_t boost = { EQ_PEAK, 0, 120, 1000, 100 };
+    eq_init (&eq, 2, RATE);
+    eq_set (&eq, &boost, 1, 0);
+    eq_apply (&eq, s16, 1, N);
+    int wraps = 0;
+    for (size_t i = 2; i < N * 2; ++i)
+        wraps += abs (s16[i] - s16[i - 2]) > 40000;
+    assert_nonfatal (wraps == 0 && s16[2 * (N - 1) - 2 * 12] != 0, "a 12 dB boost should clip, not wrap");
+
+    // every preset stays stable on noise at every rate
+    int ok = 1;
+    const uint32_t rates[] = { 22050, 44100, 48000, 96000 };
+    for (int p = 0; p < EQ_NPRESETS; ++p)
+        for (int k = 0; k < 4; ++k) {
+            uint32_t x = 1;
+            for (size_t i = 0; i < N * 2; ++i)
+                l[i] = (int32_t)(x = x * 1664525u + 1013904223u) / 2147483648.0f;
+            eq_init (&eq, 2, rates[k]);
+            eq_set (&eq, eq_presets[p], EQ_MAX_BANDS, 0);
+            eq_apply (&eq, l, 3, N);
+            ok &= isfinite (l[N * 2 - 1]) && peak (l, N) < 8;
+        }
+    assert_nonfatal (ok, "presets should be stable");
+
+    // the fixed path against the float one, on every preset in every
+    // format. glides differ between the two forms, so both start settled
+    static int16_t f16[N * 2];
+    static int32_t s32[N * 2], f32[N * 2];
+    static float   flt[N * 2];
+    double         e16 = 0, e32 = 0, eflt = 0;
+    for (int p = 1; p < EQ_NPRESETS; ++p) {
+        uint32_t x = 7;
+        for (size_t i = 0; i < N * 2; ++i) {
+            s16[i] = f16[i] = (int16_t)((x = x * 1664525u + 1013904223u) >> 16) / 4;
+            s32[i] = f32[i] = s16[i] * 65536;
+            l[i] = flt[i] = s16[i] / 32768.0f;
+        }
+        for (int fmt = 1; fmt <= 3; ++fmt) {
+            void *const bufs[][2] = { { s16, f16 }, { s32, f32 }, { l, flt } };
+            struct eq_t fx;
+            settled (&eq, eq_presets[p], EQ_MAX_BANDS, -30);
+            settled (&fx, eq_presets[p], EQ_MAX_BANDS, -30);
+            apply_flt (&eq, bufs[fmt - 1][0], fmt, N);
+            apply_fixed (&fx, bufs[fmt - 1][1], fmt, N);
+        }
+        for (size_t i = 0; i < N * 2; ++i) {
+            e16  = fmax (e16, abs (s16[i] - f16[i]));
+            e32  = fmax (e32, fabs ((double)s32[i] - f32[i]) / 65536);
+            eflt = fmax (eflt, fabs (l[i] - flt[i]) * 32768);
+        }
+    }
+    printf ("fixed against float: s16 %.0f LSB, s32 %.2f, flt %.2f\n", e16, e32, eflt);
+    assert_nonfatal (e16 <= EQ_FIXED_ERR_LSB && e32 <= EQ_FIXED_ERR_LSB && eflt <= EQ_FIXED_ERR_LSB, "the fixed path should match the float one within its bound");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
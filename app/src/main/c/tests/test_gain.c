@@ -0,0 +1,88 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../gain.c"
+
+#define N 203 // frames, odd to cover the scalar tails
+
+int
+main (void)
+{
+    static int16_t s16[N * 2], o16[N * 2];
+    static int32_t s32[N * 2], o32[N * 2];
+    static float   flt[N * 2], oflt[N * 2];
+
+    for (int i = 0; i < N * 2; ++i) {
+        s16[i] = (int16_t)(i * 331 - 32768);
+        s32[i] = (int32_t)((uint32_t)i * 21170639u);
+        flt[i] = s16[i] / 32768.0f;
+    }
+
+    s16[0] = INT16_MIN;
+    s16[1] = INT16_MAX;
+    s32[0] = INT32_MIN;
+    s32[1] = INT32_MAX;
+
+    struct gain_t g;
+    gain_init (&g);
+
+    // clang-format off
+    assert_nonfatal (gain_set (&g, 100, 100) && g.cur == 1.0f, "first gain should apply at once");
+    assert_nonfatal (!gain_set (&g, 100, 100), "same volumes should not recompute");
+
+    gain_apply (&g, o16, s16, 1, N, 2);
+    assert_nonfatal (memcmp (o16, s16, sizeof s16) == 0, "unity gain should copy");
+
+    gain_set (&g, 50, 100);
+    const float half = gain_scale (50, 100);
+    assert_nonfatal (fabsf (half - powf (0.5f, 0.67f)) < 1e-6f, "scale should follow stevens's law");
+
+    // the burst after a change ramps, per frame, up to the new gain
+    gain_apply (&g, o16, s16, 1, N, 2);
+    assert_nonfatal (g.cur == half, "ramp should end at the target");
+    assert_nonfatal (o16[2 * (N - 1)] == mul_s16 (s16[2 * (N - 1)], q15 (half)), "last frame should be at the target");
+    assert_nonfatal (abs (o16[2] - mul_s16 (s16[2], q15 (1 - (1 - half) * 2 / N))) <= 1, "first frames should be near the old gain");
+    assert_nonfatal (o16[4] == mul_s16 (s16[4], q15 (1 + (half - 1) * 3 / N)) && o16[5] == mul_s16 (s16[5], q15 (1 + (half - 1) * 3 / N)), "channels of a frame should share a gain");
+
+    // steady state, vector kernels against the scalar ones
+    int ok = 1;
+    gain_apply (&g, o16, s16, 1, N, 2);
+    for (int i = 0; i < N * 2; ++i)
+        ok &= o16[i] == mul_s16 (s16[i], q15 (half));
+    assert_nonfatal (ok, "s16 kernel should match scalar Q15");
+    assert_nonfatal (o16[0] == -q15 (half) && o16[1] > 0, "s16 extremes should scale without wrapping");
+
+    g.cur = g.target; // formats share a gain; skip the ramp for s32 and flt
+    gain_apply (&g, o32, s32, 2, N, 2);
+    for (int i = 0; i < N * 2; ++i)
+        ok &= o32[i] == mul_s32 (s32[i], q31 (half));
+    assert_nonfatal (ok, "s32 kernel should match scalar Q31");
+    assert_nonfatal (o32[0] < 0 && o32[1] > 0 && fabs (o32[1] / 2147483647.0 - half) < 1e-6, "s32 extremes should scale without wrapping");
+
+    gain_apply (&g, oflt, flt, 3, N, 2);
+    for (int i = 0; i < N * 2; ++i)
+        ok &= oflt[i] == flt[i] * half;
+    assert_nonfatal (ok, "flt kernel should match scalar");
+
+    memcpy (o16, s16, sizeof s16);
+    gain_apply (&g, o16, o16, 1, N, 2);
+    assert_nonfatal (o16[7] == mul_s16 (s16[7], q15 (half)), "gain should work in place");
+
+    assert_nonfatal (mul_s16 (INT16_MIN, INT16_MIN) == INT16_MAX, "s16 multiply should saturate");
+    assert_nonfatal (mul_s32 (INT32_MIN, INT32_MIN) == INT32_MAX, "s32 multiply should saturate");
+
+    gain_set (&g, 0, 100);
+    g.cur = 0;
+    gain_apply (&g, o32, s32, 2, N, 2);
+    for (int i = 0; i < N * 2; ++i)
+        ok &= o32[i] == 0;
+    assert_nonfatal (ok, "zero gain should silence");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.c"
+
+// each module has its own `FILENAME`, for logging on Android alone
+#define FILENAME FILENAME_headcache __attribute__ ((unused))
+#include "../headcache.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_trackdb __attribute__ ((unused))
+#include "../trackdb.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_thrctl __attribute__ ((unused))
+#include "../thrctl.c"
+#undef FILENAME
+
+#define FILENAME FILENAME_config __attribute__ ((unused))
+#include "../algs.c"
+#include "../config.c"
+#undef FILENAME
+
+#define PREFIX "music"
+#define HEAD   (48000 * NCAP_HEAD_MS / 1000)
+
+/** each track is 5 s of stereo S16, sample `i` of track `t` being `t + i` */
+static char *names[] = { "t0", "t1", "t2", "t3", "t4", "t5", "bad" };
+static const strvec_t sv = { .cap = 7, .siz = 7, .ptr = names };
+
+/** tracks opened, in order, and how many */
+static size_t     opened[64];
+static atomic_int nopened;
+
+/** while set, `pipeline_open` waits */
+static pthread_mutex_t hold_mx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  hold_cv = PTHREAD_COND_INITIALIZER;
+static bool            hold;
+
+/** what the last `pipeline_prime` was given */
+static int16_t primed[HEAD * 2];
+static size_t  nprimed;
+
+int
+pipeline_open (struct pipeline_t *pl, const char *fn, const char *fn_cache,
+               uint64_t start)
+{
+    (void)fn_cache;
+    (void)start;
+
+    pthread_mutex_lock (&hold_mx);
+    while (hold)
+        pthread_cond_wait (&hold_cv, &hold_mx);
+    pthread_mutex_unlock (&hold_mx);
+
+    const char *const name = fn + strlen (PREFIX "/");
+
+    if (strcmp (name, "bad") == 0)
+        return NCAP_EIO;
+
+    opened[atomic_fetch_add (&nopened, 1)] = name[1] - '0';
+
+    *pl = (struct pipeline_t){
+        .fmt = 1, .channels = 2, .sample_rate = 48000, .width = 2, .blk = 4,
+        .key = trackdb_key (fn), .top = true,
+        .trim = ncap_config.trim_silence,
+        .keep = (uint64_t)ncap_config.silence_keep_ms * 48000 / 1000,
+        .start = name[1] - '0', // the track, for `pipeline_read`
+    };
+
+    return NCAP_OK;
+}
+
+size_t
+pipeline_read (struct pipeline_t *pl, void *buf, size_t nframes)
+{
+    int16_t *p = buf;
+
+    if (nframes > 48000 * 5 - pl->read)
+        nframes = 48000 * 5 - pl->read;
+
+    for (size_t i = pl->read * 2; i < (pl->read + nframes) * 2; ++i)
+        *p++ = pl->start + i;
+
+    pl->read += nframes;
+
+    return nframes;
+}
+
+int
+pipeline_prime (struct pipeline_t *pl, const void *pcm, size_t nframes)
+{
+    (void)pl;
+
+    memcpy (primed, pcm, nframes * 4);
+    nprimed = nframes;
+
+    return NCAP_OK;
+}
+
+void
+pipeline_close (struct pipeline_t *pl)
+{
+    (void)pl;
+}
+
+static void
+set_hold (bool on)
+{
+    pthread_mutex_lock (&hold_mx);
+    hold = on;
+    pthread_cond_broadcast (&hold_cv);
+    pthread_mutex_unlock (&hold_mx);
+}
+
+/**
+ * @return whether the head thread has had nothing left to do for 20 ms
+ * within a second. an ask taken off the queue is not busy yet for a moment
+ */
+static bool
+settle (void)
+{
+    const struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+    int                   quiet = 0;
+
+    for (int k = 0; k < 1000; ++k) {
+        bool idle = nwant == 0;
+
+        pthread_mutex_lock (&mx);
+        for (size_t s = 0; s < NCAP_HEAD_SLOTS; ++s)
+            idle = idle && !heads[s].busy;
+        pthread_mutex_unlock (&mx);
+
+        if ((quiet = idle ? quiet + 1 : 0) == 20)
+            return true;
+
+        nanosleep (&ts, NULL);
+    }
+
+    return false;
+}
+
+/** @return frames primed into a pipeline just opened on track `t` */
+static size_t
+prime (size_t t)
+{
+    struct pipeline_t pl;
+    char              fn[64];
+
+    snprintf (fn, sizeof fn, PREFIX "/%s", names[t]);
+    nprimed = 0;
+
+    if (pipeline_open (&pl, fn, NULL, 0) != NCAP_OK)
+        return 0;
+
+    atomic_fetch_sub (&nopened, 1);
+
+    return headcache_prime (&pl);
+}
+
+/** @return whether the last head primed is that of track `t` */
+static bool
+primed_ok (size_t t)
+{
+    bool ok = nprimed == HEAD;
+
+    for (size_t i = 0; ok && i < HEAD * 2; ++i)
+        ok = primed[i] == (int16_t)(t + i);
+
+    return ok;
+}
+
+int
+main (void)
+{
+    ncap_config.trim_silence    = 1;
+    ncap_config.silence_keep_ms = 100;
+
+    // clang-format off
+    assert_nonfatal (headcache_start (PREFIX, &sv) == 0, "the head thread should start");
+
+    // a head asked for is decoded once, and primes its track from the top
+    headcache_want (0, false);
+    headcache_want (0, false);
+    assert_nonfatal (settle () && nopened == 1 && opened[0] == 0, "a head should be decoded once");
+    headcache_want (0, false);
+    assert_nonfatal (settle () && nopened == 1, "a cached head should not be decoded again");
+    assert_nonfatal (prime (0) == HEAD && primed_ok (0), "the head should prime its track with its first frames");
+    assert_nonfatal (prime (1) == 0 && nprimed == 0, "a track without a head should not be primed");
+
+    // only a pipeline as the head was decoded
+    struct pipeline_t pl;
+    pipeline_open (&pl, PREFIX "/t0", NULL, 0);
+    atomic_fetch_sub (&nopened, 1);
+    pl.read = 1;
+    assert_nonfatal (headcache_prime (&pl) == 0, "a track already read from should not be primed");
+    pl.read = 0;
+    pl.top  = false;
+    assert_nonfatal (headcache_prime (&pl) == 0, "a track opened past the top should not be primed");
+    pl.top  = true;
+    pl.fmt  = 3;
+    assert_nonfatal (headcache_prime (&pl) == 0, "another format should not be primed");
+    pl.fmt  = 1;
+    pl.trim = false;
+    assert_nonfatal (headcache_prime (&pl) == 0, "other trimming should not be primed");
+    ncap_config.silence_keep_ms = 200;
+    assert_nonfatal (prime (0) == 0, "another kept pad should not be primed");
+    headcache_want (0, false);
+    assert_nonfatal (settle () && nopened == 2 && prime (0) == HEAD, "trimming changed, the head should be decoded again");
+    ncap_config.silence_keep_ms = 100;
+
+    // a track that does not open has no head
+    headcache_want (6, false);
+    headcache_want (7, false);
+    bool none = settle ();
+    for (size_t s = 0; s < NCAP_HEAD_SLOTS; ++s)
+        none = none && heads[s].key != trackdb_key (PREFIX "/bad");
+    assert_nonfatal (none, "a track that does not open should have no head");
+
+    // the least recently used head goes first
+    atomic_store (&nopened, 0);
+    for (size_t t = 1; t <= NCAP_HEAD_SLOTS; ++t)
+        headcache_want (t, false);
+    assert_nonfatal (settle () && nopened == NCAP_HEAD_SLOTS, "each head asked for should be decoded");
+    assert_nonfatal (prime (0) == 0 && prime (1) == HEAD && primed_ok (1) && prime (NCAP_HEAD_SLOTS) == HEAD, "the least recently used head should be evicted");
+
+    // a tap goes ahead of the heads asked for in play order
+    headcache_deinit ();
+    headcache_start (PREFIX, &sv);
+    atomic_store (&nopened, 0);
+    set_hold (true);
+    headcache_want (5, false);
+    while (nwant > 0)
+        sched_yield ();
+    headcache_want (0, false);
+    headcache_want (2, false);
+    headcache_want (3, true);
+    assert_nonfatal (nwant == 3 && want[0] == 3 && want[1] == 0, "a tap should be asked for first");
+    for (size_t t = 0; t <= NCAP_HEAD_SLOTS; ++t)
+        headcache_want (t, true);
+    assert_nonfatal (nwant == NCAP_HEAD_SLOTS && want[0] == NCAP_HEAD_SLOTS && want[NCAP_HEAD_SLOTS - 1] == 1, "asks past the slots should drop the last");
+    set_hold (false);
+    bool order = settle () && nopened == NCAP_HEAD_SLOTS + 1 && opened[0] == 5;
+    for (size_t k = 1; order && k <= NCAP_HEAD_SLOTS; ++k)
+        order = opened[k] == NCAP_HEAD_SLOTS + 1 - k;
+    assert_nonfatal (order, "heads should be decoded in the order asked for");
+    assert_nonfatal (prime (1) == HEAD && primed_ok (1) && prime (5) == 0, "the head taken before the taps should be the one evicted");
+
+    headcache_deinit ();
+    headcache_want (0, true);
+    assert_nonfatal (nwant == 0 && prime (5) == 0, "a stopped cache should ask for nothing and prime nothing");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
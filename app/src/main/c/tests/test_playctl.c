@@ -0,0 +1,92 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "test.c"
+
+#include "../playctl.c"
+
+static struct playctl_t c;
+
+static inline uint64_t
+ms_since (const struct timespec *t0)
+{
+    struct timespec t1;
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000
+           + (t1.tv_nsec - t0->tv_nsec) / 1000000;
+}
+
+static void *
+pauser (void *arg)
+{
+    (void)arg;
+
+    const struct timespec ts = { .tv_sec = 0, .tv_nsec = 20000000 };
+    nanosleep (&ts, NULL);
+    playctl_clear (&c, PLAYCTL_PLAY);
+
+    return NULL;
+}
+
+static void *
+resumer (void *arg)
+{
+    (void)arg;
+
+    const struct timespec ts = { .tv_sec = 0, .tv_nsec = 20000000 };
+    nanosleep (&ts, NULL);
+
+    // not waited on: must not end the wait
+    playctl_set (&c, PLAYCTL_INT);
+    nanosleep (&ts, NULL);
+    playctl_set (&c, PLAYCTL_PLAY);
+
+    return NULL;
+}
+
+int
+main (void)
+{
+    // clang-format off
+    assert_nonfatal (sizeof c == 64 && _Alignof (struct playctl_t) == 64, "control word should have its own cache line");
+
+    playctl_init (&c, 0);
+    assert_nonfatal (playctl_get (&c) == 0, "playctl_init should set the word");
+    assert_nonfatal (playctl_set (&c, PLAYCTL_PLAY) == 0, "playctl_set should return the previous bits");
+    assert_nonfatal (playctl_get (&c) == PLAYCTL_PLAY, "playctl_set should set bits");
+    assert_nonfatal (!playctl_take (&c, PLAYCTL_INT), "playctl_take should see unset bits");
+    playctl_set (&c, PLAYCTL_INT);
+    assert_nonfatal (playctl_take (&c, PLAYCTL_INT), "playctl_take should see set bits");
+    assert_nonfatal (playctl_get (&c) == PLAYCTL_PLAY, "playctl_take should clear the bit");
+    assert_nonfatal (playctl_wait (&c, PLAYCTL_PLAY) == PLAYCTL_PLAY, "playctl_wait should not sleep on set bits");
+
+    playctl_clear (&c, PLAYCTL_PLAY);
+    assert_nonfatal (playctl_get (&c) == 0, "playctl_clear should clear bits");
+
+    pthread_t tid;
+    pthread_create (&tid, NULL, resumer, NULL);
+
+    const uint32_t w = playctl_wait (&c, PLAYCTL_PLAY | PLAYCTL_CLOSE);
+    pthread_join (tid, NULL);
+
+    assert_nonfatal (w == (PLAYCTL_PLAY | PLAYCTL_INT), "playctl_wait should wake on a waited-for bit");
+    assert_nonfatal (!(atomic_load (&c.word) & PLAYCTL_WAITERS), "playctl_wait should drop its waiter flag");
+
+    struct timespec t0;
+    playctl_take (&c, PLAYCTL_INT);
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    assert_nonfatal (playctl_sleep (&c, PLAYCTL_PLAY, 30000000) == PLAYCTL_PLAY && ms_since (&t0) >= 29, "playctl_sleep should sleep out its time");
+    assert_nonfatal (playctl_sleep (&c, 0, 30000000) == PLAYCTL_PLAY, "playctl_sleep should not sleep on another word");
+
+    pthread_create (&tid, NULL, pauser, NULL);
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    assert_nonfatal (playctl_sleep (&c, PLAYCTL_PLAY, 1000000000) == 0 && ms_since (&t0) < 500, "playctl_clear should end a playctl_sleep");
+    pthread_join (tid, NULL);
+    assert_nonfatal (!(atomic_load (&c.word) & PLAYCTL_WAITERS), "playctl_sleep should drop its waiter flag");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
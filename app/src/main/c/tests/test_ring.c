@@ -0,0 +1,97 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../ring.c"
+
+#define N 1000000
+
+static struct ring_t r;
+
+/** writes the bytes `i & 0xff` for i in [0, N), in odd-sized pieces */
+static void *
+producer (void *arg)
+{
+    (void)arg;
+
+    uint8_t buf[37];
+    size_t  i = 0;
+
+    while (i < N) {
+        size_t n = N - i < sizeof buf ? N - i : sizeof buf;
+
+        for (size_t k = 0; k < n; ++k)
+            buf[k] = (i + k) & 0xff;
+
+        for (size_t off = 0; off < n;)
+            off += ring_write (&r, buf + off, n - off);
+
+        i += n;
+    }
+
+    return NULL;
+}
+
+int
+main (void)
+{
+    uint8_t out[64];
+
+    // clang-format off
+    assert_fatal (ring_init (&r, 12) == RING_OK, "ring_init should work", exit);
+    assert_nonfatal (ring_cap (&r) == 16, "capacity should round up to a power of two");
+    assert_nonfatal (ring_read (&r, out, 4) == 0, "new ring should be empty");
+    assert_nonfatal (ring_write (&r, "abcdefghij", 10) == 10, "ring should take what fits");
+    assert_nonfatal (ring_write (&r, "klmnopqrst", 10) == 6, "full ring should take a partial write");
+    assert_nonfatal (ring_used (&r) == 16, "ring should be full");
+    assert_nonfatal (ring_read (&r, out, 12) == 12 && memcmp (out, "abcdefghijkl", 12) == 0, "reads should be FIFO");
+    assert_nonfatal (ring_write (&r, "uvwxyz", 6) == 6, "reads should free room");
+    assert_nonfatal (ring_read (&r, out, 64) == 10 && memcmp (out, "mnopuvwxyz", 10) == 0, "data should survive the wrap");
+    assert_nonfatal (ring_used (&r) == 0, "ring should be empty again");
+
+    ring_write (&r, "abc", 3);
+    const size_t pos = ring_pos (&r);
+    ring_write (&r, "def", 3);
+    ring_drop_to (&r, pos);
+    assert_nonfatal (ring_read (&r, out, 64) == 3 && memcmp (out, "def", 3) == 0, "ring_drop_to should drop only what came before");
+    ring_drop_to (&r, pos);
+    assert_nonfatal (ring_used (&r) == 0, "stale ring_drop_to should do nothing");
+
+    ring_write (&r, "abc", 3);
+    ring_reset (&r);
+    assert_nonfatal (ring_read (&r, out, 3) == 0, "ring_reset should drop buffered data");
+    ring_deinit (&r);
+
+    // two threads through a small ring, both sides wrapping at odd offsets
+
+    assert_fatal (ring_init (&r, 256) == RING_OK, "ring_init should work", exit);
+
+    pthread_t tid;
+    pthread_create (&tid, NULL, producer, NULL);
+
+    size_t i  = 0;
+    int    ok = 1;
+
+    while (i < N) {
+        const size_t n = ring_read (&r, out, 29);
+
+        for (size_t k = 0; k < n; ++k)
+            ok &= out[k] == ((i + k) & 0xff);
+
+        i += n;
+    }
+
+    pthread_join (tid, NULL);
+
+    assert_nonfatal (ok, "bytes should arrive in order");
+    assert_nonfatal (ring_used (&r) == 0, "everything written should be read");
+    ring_deinit (&r);
+    // clang-format on
+
+exit:
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../silence.c"
+
+#define LEN 1000
+
+int
+main (void)
+{
+    static int16_t s16[LEN];
+    static int32_t s32[LEN];
+    static float   flt[LEN];
+
+    // clang-format off
+    assert_nonfatal (silence_first_s16 (s16, LEN, 8) == LEN, "all zero s16 should be silent");
+    assert_nonfatal (silence_last_s16 (s16, LEN, 8) == 0, "all zero s16 should be silent");
+    assert_nonfatal (silence_first_flt (flt, LEN, 1e-3f) == LEN, "all zero flt should be silent");
+
+    // loud samples at every offset so both the vector and the scalar tail
+    // paths are hit
+    int ok = 1;
+
+    for (size_t i = 0; i < LEN; ++i) {
+        memset (s16, 0, sizeof s16);
+        memset (s32, 0, sizeof s32);
+        memset (flt, 0, sizeof flt);
+        s16[i] = i & 1 ? -9 : 9;
+        s32[i] = i & 1 ? -(1 << 20) : 1 << 20;
+        flt[i] = i & 1 ? -0.5f : 0.5f;
+
+        ok &= silence_first_s16 (s16, LEN, 8) == i;
+        ok &= silence_last_s16 (s16, LEN, 8) == i + 1;
+        ok &= silence_first_s32 (s32, LEN, 1 << 16) == i;
+        ok &= silence_last_s32 (s32, LEN, 1 << 16) == i + 1;
+        ok &= silence_first_flt (flt, LEN, 1e-3f) == i;
+        ok &= silence_last_flt (flt, LEN, 1e-3f) == i + 1;
+    }
+
+    assert_nonfatal (ok, "kernels should find a single loud sample at any offset");
+
+    for (size_t i = 0; i < LEN; ++i)
+        s16[i] = (i % 17) - 8;
+
+    assert_nonfatal (silence_first_s16 (s16, LEN, 8) == LEN, "samples at the threshold are silent");
+    assert_nonfatal (silence_first_s16 (s16, LEN, 7) == 0, "samples above the threshold are loud");
+    s16[0] = INT16_MIN;
+    assert_nonfatal (silence_first_s16 (s16, LEN, 8) == 0, "INT16_MIN should be loud");
+
+    // tracker over blocks of 500 stereo frames: silent, loud from frame 300
+    // on, silent, silent
+
+    static float zeros[LEN];
+    struct silence_t sil;
+    silence_init (&sil, SILENCE_THRESH_DEF);
+    memset (flt, 0, sizeof flt);
+
+    for (size_t i = 600; i < 1000; ++i)
+        flt[i] = 0.25f;
+
+    assert_nonfatal (silence_scan (&sil, zeros, 3, LEN / 2, 2) == LEN / 2, "silent block should report no loud frame");
+    assert_nonfatal (silence_scan (&sil, flt, 3, LEN / 2, 2) == 300, "block should report its first loud frame");
+    silence_scan (&sil, zeros, 3, LEN / 2, 2);
+    silence_scan (&sil, zeros, 3, LEN / 2, 2);
+
+    assert_nonfatal (sil.pos == 2000, "tracker should count frames");
+    assert_nonfatal (sil.first_loud == 800, "first loud frame should be 800");
+    assert_nonfatal (sil.end_loud == 1000, "loud frames should end with the loud block");
+
+    silence_init (&sil, SILENCE_THRESH_DEF);
+    assert_nonfatal (silence_scan (&sil, flt, 0, LEN / 2, 2) == 0, "unsupported formats should count as loud");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include "test.c"
+
+#include "../spscq.c"
+
+#define N 200000
+
+static struct spscq_t q;
+
+static void *
+producer (void *arg)
+{
+    (void)arg;
+
+    for (uintptr_t i = 1; i <= N; ++i)
+        if (spscq_push (&q, (void *)i) != SPSCQ_OK)
+            break;
+
+    spscq_close (&q);
+    return NULL;
+}
+
+int
+main (void)
+{
+    // clang-format off
+    assert_fatal (spscq_init (&q, 3) == SPSCQ_OK, "spscq_init should work", exit);
+    assert_nonfatal (q.mask == 3, "capacity should round up to a power of two");
+    assert_nonfatal (spscq_trypop (&q) == NULL, "new queue should be empty");
+
+    int ok = 1;
+    for (uintptr_t i = 1; i <= 4; ++i)
+        ok &= spscq_trypush (&q, (void *)i);
+
+    assert_nonfatal (ok, "queue should take `cap` items");
+    assert_nonfatal (!spscq_trypush (&q, (void *)5), "full queue should reject pushes");
+    assert_nonfatal (spscq_depth (&q) == 4, "depth should be 4");
+    assert_nonfatal (spscq_trypop (&q) == (void *)1, "queue should be FIFO");
+    assert_nonfatal (spscq_trypush (&q, (void *)5), "pop should free a slot");
+
+    for (uintptr_t i = 2; i <= 5; ++i)
+        ok &= spscq_trypop (&q) == (void *)i;
+
+    assert_nonfatal (ok, "queue should be FIFO across the wrap");
+
+    spscq_close (&q);
+    assert_nonfatal (spscq_push (&q, (void *)1) == SPSCQ_CLOSD, "closed queue should reject pushes");
+    assert_nonfatal (spscq_pop (&q) == NULL, "closed empty queue should pop NULL");
+    spscq_deinit (&q);
+
+    // two threads through a small queue, so both sides have to wait
+
+    assert_fatal (spscq_init (&q, 16) == SPSCQ_OK, "spscq_init should work", exit);
+
+    pthread_t tid;
+    pthread_create (&tid, NULL, producer, NULL);
+
+    uintptr_t expect = 1;
+    void     *p;
+
+    while ((p = spscq_pop (&q)) != NULL)
+        ok &= (uintptr_t)p == expect++;
+
+    pthread_join (tid, NULL);
+
+    assert_nonfatal (ok, "items should arrive in order");
+    assert_nonfatal (expect == N + 1, "every item pushed before the close should arrive");
+    assert_nonfatal (q.depth_max <= 16, "depth should stay within capacity");
+    spscq_deinit (&q);
+    // clang-format on
+
+exit:
+    report ();
+
+    return 0;
+}
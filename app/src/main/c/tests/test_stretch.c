@@ -0,0 +1,142 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../stretch.c"
+
+#define RATE  48000
+#define N     96000 // frames, 2 s
+#define BURST 192
+
+static int32_t src[2 * N], dst[4 * N];
+
+/**
+ * runs `src` through `st` a burst of output at a time, reading as much
+ * input as it takes, the way the output loop does.
+ *
+ * @return frames out. `worst` is the largest distance between the source
+ * frame the ramp says is next and the one `stretch_behind` says is
+ */
+static size_t
+run (struct stretch_t *st, size_t n, int64_t *worst)
+{
+    size_t in = 0, out = 0;
+
+    *worst = 0;
+
+    while (true) {
+        const size_t got = stretch_get (st, dst + 2 * out, BURST);
+
+        // past the crossfade, where output is a copy of one source frame
+        if (got > 0 && st->out_pos >= st->ovl && st->out_pos < st->out_len) {
+            const int64_t d = (int64_t)(in - stretch_behind (st))
+                              - st->out[2 * st->out_pos + 1];
+
+            *worst = llabs (d) > *worst ? llabs (d) : *worst;
+        }
+
+        out += got;
+
+        if (got == BURST)
+            continue;
+
+        if (in == n) {
+            stretch_drain (st);
+            return out + stretch_get (st, dst + 2 * out, 2 * N - out);
+        }
+
+        size_t k = stretch_want (st);
+
+        k = k < n - in ? k : n - in;
+        stretch_put (st, src + 2 * in, k);
+        in += k;
+    }
+}
+
+int
+main (void)
+{
+    struct stretch_t st;
+    int64_t          worst;
+    static int16_t   s16[N];
+
+    // clang-format off
+    assert_nonfatal (stretch_init (&st, 0, 2, RATE) == STRETCH_ERR && stretch_init (&st, 1, 0, RATE) == STRETCH_ERR, "unknown formats and no channels should fail");
+
+    // noise to correlate on the left, and on the right a ramp too quiet to
+    // matter next to it, saying which source frame each is
+    uint32_t seed = 1;
+    for (size_t i = 0; i < N; ++i) {
+        seed           = seed * 1664525 + 1013904223;
+        src[2 * i]     = (int32_t)seed >> 2;
+        src[2 * i + 1] = i;
+    }
+
+    assert_nonfatal (stretch_init (&st, 2, 2, RATE) == STRETCH_OK, "an S32 stretch should open");
+    assert_nonfatal (run (&st, N, &worst) == N && worst == 0, "normal speed should make as many frames as it takes");
+    bool same = true;
+    for (size_t i = 0; i < N; ++i)
+        same = same && dst[2 * i + 1] == src[2 * i + 1];
+    assert_nonfatal (same, "normal speed should be seamless");
+
+    static const uint16_t pcts[] = { 50, 125, 200, 300 };
+    for (size_t p = 0; p < sizeof pcts / sizeof *pcts; ++p) {
+        stretch_reset (&st);
+        stretch_set (&st, pcts[p]);
+        const size_t want = N * 100 / pcts[p];
+        const size_t got  = run (&st, N, &worst);
+        printf ("%3hu%%: %zu frames out of %d, %zu expected, position off by up to %" PRId64 "\n", pcts[p], got, N, want, worst);
+        // the input held at the end plays at normal speed
+        assert_nonfatal (labs ((long)got - (long)want) < (long)st.in_cap, "output should be the input over the speed");
+        assert_nonfatal (worst <= (int64_t)st.win, "the held input should put the position within a window");
+        assert_nonfatal (dst[2 * got - 1] == N - 1, "the end of the input should be played");
+    }
+
+    // leaving the stretch mid-way is seamless from there
+    stretch_reset (&st);
+    stretch_set (&st, 200);
+    stretch_put (&st, src, st.in_cap);
+    size_t n = stretch_get (&st, dst, 4 * BURST);
+    const int32_t last = dst[2 * n - 1];
+    const size_t  fed  = st.in_cap;
+    stretch_drain (&st);
+    n = stretch_get (&st, dst, 2 * N);
+    same = n > 0 && dst[1] == last + 1 && dst[2 * n - 1] == (int32_t)fed - 1 && !stretch_held (&st);
+    for (size_t i = 1; i < n; ++i)
+        same = same && dst[2 * i + 1] == dst[2 * i - 1] + 1;
+    printf ("drained %zu frames after frame %d\n", n, last);
+    assert_nonfatal (same, "a drain should play the rest of the input as is");
+    stretch_deinit (&st);
+
+    // S16 stereo saturates, and speed bounds clamp
+    assert_nonfatal (stretch_init (&st, 1, 2, RATE) == STRETCH_OK, "a stereo S16 stretch should open");
+    stretch_set (&st, 1000);
+    assert_nonfatal (st.speed == STRETCH_MAX / 100.0f, "speeds should be clamped");
+    stretch_set (&st, 0);
+    assert_nonfatal (st.speed == 1, "no speed should be normal speed");
+    for (size_t i = 0; i < N; ++i)
+        s16[i] = 30000 * sin (2 * M_PI * 440 * (i / 2) / RATE);
+    stretch_set (&st, 150);
+    size_t in = 0, out = 0;
+    while (in < N / 2) {
+        size_t k = stretch_want (&st);
+        k = k < N / 2 - in ? k : N / 2 - in;
+        stretch_put (&st, s16 + 2 * in, k);
+        in += k;
+        out += stretch_get (&st, (int16_t *)dst + 2 * out, N / 2);
+    }
+    int16_t peak = 0;
+    for (size_t i = 0; i < 2 * out; ++i)
+        peak = abs (((int16_t *)dst)[i]) > peak ? abs (((int16_t *)dst)[i]) : peak;
+    assert_nonfatal (out > 0 && peak <= 30000 && peak > 29000, "a sine should keep its level");
+    stretch_deinit (&st);
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -1,7 +1,10 @@
+#include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "test.c"
 
+#include "../arena.c"
 #include "../strvec.c"
 
 int
@@ -51,6 +54,19 @@ main (void)
     assert_nonfatal (memcmp (str1, sq.ptr[2], len1) == 0,
                      "pos 2 should be \"foobar\"");
 
+    // names past the first chunk of them stay where they were put
+    char name[16];
+    bool kept = true;
+    for (int i = 0; i < 1000; ++i) {
+        snprintf (name, sizeof name, "track%04d", i);
+        strvec_pushb (&sq, name, strlen (name));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        snprintf (name, sizeof name, "track%04d", i);
+        kept = kept && strcmp (sq.ptr[3 + i], name) == 0;
+    }
+    assert_nonfatal (sq.siz == 1003 && kept, "names should survive many pushes");
+
 deinit:
     strvec_deinit (&sq);
 
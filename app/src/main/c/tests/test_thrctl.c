@@ -0,0 +1,141 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "test.c"
+
+#include "../thrctl.c"
+
+/** writes `val` to `root`/`path`, making its directories */
+static void
+put (const char *root, const char *path, const char *val)
+{
+    char fn[256];
+
+    snprintf (fn, sizeof fn, "%s/%s", root, path);
+
+    for (char *p = strchr (fn + 1, '/'); p != NULL; p = strchr (p + 1, '/')) {
+        *p = '\0';
+        mkdir (fn, 0755);
+        *p = '/';
+    }
+
+    FILE *fp = fopen (fn, "w");
+
+    if (fp != NULL) {
+        fputs (val, fp);
+        fclose (fp);
+    }
+}
+
+struct applied_t {
+    int      role;
+    int      ret;
+    char     name[16];
+    uint64_t cores;
+    int      nice;
+};
+
+static void *
+tfn_apply (void *arg)
+{
+    struct applied_t *a = arg;
+    unsigned long     set[MASK_LONGS] = { 0 };
+    const size_t      bits            = 8 * sizeof (unsigned long);
+
+    a->ret = thrctl_apply (a->role);
+    prctl (PR_GET_NAME, a->name, 0, 0, 0);
+    syscall (SYS_sched_getaffinity, 0, sizeof set, set);
+
+    for (int i = 0; i < THRCTL_MAX_CPUS; ++i)
+        a->cores |= (uint64_t)(set[i / bits] >> i % bits & 1) << i;
+
+    a->nice = getpriority (PRIO_PROCESS, syscall (SYS_gettid));
+
+    return NULL;
+}
+
+/**
+ * as the output thread does: raises its own priority, then makes a thread
+ * for `arg`'s role. @return whether the priority was raised
+ */
+static void *
+tfn_parent (void *arg)
+{
+    pthread_t   tid;
+    static bool raised;
+
+    raised = setpriority (PRIO_PROCESS, syscall (SYS_gettid), -5) == 0;
+    pthread_create (&tid, NULL, tfn_apply, arg);
+    pthread_join (tid, NULL);
+
+    return &raised;
+}
+
+int
+main (void)
+{
+    struct thrctl_topo_t t;
+    uint64_t             mask;
+    char                 fn[64];
+
+    // clang-format off
+    assert_nonfatal (thrctl_parse_cpus ("0-3,6,8-9\n", &mask) == THRCTL_OK && mask == 0x34f, "cpu lists should parse ranges and singles");
+    assert_nonfatal (thrctl_parse_cpus ("0,70-71", &mask) == THRCTL_OK && mask == 1, "cpus past the mask should be left out");
+    assert_nonfatal (thrctl_parse_cpus ("3-1", &mask) == THRCTL_ERR && thrctl_parse_cpus ("0,x", &mask) == THRCTL_ERR, "bad lists should fail");
+
+    // 4 little, 3 big and one prime core, as on most recent phones
+    const char *const caps = "build/test_thrctl/caps";
+    put (caps, "present", "0-7\n");
+    for (int i = 0; i < 8; ++i) {
+        snprintf (fn, sizeof fn, "cpu%d/cpu_capacity", i);
+        put (caps, fn, i < 4 ? "381\n" : i < 7 ? "871\n" : "1024\n");
+    }
+    assert_nonfatal (thrctl_topo_read (&t, caps) == THRCTL_OK && t.ncpus == 8, "the present cpus should be read");
+    assert_nonfatal (t.little == 0x0f && t.big == 0xf0 && t.one == 7, "cores should split by capacity");
+    assert_nonfatal (thrctl_cores (&t, THRCTL_ONE) == 0x80 && thrctl_cores (&t, THRCTL_ANY) == 0xff, "roles should map to core masks");
+
+    // older kernels: the highest frequency, and no present list
+    const char *const freqs = "build/test_thrctl/freqs";
+    for (int i = 0; i < 4; ++i) {
+        snprintf (fn, sizeof fn, "cpu%d/cpufreq/cpuinfo_max_freq", i);
+        put (freqs, fn, i < 2 ? "1800000\n" : "2400000\n");
+    }
+    assert_nonfatal (thrctl_topo_read (&t, freqs) == THRCTL_OK && t.present == 0xf, "cpus should be found without a present list");
+    assert_nonfatal (t.little == 0x3 && t.big == 0xc && t.one == 3, "cores should split by frequency without capacities");
+
+    // a uniform host: every core is little and big
+    const char *const flat = "build/test_thrctl/flat";
+    put (flat, "present", "0-2\n");
+    put (flat, "cpu0/online", "1\n");
+    assert_nonfatal (thrctl_topo_read (&t, flat) == THRCTL_OK && t.little == 0x7 && t.big == 0x7 && t.one == 2, "a uniform topology should not split");
+    assert_nonfatal (thrctl_topo_read (&t, "build/test_thrctl/none") == THRCTL_ERR, "a missing tree should fail");
+    assert_nonfatal (thrctl_apply (THRCTL_NROLES) == THRCTL_ERR, "unknown roles should fail");
+
+    // on this host's own topology, in a thread of its own
+    struct applied_t a = { .role = THRCTL_ANALYSIS };
+    pthread_t        tid;
+    thrctl_init (THRCTL_SYSFS);
+    pthread_create (&tid, NULL, tfn_apply, &a);
+    pthread_join (tid, NULL);
+    printf ("analysis thread: %s, done 0x%x, cores 0x%" PRIx64 ", nice %d\n", a.name, a.ret, a.cores, a.nice);
+    assert_nonfatal (a.ret >= 0 && a.ret & THRCTL_NAMED && strcmp (a.name, "ncap-analysis") == 0, "the thread should be named for its role");
+    assert_nonfatal (!(a.ret & THRCTL_PINNED) || (a.cores & ~thrctl_cores (&topo, THRCTL_LITTLE)) == 0, "the thread should be on little cores");
+    assert_nonfatal (a.ret & THRCTL_NICED && a.nice == 10, "a lower priority should always be allowed");
+
+    // a decode thread made by the raised output thread does not keep its
+    // priority
+    struct applied_t d = { .role = THRCTL_DECODE };
+    void *raised;
+    pthread_create (&tid, NULL, tfn_parent, &d);
+    pthread_join (tid, &raised);
+    printf ("decode thread of a nice -5 thread%s: nice %d\n", *(bool *)raised ? "" : " (not raised)", d.nice);
+    assert_nonfatal (!*(bool *)raised || (d.ret & THRCTL_NICED && d.nice == 0), "a role of nice 0 should drop the priority it inherited");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../timing.c"
+
+#define RATE  48000
+#define BURST 192
+#define MS    1000000ull
+
+int
+main (void)
+{
+    struct timing_t       t;
+    struct timing_stats_t st;
+    char                  line[256];
+    uint64_t              now = 1000 * MS;
+
+    timing_init (&t);
+    timing_stream (&t, RATE, BURST);
+
+    // clang-format off
+    assert_nonfatal (t.burst_ns == 4 * MS, "the burst period should follow the rate");
+
+    // a steady loop, 4 ms apart, one burst late by 1 ms
+    for (int i = 0; i < 100; ++i)
+        timing_burst (&t, now += i == 50 ? 5 * MS : 4 * MS);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.bursts == 99, "the first burst should only start a period");
+    assert_nonfatal (st.period_mean > 4 * MS && st.period_mean < 4 * MS + 20000, "the mean period should be about the burst");
+    assert_nonfatal (st.jitter_p50 < 1000 && st.jitter_max == MS, "jitter should be what a burst strays from the period");
+    assert_nonfatal (st.period_p99 <= 5 * MS && st.period_p99 >= 4 * MS, "the 99th percentile should be the late burst's bucket at most");
+
+    // a pause or a new stream is no period
+    timing_restart (&t);
+    timing_burst (&t, now += 1000 * MS);
+    timing_stream (&t, RATE, BURST);
+    timing_burst (&t, now += 1000 * MS);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.bursts == 99 && st.jitter_max == MS, "gaps should not count as periods");
+
+    // percentiles interpolate within log2 buckets, capped at the max
+    struct timing_hist_t h;
+    memset (&h, 0, sizeof h);
+    for (int i = 0; i < 99; ++i)
+        hist_add (&h, 3000);
+    hist_add (&h, 900000);
+    assert_nonfatal (timing_pct (&h, 50) >= 2000 && timing_pct (&h, 50) < 4000, "the median should fall in its bucket");
+    assert_nonfatal (timing_pct (&h, 99) <= 4000 && timing_pct (&h, 100) == 900000, "the tail should reach the max");
+    hist_add (&h, 10000000000ull);
+    assert_nonfatal (atomic_load (&h.n[TIMING_NBUCKETS - 1]) == 1 && timing_pct (&h, 100) == 10000000000ull, "the last bucket should take anything longer");
+    memset (&h, 0, sizeof h);
+    assert_nonfatal (timing_pct (&h, 50) == 0, "an empty histogram should read 0");
+
+    // callbacks are bursts too
+    timing_restart (&t);
+    now += 4 * MS;
+    timing_cb (&t, now, now + 50000);
+    now += 4 * MS;
+    timing_cb (&t, now, now + 150000);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.callbacks == 2 && st.cb_mean == 100000 && st.cb_max == 150000 && st.bursts == 100, "callbacks should be timed");
+
+    // latency: 4800 frames in the ring, 4800 in the sink's buffer and 480
+    // read but not presented, frame 4320 having been 5 ms ago
+    assert_nonfatal (timing_due (&t, now) && !timing_due (&t, now + 99 * MS) && timing_due (&t, now + 100 * MS), "latency should be sampled every TIMING_SAMPLE_MS");
+    timing_latency (&t, 4800, 9600 + 240, 4800 + 240, 4320, now - 5 * MS, now);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.samples == 1 && st.ring == 100 * MS && st.buf == 100 * MS && st.dev == 10 * MS, "latency should add up the ring, the buffer and the device");
+    assert_nonfatal (st.latency == 210 * MS && st.latency_min == st.latency && st.latency_max == st.latency, "one sample should be its own min and max");
+
+    // a timestamp past what was written clamps to nothing queued
+    timing_latency (&t, 0, 1000, 1000, 2000, now, now);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.latency == 0 && st.latency_min == 0 && st.latency_max == 210 * MS && st.latency_mean == 105 * MS, "latency should clamp at 0 and track its range");
+
+    // with all that was read presented, the buffer is all there is
+    timing_latency (&t, 0, 960, 480, 480, now, now);
+    timing_stats (&t, &st);
+    assert_nonfatal (st.buf == 10 * MS && st.dev == 0, "frames not read yet should count as buffered");
+
+    int n = timing_summary (&st, line, sizeof line);
+    printf ("%s\n", line);
+    assert_nonfatal (n > 0 && (size_t)n < sizeof line && strstr (line, "latency 10.0 ms") && strstr (line, "callback 100 us"), "the summary should fit a line");
+    assert_nonfatal (timing_summary (&st, line, 16) == n && strlen (line) == 15, "a short buffer should truncate the summary");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.c"
+
+#include "../trackdb.c"
+
+int
+main (void)
+{
+    const char *const dbfile = "build/test.trackdb";
+    remove (dbfile);
+
+    const uint32_t tag  = TRACKDB_TAG ('T', 'E', 'S', 'T');
+    const uint64_t key1 = trackdb_key ("/sdcard/Music/NCAP-share/a.flac");
+    const uint64_t key2 = trackdb_key ("/sdcard/Music/NCAP-share/b.flac");
+    uint64_t       val;
+
+    // clang-format off
+    assert_nonfatal (key1 != key2, "different paths should have different keys");
+    assert_nonfatal (trackdb_init (dbfile) == TRACKDB_OK, "trackdb_init should work without a file");
+    assert_nonfatal (trackdb_get (key1, tag, 1, &val, sizeof val) == TRACKDB_ENOENT, "empty db should have no records");
+
+    val = 42;
+    assert_nonfatal (trackdb_put (key1, tag, 1, &val, sizeof val) == TRACKDB_OK, "trackdb_put should work");
+    val = 43;
+    assert_nonfatal (trackdb_put (key2, tag, 1, &val, sizeof val) == TRACKDB_OK, "trackdb_put should work");
+    val = 44;
+    assert_nonfatal (trackdb_put (key1, tag, 2, &val, sizeof val) == TRACKDB_OK, "trackdb_put should replace");
+    assert_nonfatal (trackdb_get (key1, tag, 1, &val, sizeof val) == TRACKDB_EVER, "old version should be rejected");
+    assert_nonfatal (trackdb_deinit () == TRACKDB_OK, "trackdb_deinit should write");
+
+    assert_nonfatal (trackdb_init (dbfile) == TRACKDB_OK, "trackdb_init should load");
+    assert_nonfatal (recs_siz == 2, "replaced records should not be duplicated");
+    assert_nonfatal (trackdb_get (key1, tag, 2, &val, sizeof val) == sizeof val, "record should persist");
+    assert_nonfatal (val == 44, "record should hold the replaced value");
+    assert_nonfatal (trackdb_get (key2, tag, 1, &val, sizeof val) == sizeof val, "record should persist");
+    assert_nonfatal (val == 43, "record should hold the written value");
+    assert_nonfatal (trackdb_get (key2, tag + 1, 1, &val, sizeof val) == TRACKDB_ENOENT, "tags should be separate");
+
+    // written back while open, as a kill would find it
+    assert_nonfatal (!dirty && trackdb_put (key2, tag, 1, &val, sizeof val) == TRACKDB_OK && !dirty, "putting the same record again should change nothing");
+    val = 45;
+    trackdb_put (key2, tag, 1, &val, sizeof val);
+    assert_nonfatal (dirty && trackdb_write () == TRACKDB_OK && !dirty, "trackdb_write should write a changed db");
+    FILE *fp = fopen (dbfile, "rb");
+    struct trackdb_rec_t *const live = recs;
+    const size_t live_siz = recs_siz, live_cap = recs_cap;
+    recs = NULL, recs_siz = recs_cap = 0;
+    assert_nonfatal (fp != NULL && load (fp) == TRACKDB_OK && recs_siz == 2 && find (key2, tag)->data[0] == 45, "the file should hold the change before deinit");
+    fclose (fp);
+    while (recs_siz)
+        free (recs[--recs_siz].data);
+    free (recs);
+    recs = live, recs_siz = live_siz, recs_cap = live_cap;
+    fp = fopen (path_tmp, "rb");
+    assert_nonfatal (fp == NULL, "no temporary file should be left behind");
+    assert_nonfatal (trackdb_deinit () == TRACKDB_OK, "trackdb_deinit should work");
+    // clang-format on
+
+    report ();
+
+    return 0;
+}
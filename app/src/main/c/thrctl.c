@@ -0,0 +1,269 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "logging.h"
+#include "properties.h"
+#include "thrctl.h"
+
+static const char *FILENAME = "thrctl.c";
+
+/** `unsigned long`s in a kernel cpu mask of `THRCTL_MAX_CPUS` */
+#define MASK_LONGS                                                            \
+    ((THRCTL_MAX_CPUS + 8 * sizeof (unsigned long) - 1)                       \
+     / (8 * sizeof (unsigned long)))
+
+// clang-format off
+struct thrctl_role_t thrctl_roles[THRCTL_NROLES] = {
+    [THRCTL_OUTPUT]   = { "output",   THRCTL_ONE,    2, -16 }, // ANDROID_PRIORITY_AUDIO
+    [THRCTL_DECODE]   = { "decode",   THRCTL_LITTLE, 0,   0 },
+    [THRCTL_IO]       = { "io",       THRCTL_LITTLE, 0,   0 },
+    [THRCTL_ANALYSIS] = { "analysis", THRCTL_LITTLE, 0,  10 }, // ANDROID_PRIORITY_BACKGROUND
+    [THRCTL_RENDER]   = { "render",   THRCTL_BIG,    0,  -4 }, // ANDROID_PRIORITY_DISPLAY
+};
+// clang-format on
+
+static struct thrctl_topo_t topo;
+
+int
+thrctl_parse_cpus (const char *s, uint64_t *mask)
+{
+    char *end;
+
+    *mask = 0;
+
+    while (*s != '\0' && *s != '\n') {
+        const long lo = strtol (s, &end, 10);
+        long       hi = lo;
+
+        if (end == s || lo < 0)
+            return THRCTL_ERR;
+
+        if (*(s = end) == '-') {
+            hi = strtol (++s, &end, 10);
+
+            if (end == s || hi < lo)
+                return THRCTL_ERR;
+
+            s = end;
+        }
+
+        for (long i = lo; i <= hi && i < THRCTL_MAX_CPUS; ++i)
+            *mask |= 1ull << i;
+
+        if (*s == ',')
+            ++s;
+        else if (*s != '\0' && *s != '\n')
+            return THRCTL_ERR;
+    }
+
+    return THRCTL_OK;
+}
+
+/** @return the first line of `root`/`path` in `buf`, or NULL */
+static char *
+read_line (const char *root, const char *path, char *buf, size_t siz)
+{
+    char  fn[256];
+    FILE *fp;
+
+    snprintf (fn, sizeof fn, "%s/%s", root, path);
+
+    if ((fp = fopen (fn, "r")) == NULL)
+        return NULL;
+
+    char *ret = fgets (buf, siz, fp);
+
+    fclose (fp);
+
+    return ret;
+}
+
+int
+thrctl_topo_read (struct thrctl_topo_t *topo, const char *root)
+{
+    char path[64];
+    char line[256];
+
+    memset (topo, 0, sizeof *topo);
+    topo->one = -1;
+
+    if (read_line (root, "present", line, sizeof line) == NULL
+        || thrctl_parse_cpus (line, &topo->present) != THRCTL_OK) {
+        // no list: every cpuN there is, up to the first missing one
+        for (int i = 0; i < THRCTL_MAX_CPUS; ++i) {
+            snprintf (line, sizeof line, "%s/cpu%d", root, i);
+
+            if (access (line, F_OK) != 0)
+                break;
+
+            topo->present |= 1ull << i;
+        }
+    }
+
+    if (topo->present == 0)
+        return THRCTL_ERR;
+
+    uint32_t lo = UINT32_MAX, hi = 0;
+
+    for (int i = 0; i < THRCTL_MAX_CPUS; ++i) {
+        if (!(topo->present >> i & 1))
+            continue;
+
+        snprintf (path, sizeof path, "cpu%d/cpu_capacity", i);
+
+        if (read_line (root, path, line, sizeof line) == NULL) {
+            snprintf (path, sizeof path, "cpu%d/cpufreq/cpuinfo_max_freq",
+                      i);
+
+            if (read_line (root, path, line, sizeof line) == NULL)
+                strcpy (line, "1");
+        }
+
+        const uint32_t cap = strtoul (line, NULL, 10);
+
+        topo->cap[i] = cap > 0 ? cap : 1;
+        topo->ncpus  = i + 1;
+        lo           = topo->cap[i] < lo ? topo->cap[i] : lo;
+        hi           = topo->cap[i] > hi ? topo->cap[i] : hi;
+    }
+
+    for (int i = 0; i < topo->ncpus; ++i) {
+        if (topo->cap[i] == 0)
+            continue;
+
+        if (topo->cap[i] == lo)
+            topo->little |= 1ull << i;
+
+        if (topo->cap[i] > lo)
+            topo->big |= 1ull << i;
+
+        if (topo->cap[i] == hi)
+            topo->one = i;
+    }
+
+    // uniform
+    if (topo->big == 0)
+        topo->big = topo->little;
+
+    return THRCTL_OK;
+}
+
+uint64_t
+thrctl_cores (const struct thrctl_topo_t *topo, uint8_t cores)
+{
+    switch (cores) {
+        case THRCTL_LITTLE:
+            return topo->little;
+        case THRCTL_BIG:
+            return topo->big;
+        case THRCTL_ONE:
+            return topo->one >= 0 ? 1ull << topo->one : topo->present;
+        case THRCTL_ANY:
+        default:
+            return topo->present;
+    }
+}
+
+int
+thrctl_init (const char *root)
+{
+    if (thrctl_topo_read (&topo, root) != THRCTL_OK) {
+        logwf ("WARN: no cpu topology under `%s'. threads keep their cores",
+               root);
+        return THRCTL_ERR;
+    }
+
+    logif ("%d cpus: little 0x%" PRIx64 ", big 0x%" PRIx64 ", output on %d",
+           topo.ncpus, topo.little, topo.big, topo.one);
+
+    return THRCTL_OK;
+}
+
+/** @return `THRCTL_PINNED` if the calling thread moved to `mask` */
+static int
+pin (uint64_t mask)
+{
+    const size_t  bits = 8 * sizeof (unsigned long);
+    unsigned long set[MASK_LONGS] = { 0 };
+    uint64_t      allowed         = 0;
+
+    // a cpuset may keep the app off some cores
+    if (syscall (SYS_sched_getaffinity, 0, sizeof set, set) > 0)
+        for (int i = 0; i < THRCTL_MAX_CPUS; ++i)
+            allowed |= (uint64_t)(set[i / bits] >> i % bits & 1) << i;
+
+    if ((mask &= allowed) == 0)
+        return 0;
+
+    memset (set, 0, sizeof set);
+
+    for (int i = 0; i < THRCTL_MAX_CPUS; ++i)
+        set[i / bits] |= (unsigned long)(mask >> i & 1) << i % bits;
+
+    if (syscall (SYS_sched_setaffinity, 0, sizeof set, set) != 0) {
+        logdf ("sched_setaffinity failed: %s", strerror (errno));
+        return 0;
+    }
+
+    return THRCTL_PINNED;
+}
+
+int
+thrctl_apply (int role)
+{
+    if (role < 0 || role >= THRCTL_NROLES)
+        return THRCTL_ERR;
+
+    const struct thrctl_role_t *r = &thrctl_roles[role];
+    char                        name[16];
+    int                         ret = 0;
+
+    snprintf (name, sizeof name, "ncap-%s", r->name);
+
+    if (prctl (PR_SET_NAME, name, 0, 0, 0) == 0)
+        ret |= THRCTL_NAMED;
+
+    if (!NCAP_THRCTL)
+        return ret;
+
+    if (topo.present != 0)
+        ret |= pin (thrctl_cores (&topo, r->cores));
+
+    const struct sched_param sp = { .sched_priority = r->fifo };
+
+    // a new thread has its creator's policy and nice value, the audio
+    // priority if the output thread made it, so both are always set. the
+    // nice value means nothing under `SCHED_FIFO`
+    if (r->fifo > 0
+        && pthread_setschedparam (pthread_self (), SCHED_FIFO, &sp) == 0) {
+        ret |= THRCTL_FIFO;
+    } else {
+        const struct sched_param other = { .sched_priority = 0 };
+
+        pthread_setschedparam (pthread_self (), SCHED_OTHER, &other);
+
+        if (setpriority (PRIO_PROCESS, syscall (SYS_gettid), r->nice) == 0)
+            ret |= THRCTL_NICED;
+    }
+
+    logdf ("%s: cores 0x%" PRIx64 "%s, %s %d", name,
+           thrctl_cores (&topo, r->cores),
+           ret & THRCTL_PINNED ? "" : " (not pinned)",
+           ret & THRCTL_FIFO ? "SCHED_FIFO" : "nice",
+           ret & THRCTL_FIFO    ? r->fifo
+           : ret & THRCTL_NICED ? r->nice
+                                : 0);
+
+    return ret;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef THRCTL_H
+#define THRCTL_H
+
+#include <stdint.h>
+
+/**
+ * thread roles. each thread calls `thrctl_apply` with its role first thing,
+ * which names it and places it on the cores and at the priority
+ * `thrctl_roles` gives the role: `SCHED_FIFO` where permitted, a nice
+ * value otherwise.
+ *
+ * cores come from the topology in sysfs: the ones of the lowest capacity
+ * are little, the rest big, all of them on a uniform host. placement that
+ * the platform refuses is skipped, never fatal.
+ */
+
+#define THRCTL_OK  0
+#define THRCTL_ERR -1
+
+#define THRCTL_SYSFS "/sys/devices/system/cpu"
+
+/** cores are kept in a 64-bit mask */
+#define THRCTL_MAX_CPUS 64
+
+#define THRCTL_OUTPUT   0 // feeds the sink
+#define THRCTL_DECODE   1
+#define THRCTL_IO       2 // demux, album art
+#define THRCTL_ANALYSIS 3
+#define THRCTL_RENDER   4
+#define THRCTL_NROLES   5
+
+#define THRCTL_ANY    0
+#define THRCTL_LITTLE 1
+#define THRCTL_BIG    2
+#define THRCTL_ONE    3 // the last core of the highest capacity, alone
+
+// what `thrctl_apply` did
+#define THRCTL_NAMED  1
+#define THRCTL_PINNED 2
+#define THRCTL_FIFO   4
+#define THRCTL_NICED  8
+
+struct thrctl_role_t {
+    const char *_Nonnull name; // the thread is named "ncap-<name>"
+    uint8_t cores;             // `THRCTL_ANY`, ...
+    uint8_t fifo;              // `SCHED_FIFO` priority, 0 for none
+    int8_t  nice;              // without `SCHED_FIFO`
+};
+
+/** defaults per role. may be changed before the threads start */
+extern struct thrctl_role_t thrctl_roles[THRCTL_NROLES];
+
+struct thrctl_topo_t {
+    int      ncpus;
+    uint32_t cap[THRCTL_MAX_CPUS]; // relative capacity, 0 if not present
+    uint64_t present;
+    uint64_t little;
+    uint64_t big;
+    int      one;
+};
+
+/**
+ * parses a sysfs cpu list such as "0-3,6" into `mask`, leaving out cpus
+ * past `THRCTL_MAX_CPUS`
+ */
+extern int thrctl_parse_cpus (const char *_Nonnull s,
+                              uint64_t *_Nonnull mask);
+
+/**
+ * reads the topology under `root`, `THRCTL_SYSFS` but for tests. capacity
+ * is `cpu_capacity` where the kernel has it, else the highest frequency.
+ */
+extern int thrctl_topo_read (struct thrctl_topo_t *_Nonnull topo,
+                             const char *_Nonnull root);
+
+/** @return the mask of `cores`, `THRCTL_ANY`, ... */
+extern uint64_t thrctl_cores (const struct thrctl_topo_t *_Nonnull topo,
+                              uint8_t cores);
+
+/**
+ * reads the topology `thrctl_apply` places threads on. before any threads
+ * start. without it, threads are only named and prioritized
+ */
+extern int thrctl_init (const char *_Nonnull root);
+
+/**
+ * names, places and prioritizes the calling thread for `role`. what it
+ * inherited from the thread that made it is replaced, a nice value of 0
+ * included.
+ *
+ * @return what was done, `THRCTL_NAMED` | ..., or `THRCTL_ERR` for an
+ * unknown role
+ */
+extern int thrctl_apply (int role);
+
+#endif // !THRCTL_H
@@ -0,0 +1,241 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "timing.h"
+
+#define RELAXED memory_order_relaxed
+
+/** adds to a counter only this thread writes, without a locked add */
+static inline void
+bump (_Atomic uint64_t *a, uint64_t v)
+{
+    atomic_store_explicit (a, atomic_load_explicit (a, RELAXED) + v, RELAXED);
+}
+
+static void
+hist_add (struct timing_hist_t *h, uint64_t ns)
+{
+    const uint64_t us = ns / 1000;
+    unsigned       b  = us == 0 ? 0 : 64 - __builtin_clzll (us);
+
+    if (b >= TIMING_NBUCKETS)
+        b = TIMING_NBUCKETS - 1;
+
+    atomic_store_explicit (&h->n[b],
+                           atomic_load_explicit (&h->n[b], RELAXED) + 1,
+                           RELAXED);
+    bump (&h->count, 1);
+    bump (&h->sum_ns, ns);
+
+    if (ns > atomic_load_explicit (&h->max_ns, RELAXED))
+        atomic_store_explicit (&h->max_ns, ns, RELAXED);
+}
+
+void
+timing_init (struct timing_t *this)
+{
+    memset (this, 0, sizeof *this);
+}
+
+void
+timing_stream (struct timing_t *this, uint32_t sample_rate, int32_t burst)
+{
+    this->sample_rate = sample_rate;
+    this->burst_ns    = sample_rate > 0 && burst > 0
+                            ? (uint64_t)burst * 1000000000 / sample_rate
+                            : 0;
+    this->sample_ns   = 0;
+    timing_restart (this);
+}
+
+void
+timing_restart (struct timing_t *this)
+{
+    atomic_store_explicit (&this->last_ns, 0, RELAXED);
+}
+
+void
+timing_burst (struct timing_t *this, uint64_t now_ns)
+{
+    const uint64_t last = atomic_load_explicit (&this->last_ns, RELAXED);
+
+    atomic_store_explicit (&this->last_ns, now_ns, RELAXED);
+
+    if (last == 0 || now_ns < last)
+        return;
+
+    const uint64_t p = now_ns - last;
+
+    hist_add (&this->period, p);
+    hist_add (&this->jitter,
+              p > this->burst_ns ? p - this->burst_ns : this->burst_ns - p);
+}
+
+void
+timing_cb (struct timing_t *this, uint64_t start_ns, uint64_t end_ns)
+{
+    timing_burst (this, start_ns);
+    hist_add (&this->cb, end_ns > start_ns ? end_ns - start_ns : 0);
+}
+
+bool
+timing_due (struct timing_t *this, uint64_t now_ns)
+{
+    if (this->sample_ns != 0
+        && now_ns - this->sample_ns < TIMING_SAMPLE_MS * 1000000ull)
+        return false;
+
+    this->sample_ns = now_ns;
+
+    return true;
+}
+
+void
+timing_latency (struct timing_t *this, int64_t ring, int64_t written,
+                int64_t read, int64_t frames, int64_t ts_ns, uint64_t now_ns)
+{
+    const int64_t rate = this->sample_rate;
+
+    if (rate == 0)
+        return;
+
+    // what the device presents now, and what is queued up to it
+    const int64_t presented
+        = frames + ((int64_t)now_ns - ts_ns) * rate / 1000000000;
+    int64_t q   = written - presented;
+    int64_t buf = written - read;
+
+    if (q < 0)
+        q = 0;
+
+    if (buf > q)
+        buf = q;
+    else if (buf < 0)
+        buf = 0;
+
+    if (ring < 0)
+        ring = 0;
+
+    const int64_t ring_ns = ring * 1000000000 / rate;
+    const int64_t buf_ns  = buf * 1000000000 / rate;
+    const int64_t dev_ns  = (q - buf) * 1000000000 / rate;
+    const int64_t lat     = ring_ns + buf_ns + dev_ns;
+    const uint64_t n = atomic_load_explicit (&this->nsamples, RELAXED);
+
+    atomic_store_explicit (&this->ring_ns, ring_ns, RELAXED);
+    atomic_store_explicit (&this->buf_ns, buf_ns, RELAXED);
+    atomic_store_explicit (&this->dev_ns, dev_ns, RELAXED);
+
+    if (n == 0 || lat < atomic_load_explicit (&this->lat_min_ns, RELAXED))
+        atomic_store_explicit (&this->lat_min_ns, lat, RELAXED);
+
+    if (n == 0 || lat > atomic_load_explicit (&this->lat_max_ns, RELAXED))
+        atomic_store_explicit (&this->lat_max_ns, lat, RELAXED);
+
+    atomic_store_explicit (
+        &this->lat_sum_ns,
+        atomic_load_explicit (&this->lat_sum_ns, RELAXED) + lat, RELAXED);
+    atomic_store_explicit (&this->nsamples, n + 1, RELAXED);
+}
+
+uint64_t
+timing_pct (const struct timing_hist_t *h, unsigned pct)
+{
+    const uint64_t count = atomic_load_explicit (&h->count, RELAXED);
+    const uint64_t max   = atomic_load_explicit (&h->max_ns, RELAXED);
+
+    if (count == 0)
+        return 0;
+
+    uint64_t target = (count * pct + 99) / 100;
+    uint64_t cum    = 0;
+
+    if (target == 0)
+        target = 1;
+
+    for (unsigned b = 0; b < TIMING_NBUCKETS; ++b) {
+        const uint64_t n = atomic_load_explicit (&h->n[b], RELAXED);
+
+        if (n > 0 && cum + n >= target) {
+            const uint64_t lo = b > 0 ? 1000ull << (b - 1) : 0;
+            const uint64_t hi
+                = b < TIMING_NBUCKETS - 1 ? 1000ull << b : max;
+            const uint64_t v
+                = hi > lo ? lo + (hi - lo) * (target - cum) / n : lo;
+
+            return v < max ? v : max;
+        }
+
+        cum += n;
+    }
+
+    // a reader racing the writer may see fewer in the buckets
+    return max;
+}
+
+static inline uint64_t
+mean (const struct timing_hist_t *h)
+{
+    const uint64_t n = atomic_load_explicit (&h->count, RELAXED);
+
+    return n > 0 ? atomic_load_explicit (&h->sum_ns, RELAXED) / n : 0;
+}
+
+void
+timing_stats (const struct timing_t *this, struct timing_stats_t *stats)
+{
+    stats->bursts      = atomic_load_explicit (&this->period.count, RELAXED);
+    stats->period_mean = mean (&this->period);
+    stats->period_p99  = timing_pct (&this->period, 99);
+    stats->jitter_p50  = timing_pct (&this->jitter, 50);
+    stats->jitter_p99  = timing_pct (&this->jitter, 99);
+    stats->jitter_max  = atomic_load_explicit (&this->jitter.max_ns, RELAXED);
+
+    stats->callbacks = atomic_load_explicit (&this->cb.count, RELAXED);
+    stats->cb_mean   = mean (&this->cb);
+    stats->cb_p99    = timing_pct (&this->cb, 99);
+    stats->cb_max    = atomic_load_explicit (&this->cb.max_ns, RELAXED);
+
+    stats->samples = atomic_load_explicit (&this->nsamples, RELAXED);
+    stats->ring    = atomic_load_explicit (&this->ring_ns, RELAXED);
+    stats->buf     = atomic_load_explicit (&this->buf_ns, RELAXED);
+    stats->dev     = atomic_load_explicit (&this->dev_ns, RELAXED);
+    stats->latency = stats->ring + stats->buf + stats->dev;
+    stats->latency_min = atomic_load_explicit (&this->lat_min_ns, RELAXED);
+    stats->latency_max = atomic_load_explicit (&this->lat_max_ns, RELAXED);
+    stats->latency_mean
+        = stats->samples > 0
+              ? atomic_load_explicit (&this->lat_sum_ns, RELAXED)
+                    / (int64_t)stats->samples
+              : 0;
+}
+
+int
+timing_summary (const struct timing_stats_t *stats, char *buf, size_t siz)
+{
+    int n = snprintf (
+        buf, siz,
+        "latency %.1f ms (ring %.1f, buffer %.1f, device %.1f; %.1f..%.1f, "
+        "mean %.1f), period %.2f ms (p99 %.2f, jitter p50 %.0f us, p99 "
+        "%.0f us, max %.0f us)",
+        stats->latency / 1e6, stats->ring / 1e6, stats->buf / 1e6,
+        stats->dev / 1e6, stats->latency_min / 1e6, stats->latency_max / 1e6,
+        stats->latency_mean / 1e6, stats->period_mean / 1e6,
+        stats->period_p99 / 1e6, stats->jitter_p50 / 1e3,
+        stats->jitter_p99 / 1e3, stats->jitter_max / 1e3);
+
+    if (stats->callbacks > 0 && n >= 0) {
+        const size_t off = (size_t)n < siz ? (size_t)n : siz;
+
+        n += snprintf (buf + off, siz - off,
+                       ", callback %.0f us (p99 %.0f, max %.0f)",
+                       stats->cb_mean / 1e3, stats->cb_p99 / 1e3,
+                       stats->cb_max / 1e3);
+    }
+
+    return n;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * output timing. keeps log2 histograms of the time between bursts handed to
+ * the sink, of how far that strays from the burst period, and of time spent
+ * in the data callback, plus the output latency from samples of the sink's
+ * frame counters and timestamp.
+ *
+ * every counter has one writer and is read relaxed, so `timing_stats` can
+ * be called from any thread while playback runs, and a burst costs a few
+ * loads and stores.
+ */
+
+/**
+ * bucket 0 holds times under 1 us, bucket `i` those from 2^(i-1) us up to
+ * 2^i us, and the last everything longer
+ */
+#define TIMING_NBUCKETS 20
+
+/** latency is sampled at most this often */
+#define TIMING_SAMPLE_MS 100
+
+/**
+ * cost of recording a burst and a callback, kept to 0.01% of a 4 ms burst.
+ * bench_timing.c checks it
+ */
+#define TIMING_BUDGET_NS 400
+
+struct timing_hist_t {
+    _Atomic uint32_t n[TIMING_NBUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+};
+
+struct timing_t {
+    uint32_t         sample_rate;
+    uint64_t         burst_ns; // nominal period
+    _Atomic uint64_t last_ns;  // last burst, 0 after a gap
+    uint64_t         sample_ns;
+
+    struct timing_hist_t period; // between bursts
+    struct timing_hist_t jitter; // |period - `burst_ns`|
+    struct timing_hist_t cb;     // inside the callback
+
+    // latency samples, in ns
+    _Atomic uint64_t nsamples;
+    _Atomic int64_t  ring_ns; // the last one's parts
+    _Atomic int64_t  buf_ns;
+    _Atomic int64_t  dev_ns;
+    _Atomic int64_t  lat_min_ns;
+    _Atomic int64_t  lat_max_ns;
+    _Atomic int64_t  lat_sum_ns;
+};
+
+/** a snapshot, all times in ns */
+struct timing_stats_t {
+    uint64_t bursts; // periods measured
+    uint64_t period_mean;
+    uint64_t period_p99;
+    uint64_t jitter_p50;
+    uint64_t jitter_p99;
+    uint64_t jitter_max;
+
+    uint64_t callbacks;
+    uint64_t cb_mean;
+    uint64_t cb_p99;
+    uint64_t cb_max;
+
+    /**
+     * the last sample: a frame handed over now waits `ring` ahead of the
+     * sink, `buf` in its buffer and `dev` past its read pointer until heard
+     */
+    uint64_t samples;
+    int64_t  latency;
+    int64_t  ring;
+    int64_t  buf;
+    int64_t  dev;
+    int64_t  latency_min;
+    int64_t  latency_mean;
+    int64_t  latency_max;
+};
+
+/** empty, before any thread uses `this` */
+extern void timing_init (struct timing_t *_Nonnull this);
+
+/**
+ * a stream opened, with `burst` frames per burst at `sample_rate`. the
+ * counters carry on; the gap since the last burst is not a period.
+ */
+extern void timing_stream (struct timing_t *_Nonnull this,
+                           uint32_t sample_rate, int32_t burst);
+
+/** the next burst follows a pause, so no period ends there */
+extern void timing_restart (struct timing_t *_Nonnull this);
+
+/** a burst went to the sink at `now_ns`. one writer at a time */
+extern void timing_burst (struct timing_t *_Nonnull this, uint64_t now_ns);
+
+/** a callback ran from `start_ns` to `end_ns`. a burst too */
+extern void timing_cb (struct timing_t *_Nonnull this, uint64_t start_ns,
+                       uint64_t end_ns);
+
+/** @return whether a latency sample is due, starting the next interval */
+extern bool timing_due (struct timing_t *_Nonnull this, uint64_t now_ns);
+
+/**
+ * records a latency sample taken at `now_ns`: `ring` frames wait ahead of
+ * the sink, which counts `written` frames taken and `read` given to the
+ * device, and presented frame `frames` at `ts_ns`
+ */
+extern void timing_latency (struct timing_t *_Nonnull this, int64_t ring,
+                            int64_t written, int64_t read, int64_t frames,
+                            int64_t ts_ns, uint64_t now_ns);
+
+/** @return the time below which `pct`% of `h` fall, interpolated */
+extern uint64_t timing_pct (const struct timing_hist_t *_Nonnull h,
+                            unsigned pct);
+
+extern void timing_stats (const struct timing_t *_Nonnull this,
+                          struct timing_stats_t *_Nonnull stats);
+
+/**
+ * formats `stats` as one line for the log.
+ *
+ * @return `snprintf`'s
+ */
+extern int timing_summary (const struct timing_stats_t *_Nonnull stats,
+                           char *_Nonnull buf, size_t siz);
+
+#endif // !TIMING_H
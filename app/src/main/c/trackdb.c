@@ -0,0 +1,368 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logging.h"
+#include "trackdb.h"
+
+static const char *FILENAME = "trackdb.c";
+
+/** "NCDB" */
+#define TRACKDB_MAGIC TRACKDB_TAG ('N', 'C', 'D', 'B')
+
+struct trackdb_rec_t {
+    uint64_t key;
+    uint32_t tag;
+    uint16_t ver;
+    uint16_t len;
+    uint8_t *_Nullable data;
+};
+
+/** on-disk record header, followed by `len` bytes of data */
+struct trackdb_hdr_t {
+    uint64_t key;
+    uint32_t tag;
+    uint16_t ver;
+    uint16_t len;
+};
+
+static struct trackdb_rec_t *recs = NULL;
+static size_t                recs_siz;
+static size_t                recs_cap;
+static bool                  dirty;
+static char                 *path     = NULL;
+static char                 *path_tmp = NULL; // written, then renamed over
+
+pthread_mutex_t trackdb_mx = PTHREAD_MUTEX_INITIALIZER;
+
+/** over the file, so `trackdb_mx` is not held across the write */
+static pthread_mutex_t write_mx = PTHREAD_MUTEX_INITIALIZER;
+
+#define TRACKDB_LOCK_MX                                                       \
+    do {                                                                      \
+        if ((pth_ret = pthread_mutex_lock (&trackdb_mx)) != 0) {              \
+            logwf ("WARN: could not lock trackdb_mx. Error code %d: %s",      \
+                   pth_ret, strerror (pth_ret));                              \
+            return TRACKDB_ETHRD;                                             \
+        }                                                                     \
+    } while (0);
+
+#define TRACKDB_UNLOCK_MX                                                     \
+    do {                                                                      \
+        pthread_mutex_unlock (&trackdb_mx);                                   \
+    } while (0);
+
+static struct trackdb_rec_t *
+find (uint64_t key, uint32_t tag)
+{
+    for (size_t i = 0; i < recs_siz; ++i)
+        if (recs[i].key == key && recs[i].tag == tag)
+            return &recs[i];
+
+    return NULL;
+}
+
+/** @return new uninitialized record at the back, NULL on allocation failure */
+static struct trackdb_rec_t *
+append (void)
+{
+    if (recs_siz == recs_cap) {
+        const size_t          cap = recs_cap ? recs_cap << 1 : 16;
+        struct trackdb_rec_t *tmp = realloc (recs, cap * sizeof *recs);
+
+        if (tmp == NULL)
+            return NULL;
+
+        recs     = tmp;
+        recs_cap = cap;
+    }
+
+    return &recs[recs_siz++];
+}
+
+static int
+load (FILE *fp)
+{
+    uint32_t magic;
+
+    if (fread (&magic, sizeof magic, 1, fp) != 1 || magic != TRACKDB_MAGIC) {
+        logw ("WARN: bad trackdb magic. starting empty");
+        return TRACKDB_OK;
+    }
+
+    struct trackdb_hdr_t hdr;
+
+    while (fread (&hdr, sizeof hdr, 1, fp) == 1) {
+        struct trackdb_rec_t *rec = append ();
+
+        if (rec == NULL)
+            return TRACKDB_EMEM;
+
+        rec->key  = hdr.key;
+        rec->tag  = hdr.tag;
+        rec->ver  = hdr.ver;
+        rec->len  = hdr.len;
+        rec->data = malloc (hdr.len);
+
+        if (rec->data == NULL) {
+            --recs_siz;
+            return TRACKDB_EMEM;
+        }
+
+        if (fread (rec->data, 1, hdr.len, fp) != hdr.len) {
+            logw ("WARN: truncated trackdb record. dropping it");
+            free (rec->data);
+            --recs_siz;
+            break;
+        }
+    }
+
+    return TRACKDB_OK;
+}
+
+int
+trackdb_init (const char *fn)
+{
+    recs_siz = 0;
+    dirty    = false;
+
+    const size_t len = strlen (fn);
+
+    if ((path = strdup (fn)) == NULL
+        || (path_tmp = malloc (len + sizeof ".tmp")) == NULL)
+        return TRACKDB_EMEM;
+
+    memcpy (path_tmp, fn, len);
+    memcpy (path_tmp + len, ".tmp", sizeof ".tmp");
+
+    FILE *fp = fopen (fn, "rb");
+
+    if (fp == NULL) {
+        logif ("no trackdb at `%s'. starting empty", fn);
+        return TRACKDB_OK;
+    }
+
+    const int ret = load (fp);
+    fclose (fp);
+
+    logif ("loaded %zu trackdb records", recs_siz);
+
+    return ret;
+}
+
+int
+trackdb_deinit (void)
+{
+    const int ret = trackdb_write ();
+
+    while (recs_siz)
+        free (recs[--recs_siz].data);
+
+    free (recs);
+    free (path);
+    free (path_tmp);
+    recs     = NULL;
+    recs_cap = 0;
+    path     = NULL;
+    path_tmp = NULL;
+
+    return ret;
+}
+
+/**
+ * @return the file's bytes, magic and records, in a new buffer of `*siz`.
+ * NULL on allocation failure. `trackdb_mx` is held
+ */
+static uint8_t *
+serialize (size_t *siz)
+{
+    const uint32_t magic = TRACKDB_MAGIC;
+
+    *siz = sizeof magic;
+
+    for (size_t i = 0; i < recs_siz; ++i)
+        *siz += sizeof (struct trackdb_hdr_t) + recs[i].len;
+
+    uint8_t *const buf = malloc (*siz);
+    uint8_t       *p   = buf;
+
+    if (buf == NULL)
+        return NULL;
+
+    memcpy (p, &magic, sizeof magic);
+    p += sizeof magic;
+
+    for (size_t i = 0; i < recs_siz; ++i) {
+        const struct trackdb_hdr_t hdr = {
+            .key = recs[i].key,
+            .tag = recs[i].tag,
+            .ver = recs[i].ver,
+            .len = recs[i].len,
+        };
+
+        memcpy (p, &hdr, sizeof hdr);
+        memcpy (p + sizeof hdr, recs[i].data, recs[i].len);
+        p += sizeof hdr + recs[i].len;
+    }
+
+    return buf;
+}
+
+int
+trackdb_write (void)
+{
+    int      pth_ret;
+    int      ret = TRACKDB_OK;
+    size_t   siz = 0;
+    uint8_t *buf = NULL;
+
+    pthread_mutex_lock (&write_mx);
+
+    if ((pth_ret = pthread_mutex_lock (&trackdb_mx)) != 0) {
+        logwf ("WARN: could not lock trackdb_mx. Error code %d: %s", pth_ret,
+               strerror (pth_ret));
+        ret = TRACKDB_ETHRD;
+        goto exit;
+    }
+
+    // the records are copied out, so a put or get never waits on the disk
+    if (dirty && path != NULL) {
+        if ((buf = serialize (&siz)) == NULL)
+            ret = TRACKDB_EMEM;
+        else
+            dirty = false;
+    }
+
+    TRACKDB_UNLOCK_MX;
+
+    if (buf == NULL)
+        goto exit;
+
+    // a kill mid-write leaves the last whole file
+    FILE *fp = fopen (path_tmp, "wb");
+
+    if (fp == NULL) {
+        logef ("ERROR: could not open trackdb `%s' for wb: %s", path_tmp,
+               strerror (errno));
+        ret = TRACKDB_ERR;
+    } else if (fwrite (buf, 1, siz, fp) != siz) {
+        logef ("ERROR: could not write trackdb: %s", strerror (errno));
+        fclose (fp);
+        ret = TRACKDB_ERR;
+    } else if (fclose (fp) == EOF) {
+        logef ("ERROR: could not close trackdb: %s", strerror (errno));
+        ret = TRACKDB_ERR;
+    } else if (rename (path_tmp, path) != 0) {
+        logef ("ERROR: could not rename trackdb to `%s': %s", path,
+               strerror (errno));
+        ret = TRACKDB_ERR;
+    }
+
+    free (buf);
+
+    // tried again on the next write
+    if (ret != TRACKDB_OK) {
+        pthread_mutex_lock (&trackdb_mx);
+        dirty = true;
+        pthread_mutex_unlock (&trackdb_mx);
+    }
+
+exit:
+    pthread_mutex_unlock (&write_mx);
+    return ret;
+}
+
+uint64_t
+trackdb_key (const char *str)
+{
+    uint64_t h = 0xcbf29ce484222325;
+
+    for (; *str; ++str) {
+        h ^= (uint8_t)*str;
+        h *= 0x100000001b3;
+    }
+
+    return h;
+}
+
+int
+trackdb_put (uint64_t key, uint32_t tag, uint16_t ver, const void *data,
+             uint16_t len)
+{
+    int pth_ret;
+    int ret = TRACKDB_OK;
+
+    TRACKDB_LOCK_MX;
+
+    struct trackdb_rec_t *rec = find (key, tag);
+
+    // the same record again is no change to write back
+    if (rec != NULL && rec->ver == ver && rec->len == len
+        && (len == 0 || memcmp (rec->data, data, len) == 0))
+        goto exit;
+
+    if (rec == NULL) {
+        if ((rec = append ()) == NULL) {
+            ret = TRACKDB_EMEM;
+            goto exit;
+        }
+
+        rec->key  = key;
+        rec->tag  = tag;
+        rec->ver  = ver;
+        rec->len  = 0;
+        rec->data = NULL;
+    }
+
+    if (rec->len != len) {
+        uint8_t *tmp = realloc (rec->data, len);
+
+        if (tmp == NULL) {
+            ret = TRACKDB_EMEM;
+            goto exit;
+        }
+
+        rec->data = tmp;
+        rec->len  = len;
+    }
+
+    rec->ver = ver;
+    memcpy (rec->data, data, len);
+    dirty = true;
+
+exit:
+    TRACKDB_UNLOCK_MX;
+    return ret;
+}
+
+int
+trackdb_get (uint64_t key, uint32_t tag, uint16_t ver, void *data,
+             uint16_t len)
+{
+    int pth_ret;
+    int ret;
+
+    TRACKDB_LOCK_MX;
+
+    const struct trackdb_rec_t *rec = find (key, tag);
+
+    if (rec == NULL) {
+        ret = TRACKDB_ENOENT;
+    } else if (rec->ver != ver) {
+        ret = TRACKDB_EVER;
+    } else {
+        ret = rec->len < len ? rec->len : len;
+        memcpy (data, rec->data, ret);
+    }
+
+    TRACKDB_UNLOCK_MX;
+    return ret;
+}
+
+#undef TRACKDB_LOCK_MX
+#undef TRACKDB_UNLOCK_MX
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef TRACKDB_H
+#define TRACKDB_H
+
+#include <stdint.h>
+
+/**
+ * small persistent key-value store for per-track data (trim points, analysis
+ * results, ...). records are keyed by track and tag and carry a version so
+ * readers can reject stale layouts.
+ *
+ * the whole database is kept in memory and written back on
+ * `trackdb_write`/`trackdb_deinit`. the app calls `trackdb_write` from its
+ * save thread every `NCAP_AUDIO_POS_SAVE_MS`, as it is seldom closed
+ * cleanly.
+ */
+
+#define TRACKDB_EVER   -5
+#define TRACKDB_ENOENT -4
+#define TRACKDB_ETHRD  -3
+#define TRACKDB_EMEM   -2
+#define TRACKDB_ERR    -1
+#define TRACKDB_OK     0
+
+#define TRACKDB_TAG(a, b, c, d)                                               \
+    ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16                 \
+     | (uint32_t)(d) << 24)
+
+/** not thread safe. loads `fn` if it exists */
+extern int trackdb_init (const char *_Nonnull fn);
+
+/** not thread safe. writes back if modified and frees everything */
+extern int trackdb_deinit (void);
+
+/**
+ * writes the database back if it was modified since the last write. the
+ * file is replaced whole, and puts and gets do not wait on it
+ */
+extern int trackdb_write (void);
+
+/** FNV-1a of `path` */
+extern uint64_t trackdb_key (const char *_Nonnull path);
+
+/**
+ * inserts or replaces the record for (`key`, `tag`). the same record again
+ * leaves nothing to write back
+ */
+extern int trackdb_put (uint64_t key, uint32_t tag, uint16_t ver,
+                        const void *_Nonnull data, uint16_t len);
+
+/**
+ * copies at most `len` bytes of the record for (`key`, `tag`) into `data`.
+ *
+ * @return bytes copied, `TRACKDB_ENOENT` if there is no record, or
+ * `TRACKDB_EVER` if the record has a different version
+ */
+extern int trackdb_get (uint64_t key, uint32_t tag, uint16_t ver,
+                        void *_Nonnull data, uint16_t len);
+
+#endif // !TRACKDB_H